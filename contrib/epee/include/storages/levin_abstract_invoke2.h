@@ -214,6 +214,24 @@ namespace epee
       return cb(command, in_struct, context);
     }
 
+    template<class t_owner, class t_in_type, class t_context, class callback_t>
+    int buff_to_t_adapter_with_buff(t_owner* powner, int command, const std::string& in_buff, callback_t cb, t_context& context)
+    {
+      serialization::portable_storage strg;
+      if(!strg.load_from_binary(in_buff))
+      {
+        LOG_ERROR("Failed to load_from_binary in notify " << command);
+        return -1;
+      }
+      boost::value_initialized<t_in_type> in_struct;
+      if (!static_cast<t_in_type&>(in_struct).load(strg))
+      {
+        LOG_ERROR("Failed to load in_struct in notify " << command);
+        return -1;
+      }
+      return cb(command, in_struct, in_buff, context);
+    }
+
 #define CHAIN_LEVIN_INVOKE_MAP2(context_type) \
   int invoke(int command, const std::string& in_buff, std::string& buff_out, context_type& context) \
   { \
@@ -271,6 +289,11 @@ namespace epee
   if(is_notify && NOTIFY::ID == command) \
   {handled=true;return epee::net_utils::buff_to_t_adapter<internal_owner_type_name, typename NOTIFY::request>(this, command, in_buff, boost::bind(func, this, _1, _2, _3), context);}
 
+//same as HANDLE_NOTIFY_T2, but the handler also gets the original buffer, e.g. to relay it as is
+#define HANDLE_NOTIFY_T2_WITH_BUFF(NOTIFY, func) \
+  if(is_notify && NOTIFY::ID == command) \
+  {handled=true;return epee::net_utils::buff_to_t_adapter_with_buff<internal_owner_type_name, typename NOTIFY::request>(this, command, in_buff, boost::bind(func, this, _1, _2, _3, _4), context);}
+
 
 #define CHAIN_INVOKE_MAP2(func) \
   { \
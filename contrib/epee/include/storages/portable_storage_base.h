@@ -32,6 +32,7 @@
 #include <boost/any.hpp>
 #include <string>
 #include <list>
+#include <map>
 
 #define PORTABLE_STORAGE_SIGNATUREA 0x01011101
 #define PORTABLE_STORAGE_SIGNATUREB 0x01020101 // bender's nightmare 
@@ -1555,6 +1555,49 @@ public:
    */
   virtual uint64_t get_database_size() const = 0;
 
+  /**
+   * @brief get statistics of the output key cache, if the backend has one
+   *
+   * @param hits return-by-reference the number of lookups served by the cache
+   * @param misses return-by-reference the number of lookups which went to the db
+   * @param size return-by-reference the number of outputs cached
+   *
+   * @return false if the backend does not cache output keys
+   */
+  virtual bool get_output_cache_stats(uint64_t &hits, uint64_t &misses, uint64_t &size) const { return false; }
+
+  /**
+   * @brief get the pruning seed of the blockchain
+   *
+   * @return the seed, 0 if the blockchain is not pruned
+   */
+  virtual uint32_t get_blockchain_pruning_seed() const = 0;
+
+  /**
+   * @brief prune the prunable data of blocks out of the seed's stripe
+   *
+   * Blocks in the last CRYPTONOTE_PRUNING_TIP_BLOCKS are never pruned.
+   *
+   * @param pruning_seed the seed to prune with, 0 to keep the current one or pick a random stripe
+   *
+   * @return true on success, false if the blockchain is already pruned with another seed
+   */
+  virtual bool prune_blockchain(uint32_t pruning_seed = 0) = 0;
+
+  /**
+   * @brief prune blocks which left the tip since the last pruning, no-op if not pruned
+   *
+   * @return true on success
+   */
+  virtual bool update_pruning() = 0;
+
+  /**
+   * @brief check that exactly the blocks out of the seed's stripe are pruned
+   *
+   * @return true if consistent
+   */
+  virtual bool check_pruning() = 0;
+
   // TODO: this should perhaps be (or call) a series of functions which
   // progressively update through version updates
   /**
@@ -0,0 +1,242 @@
+// Copyright (c) 2019, The Graft Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include <cstring>
+#include <fstream>
+#include <boost/filesystem.hpp>
+#include <boost/thread/locks.hpp>
+#include "misc_log_ex.h"
+#include "key_image_filter.h"
+
+#undef MONERO_DEFAULT_LOG_CATEGORY
+#define MONERO_DEFAULT_LOG_CATEGORY "blockchain.db"
+
+namespace
+{
+  const char FILTER_MAGIC[8] = {'K', 'I', 'F', 'I', 'L', 'T', 'E', 'R'};
+  const uint32_t FILTER_VERSION = 2;
+  // magic, version, top block hash, key image count, size, word count
+  const uint64_t FILTER_HEADER_SIZE = sizeof(FILTER_MAGIC) + sizeof(uint32_t) + sizeof(crypto::hash) + 3 * sizeof(uint64_t);
+
+  inline uint64_t read_le64(const unsigned char *p)
+  {
+    uint64_t v = 0;
+    for (int i = 7; i >= 0; --i)
+      v = (v << 8) | p[i];
+    return v;
+  }
+}
+
+namespace cryptonote
+{
+
+constexpr size_t key_image_filter::WORDS_PER_BLOCK;
+constexpr uint64_t key_image_filter::BITS_PER_KEY_IMAGE;
+constexpr uint64_t key_image_filter::MIN_BLOCKS;
+
+key_image_filter::key_image_filter(): m_block_mask(0), m_size(0)
+{
+}
+
+void key_image_filter::reset(uint64_t n_key_images)
+{
+  uint64_t blocks = MIN_BLOCKS;
+  while (blocks * WORDS_PER_BLOCK * 64 < n_key_images * BITS_PER_KEY_IMAGE)
+    blocks <<= 1;
+
+  boost::unique_lock<boost::shared_mutex> lock(m_lock);
+  m_words.assign(blocks * WORDS_PER_BLOCK, 0);
+  m_block_mask = blocks - 1;
+  m_size = 0;
+}
+
+void key_image_filter::clear()
+{
+  boost::unique_lock<boost::shared_mutex> lock(m_lock);
+  std::vector<uint64_t>().swap(m_words);
+  m_block_mask = 0;
+  m_size = 0;
+}
+
+void key_image_filter::insert(const crypto::key_image &ki)
+{
+  const unsigned char *bytes = (const unsigned char*)&ki;
+  const uint64_t block = read_le64(bytes);
+
+  boost::unique_lock<boost::shared_mutex> lock(m_lock);
+  if (m_words.empty())
+    return;
+  uint64_t *words = m_words.data() + (block & m_block_mask) * WORDS_PER_BLOCK;
+  for (size_t i = 0; i < WORDS_PER_BLOCK; ++i)
+    words[i] |= 1ull << (bytes[8 + i] & 63);
+  ++m_size;
+}
+
+bool key_image_filter::may_contain(const crypto::key_image &ki) const
+{
+  const unsigned char *bytes = (const unsigned char*)&ki;
+  const uint64_t block = read_le64(bytes);
+
+  boost::shared_lock<boost::shared_mutex> lock(m_lock);
+  if (m_words.empty())
+    return true;
+  const uint64_t *words = m_words.data() + (block & m_block_mask) * WORDS_PER_BLOCK;
+  for (size_t i = 0; i < WORDS_PER_BLOCK; ++i)
+    if (!(words[i] & (1ull << (bytes[8 + i] & 63))))
+      return false;
+  return true;
+}
+
+bool key_image_filter::enabled() const
+{
+  boost::shared_lock<boost::shared_mutex> lock(m_lock);
+  return !m_words.empty();
+}
+
+uint64_t key_image_filter::size() const
+{
+  boost::shared_lock<boost::shared_mutex> lock(m_lock);
+  return m_size;
+}
+
+bool key_image_filter::full() const
+{
+  boost::shared_lock<boost::shared_mutex> lock(m_lock);
+  return !m_words.empty() && m_size * BITS_PER_KEY_IMAGE > m_words.size() * 64;
+}
+
+void key_image_filter::swap(key_image_filter &other)
+{
+  if (&other == this)
+    return;
+  boost::unique_lock<boost::shared_mutex> lock(m_lock, boost::defer_lock);
+  boost::unique_lock<boost::shared_mutex> other_lock(other.m_lock, boost::defer_lock);
+  boost::lock(lock, other_lock);
+  m_words.swap(other.m_words);
+  std::swap(m_block_mask, other.m_block_mask);
+  std::swap(m_size, other.m_size);
+}
+
+bool key_image_filter::store(const std::string &filename, const crypto::hash &top_block_hash, uint64_t n_key_images) const
+{
+  boost::shared_lock<boost::shared_mutex> lock(m_lock);
+  if (m_words.empty())
+    return false;
+
+  std::ofstream f(filename, std::ios::binary | std::ios::trunc);
+  if (!f)
+  {
+    MWARNING("Failed to open " << filename << " for writing");
+    return false;
+  }
+  const uint64_t n_words = m_words.size();
+  const crypto::hash checksum = crypto::cn_fast_hash(m_words.data(), n_words * sizeof(uint64_t));
+  f.write(FILTER_MAGIC, sizeof(FILTER_MAGIC));
+  f.write((const char*)&FILTER_VERSION, sizeof(FILTER_VERSION));
+  f.write((const char*)&top_block_hash, sizeof(top_block_hash));
+  f.write((const char*)&n_key_images, sizeof(n_key_images));
+  f.write((const char*)&m_size, sizeof(m_size));
+  f.write((const char*)&n_words, sizeof(n_words));
+  f.write((const char*)m_words.data(), n_words * sizeof(uint64_t));
+  f.write((const char*)&checksum, sizeof(checksum));
+  f.close();
+  if (!f)
+  {
+    MWARNING("Failed to write " << filename);
+    return false;
+  }
+  return true;
+}
+
+bool key_image_filter::load(const std::string &filename, const crypto::hash &top_block_hash, uint64_t n_key_images)
+{
+  boost::system::error_code ec;
+  const uint64_t file_size = boost::filesystem::file_size(filename, ec);
+  if (ec)
+    return false;
+  std::ifstream f(filename, std::ios::binary);
+  if (!f)
+    return false;
+
+  char magic[sizeof(FILTER_MAGIC)];
+  uint32_t version = 0;
+  crypto::hash file_top_block_hash;
+  uint64_t file_key_images = 0, size = 0, n_words = 0;
+  f.read(magic, sizeof(magic));
+  f.read((char*)&version, sizeof(version));
+  f.read((char*)&file_top_block_hash, sizeof(file_top_block_hash));
+  f.read((char*)&file_key_images, sizeof(file_key_images));
+  f.read((char*)&size, sizeof(size));
+  f.read((char*)&n_words, sizeof(n_words));
+  if (!f || memcmp(magic, FILTER_MAGIC, sizeof(magic)) || version != FILTER_VERSION)
+  {
+    MWARNING("Ignoring invalid key image filter " << filename);
+    return false;
+  }
+  if (file_top_block_hash != top_block_hash || file_key_images != n_key_images)
+  {
+    MDEBUG("Key image filter " << filename << " is stale");
+    return false;
+  }
+  const uint64_t blocks = n_words / WORDS_PER_BLOCK;
+  if (n_words % WORDS_PER_BLOCK || blocks < MIN_BLOCKS || (blocks & (blocks - 1)))
+  {
+    MWARNING("Ignoring invalid key image filter " << filename);
+    return false;
+  }
+  // checked before allocating, the word count may be garbage
+  if (n_words > (file_size - FILTER_HEADER_SIZE) / sizeof(uint64_t) || file_size - FILTER_HEADER_SIZE != n_words * sizeof(uint64_t) + sizeof(crypto::hash))
+  {
+    MWARNING("Ignoring key image filter " << filename << " of wrong size");
+    return false;
+  }
+  std::vector<uint64_t> words(n_words);
+  crypto::hash checksum;
+  f.read((char*)words.data(), n_words * sizeof(uint64_t));
+  f.read((char*)&checksum, sizeof(checksum));
+  if (!f)
+  {
+    MWARNING("Ignoring truncated key image filter " << filename);
+    return false;
+  }
+  // a cleared bit would be a false negative, so don't trust a damaged file
+  if (crypto::cn_fast_hash(words.data(), n_words * sizeof(uint64_t)) != checksum)
+  {
+    MWARNING("Ignoring corrupt key image filter " << filename);
+    return false;
+  }
+
+  boost::unique_lock<boost::shared_mutex> lock(m_lock);
+  m_words.swap(words);
+  m_block_mask = blocks - 1;
+  m_size = size;
+  return true;
+}
+
+}
@@ -0,0 +1,121 @@
+// Copyright (c) 2019, The Graft Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <boost/thread/shared_mutex.hpp>
+#include "crypto/crypto.h"
+#include "crypto/hash.h"
+
+namespace cryptonote
+{
+
+/**
+ * @brief a split block Bloom filter over spent key images
+ *
+ * Each key image maps to one 512 bit block, in which it sets one bit in each
+ * of the eight 64 bit words. Key images are uniformly distributed already, so
+ * their bytes are used directly instead of hashing them. Key images cannot be
+ * removed: after a pop the filter only gets more false positives, until it is
+ * rebuilt. All methods are thread safe.
+ */
+class key_image_filter
+{
+public:
+  key_image_filter();
+
+  /**
+   * @brief empties the filter, sizing it for a number of key images
+   *
+   * @param n_key_images the number of key images to size for
+   */
+  void reset(uint64_t n_key_images);
+
+  /**
+   * @brief empties and disables the filter, may_contain then always returns true
+   */
+  void clear();
+
+  void insert(const crypto::key_image &ki);
+
+  /**
+   * @return false if the key image was never inserted, true if it may have been
+   */
+  bool may_contain(const crypto::key_image &ki) const;
+
+  bool enabled() const;
+
+  /**
+   * @return the number of key images inserted
+   */
+  uint64_t size() const;
+
+  /**
+   * @return true if more key images were inserted than the filter was sized for
+   */
+  bool full() const;
+
+  void swap(key_image_filter &other);
+
+  /**
+   * @brief writes the filter to a file
+   *
+   * @param filename the file to write to
+   * @param top_block_hash the top block hash of the key images the filter holds
+   * @param n_key_images the number of key images the filter holds
+   *
+   * @return true on success
+   */
+  bool store(const std::string &filename, const crypto::hash &top_block_hash, uint64_t n_key_images) const;
+
+  /**
+   * @brief reads the filter from a file, if it is intact and was written for the same set of key images
+   *
+   * @param filename the file to read from
+   * @param top_block_hash the current top block hash
+   * @param n_key_images the current number of key images
+   *
+   * @return true if the filter was loaded
+   */
+  bool load(const std::string &filename, const crypto::hash &top_block_hash, uint64_t n_key_images);
+
+private:
+  static constexpr size_t WORDS_PER_BLOCK = 8;
+  static constexpr uint64_t BITS_PER_KEY_IMAGE = 16;
+  static constexpr uint64_t MIN_BLOCKS = 1024;
+
+  mutable boost::shared_mutex m_lock;
+  std::vector<uint64_t> m_words;
+  uint64_t m_block_mask;
+  uint64_t m_size;
+};
+
+}
@@ -37,6 +37,7 @@
 #include "string_tools.h"
 #include "file_io_utils.h"
 #include "common/util.h"
+#include "common/pruning.h"
 #include "cryptonote_basic/cryptonote_format_utils.h"
 #include "crypto/crypto.h"
 #include "profile_tools.h"
@@ -889,11 +890,16 @@ void BlockchainLMDB::remove_transaction_data(const crypto::hash& tx_hash, const
   if (result)
       throw1(DB_ERROR(lmdb_error("Failed to add removal of pruned tx to db transaction: ", result).c_str()));
 
-  if ((result = mdb_cursor_get(m_cur_txs_prunable, &val_tx_id, NULL, MDB_SET)))
+  // prunable data is gone if the tx was pruned
+  result = mdb_cursor_get(m_cur_txs_prunable, &val_tx_id, NULL, MDB_SET);
+  if (result == 0)
+  {
+    result = mdb_cursor_del(m_cur_txs_prunable, 0);
+    if (result)
+        throw1(DB_ERROR(lmdb_error("Failed to add removal of prunable tx to db transaction: ", result).c_str()));
+  }
+  else if (result != MDB_NOTFOUND)
       throw1(DB_ERROR(lmdb_error("Failed to locate prunable tx for removal: ", result).c_str()));
-  result = mdb_cursor_del(m_cur_txs_prunable, 0);
-  if (result)
-      throw1(DB_ERROR(lmdb_error("Failed to add removal of prunable tx to db transaction: ", result).c_str()));
 
   if (tx.version > 1)
   {
@@ -1070,6 +1076,9 @@ void BlockchainLMDB::remove_output(const uint64_t amount, const uint64_t& out_in
   result = mdb_cursor_del(m_cur_output_amounts, 0);
   if (result)
     throw0(DB_ERROR(lmdb_error(std::string("Error deleting amount for output index ").append(boost::lexical_cast<std::string>(out_index).append(": ")).c_str(), result).c_str()));
+
+  // readers which started before this txn commits must not cache the output again
+  m_output_cache.remove(amount, out_index, mdb_txn_id(m_write_txn->m_txn));
 }
 
 void BlockchainLMDB::add_spent_key(const crypto::key_image& k_image)
@@ -1087,6 +1096,11 @@ void BlockchainLMDB::add_spent_key(const crypto::key_image& k_image)
     else
       throw1(DB_ERROR(lmdb_error("Error adding spent key image to db transaction: ", result).c_str()));
   }
+
+  // added before the txn commits, so the filter is always a superset of what readers can see
+  m_key_image_filter.insert(k_image);
+  if (m_key_image_filter.full())
+    rebuild_key_image_filter(2 * m_key_image_filter.size());
 }
 
 void BlockchainLMDB::remove_spent_key(const crypto::key_image& k_image)
@@ -1397,6 +1411,8 @@ void BlockchainLMDB::open(const std::string& filename, const int db_flags)
   txn.commit();
 
   m_open = true;
+
+  init_key_image_filter();
   // from here, init should be finished
 }
 
@@ -1409,6 +1425,9 @@ void BlockchainLMDB::close()
     batch_abort();
   }
   this->sync();
+  store_key_image_filter();
+  m_key_image_filter.clear();
+  m_output_cache.clear();
   m_tinfo.reset();
 
   // FIXME: not yet thread safe!!!  Use with care.
@@ -1481,9 +1500,12 @@ void BlockchainLMDB::reset()
   if (auto result = mdb_put(txn, m_properties, &k, &v, 0))
     throw0(DB_ERROR(lmdb_error("Failed to write version to database: ", result).c_str()));
 
+  const uint64_t txn_id = mdb_txn_id(txn.m_txn);
   txn.commit();
   m_cum_size = 0;
   m_cum_count = 0;
+  m_key_image_filter.reset(0);
+  m_output_cache.clear(txn_id);
 }
 
 std::vector<std::string> BlockchainLMDB::get_filenames() const
@@ -2478,6 +2500,10 @@ output_data_t BlockchainLMDB::get_output_key(const uint64_t& amount, const uint6
   LOG_PRINT_L3("BlockchainLMDB::" << __func__);
   check_open();
 
+  output_data_t ret;
+  if (m_output_cache.get(amount, index, ret))
+    return ret;
+
   TXN_PREFIX_RDONLY();
   RCURSOR(output_amounts);
 
@@ -2489,7 +2515,6 @@ output_data_t BlockchainLMDB::get_output_key(const uint64_t& amount, const uint6
   else if (get_result)
     throw0(DB_ERROR("Error attempting to retrieve an output pubkey from the db"));
 
-  output_data_t ret;
   if (amount == 0)
   {
     const outkey *okp = (const outkey *)v.mv_data;
@@ -2501,6 +2526,9 @@ output_data_t BlockchainLMDB::get_output_key(const uint64_t& amount, const uint6
     memcpy(&ret, &okp->data, sizeof(pre_rct_output_data_t));;
     ret.commitment = rct::zeroCommit(amount);
   }
+  // the write txn may see outputs which are not committed yet, only cache from read txns
+  if (m_cursors != &m_wcursors)
+    m_output_cache.put(amount, index, ret, mdb_txn_id(m_txn));
   TXN_POSTFIX_RDONLY();
   return ret;
 }
@@ -2584,6 +2612,10 @@ bool BlockchainLMDB::has_key_image(const crypto::key_image& img) const
   LOG_PRINT_L3("BlockchainLMDB::" << __func__);
   check_open();
 
+  // most key images looked up are not spent, and the filter answers those
+  if (!m_key_image_filter.may_contain(img))
+    return false;
+
   bool ret;
 
   TXN_PREFIX_RDONLY();
@@ -2596,6 +2628,68 @@ bool BlockchainLMDB::has_key_image(const crypto::key_image& img) const
   return ret;
 }
 
+uint64_t BlockchainLMDB::get_num_key_images() const
+{
+  LOG_PRINT_L3("BlockchainLMDB::" << __func__);
+  check_open();
+
+  TXN_PREFIX_RDONLY();
+  int result;
+
+  MDB_stat db_stats;
+  if ((result = mdb_stat(m_txn, m_spent_keys, &db_stats)))
+    throw0(DB_ERROR(lmdb_error("Failed to query m_spent_keys: ", result).c_str()));
+
+  TXN_POSTFIX_RDONLY();
+
+  return db_stats.ms_entries;
+}
+
+void BlockchainLMDB::init_key_image_filter()
+{
+  LOG_PRINT_L3("BlockchainLMDB::" << __func__);
+
+  const uint64_t n_key_images = get_num_key_images();
+  const std::string filename = (boost::filesystem::path(m_folder) / CRYPTONOTE_KEY_IMAGE_FILTER_FILENAME).string();
+  if (m_key_image_filter.load(filename, top_block_hash(), n_key_images))
+  {
+    MINFO("Loaded key image filter for " << n_key_images << " key images from " << filename);
+    return;
+  }
+  rebuild_key_image_filter(n_key_images);
+}
+
+void BlockchainLMDB::rebuild_key_image_filter(uint64_t n_key_images)
+{
+  LOG_PRINT_L3("BlockchainLMDB::" << __func__);
+
+  TIME_MEASURE_START(t);
+  // built aside and swapped in, so lookups meanwhile still use the old one (or none)
+  key_image_filter filter;
+  filter.reset(n_key_images);
+  for_all_key_images([&filter](const crypto::key_image &ki) { filter.insert(ki); return true; });
+  m_key_image_filter.swap(filter);
+  TIME_MEASURE_FINISH(t);
+  MINFO("Built key image filter for " << m_key_image_filter.size() << " key images in " << t << " ms");
+}
+
+void BlockchainLMDB::store_key_image_filter() const
+{
+  LOG_PRINT_L3("BlockchainLMDB::" << __func__);
+  if (is_read_only() || !m_key_image_filter.enabled())
+    return;
+
+  try
+  {
+    const std::string filename = (boost::filesystem::path(m_folder) / CRYPTONOTE_KEY_IMAGE_FILTER_FILENAME).string();
+    m_key_image_filter.store(filename, top_block_hash(), get_num_key_images());
+  }
+  catch (const std::exception &e)
+  {
+    MWARNING("Failed to store key image filter: " << e.what());
+  }
+}
+
 bool BlockchainLMDB::for_all_key_images(std::function<bool(const crypto::key_image&)> f) const
 {
   LOG_PRINT_L3("BlockchainLMDB::" << __func__);
@@ -3185,14 +3279,33 @@ void BlockchainLMDB::get_output_key(const uint64_t &amount, const std::vector<ui
   TIME_MEASURE_START(db3);
   check_open();
   outputs.clear();
+  outputs.reserve(offsets.size());
+
+  // a read txn is only needed from the first output which isn't cached
+  output_data_t data;
+  size_t i = 0;
+  while (i < offsets.size() && m_output_cache.get(amount, offsets[i], data))
+  {
+    outputs.push_back(data);
+    ++i;
+  }
+  if (i == offsets.size())
+    return;
 
   TXN_PREFIX_RDONLY();
 
   RCURSOR(output_amounts);
 
+  const bool cache_outputs = m_cursors != &m_wcursors;
   MDB_val_set(k, amount);
-  for (const uint64_t &index : offsets)
+  for (const size_t first_miss = i; i < offsets.size(); ++i)
   {
+    const uint64_t index = offsets[i];
+    if (i != first_miss && m_output_cache.get(amount, index, data))
+    {
+      outputs.push_back(data);
+      continue;
+    }
     MDB_val_set(v, index);
 
     auto get_result = mdb_cursor_get(m_cur_output_amounts, &k, &v, MDB_GET_BOTH);
@@ -3208,7 +3321,6 @@ void BlockchainLMDB::get_output_key(const uint64_t &amount, const std::vector<ui
     else if (get_result)
       throw0(DB_ERROR(lmdb_error("Error attempting to retrieve an output pubkey from the db", get_result).c_str()));
 
-    output_data_t data;
     if (amount == 0)
     {
       const outkey *okp = (const outkey *)v.mv_data;
@@ -3220,6 +3332,8 @@ void BlockchainLMDB::get_output_key(const uint64_t &amount, const std::vector<ui
       memcpy(&data, &okp->data, sizeof(pre_rct_output_data_t));
       data.commitment = rct::zeroCommit(amount);
     }
+    if (cache_outputs)
+      m_output_cache.put(amount, index, data, mdb_txn_id(m_txn));
     outputs.push_back(data);
   }
 
@@ -3486,6 +3600,226 @@ uint64_t BlockchainLMDB::get_database_size() const
   return size;
 }
 
+bool BlockchainLMDB::get_output_cache_stats(uint64_t &hits, uint64_t &misses, uint64_t &size) const
+{
+  hits = m_output_cache.hits();
+  misses = m_output_cache.misses();
+  size = m_output_cache.size();
+  return true;
+}
+
+uint32_t BlockchainLMDB::get_blockchain_pruning_seed() const
+{
+  LOG_PRINT_L3("BlockchainLMDB::" << __func__);
+  check_open();
+
+  TXN_PREFIX_RDONLY();
+  MDB_val_copy<const char*> k("pruning_seed");
+  MDB_val v;
+  int result = mdb_get(m_txn, m_properties, &k, &v);
+  if (result == MDB_NOTFOUND)
+    return 0;
+  if (result)
+    throw0(DB_ERROR(lmdb_error("Failed to retrieve pruning seed: ", result).c_str()));
+  if (v.mv_size != sizeof(uint32_t))
+    throw0(DB_ERROR("Failed to retrieve or create pruning seed: unexpected value size"));
+  uint32_t pruning_seed;
+  memcpy(&pruning_seed, v.mv_data, sizeof(pruning_seed));
+  TXN_POSTFIX_RDONLY();
+  return pruning_seed;
+}
+
+bool BlockchainLMDB::prune_blockchain(uint32_t pruning_seed)
+{
+  return prune_worker(prune_mode_prune, pruning_seed);
+}
+
+bool BlockchainLMDB::update_pruning()
+{
+  return prune_worker(prune_mode_update, 0);
+}
+
+bool BlockchainLMDB::check_pruning()
+{
+  return prune_worker(prune_mode_check, 0);
+}
+
+bool BlockchainLMDB::prune_worker(prune_mode mode, uint32_t pruning_seed)
+{
+  LOG_PRINT_L3("BlockchainLMDB::" << __func__);
+  check_open();
+
+  if (m_batch_active || m_write_txn)
+  {
+    // incremental pruning is retried later, blocks are being added now
+    if (mode == prune_mode_update)
+      MDEBUG("Pruning postponed while a batch or block write is in progress");
+    else
+      MERROR("Pruning can't run while a batch or block write is in progress");
+    return false;
+  }
+
+  const uint32_t log_stripes = tools::get_pruning_log_stripes(pruning_seed);
+  if (log_stripes && log_stripes != CRYPTONOTE_PRUNING_LOG_STRIPES)
+    throw0(DB_ERROR("Pruning seed not in range"));
+  if (pruning_seed && tools::get_pruning_stripe(pruning_seed) > (1u << CRYPTONOTE_PRUNING_LOG_STRIPES))
+    throw0(DB_ERROR("Pruning seed not in range"));
+
+  const uint32_t db_pruning_seed = get_blockchain_pruning_seed();
+  if (mode == prune_mode_prune)
+  {
+    if (db_pruning_seed && pruning_seed && pruning_seed != db_pruning_seed)
+    {
+      MERROR("Blockchain is already pruned with seed " << db_pruning_seed << ", can't prune with " << pruning_seed);
+      return false;
+    }
+    if (!pruning_seed)
+      pruning_seed = db_pruning_seed ? db_pruning_seed : tools::make_pruning_seed(tools::get_random_stripe(), CRYPTONOTE_PRUNING_LOG_STRIPES);
+  }
+  else
+  {
+    pruning_seed = db_pruning_seed;
+    if (!pruning_seed)
+      return true;
+  }
+
+  if (need_resize())
+  {
+    LOG_PRINT_L0("LMDB memory map needs to be resized, doing that now.");
+    do_resize();
+  }
+
+  mdb_txn_safe txn;
+  int result = mdb_txn_begin(m_env, NULL, mode == prune_mode_check ? MDB_RDONLY : 0, txn);
+  if (result)
+    throw0(DB_ERROR(lmdb_error("Failed to create a transaction for the db: ", result).c_str()));
+
+  MDB_stat db_stats;
+  if ((result = mdb_stat(txn, m_blocks, &db_stats)))
+    throw0(DB_ERROR(lmdb_error("Failed to query m_blocks: ", result).c_str()));
+  const uint64_t blockchain_height = db_stats.ms_entries;
+
+  // heights below pruning_height were already processed, their stripe never changes
+  MDB_val_copy<const char*> k_seed("pruning_seed");
+  MDB_val_copy<const char*> k_height("pruning_height");
+  uint64_t pruning_height = 0;
+  MDB_val v;
+  result = mdb_get(txn, m_properties, &k_height, &v);
+  if (result == 0 && v.mv_size == sizeof(uint64_t))
+    memcpy(&pruning_height, v.mv_data, sizeof(pruning_height));
+  else if (result && result != MDB_NOTFOUND)
+    throw0(DB_ERROR(lmdb_error("Failed to retrieve pruning height: ", result).c_str()));
+
+  const uint64_t end_height = blockchain_height > CRYPTONOTE_PRUNING_TIP_BLOCKS ? blockchain_height - CRYPTONOTE_PRUNING_TIP_BLOCKS : 0;
+  uint64_t height = mode == prune_mode_update ? pruning_height : 0;
+  if (mode == prune_mode_check)
+    MGINFO("Checking blockchain pruning, seed " << pruning_seed << ", up to height " << pruning_height);
+  else if (mode == prune_mode_prune)
+    MGINFO("Pruning blockchain with seed " << pruning_seed << ", " << end_height << " blocks to check");
+  const uint64_t last_height = mode == prune_mode_check ? std::min(pruning_height, end_height) : end_height;
+
+  uint64_t n_pruned = 0, n_bad = 0;
+  MDB_cursor *c_blocks, *c_tx_indices, *c_txs_prunable;
+  bool cursors_open = false;
+  for (; height < last_height; ++height)
+  {
+    if (!cursors_open)
+    {
+      if ((result = mdb_cursor_open(txn, m_blocks, &c_blocks)))
+        throw0(DB_ERROR(lmdb_error("Failed to open a cursor for blocks: ", result).c_str()));
+      if ((result = mdb_cursor_open(txn, m_tx_indices, &c_tx_indices)))
+        throw0(DB_ERROR(lmdb_error("Failed to open a cursor for tx_indices: ", result).c_str()));
+      if ((result = mdb_cursor_open(txn, m_txs_prunable, &c_txs_prunable)))
+        throw0(DB_ERROR(lmdb_error("Failed to open a cursor for txs_prunable: ", result).c_str()));
+      cursors_open = true;
+    }
+
+    const bool keep = tools::has_unpruned_block(height, blockchain_height, pruning_seed);
+    if (keep && mode != prune_mode_check)
+      continue;
+
+    MDB_val_set(k_block, height);
+    MDB_val v_block;
+    if ((result = mdb_cursor_get(c_blocks, &k_block, &v_block, MDB_SET)))
+      throw0(DB_ERROR(lmdb_error("Failed to get a block for pruning: ", result).c_str()));
+    block b;
+    if (!parse_and_validate_block_from_blob(blobdata((const char*)v_block.mv_data, v_block.mv_size), b))
+      throw0(DB_ERROR("Failed to parse block from blob retrieved from the db"));
+
+    std::vector<crypto::hash> tx_hashes(b.tx_hashes);
+    tx_hashes.push_back(get_transaction_hash(b.miner_tx));
+    for (const crypto::hash &tx_hash: tx_hashes)
+    {
+      MDB_val_set(v_tx, tx_hash);
+      if ((result = mdb_cursor_get(c_tx_indices, (MDB_val *)&zerokval, &v_tx, MDB_GET_BOTH)))
+        throw0(DB_ERROR(lmdb_error("Failed to get tx index for pruning: ", result).c_str()));
+      const txindex *ti = (const txindex *)v_tx.mv_data;
+      MDB_val_set(k_tx_id, ti->data.tx_id);
+      result = mdb_cursor_get(c_txs_prunable, &k_tx_id, NULL, MDB_SET);
+      if (result && result != MDB_NOTFOUND)
+        throw0(DB_ERROR(lmdb_error("Failed to get prunable tx data: ", result).c_str()));
+      const bool have = result == 0;
+
+      if (mode == prune_mode_check)
+      {
+        if (have != keep)
+        {
+          MERROR("Block " << height << " tx " << tx_hash << (keep ? " lost its prunable data" : " was not pruned"));
+          ++n_bad;
+        }
+      }
+      else if (have)
+      {
+        if ((result = mdb_cursor_del(c_txs_prunable, 0)))
+          throw0(DB_ERROR(lmdb_error("Failed to delete prunable tx data: ", result).c_str()));
+        ++n_pruned;
+      }
+    }
+
+    // commit every stripe, deleted pages are reused by the next ones
+    if (mode != prune_mode_check && (height + 1) % CRYPTONOTE_PRUNING_STRIPE_SIZE == 0)
+    {
+      MDB_val_copy<uint64_t> v_height(height + 1);
+      if ((result = mdb_put(txn, m_properties, &k_height, &v_height, 0)))
+        throw0(DB_ERROR(lmdb_error("Failed to save pruning height: ", result).c_str()));
+      txn.commit();
+      cursors_open = false;
+      MGINFO("Pruned up to height " << height + 1 << "/" << last_height << ", " << n_pruned << " txes pruned");
+      if (need_resize())
+      {
+        LOG_PRINT_L0("LMDB memory map needs to be resized, doing that now.");
+        do_resize();
+      }
+      if ((result = mdb_txn_begin(m_env, NULL, 0, txn)))
+        throw0(DB_ERROR(lmdb_error("Failed to create a transaction for the db: ", result).c_str()));
+    }
+  }
+
+  if (mode == prune_mode_check)
+  {
+    if (cursors_open)
+    {
+      mdb_cursor_close(c_blocks);
+      mdb_cursor_close(c_tx_indices);
+      mdb_cursor_close(c_txs_prunable);
+    }
+    txn.commit();
+    MGINFO("Pruning check done, " << n_bad << " inconsistencies");
+    return n_bad == 0;
+  }
+
+  MDB_val_copy<uint32_t> v_seed(pruning_seed);
+  if ((result = mdb_put(txn, m_properties, &k_seed, &v_seed, 0)))
+    throw0(DB_ERROR(lmdb_error("Failed to save pruning seed: ", result).c_str()));
+  MDB_val_copy<uint64_t> v_height(std::max(pruning_height, end_height));
+  if ((result = mdb_put(txn, m_properties, &k_height, &v_height, 0)))
+    throw0(DB_ERROR(lmdb_error("Failed to save pruning height: ", result).c_str()));
+  txn.commit();
+  if (mode == prune_mode_prune || n_pruned)
+    MGINFO("Blockchain pruned up to height " << end_height << ", " << n_pruned << " txes pruned");
+  return true;
+}
+
 void BlockchainLMDB::fixup()
 {
   LOG_PRINT_L3("BlockchainLMDB::" << __func__);
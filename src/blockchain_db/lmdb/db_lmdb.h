@@ -29,6 +29,8 @@
 #include <atomic>
 
 #include "blockchain_db/blockchain_db.h"
+#include "blockchain_db/key_image_filter.h"
+#include "blockchain_db/output_cache.h"
 #include "cryptonote_basic/blobdatatype.h" // for type blobdata
 #include "ringct/rctTypes.h"
 #include <boost/thread/tss.hpp>
@@ -244,6 +246,7 @@ public:
 
   virtual output_data_t get_output_key(const uint64_t& amount, const uint64_t& index);
   virtual void get_output_key(const uint64_t &amount, const std::vector<uint64_t> &offsets, std::vector<output_data_t> &outputs, bool allow_partial = false);
+  virtual bool get_output_cache_stats(uint64_t &hits, uint64_t &misses, uint64_t &size) const;
 
   virtual tx_out_index get_output_tx_and_index_from_global(const uint64_t& index) const;
   virtual void get_output_tx_and_index_from_global(const std::vector<uint64_t> &global_indices,
@@ -309,6 +312,11 @@ public:
 
   bool get_output_distribution(uint64_t amount, uint64_t from_height, uint64_t to_height, std::vector<uint64_t> &distribution, uint64_t &base) const;
 
+  virtual uint32_t get_blockchain_pruning_seed() const;
+  virtual bool prune_blockchain(uint32_t pruning_seed = 0);
+  virtual bool update_pruning();
+  virtual bool check_pruning();
+
 private:
   void do_resize(uint64_t size_increase=0);
 
@@ -381,6 +389,16 @@ private:
 
   virtual uint64_t get_database_size() const;
 
+  enum prune_mode { prune_mode_prune, prune_mode_update, prune_mode_check };
+  bool prune_worker(prune_mode mode, uint32_t pruning_seed);
+
+  uint64_t get_num_key_images() const;
+
+  // loads the key image filter from its file, or builds it from the spent keys table
+  void init_key_image_filter();
+  void rebuild_key_image_filter(uint64_t n_key_images);
+  void store_key_image_filter() const;
+
   // fix up anything that may be wrong due to past bugs
   virtual void fixup();
 
@@ -438,6 +456,12 @@ private:
   mdb_txn_cursors m_wcursors;
   mutable boost::thread_specific_ptr<mdb_threadinfo> m_tinfo;
 
+  // spent key images, so most has_key_image lookups don't need to hit m_spent_keys
+  key_image_filter m_key_image_filter;
+
+  // recently looked up output keys, mostly ring members
+  output_cache m_output_cache;
+
 #if defined(__arm__)
   // force a value so it can compile with 32-bit ARM
   constexpr static uint64_t DEFAULT_MAPSIZE = 1LL << 31;
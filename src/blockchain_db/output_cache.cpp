@@ -0,0 +1,154 @@
+// Copyright (c) 2019, The Graft Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include <algorithm>
+#include <boost/thread/locks.hpp>
+#include "output_cache.h"
+
+namespace cryptonote
+{
+
+constexpr size_t output_cache::SHARDS;
+constexpr size_t output_cache::WAYS;
+
+output_cache::output_cache(size_t max_size):
+  m_min_generation(0),
+  m_hits(0),
+  m_misses(0)
+{
+  const size_t sets = std::max<size_t>(max_size / (SHARDS * WAYS), 1);
+  for (shard_t &shard: m_shards)
+  {
+    shard.sets.resize(sets);
+    for (set_t &set: shard.sets)
+      std::fill(set.last_used, set.last_used + WAYS, 0);
+    shard.clock = 0;
+    shard.size = 0;
+  }
+}
+
+int output_cache::find(const set_t &set, const key_t &key)
+{
+  for (size_t i = 0; i < WAYS; ++i)
+    if (set.last_used[i] && set.keys[i] == key)
+      return i;
+  return -1;
+}
+
+bool output_cache::get(uint64_t amount, uint64_t index, output_data_t &data)
+{
+  const key_t key{amount, index};
+  const uint64_t h = hash(key);
+  shard_t &shard = get_shard(h);
+  {
+    boost::lock_guard<boost::mutex> lock(shard.lock);
+    set_t &set = get_set(shard, h);
+    const int way = find(set, key);
+    if (way >= 0)
+    {
+      set.last_used[way] = ++shard.clock;
+      data = set.data[way];
+      ++m_hits;
+      return true;
+    }
+  }
+  ++m_misses;
+  return false;
+}
+
+void output_cache::put(uint64_t amount, uint64_t index, const output_data_t &data, uint64_t generation)
+{
+  const key_t key{amount, index};
+  const uint64_t h = hash(key);
+  shard_t &shard = get_shard(h);
+  boost::lock_guard<boost::mutex> lock(shard.lock);
+  // checked under the shard lock, so either remove() sees this entry, or this sees its generation
+  if (generation < m_min_generation)
+    return;
+  set_t &set = get_set(shard, h);
+  int way = find(set, key);
+  if (way < 0)
+  {
+    // free ways have the lowest last_used, so they are picked first
+    way = std::min_element(set.last_used, set.last_used + WAYS) - set.last_used;
+    if (!set.last_used[way])
+      ++shard.size;
+    set.keys[way] = key;
+    set.data[way] = data;
+  }
+  set.last_used[way] = ++shard.clock;
+}
+
+void output_cache::remove(uint64_t amount, uint64_t index, uint64_t generation)
+{
+  raise_min_generation(generation);
+  const key_t key{amount, index};
+  const uint64_t h = hash(key);
+  shard_t &shard = get_shard(h);
+  boost::lock_guard<boost::mutex> lock(shard.lock);
+  set_t &set = get_set(shard, h);
+  const int way = find(set, key);
+  if (way >= 0)
+  {
+    set.last_used[way] = 0;
+    --shard.size;
+  }
+}
+
+void output_cache::clear(uint64_t generation)
+{
+  m_min_generation = generation;
+  for (shard_t &shard: m_shards)
+  {
+    boost::lock_guard<boost::mutex> lock(shard.lock);
+    for (set_t &set: shard.sets)
+      std::fill(set.last_used, set.last_used + WAYS, 0);
+    shard.size = 0;
+  }
+}
+
+uint64_t output_cache::size() const
+{
+  uint64_t size = 0;
+  for (const shard_t &shard: m_shards)
+  {
+    boost::lock_guard<boost::mutex> lock(shard.lock);
+    size += shard.size;
+  }
+  return size;
+}
+
+void output_cache::raise_min_generation(uint64_t generation)
+{
+  uint64_t current = m_min_generation;
+  while (current < generation && !m_min_generation.compare_exchange_weak(current, generation))
+    ;
+}
+
+}
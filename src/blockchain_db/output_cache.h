@@ -0,0 +1,132 @@
+// Copyright (c) 2019, The Graft Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#pragma once
+
+#include <atomic>
+#include <vector>
+#include <boost/thread/mutex.hpp>
+#include "blockchain_db/blockchain_db.h"
+#include "cryptonote_config.h"
+
+namespace cryptonote
+{
+
+/**
+ * @brief a sharded LRU cache of output keys, by amount and amount index
+ *
+ * Ring members are mostly picked among recent outputs, so the same outputs
+ * are looked up over and over by pool, block and RPC code. The cache is set
+ * associative: an output can only go in one of the eight ways of one set,
+ * and the least recently used of those is evicted. Entries are stored inline,
+ * so a lookup touches a few adjacent cache lines instead of chasing list and
+ * hash map nodes.
+ *
+ * Entries are tagged with the generation (LMDB txn id) of the snapshot they
+ * were read from. Removing an output raises the oldest generation which may
+ * still be added, so a reader that started before a pop cannot put back an
+ * output the pop removed. All methods are thread safe.
+ */
+class output_cache
+{
+public:
+  /**
+   * @param max_size the number of outputs to keep, rounded down to a multiple of 128
+   */
+  output_cache(size_t max_size = DEFAULT_OUTPUT_CACHE_SIZE);
+
+  /**
+   * @brief looks up an output, counting a hit or a miss
+   *
+   * @return true if the output was cached
+   */
+  bool get(uint64_t amount, uint64_t index, output_data_t &data);
+
+  /**
+   * @brief adds an output read from a snapshot of the given generation
+   *
+   * The output is not added if it was removed at a later generation.
+   */
+  void put(uint64_t amount, uint64_t index, const output_data_t &data, uint64_t generation);
+
+  /**
+   * @brief drops an output, and refuses it from snapshots older than the given generation
+   */
+  void remove(uint64_t amount, uint64_t index, uint64_t generation);
+
+  /**
+   * @brief drops all outputs, and refuses any from snapshots older than the given generation
+   *
+   * Unlike remove(), this also lowers the generation, for when the db is closed.
+   */
+  void clear(uint64_t generation = 0);
+
+  uint64_t hits() const { return m_hits; }
+  uint64_t misses() const { return m_misses; }
+  uint64_t size() const;
+
+private:
+  static constexpr size_t SHARDS = 16;
+  static constexpr size_t WAYS = 8;
+
+  struct key_t
+  {
+    uint64_t amount;
+    uint64_t index;
+    bool operator==(const key_t &other) const { return amount == other.amount && index == other.index; }
+  };
+
+  struct set_t
+  {
+    key_t keys[WAYS];
+    uint64_t last_used[WAYS]; // 0 if the way is free
+    output_data_t data[WAYS];
+  };
+
+  struct shard_t
+  {
+    mutable boost::mutex lock;
+    std::vector<set_t> sets;
+    uint64_t clock;
+    uint64_t size;
+  };
+
+  static uint64_t hash(const key_t &key) { return key.index ^ (key.amount * 0x9e3779b97f4a7c15ull); }
+  shard_t &get_shard(uint64_t h) { return m_shards[h % SHARDS]; }
+  set_t &get_set(shard_t &shard, uint64_t h) { return shard.sets[(h / SHARDS) % shard.sets.size()]; }
+  static int find(const set_t &set, const key_t &key);
+  void raise_min_generation(uint64_t generation);
+
+  shard_t m_shards[SHARDS];
+  std::atomic<uint64_t> m_min_generation;
+  std::atomic<uint64_t> m_hits;
+  std::atomic<uint64_t> m_misses;
+};
+
+}
@@ -0,0 +1,221 @@
+// Copyright (c) 2019, The Graft Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include <boost/filesystem.hpp>
+#include "common/command_line.h"
+#include "common/pruning.h"
+#include "cryptonote_core/cryptonote_core.h"
+#include "blockchain_db/blockchain_db.h"
+#include "blockchain_db/db_types.h"
+#include "version.h"
+#include <lmdb.h>
+
+#undef MONERO_DEFAULT_LOG_CATEGORY
+#define MONERO_DEFAULT_LOG_CATEGORY "bcutil"
+
+namespace po = boost::program_options;
+using namespace epee;
+using namespace cryptonote;
+
+// LMDB never shrinks its file, so the freed pages are dropped by a compacting copy
+static bool compact_lmdb(const boost::filesystem::path &folder)
+{
+  const boost::filesystem::path compact_folder = folder.string() + "-compact";
+  boost::system::error_code ec;
+  boost::filesystem::remove_all(compact_folder, ec);
+  if (!boost::filesystem::create_directories(compact_folder, ec))
+  {
+    MERROR("Failed to create " << compact_folder.string() << ": " << ec.message());
+    return false;
+  }
+
+  MDB_env *env;
+  int dbr = mdb_env_create(&env);
+  CHECK_AND_ASSERT_MES(!dbr, false, "Failed to create LMDB environment: " << mdb_strerror(dbr));
+  epee::misc_utils::auto_scope_leave_caller env_dtor = epee::misc_utils::create_scope_leave_handler([&](){ mdb_env_close(env); });
+  dbr = mdb_env_set_maxdbs(env, 32);
+  CHECK_AND_ASSERT_MES(!dbr, false, "Failed to set max env dbs: " << mdb_strerror(dbr));
+  dbr = mdb_env_open(env, folder.string().c_str(), MDB_RDONLY, 0664);
+  CHECK_AND_ASSERT_MES(!dbr, false, "Failed to open " << folder.string() << ": " << mdb_strerror(dbr));
+
+  LOG_PRINT_L0("Writing compacted copy to " << compact_folder.string() << " ...");
+  dbr = mdb_env_copy2(env, compact_folder.string().c_str(), MDB_CP_COMPACT);
+  CHECK_AND_ASSERT_MES(!dbr, false, "Failed to copy database: " << mdb_strerror(dbr));
+
+  const boost::filesystem::path datafile = folder / CRYPTONOTE_BLOCKCHAINDATA_FILENAME;
+  const uint64_t old_size = boost::filesystem::file_size(datafile);
+  boost::filesystem::rename(compact_folder / CRYPTONOTE_BLOCKCHAINDATA_FILENAME, datafile, ec);
+  if (ec)
+  {
+    MERROR("Failed to replace " << datafile.string() << ": " << ec.message());
+    return false;
+  }
+  boost::filesystem::remove_all(compact_folder, ec);
+  LOG_PRINT_L0("Database size: " << old_size / 1048576 << " MB -> " << boost::filesystem::file_size(datafile) / 1048576 << " MB");
+  return true;
+}
+
+int main(int argc, char* argv[])
+{
+  TRY_ENTRY();
+
+  epee::string_tools::set_module_name_and_folder(argv[0]);
+
+  std::string default_db_type = "lmdb";
+
+  std::string available_dbs = cryptonote::blockchain_db_types(", ");
+  available_dbs = "available: " + available_dbs;
+
+  const std::string pruning_seed_desc = "Stripe to keep, 1 to " + std::to_string(1 << CRYPTONOTE_PRUNING_LOG_STRIPES) + ", 0 for the current or a random one";
+
+  uint32_t log_level = 0;
+
+  tools::on_startup();
+
+  po::options_description desc_cmd_only("Command line options");
+  po::options_description desc_cmd_sett("Command line options and settings options");
+  const command_line::arg_descriptor<std::string> arg_log_level  = {"log-level",  "0-4 or categories", ""};
+  const command_line::arg_descriptor<std::string> arg_database = {
+    "database", available_dbs.c_str(), default_db_type
+  };
+  const command_line::arg_descriptor<uint32_t> arg_pruning_seed  = {"pruning-seed", pruning_seed_desc.c_str(), 0};
+  const command_line::arg_descriptor<bool> arg_check  = {"check", "Only check that the blockchain is pruned consistently", false};
+  const command_line::arg_descriptor<bool> arg_no_compact  = {"no-compact", "Don't shrink the database file after pruning", false};
+
+  command_line::add_arg(desc_cmd_sett, cryptonote::arg_data_dir);
+  command_line::add_arg(desc_cmd_sett, cryptonote::arg_testnet_on);
+  command_line::add_arg(desc_cmd_sett, cryptonote::arg_stagenet_on);
+  command_line::add_arg(desc_cmd_sett, arg_log_level);
+  command_line::add_arg(desc_cmd_sett, arg_database);
+  command_line::add_arg(desc_cmd_sett, arg_pruning_seed);
+  command_line::add_arg(desc_cmd_sett, arg_check);
+  command_line::add_arg(desc_cmd_sett, arg_no_compact);
+  command_line::add_arg(desc_cmd_only, command_line::arg_help);
+
+  po::options_description desc_options("Allowed options");
+  desc_options.add(desc_cmd_only).add(desc_cmd_sett);
+
+  po::variables_map vm;
+  bool r = command_line::handle_error_helper(desc_options, [&]()
+  {
+    auto parser = po::command_line_parser(argc, argv).options(desc_options);
+    po::store(parser.run(), vm);
+    po::notify(vm);
+    return true;
+  });
+  if (! r)
+    return 1;
+
+  if (command_line::get_arg(vm, command_line::arg_help))
+  {
+    std::cout << "Graft '" << GRAFT_RELEASE_NAME << "' (v" << GRAFT_VERSION_FULL << ")" << ENDL << ENDL;
+    std::cout << desc_options << std::endl;
+    return 1;
+  }
+
+  mlog_configure(mlog_get_default_log_path("graft-blockchain-prune.log"), true);
+  if (!command_line::is_arg_defaulted(vm, arg_log_level))
+    mlog_set_log(command_line::get_arg(vm, arg_log_level).c_str());
+  else
+    mlog_set_log(std::string(std::to_string(log_level) + ",bcutil:INFO").c_str());
+
+  LOG_PRINT_L0("Starting...");
+
+  std::string opt_data_dir = command_line::get_arg(vm, cryptonote::arg_data_dir);
+  const uint32_t opt_stripe = command_line::get_arg(vm, arg_pruning_seed);
+  const bool opt_check = command_line::get_arg(vm, arg_check);
+  const bool opt_compact = !command_line::get_arg(vm, arg_no_compact);
+
+  if (opt_stripe > (1u << CRYPTONOTE_PRUNING_LOG_STRIPES))
+  {
+    std::cerr << "Invalid pruning seed: " << opt_stripe << std::endl;
+    return 1;
+  }
+
+  std::string db_type = command_line::get_arg(vm, arg_database);
+  if (db_type != "lmdb")
+  {
+    std::cerr << "Only lmdb databases can be pruned" << std::endl;
+    return 1;
+  }
+
+  std::unique_ptr<BlockchainDB> db(new_db(db_type));
+  if (!db)
+  {
+    LOG_ERROR("Attempted to use non-existent database type: " << db_type);
+    return 1;
+  }
+
+  const boost::filesystem::path folder = boost::filesystem::path(opt_data_dir) / db->get_db_name();
+  LOG_PRINT_L0("Loading blockchain from folder " << folder.string() << " ...");
+  try
+  {
+    db->open(folder.string(), opt_check ? DBF_RDONLY : 0);
+  }
+  catch (const std::exception& e)
+  {
+    LOG_PRINT_L0("Error opening database: " << e.what());
+    return 1;
+  }
+  if (!db->is_open())
+    return 1;
+
+  if (opt_check)
+  {
+    const uint32_t pruning_seed = db->get_blockchain_pruning_seed();
+    if (!pruning_seed)
+    {
+      LOG_PRINT_L0("Blockchain is not pruned");
+      db->close();
+      return 0;
+    }
+    LOG_PRINT_L0("Blockchain is pruned, keeping stripe " << tools::get_pruning_stripe(pruning_seed));
+    r = db->check_pruning();
+    db->close();
+    return r ? 0 : 1;
+  }
+
+  const uint32_t pruning_seed = opt_stripe ? tools::make_pruning_seed(opt_stripe, CRYPTONOTE_PRUNING_LOG_STRIPES) : 0;
+  r = db->prune_blockchain(pruning_seed);
+  const uint32_t db_pruning_seed = db->get_blockchain_pruning_seed();
+  db->close();
+  if (!r)
+  {
+    LOG_ERROR("Failed to prune blockchain");
+    return 1;
+  }
+  LOG_PRINT_L0("Blockchain pruned, keeping stripe " << tools::get_pruning_stripe(db_pruning_seed) << " of " << (1 << CRYPTONOTE_PRUNING_LOG_STRIPES));
+
+  if (opt_compact && !compact_lmdb(folder))
+    return 1;
+
+  return 0;
+
+  CATCH_ENTRY("Pruning error", 1);
+}
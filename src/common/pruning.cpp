@@ -0,0 +1,103 @@
+// Copyright (c) 2019, The Graft Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include <algorithm>
+#include "misc_log_ex.h"
+#include "crypto/crypto.h"
+#include "cryptonote_config.h"
+#include "pruning.h"
+
+namespace tools
+{
+
+uint32_t make_pruning_seed(uint32_t stripe, uint32_t log_stripes)
+{
+  CHECK_AND_ASSERT_THROW_MES(log_stripes <= PRUNING_SEED_LOG_STRIPES_MASK, "log_stripes out of range");
+  CHECK_AND_ASSERT_THROW_MES(stripe > 0 && stripe <= (1ul << log_stripes), "stripe out of range");
+  return (log_stripes << PRUNING_SEED_LOG_STRIPES_SHIFT) | ((stripe - 1) << PRUNING_SEED_STRIPE_SHIFT);
+}
+
+uint32_t get_pruning_stripe(uint64_t block_height, uint64_t blockchain_height, uint32_t log_stripes)
+{
+  if (block_height + CRYPTONOTE_PRUNING_TIP_BLOCKS >= blockchain_height)
+    return 0;
+  return ((block_height / CRYPTONOTE_PRUNING_STRIPE_SIZE) & ((1ul << log_stripes) - 1)) + 1;
+}
+
+bool has_unpruned_block(uint64_t block_height, uint64_t blockchain_height, uint32_t pruning_seed)
+{
+  const uint32_t stripe = get_pruning_stripe(pruning_seed);
+  if (stripe == 0)
+    return true;
+  const uint32_t block_stripe = get_pruning_stripe(block_height, blockchain_height, get_pruning_log_stripes(pruning_seed));
+  return block_stripe == 0 || block_stripe == stripe;
+}
+
+uint64_t get_next_unpruned_block_height(uint64_t block_height, uint64_t blockchain_height, uint32_t pruning_seed)
+{
+  if (has_unpruned_block(block_height, blockchain_height, pruning_seed))
+    return block_height;
+
+  const uint64_t stripes = 1ull << get_pruning_log_stripes(pruning_seed);
+  const uint64_t cycle = CRYPTONOTE_PRUNING_STRIPE_SIZE * stripes;
+  const uint64_t stripe = get_pruning_stripe(pruning_seed) - 1;
+  uint64_t next = block_height / cycle * cycle + stripe * CRYPTONOTE_PRUNING_STRIPE_SIZE;
+  if (next < block_height)
+    next += cycle;
+
+  // the tip is kept by everyone, and it may start before the next own stripe
+  const uint64_t tip_start = blockchain_height - CRYPTONOTE_PRUNING_TIP_BLOCKS;
+  return std::min(next, tip_start);
+}
+
+uint64_t get_next_pruned_block_height(uint64_t block_height, uint64_t blockchain_height, uint32_t pruning_seed)
+{
+  const uint32_t stripe = get_pruning_stripe(pruning_seed);
+  if (stripe == 0)
+    return blockchain_height;
+  if (block_height + CRYPTONOTE_PRUNING_TIP_BLOCKS >= blockchain_height)
+    return blockchain_height;
+  if (!has_unpruned_block(block_height, blockchain_height, pruning_seed))
+    return block_height;
+
+  // own stripe, the next one is pruned unless it is in the tip
+  const uint64_t next = (block_height / CRYPTONOTE_PRUNING_STRIPE_SIZE + 1) * CRYPTONOTE_PRUNING_STRIPE_SIZE;
+  if (next + CRYPTONOTE_PRUNING_TIP_BLOCKS >= blockchain_height)
+    return blockchain_height;
+  if (get_pruning_log_stripes(pruning_seed) == 0)
+    return blockchain_height;
+  return next;
+}
+
+uint32_t get_random_stripe()
+{
+  return 1 + (crypto::rand<uint8_t>() & ((1 << CRYPTONOTE_PRUNING_LOG_STRIPES) - 1));
+}
+
+}
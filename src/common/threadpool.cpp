@@ -28,6 +28,7 @@
 #include "misc_log_ex.h"
 #include "common/threadpool.h"
 
+#include <algorithm>
 #include <cassert>
 #include <limits>
 #include <stdexcept>
@@ -46,7 +47,7 @@ threadpool::threadpool(unsigned int max_threads) : running(true), active(0) {
   max = max_threads ? max_threads : tools::get_max_concurrency();
   size_t i = max ? max - 1 : 0;
   while(i--) {
-    threads.push_back(boost::thread(attrs, boost::bind(&threadpool::run, this, false)));
+    threads.push_back(boost::thread(attrs, boost::bind(&threadpool::run, this, (waiter*)NULL)));
   }
 }
 
@@ -108,7 +109,7 @@ threadpool::waiter::~waiter()
 
 void threadpool::waiter::wait(threadpool *tpool) {
   if (tpool)
-    tpool->run(true);
+    tpool->run(this);
   boost::unique_lock<boost::mutex> lock(mt);
   while(num)
     cv.wait(lock);
@@ -126,21 +127,24 @@ void threadpool::waiter::dec() {
     cv.notify_all();
 }
 
-void threadpool::run(bool flush) {
+void threadpool::run(waiter *flush) {
   boost::unique_lock<boost::mutex> lock(mutex);
   while (running) {
     entry e;
-    while(queue.empty() && running)
+    // a waiting caller only runs its own tasks, it must not get stuck behind other callers' work
+    std::deque<entry>::iterator it = flush ? std::find_if(queue.begin(), queue.end(), [flush](const entry &e) { return e.wo == flush; }) : queue.begin();
+    while(it == queue.end() && running)
     {
       if (flush)
         return;
       has_work.wait(lock);
+      it = queue.begin();
     }
     if (!running) break;
 
     active++;
-    e = queue.front();
-    queue.pop_front();
+    e = std::move(*it);
+    queue.erase(it);
     lock.unlock();
     ++depth;
     is_leaf = e.leaf;
@@ -59,7 +59,7 @@ public:
     public:
     void inc();
     void dec();
-    void wait(threadpool *tpool);  //! Wait for a set of tasks to finish.
+    void wait(threadpool *tpool);  //! Wait for a set of tasks to finish, running the queued ones from tpool meanwhile.
     waiter() : num(0){}
     ~waiter();
   };
@@ -87,7 +87,7 @@ public:
     unsigned int active;
     unsigned int max;
     bool running;
-    void run(bool flush = false);
+    void run(waiter *flush = NULL);
 };
 
 }
@@ -1663,6 +1663,40 @@ void ge_tobytes(unsigned char *s, const ge_p2 *h) {
   s[31] ^= fe_isnegative(x) << 7;
 }
 
+/* Batch version of ge_tobytes: encodes n points sharing a single field inversion
+   (Montgomery's trick). tmp is a scratch buffer of n field elements. */
+
+void ge_tobytes_batch(unsigned char *s, const ge_p2 *h, fe *tmp, size_t n) {
+  fe acc;
+  fe recip;
+  fe x;
+  fe y;
+  size_t i;
+
+  if (n == 0)
+    return;
+
+  fe_copy(tmp[0], h[0].Z);
+  for (i = 1; i < n; i++)
+    fe_mul(tmp[i], tmp[i - 1], h[i].Z);
+
+  fe_invert(acc, tmp[n - 1]);
+
+  for (i = n - 1; i > 0; i--) {
+    fe_mul(recip, acc, tmp[i - 1]);
+    fe_mul(acc, acc, h[i].Z);
+    fe_mul(x, h[i].X, recip);
+    fe_mul(y, h[i].Y, recip);
+    fe_tobytes(s + 32 * i, y);
+    s[32 * i + 31] ^= fe_isnegative(x) << 7;
+  }
+
+  fe_mul(x, h[0].X, acc);
+  fe_mul(y, h[0].Y, acc);
+  fe_tobytes(s, y);
+  s[31] ^= fe_isnegative(x) << 7;
+}
+
 /* From sc_reduce.c */
 
 /*
@@ -30,6 +30,8 @@
 
 #pragma once
 
+#include <stddef.h>
+
 /* From fe.h */
 
 typedef int32_t fe[10];
@@ -120,6 +122,7 @@ void ge_scalarmult_base(ge_p3 *, const unsigned char *);
 /* From ge_tobytes.c */
 
 void ge_tobytes(unsigned char *, const ge_p2 *);
+void ge_tobytes_batch(unsigned char *, const ge_p2 *, fe *, size_t);
 
 /* From sc_reduce.c */
 
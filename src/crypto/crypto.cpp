@@ -29,6 +29,7 @@
 // Parts of this file are originally copyright (c) 2012-2013 The Cryptonote developers
 
 #include <unistd.h>
+#include <algorithm>
 #include <cassert>
 #include <cstddef>
 #include <cstdint>
@@ -186,6 +187,24 @@ namespace crypto {
     return true;
   }
 
+  bool crypto_ops::generate_key_derivations(const public_key &key1, const std::vector<secret_key> &keys2, std::vector<key_derivation> &derivations) {
+    ge_p3 point;
+    ge_p2 point2;
+    ge_p1p1 point3;
+    if (ge_frombytes_vartime(&point, &key1) != 0) {
+      return false;
+    }
+    derivations.resize(keys2.size());
+    for (size_t i = 0; i < keys2.size(); ++i) {
+      assert(sc_check(&keys2[i]) == 0);
+      ge_scalarmult(&point2, &unwrap(keys2[i]), &point);
+      ge_mul8(&point3, &point2);
+      ge_p1p1_to_p2(&point2, &point3);
+      ge_tobytes(&derivations[i], &point2);
+    }
+    return true;
+  }
+
   void crypto_ops::derivation_to_scalar(const key_derivation &derivation, size_t output_index, ec_scalar &res) {
     struct {
       key_derivation derivation;
@@ -312,6 +331,69 @@ namespace crypto {
     return sc_isnonzero(&c) == 0;
   }
 
+  bool crypto_ops::check_signatures(const std::vector<signature_check> &checks, std::vector<size_t> *failed) {
+    static const ec_point infinity = {{ 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0}};
+    std::vector<ge_p2> comms;
+    std::vector<size_t> comm_indexes;
+    bool result = true;
+
+    if (failed)
+      failed->clear();
+
+    auto fail = [&](size_t i) {
+      result = false;
+      if (failed)
+        failed->push_back(i);
+    };
+
+    comms.reserve(checks.size());
+    comm_indexes.reserve(checks.size());
+
+    // first pass: R' = c*P + r*G for well formed signatures, encoding is deferred
+    for (size_t i = 0; i < checks.size(); ++i) {
+      const signature_check &check = checks[i];
+      ge_p3 tmp3;
+      if (ge_frombytes_vartime(&tmp3, &check.pub) != 0 ||
+          sc_check(&check.sig.c) != 0 || sc_check(&check.sig.r) != 0 || !sc_isnonzero(&check.sig.c)) {
+        fail(i);
+        continue;
+      }
+      comms.emplace_back();
+      ge_double_scalarmult_base_vartime(&comms.back(), &check.sig.c, &tmp3, &check.sig.r);
+      comm_indexes.push_back(i);
+    }
+
+    if (comms.empty())
+      return result;
+
+    // second pass: encode all R' with a single field inversion
+    std::unique_ptr<fe[]> tmp(new fe[comms.size()]);
+    std::vector<ec_point> comm_bytes(comms.size());
+    ge_tobytes_batch(reinterpret_cast<unsigned char*>(comm_bytes.data()), comms.data(), tmp.get(), comms.size());
+
+    for (size_t j = 0; j < comms.size(); ++j) {
+      const size_t i = comm_indexes[j];
+      s_comm buf;
+      ec_scalar c;
+      buf.h = checks[i].prefix_hash;
+      buf.key = checks[i].pub;
+      buf.comm = comm_bytes[j];
+      if (memcmp(&buf.comm, &infinity, 32) == 0) {
+        fail(i);
+        continue;
+      }
+      hash_to_scalar(&buf, sizeof(s_comm), c);
+      sc_sub(&c, &c, &checks[i].sig.c);
+      if (sc_isnonzero(&c) != 0)
+        fail(i);
+    }
+
+    if (failed)
+      std::sort(failed->begin(), failed->end());
+
+    return result;
+  }
+
   void crypto_ops::generate_tx_proof(const hash &prefix_hash, const public_key &R, const public_key &A, const boost::optional<public_key> &B, const public_key &D, const secret_key &r, signature &sig) {
     // sanity check
     ge_p3 R_p3;
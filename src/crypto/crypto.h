@@ -98,6 +98,12 @@ namespace crypto {
   };
 #pragma pack(pop)
 
+  struct signature_check {
+    hash prefix_hash;
+    public_key pub;
+    signature sig;
+  };
+
   void hash_to_scalar(const void *data, size_t length, ec_scalar &res);
   void random32_unbiased(unsigned char *bytes);
 
@@ -120,6 +126,8 @@ namespace crypto {
     friend bool secret_key_to_public_key(const secret_key &, public_key &);
     static bool generate_key_derivation(const public_key &, const secret_key &, key_derivation &);
     friend bool generate_key_derivation(const public_key &, const secret_key &, key_derivation &);
+    static bool generate_key_derivations(const public_key &, const std::vector<secret_key> &, std::vector<key_derivation> &);
+    friend bool generate_key_derivations(const public_key &, const std::vector<secret_key> &, std::vector<key_derivation> &);
     static void derivation_to_scalar(const key_derivation &derivation, size_t output_index, ec_scalar &res);
     friend void derivation_to_scalar(const key_derivation &derivation, size_t output_index, ec_scalar &res);
     static bool derive_public_key(const key_derivation &, std::size_t, const public_key &, public_key &);
@@ -132,6 +140,8 @@ namespace crypto {
     friend void generate_signature(const hash &, const public_key &, const secret_key &, signature &);
     static bool check_signature(const hash &, const public_key &, const signature &);
     friend bool check_signature(const hash &, const public_key &, const signature &);
+    static bool check_signatures(const std::vector<signature_check> &, std::vector<size_t> *);
+    friend bool check_signatures(const std::vector<signature_check> &, std::vector<size_t> *);
     static void generate_tx_proof(const hash &, const public_key &, const public_key &, const boost::optional<public_key> &, const public_key &, const secret_key &, signature &);
     friend void generate_tx_proof(const hash &, const public_key &, const public_key &, const boost::optional<public_key> &, const public_key &, const secret_key &, signature &);
     static bool check_tx_proof(const hash &, const public_key &, const public_key &, const boost::optional<public_key> &, const public_key &, const signature &);
@@ -192,6 +202,12 @@ namespace crypto {
   inline bool generate_key_derivation(const public_key &key1, const secret_key &key2, key_derivation &derivation) {
     return crypto_ops::generate_key_derivation(key1, key2, derivation);
   }
+  /* Generates the key derivations of one transaction key with several view keys. The transaction key
+   * is decompressed once, which is cheaper than calling generate_key_derivation for each view key.
+   */
+  inline bool generate_key_derivations(const public_key &key1, const std::vector<secret_key> &keys2, std::vector<key_derivation> &derivations) {
+    return crypto_ops::generate_key_derivations(key1, keys2, derivations);
+  }
   inline bool derive_public_key(const key_derivation &derivation, std::size_t output_index,
     const public_key &base, public_key &derived_key) {
     return crypto_ops::derive_public_key(derivation, output_index, base, derived_key);
@@ -216,6 +232,13 @@ namespace crypto {
     return crypto_ops::check_signature(prefix_hash, pub, sig);
   }
 
+  /* Check a batch of signatures. Points are normalized together, which is cheaper than checking them one by one.
+   * Returns true if all signatures are valid; indexes of invalid signatures are returned in failed (if not null).
+   */
+  inline bool check_signatures(const std::vector<signature_check> &checks, std::vector<size_t> *failed = nullptr) {
+    return crypto_ops::check_signatures(checks, failed);
+  }
+
   /* Generation and checking of a tx proof; given a tx pubkey R, the recipient's view pubkey A, and the key 
    * derivation D, the signature proves the knowledge of the tx secret key r such that R=r*G and D=r*A
    * When the recipient's address is a subaddress, the tx pubkey R is defined as R=r*B where B is the recipient's spend pubkey
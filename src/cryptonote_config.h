@@ -106,6 +106,10 @@
 
 #define COMMAND_RPC_GET_BLOCKS_FAST_MAX_COUNT           1000
 
+#define CRYPTONOTE_PRUNING_STRIPE_SIZE                  4096 // blocks in a row kept or pruned together
+#define CRYPTONOTE_PRUNING_LOG_STRIPES                  3    // log2 of the number of stripes
+#define CRYPTONOTE_PRUNING_TIP_BLOCKS                   5500 // last blocks are never pruned, ~7.6 days
+
 #define P2P_LOCAL_WHITE_PEERLIST_LIMIT                  1000
 #define P2P_LOCAL_GRAY_PEERLIST_LIMIT                   5000
 
@@ -126,7 +130,14 @@
 #define P2P_IDLE_CONNECTION_KILL_INTERVAL               (5*60) //5 minutes
 
 #define P2P_SUPPORT_FLAG_FLUFFY_BLOCKS                  0x01
-#define P2P_SUPPORT_FLAGS                               P2P_SUPPORT_FLAG_FLUFFY_BLOCKS
+#define P2P_SUPPORT_FLAG_ANNOUNCE_BATCH                 0x02
+#define P2P_SUPPORT_FLAG_PRUNING                        0x04       //sends CORE_SYNC_DATA::pruning_seed, answers with missed_ids for pruned blocks
+#define P2P_SUPPORT_FLAGS                               (P2P_SUPPORT_FLAG_FLUFFY_BLOCKS | P2P_SUPPORT_FLAG_ANNOUNCE_BATCH | P2P_SUPPORT_FLAG_PRUNING)
+
+#define P2P_ANNOUNCE_BATCH_WINDOW_MS                    500        //supernode announces are collected for relay during this window
+#define P2P_ANNOUNCE_BATCH_MAX_SIZE                     1000       //batch is flushed early when this many announces are collected
+#define P2P_ANNOUNCE_PEER_RATE                          50         //announces per second accepted from a peer on average
+#define P2P_ANNOUNCE_PEER_BURST                         5000       //announces accepted from a peer at once
 
 #define ALLOW_DEBUG_COMMANDS
 
@@ -134,6 +145,7 @@
 #define CRYPTONOTE_POOLDATA_FILENAME            "poolstate.bin"
 #define CRYPTONOTE_BLOCKCHAINDATA_FILENAME      "data.mdb"
 #define CRYPTONOTE_BLOCKCHAINDATA_LOCK_FILENAME "lock.mdb"
+#define CRYPTONOTE_KEY_IMAGE_FILTER_FILENAME    "key_images.filter"
 #define P2P_NET_DATA_FILENAME                   "p2pstate.bin"
 #define MINER_CONFIG_FILE_NAME                  "miner_conf.json"
 
@@ -151,6 +163,7 @@
 #define HASH_OF_HASHES_STEP                     256
 
 #define DEFAULT_TXPOOL_MAX_WEIGHT               648000000ull // 3 days at 300000, in bytes
+#define DEFAULT_OUTPUT_CACHE_SIZE               65536 // output keys, about 9 MB
 
 #define BULLETPROOF_MAX_OUTPUTS                 16
 
@@ -54,6 +54,7 @@
 #include "ringct/rctSigs.h"
 #include "common/perf_timer.h"
 #include "common/notify.h"
+#include "common/pruning.h"
 #if defined(PER_BLOCK_CHECKPOINT)
 #include "blocks/blocks.h"
 #endif
@@ -578,6 +579,8 @@ bool Blockchain::deinit()
   m_async_pool.join_all();
   m_async_service.stop();
 
+  discard_speculative_checks();
+
   // as this should be called if handling a SIGSEGV, need to check
   // if m_db is a NULL pointer (and thus may have caused the illegal
   // memory operation), otherwise we may cause a loop.
@@ -671,6 +674,7 @@ block Blockchain::pop_block_from_blockchain()
   m_scan_table.clear();
   m_blocks_txs_check.clear();
   m_check_txin_table.clear();
+  discard_speculative_checks();
 
   update_next_cumulative_weight_limit();
   m_tx_pool.on_blockchain_dec(m_db->height()-1, get_tail_id());
@@ -1744,8 +1748,17 @@ bool Blockchain::handle_get_objects(NOTIFY_REQUEST_GET_OBJECTS::request& arg, NO
   std::vector<std::pair<cryptonote::blobdata,block>> blocks;
   get_blocks(arg.blocks, blocks, rsp.missed_ids);
 
+  const uint32_t pruning_seed = m_db->get_blockchain_pruning_seed();
   for (auto& bl: blocks)
   {
+    // prunable data of blocks out of our stripe is gone, the peer has to get them elsewhere
+    if (pruning_seed && !bl.second.tx_hashes.empty() &&
+        !tools::has_unpruned_block(get_block_height(bl.second), rsp.current_blockchain_height, pruning_seed))
+    {
+      rsp.missed_ids.push_back(get_block_hash(bl.second));
+      continue;
+    }
+
     std::vector<crypto::hash> missed_tx_ids;
     std::vector<cryptonote::blobdata> txs;
 
@@ -2156,10 +2169,14 @@ bool Blockchain::find_blockchain_supplement(const uint64_t req_start_block, cons
 
   m_db->block_txn_start(true);
   total_height = get_current_blockchain_height();
+  const uint32_t pruning_seed = pruned ? 0 : m_db->get_blockchain_pruning_seed();
   size_t count = 0, size = 0;
   blocks.reserve(std::min(std::min(max_count, (size_t)10000), (size_t)(total_height - start_height)));
   for(uint64_t i = start_height; i < total_height && count < max_count && (size < FIND_BLOCKCHAIN_SUPPLEMENT_MAX_SIZE || count < 3); i++, count++)
   {
+    // full blobs stop at the first block we pruned, the caller gets the blocks before it
+    if (pruning_seed && !tools::has_unpruned_block(i, total_height, pruning_seed))
+      break;
     blocks.resize(blocks.size()+1);
     blocks.back().first.first = m_db->get_block_blob_from_height(i);
     block b;
@@ -2673,6 +2690,12 @@ bool Blockchain::check_tx_inputs(transaction& tx, tx_verification_context &tvc,
   std::vector < uint64_t > results;
   results.resize(tx.vin.size(), 0);
 
+  // signatures may already be being checked on the threadpool, see prepare_handle_incoming_blocks
+  speculative_tx_check *speculative = NULL;
+  const auto its = m_speculative_checks.find(tx_prefix_hash);
+  if (its != m_speculative_checks.end())
+    speculative = its->second.get();
+
   tools::threadpool& tpool = tools::threadpool::getInstance();
   tools::threadpool::waiter waiter;
   const auto waiter_guard = epee::misc_utils::create_scope_leave_handler([&]() { waiter.wait(&tpool); });
@@ -2731,7 +2754,7 @@ bool Blockchain::check_tx_inputs(transaction& tx, tx_verification_context &tvc,
       return false;
     }
 
-    if (tx.version == 1)
+    if (tx.version == 1 && !speculative)
     {
       if (threads > 1)
       {
@@ -2760,12 +2783,25 @@ bool Blockchain::check_tx_inputs(transaction& tx, tx_verification_context &tvc,
 
     sig_index++;
   }
-  if (tx.version == 1 && threads > 1)
+  if (tx.version == 1 && threads > 1 && !speculative)
     waiter.wait(&tpool);
 
   if (tx.version == 1)
   {
-    if (threads > 1)
+    if (speculative)
+    {
+      if (use_speculative_check(*speculative, tx, pubkeys))
+      {
+        results = speculative->results;
+      }
+      else
+      {
+        for (size_t i = 0; i < tx.vin.size(); i++)
+          check_ring_signature(tx_prefix_hash, boost::get<txin_to_key>(tx.vin[i]).k_image, pubkeys[i], tx.signatures[i], results[i]);
+      }
+    }
+
+    if (threads > 1 || speculative)
     {
       // save results to table, passed or otherwise
       bool failed = false;
@@ -2792,6 +2828,8 @@ bool Blockchain::check_tx_inputs(transaction& tx, tx_verification_context &tvc,
       return false;
     }
 
+    const bool have_speculative = speculative && use_speculative_check(*speculative, tx, pubkeys);
+
     // from version 2, check ringct signatures
     // obviously, the original and simple rct APIs use a mixRing that's indexes
     // in opposite orders, because it'd be too simple otherwise...
@@ -2854,7 +2892,7 @@ bool Blockchain::check_tx_inputs(transaction& tx, tx_verification_context &tvc,
         }
       }
 
-      if (!rct::verRctNonSemanticsSimple(rv))
+      if (!(have_speculative ? speculative->results[0] : rct::verRctNonSemanticsSimple(rv)))
       {
         MERROR_VER("Failed to check ringct signatures!");
         return false;
@@ -2913,7 +2951,7 @@ bool Blockchain::check_tx_inputs(transaction& tx, tx_verification_context &tvc,
         }
       }
 
-      if (!rct::verRct(rv, false))
+      if (!(have_speculative ? speculative->results[0] : rct::verRct(rv, false)))
       {
         MERROR_VER("Failed to check ringct signatures!");
         return false;
@@ -2958,6 +2996,111 @@ void Blockchain::check_ring_signature(const crypto::hash &tx_prefix_hash, const
   result = crypto::check_ring_signature(tx_prefix_hash, key_image, p_output_keys, sig.data()) ? 1 : 0;
 }
 
+//------------------------------------------------------------------
+void Blockchain::speculative_check_worker(speculative_tx_check &check)
+{
+  if (check.claimed.exchange(true))
+    return;
+  run_speculative_check(check);
+}
+//------------------------------------------------------------------
+void Blockchain::run_speculative_check(speculative_tx_check &check)
+{
+  if (m_cancel)
+    return;
+
+  try
+  {
+    transaction tx;
+    crypto::hash tx_hash, tx_prefix_hash;
+    if (!parse_and_validate_tx_from_blob(check.tx_blob, tx, tx_hash, tx_prefix_hash))
+      return;
+    if (tx.vin.size() != check.pubkeys.size())
+      return;
+
+    std::vector<uint64_t> results;
+    if (tx.version == 1)
+    {
+      if (tx.signatures.size() != tx.vin.size())
+        return;
+      results.resize(tx.vin.size(), 0);
+      for (size_t i = 0; i < tx.vin.size(); i++)
+      {
+        if (tx.signatures[i].size() != check.pubkeys[i].size())
+          return;
+        check_ring_signature(tx_prefix_hash, boost::get<txin_to_key>(tx.vin[i]).k_image, check.pubkeys[i], tx.signatures[i], results[i]);
+      }
+    }
+    else
+    {
+      if (!expand_transaction_2(tx, tx_prefix_hash, check.pubkeys))
+        return;
+      const rct::rctSig &rv = tx.rct_signatures;
+      switch (rv.type)
+      {
+      case rct::RCTTypeSimple:
+      case rct::RCTTypeBulletproof:
+        results.push_back(rct::verRctNonSemanticsSimple(rv) ? 1 : 0);
+        break;
+      case rct::RCTTypeFull:
+        results.push_back(rct::verRct(rv, false) ? 1 : 0);
+        break;
+      default:
+        return;
+      }
+    }
+
+    check.tx_hash = tx_hash;
+    check.results = std::move(results);
+  }
+  catch (const std::exception &e)
+  {
+    MDEBUG("Speculative check failed: " << e.what());
+  }
+}
+//------------------------------------------------------------------
+bool Blockchain::use_speculative_check(speculative_tx_check &check, const transaction &tx, const std::vector<std::vector<rct::ctkey>> &pubkeys)
+{
+  // run it here if no pool thread got to it yet, else wait for the one that did
+  if (!check.claimed.exchange(true))
+    run_speculative_check(check);
+  else
+    check.waiter.wait(NULL);
+
+  if (check.results.empty() || check.tx_hash != get_transaction_hash(tx))
+    return false;
+  if (check.pubkeys.size() != pubkeys.size())
+    return false;
+  for (size_t n = 0; n < pubkeys.size(); ++n)
+  {
+    if (check.pubkeys[n].size() != pubkeys[n].size())
+      return false;
+    for (size_t m = 0; m < pubkeys[n].size(); ++m)
+      if (!(check.pubkeys[n][m].dest == pubkeys[n][m].dest) || !(check.pubkeys[n][m].mask == pubkeys[n][m].mask))
+        return false;
+  }
+  return true;
+}
+//------------------------------------------------------------------
+void Blockchain::discard_speculative_checks()
+{
+  if (m_speculative_checks.empty())
+    return;
+
+  // queued checks turn into no-ops, then wait for the ones already running
+  for (auto &e : m_speculative_checks)
+    e.second->claimed = true;
+  tools::threadpool& tpool = tools::threadpool::getInstance();
+  for (auto &e : m_speculative_checks)
+    e.second->waiter.wait(&tpool);
+  m_speculative_checks.clear();
+}
+//------------------------------------------------------------------
+size_t Blockchain::get_speculative_check_count() const
+{
+  return m_speculative_checks.size();
+}
+
 //------------------------------------------------------------------
 uint64_t Blockchain::get_fee_quantization_mask()
 {
@@ -3315,6 +3458,8 @@ bool Blockchain::handle_block_to_main_chain(const block& bl, const crypto::hash&
     MERROR_VER("Block with id: " << id << std::endl << "has wrong prev_id: " << bl.prev_id << std::endl << "expected: " << get_tail_id());
     bvc.m_verifivation_failed = true;
 leave:
+    // the rest of the batch won't be added after a failed block
+    discard_speculative_checks();
     m_db->block_txn_stop();
     return false;
   }
@@ -3856,6 +4001,7 @@ bool Blockchain::cleanup_handle_incoming_blocks(bool force_sync)
   m_scan_table.clear();
   m_blocks_txs_check.clear();
   m_check_txin_table.clear();
+  discard_speculative_checks();
 
   // when we're well clear of the precomputed hashes, free the memory
   if (!m_blocks_hash_check.empty() && m_db->height() > m_blocks_hash_check.size() + 4096)
@@ -4148,6 +4294,7 @@ bool Blockchain::prepare_handle_incoming_blocks(const std::vector<block_complete
   m_fake_scan_time = 0;
   m_fake_pow_calc_time = 0;
 
+  discard_speculative_checks();
   m_scan_table.clear();
   m_check_txin_table.clear();
 
@@ -4329,6 +4476,57 @@ bool Blockchain::prepare_handle_incoming_blocks(const std::vector<block_complete
     }
   }
 
+  // Start checking the signatures of every tx whose ring is fully known now, so
+  // that the checks for later blocks run on the threadpool while earlier ones are
+  // being added. Rings spending outputs created in this batch are left to
+  // check_tx_inputs. Whatever a check finds is only used if check_tx_inputs looks
+  // up the same ring for the same tx.
+  if (tpool.get_max_concurrency() > 1)
+  {
+    std::vector<speculative_tx_check*> checks;
+    checks.reserve(total_txs);
+    tx_index = 0;
+    for (const auto &entry : blocks_entry)
+    {
+      for (const auto &tx_blob : entry.txs)
+      {
+        const transaction &tx = txes[tx_index].first;
+        const crypto::hash &tx_prefix_hash = txes[tx_index].second;
+        ++tx_index;
+
+        const auto its = m_scan_table.find(tx_prefix_hash);
+        if (its == m_scan_table.end())
+          continue;
+
+        std::unique_ptr<speculative_tx_check> check(new speculative_tx_check());
+        check->pubkeys.resize(tx.vin.size());
+        bool complete = true;
+        for (size_t n = 0; n < tx.vin.size() && complete; ++n)
+        {
+          const txin_to_key &in_to_key = boost::get<txin_to_key>(tx.vin[n]);
+          const auto ito = its->second.find(in_to_key.k_image);
+          complete = ito != its->second.end() && ito->second.size() == in_to_key.key_offsets.size();
+          if (!complete)
+            break;
+          check->pubkeys[n].reserve(ito->second.size());
+          for (const output_data_t &output : ito->second)
+            check->pubkeys[n].push_back(rct::ctkey({rct::pk2rct(output.pubkey), output.commitment}));
+        }
+        if (!complete)
+          continue;
+
+        check->tx_blob = tx_blob;
+        checks.push_back(check.get());
+        m_speculative_checks.emplace(tx_prefix_hash, std::move(check));
+      }
+    }
+
+    // not leaf tasks, as rct verification uses the threadpool itself (inline when nested)
+    for (speculative_tx_check *check : checks)
+      tpool.submit(&check->waiter, boost::bind(&Blockchain::speculative_check_worker, this, std::ref(*check)));
+    MDEBUG("Started speculative signature checks for " << checks.size() << "/" << total_txs << " txes");
+  }
+
   TIME_MEASURE_FINISH(scantable);
   if (total_txs > 0)
   {
@@ -4380,6 +4578,24 @@ bool Blockchain::for_all_txpool_txes(std::function<bool(const crypto::hash&, con
   return m_db->for_all_txpool_txes(f, include_blob, include_unrelayed_txes);
 }
 
+bool Blockchain::prune_blockchain(uint32_t pruning_seed)
+{
+  CRITICAL_REGION_LOCAL(m_blockchain_lock);
+  return m_db->prune_blockchain(pruning_seed);
+}
+
+bool Blockchain::update_blockchain_pruning()
+{
+  CRITICAL_REGION_LOCAL(m_blockchain_lock);
+  return m_db->update_pruning();
+}
+
+bool Blockchain::check_blockchain_pruning()
+{
+  CRITICAL_REGION_LOCAL(m_blockchain_lock);
+  return m_db->check_pruning();
+}
+
 void Blockchain::set_user_options(uint64_t maxthreads, bool sync_on_blocks, uint64_t sync_threshold, blockchain_db_sync_mode sync_mode, bool fast_sync)
 {
   if (sync_mode == db_defaultsync)
@@ -45,6 +45,7 @@
 #include "string_tools.h"
 #include "cryptonote_basic/cryptonote_basic.h"
 #include "common/util.h"
+#include "common/threadpool.h"
 #include "cryptonote_protocol/cryptonote_protocol_defs.h"
 #include "rpc/core_rpc_server_commands_defs.h"
 #include "cryptonote_basic/difficulty.h"
@@ -227,6 +228,13 @@ namespace cryptonote
      */
     bool cleanup_handle_incoming_blocks(bool force_sync = false);
 
+    /**
+     * @brief gets the number of signature checks started ahead for the incoming blocks
+     *
+     * @return the number of speculative checks not discarded yet
+     */
+    size_t get_speculative_check_count() const;
+
     /**
      * @brief search the blockchain for a transaction by hash
      *
@@ -418,7 +426,8 @@ namespace cryptonote
      * @param blocks return-by-reference the blocks and their transactions
      * @param total_height return-by-reference our current blockchain height
      * @param start_height return-by-reference the height of the first block returned
-     * @param pruned whether to return full or pruned tx blobs
+     * @param pruned whether to return full or pruned tx blobs; on a pruned blockchain full blobs
+     *        stop before the first block out of our stripe, so no blocks may be returned
      * @param max_count the max number of blocks to get
      *
      * @return true if a block found in common or req_start_block specified, else false
@@ -431,11 +440,12 @@ namespace cryptonote
      * the request object encapsulates a list of block hashes and a (possibly empty) list of
      * transaction hashes.  for each block hash, the block is fetched along with all of that
      * block's transactions.  Any transactions requested separately are fetched afterwards.
+     * On a pruned blockchain, blocks whose prunable data was pruned go to missed_ids.
      *
      * @param arg the request
      * @param rsp return-by-reference the response to fill in
      *
-     * @return true unless any blocks or transactions are missing
+     * @return false if a transaction of a block we keep in full is missing, else true
      */
     bool handle_get_objects(NOTIFY_REQUEST_GET_OBJECTS::request& arg, NOTIFY_RESPONSE_GET_OBJECTS::request& rsp);
 
@@ -898,6 +908,34 @@ namespace cryptonote
       return *m_db;
     }
 
+    /**
+     * @brief get the pruning seed of the blockchain, 0 if not pruned
+     */
+    uint32_t get_blockchain_pruning_seed() const { return m_db->get_blockchain_pruning_seed(); }
+
+    /**
+     * @brief prune the blockchain, see BlockchainDB::prune_blockchain
+     *
+     * @param pruning_seed the seed to prune with, 0 to keep the current one or pick a random stripe
+     *
+     * @return true on success
+     */
+    bool prune_blockchain(uint32_t pruning_seed = 0);
+
+    /**
+     * @brief prune blocks which left the tip since the last call, no-op if not pruned
+     *
+     * @return true on success
+     */
+    bool update_blockchain_pruning();
+
+    /**
+     * @brief check that the blockchain is pruned consistently with its seed
+     *
+     * @return true if consistent
+     */
+    bool check_blockchain_pruning();
+
     /**
      * @brief get a number of outputs of a specific amount
      *
@@ -990,6 +1028,21 @@ namespace cryptonote
     std::unordered_map<crypto::hash, crypto::hash> m_blocks_longhash_table;
     std::unordered_map<crypto::hash, std::unordered_map<crypto::key_image, bool>> m_check_txin_table;
 
+    // signature checks for the txes of the incoming batch, run on the threadpool ahead of
+    // the blocks being added; a check is done once by whoever claims it first
+    struct speculative_tx_check
+    {
+      cryptonote::blobdata tx_blob;
+      crypto::hash tx_hash;
+      std::vector<std::vector<rct::ctkey>> pubkeys;
+      std::vector<uint64_t> results; //!< per input for v1, one for v2; empty if the tx could not be checked
+      std::atomic<bool> claimed;
+      tools::threadpool::waiter waiter;
+
+      speculative_tx_check(): tx_hash(crypto::null_hash), claimed(false) {}
+    };
+    std::unordered_map<crypto::hash, std::unique_ptr<speculative_tx_check>> m_speculative_checks;
+
     // SHA-3 hashes for each block and for fast pow checking
     std::vector<crypto::hash> m_blocks_hash_of_hashes;
     std::vector<crypto::hash> m_blocks_hash_check;
@@ -1367,6 +1420,39 @@ namespace cryptonote
     void check_ring_signature(const crypto::hash &tx_prefix_hash, const crypto::key_image &key_image,
         const std::vector<rct::ctkey> &pubkeys, const std::vector<crypto::signature> &sig, uint64_t &result);
 
+    /**
+     * @brief threadpool entry for a speculative signature check, does nothing if already claimed
+     *
+     * @param check the check to run
+     */
+    void speculative_check_worker(speculative_tx_check &check);
+
+    /**
+     * @brief verifies the signatures of a speculative check against its ring
+     *
+     * @param check the check to run, results are left empty if the tx can't be checked
+     */
+    void run_speculative_check(speculative_tx_check &check);
+
+    /**
+     * @brief gets the result of a speculative check, waiting for it or running it if needed
+     *
+     * The result is only usable if it was computed for this very transaction
+     * and against the ring the caller has just looked up.
+     *
+     * @param check the speculative check for the transaction's prefix hash
+     * @param tx the transaction being validated
+     * @param pubkeys the ring for each input
+     *
+     * @return true if check.results can be used in place of verifying again
+     */
+    bool use_speculative_check(speculative_tx_check &check, const transaction &tx, const std::vector<std::vector<rct::ctkey>> &pubkeys);
+
+    /**
+     * @brief stops and drops all speculative checks, waiting for those being run
+     */
+    void discard_speculative_checks();
+
     /**
      * @brief loads block hashes from compiled-in data set
      *
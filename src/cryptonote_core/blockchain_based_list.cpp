@@ -12,6 +12,31 @@ namespace
 const size_t BLOCKCHAIN_BASED_LIST_SIZE = 32; //TODO: configuration parameter
 const size_t PREVIOS_BLOCKCHAIN_BASED_LIST_MAX_SIZE = 16; //TODO: configuration parameter
 const size_t BLOCKCHAIN_BASED_LISTS_HISTORY_DEPTH   = 1000;
+const uint32_t BLOCKCHAIN_BASED_LIST_JOURNAL_FORMAT_VERSION       = 7;
+const size_t   BLOCKCHAIN_BASED_LIST_JOURNAL_COMPACTION_THRESHOLD = 250; //number of records after the last snapshot
+
+typedef std::vector<std::vector<uint32_t>> tier_index_array;
+
+/// Block record refers supernodes of the previous block by position (in order of tiers) and adds only new supernodes;
+/// index i refers to the previous block if i < previous block supernodes count, otherwise to new_supernodes
+struct blockchain_based_list_block_record
+{
+  uint64_t block_height;
+  tier_index_array tiers;
+  BlockchainBasedList::supernode_array new_supernodes;
+
+  BEGIN_SERIALIZE_OBJECT()
+    FIELD(block_height)
+    FIELD(tiers)
+    FIELD(new_supernodes)
+  END_SERIALIZE()
+};
+
+bool is_same_supernode(const BlockchainBasedList::supernode& s1, const BlockchainBasedList::supernode& s2)
+{
+  return s1.supernode_public_id == s2.supernode_public_id && s1.supernode_public_address == s2.supernode_public_address &&
+         s1.amount == s2.amount && s1.block_height == s2.block_height && s1.unlock_time == s2.unlock_time;
+}
 
 }
 
@@ -21,23 +46,92 @@ BlockchainBasedList::BlockchainBasedList(const std::string& m_storage_file_name,
   , m_history_depth()
   , m_first_block_number(first_block_number)
   , m_need_store()
+  , m_journal(m_storage_file_name, BLOCKCHAIN_BASED_LIST_JOURNAL_FORMAT_VERSION, BLOCKCHAIN_BASED_LIST_JOURNAL_COMPACTION_THRESHOLD)
 {
   load();
 }
 
-const BlockchainBasedList::supernode_tier_array& BlockchainBasedList::tiers(size_t depth) const
+BlockchainBasedList::supernode_tier_array BlockchainBasedList::tiers(size_t depth) const
 {
   if (depth >= m_history_depth)
     throw std::runtime_error("internal error: attempt to get tier which is not present in a blockchain based list");
 
-  if (!depth)
-    return m_history.back();
+  supernode_tier_array tiers;
 
-  list_history::const_reverse_iterator it = m_history.rbegin();
+  fill_tiers(m_history[m_history.size() - 1 - depth], tiers);
 
-  std::advance(it, depth);
+  return tiers;
+}
+
+void BlockchainBasedList::fill_tiers(const supernode_tier_index_array& indexes, supernode_tier_array& tiers) const
+{
+  tiers.clear();
+  tiers.resize(indexes.size());
 
-  return *it;
+  for (size_t i=0; i<indexes.size(); i++)
+  {
+    tiers[i].reserve(indexes[i].size());
+
+    for (supernode_index index : indexes[i])
+      tiers[i].push_back(m_supernodes[index].data);
+  }
+}
+
+BlockchainBasedList::supernode_index BlockchainBasedList::acquire_supernode(const supernode& sn)
+{
+  auto range = m_supernode_indexes.equal_range(sn.supernode_public_id);
+
+  for (supernode_index_map::iterator it=range.first; it!=range.second; ++it)
+  {
+    supernode_entry& entry = m_supernodes[it->second];
+
+    if (is_same_supernode(entry.data, sn))
+    {
+      entry.references++;
+      return it->second;
+    }
+  }
+
+  supernode_index index;
+
+  if (m_free_supernodes.empty())
+  {
+    index = static_cast<supernode_index>(m_supernodes.size());
+    m_supernodes.push_back(supernode_entry{sn, 1});
+  }
+  else
+  {
+    index = m_free_supernodes.back();
+    m_free_supernodes.pop_back();
+    m_supernodes[index] = supernode_entry{sn, 1};
+  }
+
+  m_supernode_indexes.emplace(sn.supernode_public_id, index);
+
+  return index;
+}
+
+void BlockchainBasedList::release_supernode(supernode_index index)
+{
+  supernode_entry& entry = m_supernodes[index];
+
+  if (--entry.references)
+    return;
+
+  auto range = m_supernode_indexes.equal_range(entry.data.supernode_public_id);
+
+  for (supernode_index_map::iterator it=range.first; it!=range.second; ++it)
+  {
+    if (it->second == index)
+    {
+      m_supernode_indexes.erase(it);
+      break;
+    }
+  }
+
+  entry.data = supernode();
+
+  m_free_supernodes.push_back(index);
 }
 
 void BlockchainBasedList::select_supernodes(size_t items_count, const supernode_array& src_list, supernode_array& dst_list)
@@ -84,12 +178,13 @@ void BlockchainBasedList::apply_block(uint64_t block_height, const crypto::hash&
 
     if (!m_history.empty())
     {
-      const supernode_array& full_prev_supernodes = m_history.back()[i];
+      const supernode_index_array& full_prev_supernodes = m_history.back()[i];
 
       prev_supernodes.reserve(full_prev_supernodes.size());
 
-      for (const supernode& sn : full_prev_supernodes)
+      for (supernode_index index : full_prev_supernodes)
       {
+        const supernode& sn = m_supernodes[index].data;
         const supernode_stake* stake = stake_txs_storage.find_supernode_stake(block_height, sn.supernode_public_id);
 
         if (!stake || !stake->amount)
@@ -168,9 +263,75 @@ void BlockchainBasedList::apply_block(uint64_t block_height, const crypto::hash&
     new_tier.emplace_back(std::move(new_supernodes));
   }
 
+    //journal new block as a difference with the previous block
+
+  blockchain_based_list_block_record record;
+
+  record.block_height = block_height;
+
+  supernode_index_array prev_supernode_indexes;
+  std::unordered_map<std::string, uint32_t> prev_positions;
+
+  if (!m_history.empty())
+  {
+    for (const supernode_index_array& tier : m_history.back())
+      prev_supernode_indexes.insert(prev_supernode_indexes.end(), tier.begin(), tier.end());
+
+    for (size_t i=0; i<prev_supernode_indexes.size(); i++)
+      prev_positions.emplace(m_supernodes[prev_supernode_indexes[i]].data.supernode_public_id, static_cast<uint32_t>(i));
+  }
+
+  uint32_t prev_supernodes_count = static_cast<uint32_t>(prev_supernode_indexes.size());
+
+  record.tiers.resize(new_tier.size());
+
+  for (size_t i=0; i<new_tier.size(); i++)
+  {
+    for (const supernode& sn : new_tier[i])
+    {
+      auto it = prev_positions.find(sn.supernode_public_id);
+
+      uint32_t position;
+
+      if (it != prev_positions.end() && is_same_supernode(sn, m_supernodes[prev_supernode_indexes[it->second]].data))
+      {
+        position = it->second;
+      }
+      else
+      {
+        position = prev_supernodes_count + static_cast<uint32_t>(record.new_supernodes.size());
+        record.new_supernodes.push_back(sn);
+      }
+
+      record.tiers[i].push_back(position);
+    }
+  }
+
+  std::string data;
+
+  if (!::serialization::dump_binary(record, data))
+    throw std::runtime_error("internal error: failed to serialize blockchain based list journal record");
+
+  m_journal.append(StorageJournal::record_type_block, data);
+
     //update history
 
-  m_history.emplace_back(std::move(new_tier));
+  add_tiers(block_height, new_tier);
+}
+
+void BlockchainBasedList::add_tiers(uint64_t block_height, const supernode_tier_array& tiers)
+{
+  supernode_tier_index_array indexes(tiers.size());
+
+  for (size_t i=0; i<tiers.size(); i++)
+  {
+    indexes[i].reserve(tiers[i].size());
+
+    for (const supernode& sn : tiers[i])
+      indexes[i].push_back(acquire_supernode(sn));
+  }
+
+  m_history.emplace_back(std::move(indexes));
 
   if (m_history_depth < BLOCKCHAIN_BASED_LISTS_HISTORY_DEPTH)
   {
@@ -178,6 +339,10 @@ void BlockchainBasedList::apply_block(uint64_t block_height, const crypto::hash&
   }
   else
   {
+    for (const supernode_index_array& tier : m_history.front())
+      for (supernode_index index : tier)
+        release_supernode(index);
+
     m_history.pop_front();
   }
 
@@ -186,12 +351,26 @@ void BlockchainBasedList::apply_block(uint64_t block_height, const crypto::hash&
 }
 
 void BlockchainBasedList::remove_latest_block()
+{
+  if (!m_history_depth)
+    return;
+
+  remove_latest_block_impl();
+
+  m_journal.append(StorageJournal::record_type_tombstone, std::string());
+}
+
+void BlockchainBasedList::remove_latest_block_impl()
 {
   if (!m_history_depth)
     return;
 
   m_need_store = true;
 
+  for (const supernode_index_array& tier : m_history.back())
+    for (supernode_index index : tier)
+      release_supernode(index);
+
   m_block_height--;
   m_history_depth--;
 
@@ -204,18 +383,18 @@ void BlockchainBasedList::remove_latest_block()
 namespace
 {
 
+/// Snapshot keeps each supernode once and blocks as indexes of supernodes
 struct blockchain_based_list_container
 {
   uint64_t block_height;
-  size_t history_depth;
-  BlockchainBasedList::list_history& history;
-
-  blockchain_based_list_container(uint64_t block_height, size_t history_depth, BlockchainBasedList::list_history& history)
-    : block_height(block_height), history_depth(history_depth), history(history) {}
+  uint64_t history_depth;
+  BlockchainBasedList::supernode_array supernodes;
+  std::vector<tier_index_array> history;
 
   BEGIN_SERIALIZE_OBJECT()
     FIELD(block_height)
     FIELD(history_depth)
+    FIELD(supernodes)
     FIELD(history)
   END_SERIALIZE()
 };
@@ -224,53 +403,177 @@ struct blockchain_based_list_container
 
 void BlockchainBasedList::store() const
 {
-  blockchain_based_list_container data(m_block_height, m_history_depth, const_cast<list_history&>(m_history));
+  if (m_journal.need_compaction())
+  {
+    blockchain_based_list_container data;
+
+    data.block_height  = m_block_height;
+    data.history_depth = m_history_depth;
+
+      //pack supernodes which are used in history
+
+    static const uint32_t INVALID_INDEX = std::numeric_limits<uint32_t>::max();
+
+    std::vector<uint32_t> packed_indexes(m_supernodes.size(), INVALID_INDEX);
+
+    data.history.reserve(m_history.size());
+
+    for (const supernode_tier_index_array& tiers : m_history)
+    {
+      tier_index_array packed_tiers(tiers.size());
 
-  std::ofstream ostr;
-  ostr.open(m_storage_file_name, std::ios_base::binary | std::ios_base::out | std::ios_base::trunc);
+      for (size_t i=0; i<tiers.size(); i++)
+      {
+        packed_tiers[i].reserve(tiers[i].size());
+
+        for (supernode_index index : tiers[i])
+        {
+          uint32_t& packed_index = packed_indexes[index];
 
-  binary_archive<true> oar(ostr);
+          if (packed_index == INVALID_INDEX)
+          {
+            packed_index = static_cast<uint32_t>(data.supernodes.size());
+            data.supernodes.push_back(m_supernodes[index].data);
+          }
 
-  bool success = ::serialization::serialize(oar, data);
+          packed_tiers[i].push_back(packed_index);
+        }
+      }
+
+      data.history.emplace_back(std::move(packed_tiers));
+    }
 
-  ostr.close();
+    std::string snapshot;
 
-  CHECK_AND_ASSERT_THROW_MES(success && ostr.good(), "Error at save blockchain based list file '" << m_storage_file_name << "'");
+    bool success = ::serialization::dump_binary(data, snapshot);
+
+    CHECK_AND_ASSERT_THROW_MES(success, "Error at serialization of blockchain based list snapshot for '" << m_storage_file_name << "'");
+
+    m_journal.compact(snapshot);
+  }
+  else
+  {
+    m_journal.flush();
+  }
 
   m_need_store = false;
 }
 
 void BlockchainBasedList::load()
 {
-  if (!boost::filesystem::exists(m_storage_file_name))
-    return;
+  StorageJournal::record_array records;
 
-  std::string buffer;
-  bool r = epee::file_io_utils::load_file_to_string(m_storage_file_name, buffer);
-
-  CHECK_AND_ASSERT_THROW_MES(r, "blockchain based list file '" << m_storage_file_name << "' is not found");
+  if (!m_journal.load(records))
+    return;
 
   try
   {
-    LOG_PRINT_L0("Trying to parse blockchain based list");
+    LOG_PRINT_L0("Trying to parse blockchain based list journal");
 
-    list_history new_history;
-    blockchain_based_list_container data(0, 0, new_history);
+    blockchain_based_list_container data;
 
-    r = ::serialization::parse_binary(buffer, data);
+    bool r = ::serialization::parse_binary(records.front().data, data);
 
-    CHECK_AND_ASSERT_THROW_MES(r, "internal error: failed to deserialize blockchain based list file '" << m_storage_file_name << "'");
+    CHECK_AND_ASSERT_THROW_MES(r, "internal error: failed to deserialize blockchain based list snapshot from '" << m_storage_file_name << "'");
+    CHECK_AND_ASSERT_THROW_MES(data.history.size() == data.history_depth, "internal error: invalid history depth in blockchain based list snapshot from '" << m_storage_file_name << "'");
 
     m_block_height  = data.block_height;
-    m_history_depth = data.history_depth;
+    m_history_depth = 0;
+
+    m_history.clear();
+    m_supernodes.clear();
+    m_free_supernodes.clear();
+    m_supernode_indexes.clear();
+
+      //restore table of supernodes and history
+
+    m_supernodes.reserve(data.supernodes.size());
+
+    for (supernode& sn : data.supernodes)
+    {
+      m_supernode_indexes.emplace(sn.supernode_public_id, static_cast<supernode_index>(m_supernodes.size()));
+      m_supernodes.push_back(supernode_entry{std::move(sn), 0});
+    }
+
+    for (tier_index_array& tiers : data.history)
+    {
+      for (const std::vector<uint32_t>& tier : tiers)
+      {
+        for (uint32_t index : tier)
+        {
+          CHECK_AND_ASSERT_THROW_MES(index < m_supernodes.size(), "internal error: invalid supernode index in blockchain based list snapshot from '" << m_storage_file_name << "'");
+
+          m_supernodes[index].references++;
+        }
+      }
+
+      m_history.emplace_back(std::move(tiers));
+      m_history_depth++;
+    }
 
-    std::swap(m_history, data.history);
+      //replay journal tail after the snapshot
+
+    for (size_t i=1; i<records.size(); i++)
+    {
+      const StorageJournal::record& record = records[i];
+
+      switch (record.type)
+      {
+        case StorageJournal::record_type_block:
+        {
+          blockchain_based_list_block_record block_record;
+
+          r = ::serialization::parse_binary(record.data, block_record);
+
+          CHECK_AND_ASSERT_THROW_MES(r, "internal error: failed to deserialize blockchain based list journal record from '" << m_storage_file_name << "'");
+
+          supernode_index_array prev_supernode_indexes;
+
+          if (!m_history.empty())
+          {
+            for (const supernode_index_array& tier : m_history.back())
+              prev_supernode_indexes.insert(prev_supernode_indexes.end(), tier.begin(), tier.end());
+          }
+
+          supernode_tier_array tiers(block_record.tiers.size());
+
+          for (size_t j=0; j<block_record.tiers.size(); j++)
+          {
+            for (uint32_t position : block_record.tiers[j])
+            {
+              if (position < prev_supernode_indexes.size())
+              {
+                tiers[j].push_back(m_supernodes[prev_supernode_indexes[position]].data);
+                continue;
+              }
+
+              position -= static_cast<uint32_t>(prev_supernode_indexes.size());
+
+              CHECK_AND_ASSERT_THROW_MES(position < block_record.new_supernodes.size(), "internal error: invalid supernode position in blockchain based list journal record from '" << m_storage_file_name << "'");
+
+              tiers[j].push_back(block_record.new_supernodes[position]);
+            }
+          }
+
+          add_tiers(block_record.block_height, tiers);
+
+          break;
+        }
+        case StorageJournal::record_type_tombstone:
+          remove_latest_block_impl();
+          break;
+        default:
+          throw std::runtime_error("internal error: unexpected blockchain based list journal record type");
+      }
+    }
 
     m_need_store = false;
+
+    LOG_PRINT_L0("Blockchain based list journal has been loaded: " << records.size() - 1 << " record(s) after snapshot, block height is " << m_block_height);
   }
   catch (...)
   {
-    LOG_PRINT_L0("Can't parse blockchain based list file '" << m_storage_file_name << "'");
+    LOG_PRINT_L0("Can't parse blockchain based list journal '" << m_storage_file_name << "'");
     throw;
   }
 }
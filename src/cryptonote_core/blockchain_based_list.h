@@ -1,6 +1,8 @@
 #pragma once
 
+#include <deque>
 #include <random>
+#include <unordered_map>
 
 #include "blockchain.h"
 #include "serialization/crypto.h"
@@ -8,6 +10,7 @@
 #include "serialization/vector.h"
 #include "serialization/string.h"
 #include "cryptonote_core/stake_transaction_storage.h"
+#include "cryptonote_core/storage_journal.h"
 
 namespace cryptonote
 {
@@ -34,13 +37,12 @@ public:
 
   typedef std::vector<supernode>           supernode_array;
   typedef std::vector<supernode_array>     supernode_tier_array;
-  typedef std::list<supernode_tier_array>  list_history;
 
   /// Constructors
   BlockchainBasedList(const std::string& file_name, uint64_t first_block_number);
 
-  /// List of tiers
-  const supernode_tier_array& tiers(size_t depth = 0) const;
+  /// List of tiers, built from the interned supernodes on each call
+  supernode_tier_array tiers(size_t depth = 0) const;
 
   /// Height of the corresponding block
   uint64_t block_height() const { return m_block_height; }
@@ -54,27 +56,61 @@ public:
   /// Remove latest block
   void remove_latest_block();
 
-  /// Save list to file
+  /// Save list changes to journal file
   void store() const;
 
   /// Is the list requires store
   bool need_store() const { return m_need_store; }
 
 private:
-  /// Load list from file
+  /// Load list from journal file
   void load();
 
+  /// Add tiers of new block on top of the history
+  void add_tiers(uint64_t block_height, const supernode_tier_array& tiers);
+
+  /// Remove latest block without journaling
+  void remove_latest_block_impl();
+
   /// Select supernodes from a list
   void select_supernodes(size_t max_items_count, const supernode_array& src_list, supernode_array& dst_list);
 
+  typedef uint32_t                                           supernode_index;
+  typedef std::vector<supernode_index>                       supernode_index_array;
+  typedef std::vector<supernode_index_array>                 supernode_tier_index_array;
+  typedef std::deque<supernode_tier_index_array>             list_history;
+  typedef std::unordered_multimap<std::string, supernode_index> supernode_index_map;
+
+  /// Interned supernode shared between blocks of the history
+  struct supernode_entry
+  {
+    supernode data;
+    size_t    references;
+  };
+
+  typedef std::vector<supernode_entry> supernode_entry_array;
+
+  /// Find or add supernode to the table of interned supernodes
+  supernode_index acquire_supernode(const supernode&);
+
+  /// Release supernode reference
+  void release_supernode(supernode_index);
+
+  /// Build tiers from indexes of supernodes
+  void fill_tiers(const supernode_tier_index_array& indexes, supernode_tier_array& tiers) const;
+
 private:
   std::string m_storage_file_name;
   list_history m_history;
+  supernode_entry_array m_supernodes;
+  std::vector<supernode_index> m_free_supernodes;
+  supernode_index_map m_supernode_indexes;
   uint64_t m_block_height;
   size_t m_history_depth;
   std::mt19937_64 m_rng;
   uint64_t m_first_block_number;
   mutable bool m_need_store;
+  mutable StorageJournal m_journal;
 };
 
 }
@@ -179,6 +179,11 @@ namespace cryptonote
   , "Disable stake transaction processing."
   , false
   };
+  static const command_line::arg_descriptor<bool> arg_prune_blockchain  = {
+    "prune-blockchain"
+  , "Prune blockchain, keeping prunable data only for one stripe of old blocks. Full transactions of other old blocks can't be served: /getblocks.bin and /get_transactions.bin need prune=true for them"
+  , false
+  };
 
   //-----------------------------------------------------------------------------------------------
   core::core(i_cryptonote_protocol* pprotocol):
@@ -291,6 +296,7 @@ namespace cryptonote
     command_line::add_arg(desc, arg_max_txpool_weight);
     command_line::add_arg(desc, arg_block_notify);
     command_line::add_arg(desc, arg_disable_stake_tx_processing);
+    command_line::add_arg(desc, arg_prune_blockchain);
 
     miner::init_options(desc);
     BlockchainDB::init_options(desc);
@@ -604,6 +610,12 @@ namespace cryptonote
     m_blockchain_storage.set_show_time_stats(show_time_stats);
     CHECK_AND_ASSERT_MES(r, false, "Failed to initialize blockchain storage");
 
+    if (command_line::get_arg(vm, arg_prune_blockchain))
+    {
+      r = m_blockchain_storage.prune_blockchain();
+      CHECK_AND_ASSERT_MES(r, false, "Failed to prune blockchain");
+    }
+
     block_sync_size = command_line::get_arg(vm, arg_block_sync_size);
 
     MGINFO("Loading checkpoints");
@@ -821,6 +833,8 @@ namespace cryptonote
             tx_info[n].result = false;
             break;
           }
+          if (keeped_by_block && m_batch_verified_txes.find(tx_info[n].tx_hash) != m_batch_verified_txes.end())
+            break; // already verified with the rest of its block span
           rvv.push_back(&rv); // delayed batch verification
           break;
         default:
@@ -842,6 +856,8 @@ namespace cryptonote
           continue;
         if (tx_info[n].tx->rct_signatures.type != rct::RCTTypeBulletproof)
           continue;
+        if (keeped_by_block && m_batch_verified_txes.find(tx_info[n].tx_hash) != m_batch_verified_txes.end())
+          continue;
         if (assumed_bad || !rct::verRctSemanticsSimple(tx_info[n].tx->rct_signatures))
         {
           set_semantics_failed(tx_info[n].tx_hash);
@@ -854,6 +870,56 @@ namespace cryptonote
     return ret;
   }
   //-----------------------------------------------------------------------------------------------
+  void core::batch_verify_incoming_blocks_txes(const std::vector<block_complete_entry> &blocks)
+  {
+    m_batch_verified_txes.clear();
+    if (get_blockchain_storage().is_within_compiled_block_hash_area())
+      return;
+
+    size_t total_txes = 0;
+    for (const block_complete_entry &entry: blocks)
+      total_txes += entry.txs.size();
+
+    // all the bulletproofs of the span go through a single multiexp
+    std::vector<transaction> txes;
+    std::vector<crypto::hash> tx_hashes;
+    txes.reserve(total_txes);
+    tx_hashes.reserve(total_txes);
+    for (const block_complete_entry &entry: blocks)
+    {
+      for (const blobdata &tx_blob: entry.txs)
+      {
+        transaction tx;
+        crypto::hash tx_hash, tx_prefix_hash;
+        if (!parse_and_validate_tx_from_blob(tx_blob, tx, tx_hash, tx_prefix_hash))
+          continue; // rejected later, when handled with its block
+        if (tx.version < 2 || tx.rct_signatures.type != rct::RCTTypeBulletproof || !is_canonical_bulletproof_layout(tx.rct_signatures.p.bulletproofs))
+          continue;
+        txes.push_back(std::move(tx));
+        tx_hashes.push_back(tx_hash);
+      }
+    }
+    if (txes.empty())
+      return;
+
+    std::vector<const rct::rctSig*> rvv;
+    rvv.reserve(txes.size());
+    for (const transaction &tx: txes)
+      rvv.push_back(&tx.rct_signatures);
+
+    if (rct::verRctSemanticsSimple(rvv))
+    {
+      m_batch_verified_txes.insert(tx_hashes.begin(), tx_hashes.end());
+      return;
+    }
+
+    // the bad ones are left for handle_incoming_txs to reject
+    LOG_PRINT_L1("One transaction among " << txes.size() << " in incoming blocks has bad semantics, verifying one at a time");
+    for (size_t n = 0; n < txes.size(); ++n)
+      if (txes.size() > 1 && rct::verRctSemanticsSimple(txes[n].rct_signatures))
+        m_batch_verified_txes.insert(tx_hashes[n]);
+  }
+  //-----------------------------------------------------------------------------------------------
   bool core::handle_incoming_txs(const std::vector<blobdata>& tx_blobs, std::vector<tx_verification_context>& tvc, bool keeped_by_block, bool relayed, bool do_not_relay)
   {
     TRY_ENTRY();
@@ -1359,6 +1425,7 @@ namespace cryptonote
   {
     m_incoming_tx_lock.lock();
     m_blockchain_storage.prepare_handle_incoming_blocks(blocks);
+    batch_verify_incoming_blocks_txes(blocks);
     return true;
   }
 
@@ -1370,6 +1437,7 @@ namespace cryptonote
       success = m_blockchain_storage.cleanup_handle_incoming_blocks(force_sync);
     }
     catch (...) {}
+    m_batch_verified_txes.clear();
     m_incoming_tx_lock.unlock();
     return success;
   }
@@ -1542,6 +1610,7 @@ namespace cryptonote
     m_txpool_auto_relayer.do_call(boost::bind(&core::relay_txpool_transactions, this));
     m_check_updates_interval.do_call(boost::bind(&core::check_updates, this));
     m_check_disk_space_interval.do_call(boost::bind(&core::check_disk_space, this));
+    m_blockchain_pruning_interval.do_call(boost::bind(&core::update_blockchain_pruning, this));
     m_miner.on_idle();
     m_mempool.on_idle();
     m_graft_stake_transaction_processor.synchronize();
@@ -1580,6 +1649,21 @@ namespace cryptonote
     return get_blockchain_storage().get_ideal_hard_fork_version(height);
   }
   //-----------------------------------------------------------------------------------------------
+  uint32_t core::get_blockchain_pruning_seed() const
+  {
+    return get_blockchain_storage().get_blockchain_pruning_seed();
+  }
+  //-----------------------------------------------------------------------------------------------
+  bool core::prune_blockchain(uint32_t pruning_seed)
+  {
+    return get_blockchain_storage().prune_blockchain(pruning_seed);
+  }
+  //-----------------------------------------------------------------------------------------------
+  bool core::update_blockchain_pruning()
+  {
+    return get_blockchain_storage().update_blockchain_pruning();
+  }
+  //-----------------------------------------------------------------------------------------------
   uint8_t core::get_hard_fork_version(uint64_t height) const
   {
     return get_blockchain_storage().get_hard_fork_version(height);
@@ -642,6 +642,22 @@ namespace cryptonote
       */
      uint8_t get_ideal_hard_fork_version(uint64_t height) const;
 
+     /**
+      * @brief get the pruning seed of the blockchain
+      *
+      * @return the seed, 0 if the blockchain is not pruned
+      */
+     uint32_t get_blockchain_pruning_seed() const;
+
+     /**
+      * @brief prune the blockchain
+      *
+      * @param pruning_seed the seed to prune with, 0 to keep the current one or pick a random stripe
+      *
+      * @return true on success
+      */
+     bool prune_blockchain(uint32_t pruning_seed = 0);
+
      /**
       * @brief return the hard fork version for a given block height
       *
@@ -891,6 +907,16 @@ namespace cryptonote
      struct tx_verification_batch_info { const cryptonote::transaction *tx; crypto::hash tx_hash; tx_verification_context &tvc; bool &result; };
      bool handle_incoming_tx_accumulated_batch(std::vector<tx_verification_batch_info> &tx_info, bool keeped_by_block);
 
+     /**
+      * @brief verifies the bulletproof txes of a set of incoming blocks in a single batch
+      *
+      * Txes which pass are remembered, so handle_incoming_tx_accumulated_batch
+      * does not verify their range proofs again while the blocks are added.
+      *
+      * @param blocks the blocks about to be added
+      */
+     void batch_verify_incoming_blocks_txes(const std::vector<block_complete_entry> &blocks);
+
      /**
       * @copydoc miner::on_block_chain_update
       *
@@ -970,6 +996,13 @@ namespace cryptonote
       */
      bool check_disk_space();
 
+     /**
+      * @brief prunes blocks which left the blockchain tip, if the blockchain is pruned
+      *
+      * @return true on success, false otherwise
+      */
+     bool update_blockchain_pruning();
+
      bool m_test_drop_download = true; //!< whether or not to drop incoming blocks (for testing)
 
      uint64_t m_test_drop_download_height = 0; //!< height under which to drop incoming blocks, if doing so
@@ -995,6 +1028,7 @@ namespace cryptonote
      epee::math_helper::once_a_time_seconds<60*2, false> m_txpool_auto_relayer; //!< interval for checking re-relaying txpool transactions
      epee::math_helper::once_a_time_seconds<60*60*12, true> m_check_updates_interval; //!< interval for checking for new versions
      epee::math_helper::once_a_time_seconds<60*10, true> m_check_disk_space_interval; //!< interval for checking for disk space
+     epee::math_helper::once_a_time_seconds<60*60, true> m_blockchain_pruning_interval; //!< interval for incremental pruning
 
      std::atomic<bool> m_starter_message_showed; //!< has the "daemon will sync now" message been shown?
 
@@ -1018,6 +1052,8 @@ namespace cryptonote
      std::unordered_set<crypto::hash> bad_semantics_txes[2];
      boost::mutex bad_semantics_txes_lock;
 
+     std::unordered_set<crypto::hash> m_batch_verified_txes; //!< txes of the blocks being added whose rct semantics passed, under m_incoming_tx_lock
+
      enum {
        UPDATES_DISABLED,
        UPDATES_NOTIFY,
@@ -1,8 +1,11 @@
 #include <string_tools.h>
+#include <misc_language.h>
 
 #include "stake_transaction_processor.h"
+#include "common/threadpool.h"
 #include "../graft_rta_config.h"
 
+#include <chrono>
 #include <mutex>
 
 
@@ -15,8 +18,8 @@ using namespace cryptonote;
 namespace
 {
 
-const char* STAKE_TRANSACTION_STORAGE_FILE_NAME = "stake_transactions.v2.bin";
-const char* BLOCKCHAIN_BASED_LIST_FILE_NAME     = "blockchain_based_list.v5.bin";
+const char* STAKE_TRANSACTION_STORAGE_FILE_NAME = "stake_transactions.v3.bin";
+const char* BLOCKCHAIN_BASED_LIST_FILE_NAME     = "blockchain_based_list.v7.bin";
 
 }
 
@@ -38,6 +41,8 @@ StakeTransactionProcessor::StakeTransactionProcessor(Blockchain& blockchain)
   : m_blockchain(blockchain)
   , m_stakes_need_update(true)
   , m_blockchain_based_list_need_update(true)
+  , m_supernode_keys_first_block()
+  , m_supernode_keys(std::make_shared<supernode_key_history>())
 {
 }
 
@@ -51,6 +56,61 @@ const supernode_stake* StakeTransactionProcessor::find_supernode_stake(uint64_t
   return m_storage->find_supernode_stake(block_number, supernode_public_id);
 }
 
+StakeTransactionProcessor::supernode_key_set_ptr StakeTransactionProcessor::get_supernode_keys(uint64_t block_number) const
+{
+  supernode_key_history_ptr history = std::atomic_load(&m_supernode_keys);
+
+  supernode_key_history::const_iterator it = history->find(block_number);
+
+  if (it == history->end())
+    return nullptr;
+
+  return it->second;
+}
+
+void StakeTransactionProcessor::publish_supernode_keys(uint64_t block_number)
+{
+  std::shared_ptr<supernode_key_set> keys = std::make_shared<supernode_key_set>();
+
+  for (const supernode_stake& stake : m_storage->get_supernode_stakes(block_number))
+  {
+    if (stake.amount < config::graft::TIER1_STAKE_AMOUNT)
+      continue;
+
+    crypto::public_key key;
+
+    if (!epee::string_tools::hex_to_pod(stake.supernode_public_id, key))
+      continue;
+
+    keys->insert(key);
+  }
+
+    //copy on write: readers keep using the previous history until they release it
+
+  std::shared_ptr<supernode_key_history> history = std::make_shared<supernode_key_history>(*std::atomic_load(&m_supernode_keys));
+
+  (*history)[block_number] = keys;
+
+  while (!history->empty() && history->begin()->first + config::graft::SUPERNODE_HISTORY_SIZE <= block_number)
+    history->erase(history->begin());
+
+  std::atomic_store(&m_supernode_keys, supernode_key_history_ptr(history));
+}
+
+void StakeTransactionProcessor::unpublish_supernode_keys(uint64_t first_block_number)
+{
+  supernode_key_history_ptr current = std::atomic_load(&m_supernode_keys);
+
+  if (current->lower_bound(first_block_number) == current->end())
+    return;
+
+  std::shared_ptr<supernode_key_history> history = std::make_shared<supernode_key_history>(*current);
+
+  history->erase(history->lower_bound(first_block_number), history->end());
+
+  std::atomic_store(&m_supernode_keys, supernode_key_history_ptr(history));
+}
+
 namespace
 {
 
@@ -148,108 +208,166 @@ void StakeTransactionProcessor::init_storages_impl()
   m_blockchain_based_list.reset(new BlockchainBasedList(m_config_dir + "/" + BLOCKCHAIN_BASED_LIST_FILE_NAME, first_block_number));
 }
 
-void StakeTransactionProcessor::process_block_stake_transaction(uint64_t block_index, const block& block, const crypto::hash& block_hash, bool update_storage)
+void StakeTransactionProcessor::extract_stake_transactions(network_type nettype, prepared_block& block)
 {
-  if (block_index <= m_storage->get_last_processed_block_index())
-    return;
+  const uint64_t block_index = block.block_index;
 
-  if (m_blockchain.get_hard_fork_version(block_index) >= config::graft::STAKE_TRANSACTION_PROCESSING_DB_VERSION)
-  {
-      //analyze block transactions and add new stake transactions if exist
+    //parse transactions, their prunable part is not fetched so a pruned DB gives the same stakes
 
-    stake_transaction stake_tx;
+  std::vector<transaction> txs;
 
-    std::vector<transaction> txs;
-    std::vector<crypto::hash> missed_txs;
-    
-    if (!m_blockchain.get_transactions(block.tx_hashes, txs, missed_txs))
+  txs.reserve(block.tx_blobs.size());
+
+  for (const blobdata& tx_blob : block.tx_blobs)
+  {
+    transaction tx;
+
+    if (!parse_and_validate_tx_base_from_blob(tx_blob, tx))
     {
-      MWARNING("Unable to get transactions for block #" << block_index);
-      return;
+      MWARNING("Unable to parse transaction at block #" << block_index);
+      continue;
     }
 
-    if (!missed_txs.empty())
-    {
-      MWARNING("Some transactions for block #" << block_index << " have been missed:");
+    txs.emplace_back(std::move(tx));
+  }
 
-      for (const crypto::hash& tx_hash : missed_txs)
-        MWARNING("  " << tx_hash);
-    }
+    //parse stake transactions and collect supernode signatures for batch check
 
-    for (const transaction& tx : txs)
+  struct stake_candidate
+  {
+    const transaction* tx;
+    crypto::hash tx_hash;
+    stake_transaction stake_tx;
+  };
+
+  std::vector<stake_candidate> candidates;
+  std::vector<crypto::signature_check> checks;
+
+  for (const transaction& tx : txs)
+  {
+    const crypto::hash tx_hash = get_transaction_prefix_hash(tx);
+
+    try
     {
-      const crypto::hash tx_hash = get_transaction_prefix_hash(tx);
+      stake_transaction stake_tx;
 
-      try
-      {
-        if (!get_graft_stake_tx_extra_from_extra(tx, stake_tx.supernode_public_id, stake_tx.supernode_public_address, stake_tx.supernode_signature, stake_tx.tx_secret_key))
-          continue;
+      if (!get_graft_stake_tx_extra_from_extra(tx, stake_tx.supernode_public_id, stake_tx.supernode_public_address, stake_tx.supernode_signature, stake_tx.tx_secret_key))
+        continue;
 
-        crypto::public_key W;
-        if (!epee::string_tools::hex_to_pod(stake_tx.supernode_public_id, W) || !check_key(W))
-        {
-          MWARNING("Ignore stake transaction at block #" << block_index << ", tx_hash=" << tx_hash
-            << " because of invalid supernode public identifier '" << stake_tx.supernode_public_id << "'");
-          continue;
-        }
+      crypto::public_key W;
+      if (!epee::string_tools::hex_to_pod(stake_tx.supernode_public_id, W) || !check_key(W))
+      {
+        MWARNING("Ignore stake transaction at block #" << block_index << ", tx_hash=" << tx_hash
+          << " because of invalid supernode public identifier '" << stake_tx.supernode_public_id << "'");
+        continue;
+      }
 
-        const bool is_subaddress = false;
-        std::string supernode_public_address_str = cryptonote::get_account_address_as_str(m_blockchain.nettype(), is_subaddress, stake_tx.supernode_public_address);
-        std::string data = supernode_public_address_str + ":" + stake_tx.supernode_public_id;
-        crypto::hash hash;
-        crypto::cn_fast_hash(data.data(), data.size(), hash);
+      const bool is_subaddress = false;
+      std::string supernode_public_address_str = cryptonote::get_account_address_as_str(nettype, is_subaddress, stake_tx.supernode_public_address);
+      std::string data = supernode_public_address_str + ":" + stake_tx.supernode_public_id;
+      crypto::hash hash;
+      crypto::cn_fast_hash(data.data(), data.size(), hash);
 
-        if (!crypto::check_signature(hash, W, stake_tx.supernode_signature))
-        {
-          MWARNING("Ignore stake transaction at block #" << block_index << ", tx_hash=" << tx_hash << ", supernode_public_id '" << stake_tx.supernode_public_id << "'"
-            << " because of invalid supernode signature (mismatch)");
-          continue;
-        }
+      checks.push_back({hash, W, stake_tx.supernode_signature});
+      candidates.push_back({&tx, tx_hash, std::move(stake_tx)});
+    }
+    catch (std::exception& e)
+    {
+      MWARNING("Ignore transaction at block #" << block_index << ", tx_hash=" << tx_hash << " because of error at parsing: " << e.what());
+    }
+    catch (...)
+    {
+      MWARNING("Ignore transaction at block #" << block_index << ", tx_hash=" << tx_hash << " because of unknown error at parsing");
+    }
+  }
 
-        uint64_t unlock_time = tx.unlock_time - block_index;
+  std::vector<size_t> failed_checks;
 
-        if (unlock_time < config::graft::STAKE_MIN_UNLOCK_TIME)
-        {
-          MWARNING("Ignore stake transaction at block #" << block_index << ", tx_hash=" << tx_hash << ", supernode_public_id '" << stake_tx.supernode_public_id << "'"
-            << " because unlock time " << unlock_time << " is less than minimum allowed " << config::graft::STAKE_MIN_UNLOCK_TIME);
-          continue;
-        }
-        const auto CURRENT_STAKE_MAX_UNLOCK_TIME = m_blockchain.get_current_hard_fork_version() < 16 ? config::graft::STAKE_MAX_UNLOCK_TIME_V15
-                                                                                                     : config::graft::STAKE_MAX_UNLOCK_TIME;
-        if (unlock_time > CURRENT_STAKE_MAX_UNLOCK_TIME)
-        {
-          MWARNING("Ignore stake transaction at block #" << block_index << ", tx_hash=" << tx_hash << ", supernode_public_id '" << stake_tx.supernode_public_id << "'"
-            << " because unlock time " << unlock_time << " is greater than maximum allowed " << CURRENT_STAKE_MAX_UNLOCK_TIME);
-          continue;
-        }
+  crypto::check_signatures(checks, &failed_checks);
 
-        uint64_t amount = get_transaction_amount(tx, stake_tx.supernode_public_address, stake_tx.tx_secret_key);
+  std::vector<size_t>::const_iterator failed_it = failed_checks.begin();
 
-        if (!amount)
-        {
-          MWARNING("Ignore stake transaction at block #" << block_index << ", tx_hash=" << tx_hash << ", supernode_public_id '" << stake_tx.supernode_public_id << "'"
-            << " because of error at parsing amount");
-          continue;
-        }
+  for (size_t i=0; i<candidates.size(); i++)
+  {
+    const transaction& tx = *candidates[i].tx;
+    const crypto::hash& tx_hash = candidates[i].tx_hash;
+    stake_transaction& stake_tx = candidates[i].stake_tx;
 
-        stake_tx.amount = amount;
-        stake_tx.block_height = block_index;
-        stake_tx.hash = tx_hash;
-        stake_tx.unlock_time = unlock_time;
+    if (failed_it != failed_checks.end() && *failed_it == i)
+    {
+      ++failed_it;
+      MWARNING("Ignore stake transaction at block #" << block_index << ", tx_hash=" << tx_hash << ", supernode_public_id '" << stake_tx.supernode_public_id << "'"
+        << " because of invalid supernode signature (mismatch)");
+      continue;
+    }
 
-        m_storage->add_tx(stake_tx);
+    try
+    {
+      uint64_t unlock_time = tx.unlock_time - block_index;
 
-        MDEBUG("New stake transaction found at block #" << block_index << ", tx_hash=" << tx_hash << ", supernode_public_id '" << stake_tx.supernode_public_id
-          << "', amount=" << amount / double(COIN));
+      if (unlock_time < config::graft::STAKE_MIN_UNLOCK_TIME)
+      {
+        MWARNING("Ignore stake transaction at block #" << block_index << ", tx_hash=" << tx_hash << ", supernode_public_id '" << stake_tx.supernode_public_id << "'"
+          << " because unlock time " << unlock_time << " is less than minimum allowed " << config::graft::STAKE_MIN_UNLOCK_TIME);
+        continue;
       }
-      catch (std::exception& e)
+
+      if (unlock_time > block.max_unlock_time)
       {
-        MWARNING("Ignore transaction at block #" << block_index << ", tx_hash=" << tx_hash << " because of error at parsing: " << e.what());
+        MWARNING("Ignore stake transaction at block #" << block_index << ", tx_hash=" << tx_hash << ", supernode_public_id '" << stake_tx.supernode_public_id << "'"
+          << " because unlock time " << unlock_time << " is greater than maximum allowed " << block.max_unlock_time);
+        continue;
       }
-      catch (...)
+
+      uint64_t amount = get_transaction_amount(tx, stake_tx.supernode_public_address, stake_tx.tx_secret_key);
+
+      if (!amount)
       {
-        MWARNING("Ignore transaction at block #" << block_index << ", tx_hash=" << tx_hash << " because of unknown error at parsing");
+        MWARNING("Ignore stake transaction at block #" << block_index << ", tx_hash=" << tx_hash << ", supernode_public_id '" << stake_tx.supernode_public_id << "'"
+          << " because of error at parsing amount");
+        continue;
       }
+
+      stake_tx.amount = amount;
+      stake_tx.block_height = block_index;
+      stake_tx.hash = tx_hash;
+      stake_tx.unlock_time = unlock_time;
+
+      block.stake_txs.emplace_back(std::move(stake_tx));
+    }
+    catch (std::exception& e)
+    {
+      MWARNING("Ignore transaction at block #" << block_index << ", tx_hash=" << tx_hash << " because of error at parsing: " << e.what());
+    }
+    catch (...)
+    {
+      MWARNING("Ignore transaction at block #" << block_index << ", tx_hash=" << tx_hash << " because of unknown error at parsing");
+    }
+  }
+
+    //transactions are not needed anymore
+
+  candidates.clear();
+  std::vector<blobdata>().swap(block.tx_blobs);
+}
+
+void StakeTransactionProcessor::process_block_stake_transaction(const prepared_block& block, bool update_storage)
+{
+  const uint64_t block_index = block.block_index;
+
+  if (block_index <= m_storage->get_last_processed_block_index())
+    return;
+
+  if (block.process_stakes)
+  {
+      //add new stake transactions if exist
+
+    for (const stake_transaction& stake_tx : block.stake_txs)
+    {
+      m_storage->add_tx(stake_tx);
+
+      MDEBUG("New stake transaction found at block #" << block_index << ", tx_hash=" << stake_tx.hash << ", supernode_public_id '" << stake_tx.supernode_public_id
+        << "', amount=" << stake_tx.amount / double(COIN));
     }
 
     m_stakes_need_update = true; //TODO: cache for stakes
@@ -257,21 +375,24 @@ void StakeTransactionProcessor::process_block_stake_transaction(uint64_t block_i
       //update supernode stakes
 
     m_storage->update_supernode_stakes(block_index);
+
+    if (block_index >= m_supernode_keys_first_block)
+      publish_supernode_keys(block_index);
   }
 
     //update cache entries and save storage
 
-  m_storage->add_last_processed_block(block_index, block_hash);
+  m_storage->add_last_processed_block(block_index, block.block_hash);
 
   if (update_storage)
     m_storage->store();
 }
 
-void StakeTransactionProcessor::process_block_blockchain_based_list(uint64_t block_index, const block& block, const crypto::hash& block_hash, bool update_storage)
+void StakeTransactionProcessor::process_block_blockchain_based_list(const prepared_block& block, bool update_storage)
 {
   uint64_t prev_block_height = m_blockchain_based_list->block_height();
 
-  m_blockchain_based_list->apply_block(block_index, block_hash, *m_storage);
+  m_blockchain_based_list->apply_block(block.block_index, block.block_hash, *m_storage);
 
   if (m_blockchain_based_list->need_store() || prev_block_height != m_blockchain_based_list->block_height())
   {
@@ -282,22 +403,33 @@ void StakeTransactionProcessor::process_block_blockchain_based_list(uint64_t blo
   }
 }
 
-void StakeTransactionProcessor::process_block(uint64_t block_index, const block& block, const crypto::hash& block_hash, bool update_storage)
+bool StakeTransactionProcessor::process_block(const prepared_block& block, bool update_storage)
 {
-  process_block_stake_transaction(block_index, block, block_hash, update_storage);
-  process_block_blockchain_based_list(block_index, block, block_hash, update_storage);
+    //check that block is built on top of the already processed one (blockchain may be switched between fetching and processing)
+
+  if (m_storage->has_last_processed_block() && block.block_index == m_storage->get_last_processed_block_index() + 1 &&
+      block.prev_block_hash != m_storage->get_last_processed_block_hash())
+  {
+    MWARNING("Block #" << block.block_index << " is not built on top of the processed block " << m_storage->get_last_processed_block_hash());
+    return false;
+  }
+
+  process_block_stake_transaction(block, update_storage);
+  process_block_blockchain_based_list(block, update_storage);
+
+  return true;
 }
 
-void StakeTransactionProcessor::synchronize()
+bool StakeTransactionProcessor::unroll_blocks(uint64_t& height, uint64_t& first_block_index)
 {
   std::unique_lock<epee::critical_section> storage_lock{m_storage_lock, std::defer_lock};
   std::unique_lock<Blockchain> blockchain_lock{m_blockchain, std::defer_lock};
   std::lock(storage_lock, blockchain_lock);
 
-  uint64_t height = m_blockchain.get_current_blockchain_height();
+  height = m_blockchain.get_current_blockchain_height();
 
   if (!height || m_blockchain.get_hard_fork_version(height - 1) < config::graft::STAKE_TRANSACTION_PROCESSING_DB_VERSION)
-    return;
+    return false;
 
   if (!m_storage || !m_blockchain_based_list)
   {
@@ -305,51 +437,131 @@ void StakeTransactionProcessor::synchronize()
   }
 
     //unroll already processed blocks for alternative chains
-  
-  try
+
+  while (m_storage->has_last_processed_block())
   {
-    while (m_storage->has_last_processed_block())
-    {
-      size_t   stake_tx_count = m_storage->get_tx_count();
-      uint64_t last_processed_block_index = m_storage->get_last_processed_block_index();
+    size_t   stake_tx_count = m_storage->get_tx_count();
+    uint64_t last_processed_block_index = m_storage->get_last_processed_block_index();
 
-      if (last_processed_block_index < height)
+    if (last_processed_block_index < height)
+    {
+      try
       {
-        try
-        {
-          const crypto::hash& last_processed_block_hash  = m_storage->get_last_processed_block_hash();
-          crypto::hash        last_blockchain_block_hash = m_blockchain.get_block_id_by_height(last_processed_block_index);
+        const crypto::hash& last_processed_block_hash  = m_storage->get_last_processed_block_hash();
+        crypto::hash        last_blockchain_block_hash = m_blockchain.get_block_id_by_height(last_processed_block_index);
 
-          if (!memcmp(&last_processed_block_hash.data[0], &last_blockchain_block_hash.data[0], sizeof(last_blockchain_block_hash.data)))
-            break; //latest block hash is the same as processed
-        }
-        catch (BLOCK_DNE&)
-        {
-          //block does not exist, waiting until it will be received
-          return;
-        }
+        if (!memcmp(&last_processed_block_hash.data[0], &last_blockchain_block_hash.data[0], sizeof(last_blockchain_block_hash.data)))
+          break; //latest block hash is the same as processed
       }
-      
-      MWARNING("Stake transactions processing: unroll block " << last_processed_block_index << " (height=" << height << ")");
+      catch (BLOCK_DNE&)
+      {
+        //block does not exist, waiting until it will be received
+        return false;
+      }
+    }
+
+    MWARNING("Stake transactions processing: unroll block " << last_processed_block_index << " (height=" << height << ")");
+
+    m_storage->remove_last_processed_block();
+
+    if (stake_tx_count != m_storage->get_tx_count())
+      m_storage->clear_supernode_stakes();
+
+    if (m_blockchain_based_list->block_height() == last_processed_block_index)
+      m_blockchain_based_list->remove_latest_block();
+  }
+
+  unpublish_supernode_keys(m_storage->get_last_processed_block_index() + 1);
+
+  m_supernode_keys_first_block = height > config::graft::SUPERNODE_HISTORY_SIZE ? height - config::graft::SUPERNODE_HISTORY_SIZE : 0;
+
+  first_block_index = m_storage->get_last_processed_block_index() + 1;
 
-      m_storage->remove_last_processed_block();
+  if (first_block_index > m_blockchain_based_list->block_height() + 1)
+    first_block_index = m_blockchain_based_list->block_height() + 1;
 
-      if (stake_tx_count != m_storage->get_tx_count())
-        m_storage->clear_supernode_stakes();
+  return true;
+}
+
+void StakeTransactionProcessor::fetch_blocks(uint64_t first_block_index, uint64_t last_block_index, uint64_t last_processed_stakes_block_index, prepared_block_array& blocks)
+{
+  blocks.clear();
+
+  CRITICAL_REGION_LOCAL1(m_blockchain);
+
+  const uint64_t max_unlock_time = m_blockchain.get_current_hard_fork_version() < 16 ? config::graft::STAKE_MAX_UNLOCK_TIME_V15
+                                                                                     : config::graft::STAKE_MAX_UNLOCK_TIME;
+
+  BlockchainDB& db = m_blockchain.get_db();
 
-      if (m_blockchain_based_list->block_height() == last_processed_block_index)
-        m_blockchain_based_list->remove_latest_block();
+  blocks.reserve(last_block_index - first_block_index);
+
+  for (uint64_t block_index=first_block_index; block_index<last_block_index; block_index++)
+  {
+    block blk;
+    crypto::hash block_hash;
+
+    try
+    {
+      block_hash = db.get_block_hash_from_height(block_index);
+      blk        = db.get_block_from_height(block_index);
     }
+    catch (BLOCK_DNE&)
+    {
+      //block does not exist, waiting until it will be received
+      break;
+    }
+
+    blocks.emplace_back();
 
-    //apply new blocks
+    prepared_block& prepared = blocks.back();
 
-    uint64_t first_block_index = m_storage->get_last_processed_block_index() + 1;
+    prepared.block_index     = block_index;
+    prepared.block_hash      = block_hash;
+    prepared.prev_block_hash = blk.prev_id;
+    prepared.process_stakes  = block_index > last_processed_stakes_block_index &&
+                               m_blockchain.get_hard_fork_version(block_index) >= config::graft::STAKE_TRANSACTION_PROCESSING_DB_VERSION;
+    prepared.max_unlock_time = max_unlock_time;
 
-    if (first_block_index > m_blockchain_based_list->block_height() + 1)
-      first_block_index = m_blockchain_based_list->block_height() + 1;
+    if (!prepared.process_stakes || blk.tx_hashes.empty())
+      continue;
+
+    std::vector<crypto::hash> missed_txs;
+
+    if (!m_blockchain.get_transactions_blobs(blk.tx_hashes, prepared.tx_blobs, missed_txs, true))
+    {
+      MWARNING("Unable to get transactions for block #" << block_index);
+      prepared.tx_blobs.clear();
+      continue;
+    }
+
+    if (!missed_txs.empty())
+    {
+      MWARNING("Some transactions for block #" << block_index << " have been missed:");
+
+      for (const crypto::hash& tx_hash : missed_txs)
+        MWARNING("  " << tx_hash);
+    }
+  }
+}
+
+void StakeTransactionProcessor::synchronize()
+{
+  CRITICAL_REGION_LOCAL(m_synchronize_lock);
+
+  try
+  {
+    uint64_t height = 0, first_block_index = 0;
+
+    if (!unroll_blocks(height, first_block_index))
+      return;
+
+      //apply new blocks: blocks are fetched in batches under blockchain lock, stake transactions are extracted
+      //on the thread pool, and the results are applied in order under storage lock while the next batch is prepared
 
     static const uint64_t SYNC_DEBUG_LOG_STEP  = 10000;
     static const uint64_t MAX_ITERATIONS_COUNT = 10000;
+    static const uint64_t FETCH_BATCH_SIZE     = 256;
 
     uint64_t last_block_index = first_block_index,
              last_block_index_for_sync = height;
@@ -357,37 +569,114 @@ void StakeTransactionProcessor::synchronize()
     if (last_block_index_for_sync - last_block_index > MAX_ITERATIONS_COUNT)
       last_block_index_for_sync = first_block_index + MAX_ITERATIONS_COUNT;
 
-    for (; last_block_index<last_block_index_for_sync; last_block_index++)
+    uint64_t last_processed_stakes_block_index = 0;
+
     {
-      if (last_block_index % SYNC_DEBUG_LOG_STEP == 0 || last_block_index == height - 1)
-        MDEBUG("RTA block sync " << last_block_index << "/" << (height - 1));
+      CRITICAL_REGION_LOCAL1(m_storage_lock);
+      last_processed_stakes_block_index = m_storage->get_last_processed_block_index();
+    }
 
-      try
+    tools::threadpool& tpool = tools::threadpool::getInstance();
+    prepared_block_array batches[2];
+    tools::threadpool::waiter waiters[2];
+
+      //extract tasks write into batches, so they must be finished on every exit path before batches are destroyed
+
+    auto wait_batches = epee::misc_utils::create_scope_leave_handler([&]() {
+      waiters[0].wait(&tpool);
+      waiters[1].wait(&tpool);
+    });
+
+    const size_t threads_count = std::max(1u, tpool.get_max_concurrency());
+    const network_type nettype = m_blockchain.nettype();
+
+    auto prepare_batch = [&](size_t slot, uint64_t first_index) {
+      prepared_block_array& batch = batches[slot];
+
+      fetch_blocks(first_index, std::min(first_index + FETCH_BATCH_SIZE, last_block_index_for_sync), last_processed_stakes_block_index, batch);
+
+      size_t chunk_size = (batch.size() + threads_count - 1) / threads_count;
+
+      for (size_t offset=0; offset<batch.size(); offset+=chunk_size)
       {
-        crypto::hash block_hash = m_blockchain.get_block_id_by_height(last_block_index);
-        block block;
+        size_t end = std::min(offset + chunk_size, batch.size());
+
+        tpool.submit(&waiters[slot], [nettype, &batch, offset, end]() {
+          for (size_t i=offset; i<end; i++)
+            if (batch[i].process_stakes)
+              extract_stake_transactions(nettype, batch[i]);
+        }, true);
+      }
+    };
 
-        if (!m_blockchain.get_block_by_hash(block_hash, block))
+    auto sync_start_time = std::chrono::steady_clock::now();
+    size_t slot = 0;
+    bool chain_switched = false;
+
+    if (first_block_index < last_block_index_for_sync)
+      prepare_batch(slot, first_block_index);
+
+    while (last_block_index < last_block_index_for_sync && !chain_switched)
+    {
+      waiters[slot].wait(&tpool);
+
+      prepared_block_array& batch = batches[slot];
+
+      if (batch.empty())
+        break; //block does not exist, waiting until it will be received
+
+      bool full_batch = last_block_index + batch.size() < last_block_index_for_sync && batch.size() == FETCH_BATCH_SIZE;
+
+      if (full_batch)
+        prepare_batch(slot ^ 1, last_block_index + batch.size());
+
+        //apply blocks in order
+
+      {
+        CRITICAL_REGION_LOCAL1(m_storage_lock);
+
+        for (const prepared_block& block : batch)
         {
-          MWARNING("Block with hash " << block_hash << " has not been found");
-          throw std::runtime_error("Error at parsing blockchain. Block hash has not been found");
-        }
+          if (block.block_index % SYNC_DEBUG_LOG_STEP == 0 || block.block_index == height - 1)
+            MDEBUG("RTA block sync " << block.block_index << "/" << (height - 1));
 
-        process_block(last_block_index, block, block_hash, false);
+          if (!process_block(block, false))
+          {
+            chain_switched = true;
+            break;
+          }
+
+          last_block_index = block.block_index + 1;
+        }
       }
-      catch (BLOCK_DNE&)
-      {
-        //block does not exist, waiting until it will be received
+
+      if (!full_batch)
         break;
-      }
+
+      slot ^= 1;
     }
 
+      //a batch may still be prefetching after a chain switch
+
+    waiters[0].wait(&tpool);
+    waiters[1].wait(&tpool);
+
+    CRITICAL_REGION_LOCAL1(m_storage_lock);
+
     if (m_blockchain_based_list->need_store())
       m_blockchain_based_list->store();
 
     if (m_storage->need_store())
       m_storage->store();
 
+    if (last_block_index != first_block_index)
+    {
+      double sync_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - sync_start_time).count();
+
+      MDEBUG("RTA block sync: " << (last_block_index - first_block_index) << " block(s) processed in " << sync_time << " s ("
+        << (sync_time > 0 ? (last_block_index - first_block_index) / sync_time : 0.0) << " blocks/s)");
+    }
+
     if (last_block_index == height)
     {
       if (m_stakes_need_update && m_on_stakes_update)
@@ -466,7 +755,9 @@ void StakeTransactionProcessor::invoke_update_blockchain_based_list_handler_impl
 
     uint64_t height = m_blockchain_based_list->block_height();
 
-    for (size_t i=0; i<depth; i++)
+      //oldest list first, so consecutive lists can be delivered as deltas
+
+    for (size_t i=depth; i--;)
       m_on_blockchain_based_list_update(height - i, m_blockchain_based_list->tiers(i));
 
     m_blockchain_based_list_need_update = false;
@@ -1,17 +1,22 @@
 #pragma once
 
 #include <functional>
+#include <map>
 #include <memory>
+#include <unordered_set>
 
 #include "blockchain.h"
 #include "cryptonote_core/blockchain_based_list.h"
 #include "cryptonote_core/stake_transaction_storage.h"
 
+class StakeTransactionProcessor_pruned_stake_blobs_Test;
+
 namespace cryptonote
 {
 
 class StakeTransactionProcessor
 {
+  friend class ::StakeTransactionProcessor_pruned_stake_blobs_Test;
 public:
   typedef StakeTransactionStorage::supernode_stake_array supernode_stake_array;
 
@@ -23,6 +28,12 @@ public:
   /// Search supernode stake by supernode public id (returns nullptr if no stake is found)
   const supernode_stake* find_supernode_stake(uint64_t block_number, const std::string& supernode_public_id) const;
 
+  typedef std::unordered_set<crypto::public_key>   supernode_key_set;
+  typedef std::shared_ptr<const supernode_key_set> supernode_key_set_ptr;
+
+  /// Keys of supernodes with valid stakes for the block (returns nullptr if the block is out of published history); lock free
+  supernode_key_set_ptr get_supernode_keys(uint64_t block_number) const;
+
   /// Synchronize with blockchain
   void synchronize();
 
@@ -50,12 +61,38 @@ public:
   bool is_enabled() const;
 
 private:
+  /// Block prepared for processing: transaction blobs are fetched from DB and stake transactions are extracted in parallel
+  struct prepared_block
+  {
+    uint64_t block_index;
+    crypto::hash block_hash;
+    crypto::hash prev_block_hash;
+    bool process_stakes;      //block has to be analyzed for stake transactions
+    uint64_t max_unlock_time; //maximum allowed unlock time for stakes
+    std::vector<blobdata> tx_blobs; //pruned blobs, prefix and RCT base are all stakes need
+    std::vector<stake_transaction> stake_txs;
+  };
+
+  typedef std::vector<prepared_block> prepared_block_array;
+
   void init_storages_impl();
-  void process_block(uint64_t block_index, const block& block, const crypto::hash& block_hash, bool update_storage = true);
+  bool unroll_blocks(uint64_t& height, uint64_t& first_block_index);
+  void fetch_blocks(uint64_t first_block_index, uint64_t last_block_index, uint64_t last_processed_stakes_block_index, prepared_block_array& blocks);
+  static void extract_stake_transactions(network_type nettype, prepared_block& block);
+  bool process_block(const prepared_block& block, bool update_storage = true);
   void invoke_update_stakes_handler_impl(uint64_t block_index);
   void invoke_update_blockchain_based_list_handler_impl(size_t depth);
-  void process_block_stake_transaction(uint64_t block_index, const block& block, const crypto::hash& block_hash, bool update_storage = true);
-  void process_block_blockchain_based_list(uint64_t block_index, const block& block, const crypto::hash& block_hash, bool update_storage = true);
+  void process_block_stake_transaction(const prepared_block& block, bool update_storage = true);
+  void process_block_blockchain_based_list(const prepared_block& block, bool update_storage = true);
+
+  typedef std::map<uint64_t, supernode_key_set_ptr>   supernode_key_history;
+  typedef std::shared_ptr<const supernode_key_history> supernode_key_history_ptr;
+
+  /// Publish keys of supernodes with valid stakes for the block
+  void publish_supernode_keys(uint64_t block_number);
+
+  /// Withdraw published keys for blocks starting from the specified one
+  void unpublish_supernode_keys(uint64_t first_block_number);
 
 private:
   std::string m_config_dir;
@@ -63,11 +100,14 @@ private:
   std::unique_ptr<StakeTransactionStorage> m_storage;
   std::unique_ptr<BlockchainBasedList> m_blockchain_based_list;
   mutable epee::critical_section m_storage_lock;
+  epee::critical_section m_synchronize_lock;
   supernode_stakes_update_handler m_on_stakes_update;
   blockchain_based_list_update_handler m_on_blockchain_based_list_update;
   bool m_stakes_need_update;
   bool m_blockchain_based_list_need_update;
   bool m_enabled {true};
+  uint64_t m_supernode_keys_first_block;          //first block which keys are published during synchronization
+  supernode_key_history_ptr m_supernode_keys;     //accessed only via std::atomic_load / std::atomic_store
 };
 
 }
@@ -15,6 +15,8 @@ namespace
 
 const uint64_t BLOCK_HASHES_HISTORY_DEPTH       = 1000;
 const uint64_t STAKE_TRANSACTIONS_HISTORY_DEPTH = BLOCK_HASHES_HISTORY_DEPTH + config::graft::STAKE_VALIDATION_PERIOD + config::graft::TRUSTED_RESTAKING_PERIOD;
+const uint32_t STAKE_TRANSACTIONS_JOURNAL_FORMAT_VERSION       = 3;
+const size_t   STAKE_TRANSACTIONS_JOURNAL_COMPACTION_THRESHOLD = 1000; //number of records after the last snapshot
 
 struct stake_transaction_file_data
 {
@@ -40,6 +42,19 @@ struct stake_transaction_file_data
   END_SERIALIZE()
 };
 
+struct stake_transaction_block_record
+{
+  uint64_t block_index;
+  crypto::hash block_hash;
+  StakeTransactionStorage::stake_transaction_array stake_txs;
+
+  BEGIN_SERIALIZE_OBJECT()
+    FIELD(block_index)
+    FIELD(block_hash)
+    FIELD(stake_txs)
+  END_SERIALIZE()
+};
+
 }
 
 StakeTransactionStorage::StakeTransactionStorage(const std::string& storage_file_name, uint64_t first_block_number)
@@ -49,6 +64,10 @@ StakeTransactionStorage::StakeTransactionStorage(const std::string& storage_file
   , m_need_store()
   , m_supernode_stakes_update_block_number()
   , m_first_block_number(first_block_number)
+  , m_journal(storage_file_name, STAKE_TRANSACTIONS_JOURNAL_FORMAT_VERSION, STAKE_TRANSACTIONS_JOURNAL_COMPACTION_THRESHOLD)
+  , m_journal_first_tx_index()
+  , m_stake_index_built()
+  , m_stake_index_block_number()
 {
   load();
 }
@@ -58,6 +77,28 @@ void StakeTransactionStorage::add_tx(const stake_transaction& tx)
   m_stake_txs.push_back(tx);
 
   m_need_store = true;
+
+  if (!m_stake_index_built)
+    return;
+
+    //register new transaction in the index of stakes
+
+  try
+  {
+    size_t tx_index = m_stake_txs.size() - 1;
+
+    m_stake_tx_states.push_back(stake_transaction_state_excluded);
+
+    add_tx_events(tx_index);
+    set_tx_state(tx_index, get_tx_state(tx, m_stake_index_block_number));
+  }
+  catch (...)
+  {
+    clear_supernode_stakes();
+    throw;
+  }
+
+  m_supernode_stakes_update_block_number = 0; //force refill of supernode stakes
 }
 
 const crypto::hash& StakeTransactionStorage::get_last_processed_block_hash() const
@@ -69,6 +110,29 @@ const crypto::hash& StakeTransactionStorage::get_last_processed_block_hash() con
 }
 
 void StakeTransactionStorage::add_last_processed_block(uint64_t index, const crypto::hash& hash)
+{
+  add_last_processed_block_impl(index, hash);
+
+    //journal block with transactions which have been added since the previous block
+
+  stake_transaction_block_record record;
+
+  record.block_index = index;
+  record.block_hash  = hash;
+
+  record.stake_txs.assign(m_stake_txs.begin() + m_journal_first_tx_index, m_stake_txs.end());
+
+  std::string data;
+
+  if (!::serialization::dump_binary(record, data))
+    throw std::runtime_error("internal error: failed to serialize stake transactions journal record");
+
+  m_journal.append(StorageJournal::record_type_block, data);
+
+  m_journal_first_tx_index = m_stake_txs.size();
+}
+
+void StakeTransactionStorage::add_last_processed_block_impl(uint64_t index, const crypto::hash& hash)
 {
   if (index != m_last_processed_block_index + 1)
     throw std::runtime_error("internal error: new block index must be compared to the already processed block index");
@@ -90,16 +154,40 @@ void StakeTransactionStorage::add_last_processed_block(uint64_t index, const cry
 }
 
 void StakeTransactionStorage::remove_last_processed_block()
+{
+  if (!m_last_processed_block_hashes_count)
+    return;
+
+  remove_last_processed_block_impl();
+
+  m_journal.append(StorageJournal::record_type_tombstone, std::string());
+
+  if (m_journal_first_tx_index != m_stake_txs.size())
+  {
+      //transactions of not finished block can't be restored from journal
+
+    m_journal.request_compaction();
+  }
+
+  m_journal_first_tx_index = m_stake_txs.size();
+}
+
+void StakeTransactionStorage::remove_last_processed_block_impl()
 {
   if (!m_last_processed_block_hashes_count)
     return;
 
   m_need_store = true;
 
+  size_t stake_tx_count = m_stake_txs.size();
+
   m_stake_txs.erase(std::remove_if(m_stake_txs.begin(), m_stake_txs.end(), [&](const stake_transaction& tx) {
     return tx.block_height == m_last_processed_block_index;
   }), m_stake_txs.end());
 
+  if (stake_tx_count != m_stake_txs.size())
+    reset_stake_index();
+
   m_last_processed_block_hashes_count--;
   m_last_processed_block_index--;
 
@@ -111,6 +199,8 @@ void StakeTransactionStorage::remove_last_processed_block()
 
     m_stake_txs.clear();
 
+    reset_stake_index();
+
     m_last_processed_block_index = m_first_block_number;
   }
 }
@@ -127,6 +217,8 @@ void StakeTransactionStorage::clear_supernode_stakes()
   m_supernode_stake_indexes.clear();
 
   m_supernode_stakes_update_block_number = 0;
+
+  reset_stake_index();
 }
 
 namespace
@@ -143,11 +235,238 @@ unsigned int get_tier(uint64_t stake)
 
 }
 
+StakeTransactionStorage::stake_transaction_state StakeTransactionStorage::get_tx_state(const stake_transaction& tx, uint64_t block_number)
+{
+  if (tx.is_valid(block_number))
+    return stake_transaction_state_valid;
+
+  uint64_t first_history_block = block_number - config::graft::SUPERNODE_HISTORY_SIZE;
+
+  if (tx.block_height + tx.unlock_time < first_history_block)
+    return stake_transaction_state_excluded;
+
+  return stake_transaction_state_obsolete;
+}
+
+void StakeTransactionStorage::add_tx_events(size_t tx_index)
+{
+  const stake_transaction& tx = m_stake_txs[tx_index];
+
+    //state of transaction may change only at following blocks (see get_tx_state); the beginning of supernodes history
+    //at block SUPERNODE_HISTORY_SIZE is common for all transactions and is processed in move_stake_index
+
+  const uint64_t events[] = {
+    tx.block_height + config::graft::STAKE_VALIDATION_PERIOD,
+    tx.block_height + tx.unlock_time + config::graft::TRUSTED_RESTAKING_PERIOD,
+    tx.block_height + tx.unlock_time + config::graft::SUPERNODE_HISTORY_SIZE + 1,
+  };
+
+  for (uint64_t event_block_number : events)
+    m_stake_tx_events[event_block_number].push_back(tx_index);
+}
+
+void StakeTransactionStorage::set_tx_state(size_t tx_index, stake_transaction_state state)
+{
+  stake_transaction_state prev_state = static_cast<stake_transaction_state>(m_stake_tx_states[tx_index]);
+
+  if (prev_state == state)
+    return;
+
+  const stake_transaction& tx = m_stake_txs[tx_index];
+
+  uint64_t first_block = tx.block_height + config::graft::STAKE_VALIDATION_PERIOD,
+           last_block  = tx.block_height + tx.unlock_time + config::graft::TRUSTED_RESTAKING_PERIOD;
+
+  MDEBUG("...stake transaction " << tx.hash << " of supernode " << tx.supernode_public_id << " changes state from " << int(prev_state) << " to " << int(state));
+
+    //remove previous state from aggregated stake
+
+  if (prev_state != stake_transaction_state_excluded)
+  {
+    supernode_stake_aggregate_map::iterator it = m_supernode_stake_aggregates.find(tx.supernode_public_id);
+
+    if (it == m_supernode_stake_aggregates.end())
+      throw std::runtime_error("internal error: aggregated stake for supernode '" + tx.supernode_public_id + "' is not found");
+
+    supernode_stake_aggregate& aggregate = it->second;
+
+    if (prev_state == stake_transaction_state_valid)
+    {
+      aggregate.amount -= tx.amount;
+      aggregate.first_blocks.erase(aggregate.first_blocks.find(first_block));
+      aggregate.last_blocks.erase(aggregate.last_blocks.find(last_block));
+    }
+
+    aggregate.txs.erase(tx_index);
+
+    if (aggregate.txs.empty())
+      m_supernode_stake_aggregates.erase(it);
+  }
+
+    //add new state to aggregated stake
+
+  if (state != stake_transaction_state_excluded)
+  {
+    supernode_stake_aggregate& aggregate = m_supernode_stake_aggregates[tx.supernode_public_id];
+
+    if (state == stake_transaction_state_valid)
+    {
+      aggregate.amount += tx.amount;
+      aggregate.first_blocks.insert(first_block);
+      aggregate.last_blocks.insert(last_block);
+    }
+
+    aggregate.txs.insert(tx_index);
+  }
+
+  m_stake_tx_states[tx_index] = state;
+}
+
+void StakeTransactionStorage::reset_stake_index()
+{
+  m_stake_index_built = false;
+  m_stake_index_block_number = 0;
+
+  m_stake_tx_events.clear();
+  m_stake_tx_states.clear();
+  m_supernode_stake_aggregates.clear();
+}
+
+void StakeTransactionStorage::build_stake_index(uint64_t block_number)
+{
+  MDEBUG("Build index of stakes for block " << block_number);
+
+  reset_stake_index();
+
+  m_stake_tx_states.resize(m_stake_txs.size(), stake_transaction_state_excluded);
+
+  for (size_t i=0, count=m_stake_txs.size(); i<count; i++)
+  {
+    add_tx_events(i);
+    set_tx_state(i, get_tx_state(m_stake_txs[i], block_number));
+  }
+
+  m_stake_index_block_number = block_number;
+  m_stake_index_built = true;
+}
+
+void StakeTransactionStorage::move_stake_index(uint64_t block_number)
+{
+  uint64_t prev_block_number = m_stake_index_block_number;
+
+  if (block_number == prev_block_number)
+    return;
+
+  if ((prev_block_number < config::graft::SUPERNODE_HISTORY_SIZE) != (block_number < config::graft::SUPERNODE_HISTORY_SIZE))
+  {
+      //beginning of supernodes history changes state of all transactions
+
+    build_stake_index(block_number);
+    return;
+  }
+
+  MDEBUG("Move index of stakes from block " << prev_block_number << " to block " << block_number);
+
+    //an event at block N means that transaction state may differ for blocks N-1 and N
+
+  uint64_t min_block_number = std::min(prev_block_number, block_number),
+           max_block_number = std::max(prev_block_number, block_number);
+
+  for (stake_transaction_event_map::const_iterator it=m_stake_tx_events.upper_bound(min_block_number), end=m_stake_tx_events.end(); it!=end && it->first <= max_block_number; ++it)
+  {
+    for (size_t tx_index : it->second)
+      set_tx_state(tx_index, get_tx_state(m_stake_txs[tx_index], block_number));
+  }
+
+  m_stake_index_block_number = block_number;
+}
+
+void StakeTransactionStorage::fill_supernode_stakes()
+{
+  m_supernode_stakes.clear();
+  m_supernode_stake_indexes.clear();
+
+    //order supernodes by the first stake transaction as it is done during the full rebuild
+
+  typedef std::pair<size_t, const supernode_stake_aggregate_map::value_type*> ordered_aggregate;
+
+  std::vector<ordered_aggregate> aggregates;
+
+  aggregates.reserve(m_supernode_stake_aggregates.size());
+
+  for (const supernode_stake_aggregate_map::value_type& aggregate : m_supernode_stake_aggregates)
+    aggregates.push_back(std::make_pair(*aggregate.second.txs.begin(), &aggregate));
+
+  std::sort(aggregates.begin(), aggregates.end(), [](const ordered_aggregate& a1, const ordered_aggregate& a2) {
+    return a1.first < a2.first;
+  });
+
+  m_supernode_stakes.reserve(aggregates.size());
+
+  for (const ordered_aggregate& it : aggregates)
+  {
+    const std::string& supernode_public_id = it.second->first;
+    const supernode_stake_aggregate& aggregate = it.second->second;
+
+    supernode_stake stake;
+
+    if (aggregate.first_blocks.empty())
+    {
+      stake.amount       = 0;
+      stake.tier         = 0;
+      stake.block_height = 0;
+      stake.unlock_time  = 0;
+    }
+    else
+    {
+        //intersection of stake transaction intervals
+
+      uint64_t min_block_height = *aggregate.first_blocks.rbegin(),
+               max_block_height = *aggregate.last_blocks.begin();
+
+      if (max_block_height <= min_block_height)
+        max_block_height = min_block_height;
+
+      stake.amount       = aggregate.amount;
+      stake.tier         = get_tier(stake.amount);
+      stake.block_height = min_block_height;
+      stake.unlock_time  = max_block_height - min_block_height;
+    }
+
+    stake.supernode_public_id      = supernode_public_id;
+    stake.supernode_public_address = m_stake_txs[it.first].supernode_public_address;
+
+    m_supernode_stakes.emplace_back(std::move(stake));
+
+    m_supernode_stake_indexes[supernode_public_id] = m_supernode_stakes.size() - 1;
+  }
+}
+
 void StakeTransactionStorage::update_supernode_stakes(uint64_t block_number)
 {
   if (block_number == m_supernode_stakes_update_block_number)
     return;
 
+  try
+  {
+    if (m_stake_index_built)
+      move_stake_index(block_number);
+    else
+      build_stake_index(block_number);
+
+    fill_supernode_stakes();
+  }
+  catch (...)
+  {
+    clear_supernode_stakes();
+    throw;
+  }
+
+  m_supernode_stakes_update_block_number = block_number;
+}
+
+void StakeTransactionStorage::rebuild_supernode_stakes(uint64_t block_number)
+{
   MDEBUG("Build stakes for block " << block_number);
 
   m_supernode_stakes.clear();
@@ -293,25 +612,22 @@ const supernode_stake* StakeTransactionStorage::find_supernode_stake(uint64_t bl
 
 void StakeTransactionStorage::load()
 {
-  if (!boost::filesystem::exists(m_storage_file_name))
-    return;
+  StorageJournal::record_array records;
 
-  std::string buffer;
-  bool r = epee::file_io_utils::load_file_to_string(m_storage_file_name, buffer);
-
-  CHECK_AND_ASSERT_THROW_MES(r, "stake transaction storage file '" << m_storage_file_name << "' is not found");
+  if (!m_journal.load(records))
+    return;
 
   try
   {
-    LOG_PRINT_L0("Trying to parse stake transaction file");
+    LOG_PRINT_L0("Trying to parse stake transaction journal");
 
     StakeTransactionStorage::stake_transaction_array tmp_stake_txs;
     StakeTransactionStorage::block_hash_list tmp_block_hashes;
     stake_transaction_file_data data(0, tmp_stake_txs, 0, tmp_block_hashes);
 
-    r = ::serialization::parse_binary(buffer, data);
+    bool r = ::serialization::parse_binary(records.front().data, data);
 
-    CHECK_AND_ASSERT_THROW_MES(r, "internal error: failed to deserialize stake transaction storage file '" << m_storage_file_name << "'");
+    CHECK_AND_ASSERT_THROW_MES(r, "internal error: failed to deserialize stake transaction storage snapshot from '" << m_storage_file_name << "'");
 
     m_last_processed_block_index        = data.last_processed_block_index;
     m_last_processed_block_hashes_count = data.last_processed_block_hashes_count;
@@ -319,30 +635,69 @@ void StakeTransactionStorage::load()
     std::swap(m_stake_txs, data.stake_txs);
     std::swap(m_last_processed_block_hashes, data.block_hashes);
 
+      //replay journal tail after the snapshot
+
+    for (size_t i=1; i<records.size(); i++)
+    {
+      const StorageJournal::record& record = records[i];
+
+      switch (record.type)
+      {
+        case StorageJournal::record_type_block:
+        {
+          stake_transaction_block_record block_record;
+
+          r = ::serialization::parse_binary(record.data, block_record);
+
+          CHECK_AND_ASSERT_THROW_MES(r, "internal error: failed to deserialize stake transaction journal record from '" << m_storage_file_name << "'");
+
+          for (const stake_transaction& tx : block_record.stake_txs)
+            add_tx(tx);
+
+          add_last_processed_block_impl(block_record.block_index, block_record.block_hash);
+
+          break;
+        }
+        case StorageJournal::record_type_tombstone:
+          remove_last_processed_block_impl();
+          break;
+        default:
+          throw std::runtime_error("internal error: unexpected stake transaction journal record type");
+      }
+    }
+
+    m_journal_first_tx_index = m_stake_txs.size();
+
     m_need_store = false;
+
+    LOG_PRINT_L0("Stake transaction journal has been loaded: " << records.size() - 1 << " record(s) after snapshot, last processed block is " << m_last_processed_block_index);
   }
   catch (...)
   {
-    LOG_PRINT_L0("Can't parse stake transaction storage file '" << m_storage_file_name << "'");
+    LOG_PRINT_L0("Can't parse stake transaction journal '" << m_storage_file_name << "'");
     throw;
   }
 }
 
 void StakeTransactionStorage::store() const
 {
-  stake_transaction_file_data data(m_last_processed_block_index, const_cast<stake_transaction_array&>(m_stake_txs),
-    m_last_processed_block_hashes_count, const_cast<block_hash_list&>(m_last_processed_block_hashes));
+  if (m_journal.need_compaction())
+  {
+    stake_transaction_file_data data(m_last_processed_block_index, const_cast<stake_transaction_array&>(m_stake_txs),
+      m_last_processed_block_hashes_count, const_cast<block_hash_list&>(m_last_processed_block_hashes));
 
-  std::ofstream ostr;
-  ostr.open(m_storage_file_name, std::ios_base::binary | std::ios_base::out | std::ios_base::trunc);
+    std::string snapshot;
 
-  binary_archive<true> oar(ostr);
+    bool success = ::serialization::dump_binary(data, snapshot);
 
-  bool success = ::serialization::serialize(oar, data);
+    CHECK_AND_ASSERT_THROW_MES(success, "Error at serialization of stake transaction storage snapshot for '" << m_storage_file_name << "'");
 
-  ostr.close();
-  
-  CHECK_AND_ASSERT_THROW_MES(success && ostr.good(), "Error at save stake transaction storage file '" << m_storage_file_name << "'");
+    m_journal.compact(snapshot);
+  }
+  else
+  {
+    m_journal.flush();
+  }
 
   m_need_store = false;
 }
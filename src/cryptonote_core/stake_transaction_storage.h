@@ -2,6 +2,8 @@
 
 #include <cryptonote_config.h>
 #include <list>
+#include <map>
+#include <set>
 #include <unordered_map>
 
 #include "crypto/hash.h"
@@ -10,6 +12,7 @@
 #include "serialization/list.h"
 #include "serialization/vector.h"
 #include "serialization/string.h"
+#include "storage_journal.h"
 
 namespace cryptonote
 {
@@ -88,24 +91,77 @@ public:
   /// Search supernode stake by supernode public id (returns nullptr if no stake is found)
   const supernode_stake* find_supernode_stake(uint64_t block_number, const std::string& supernode_public_id);
 
-  /// Update supernode stakes
+  /// Update supernode stakes (incrementally moves aggregated stakes to the specified block)
   void update_supernode_stakes(uint64_t block_number);
 
+  /// Rebuild supernode stakes from scratch by scanning all stake transactions
+  void rebuild_supernode_stakes(uint64_t block_number);
+
   /// Clear supernode stakes
   void clear_supernode_stakes();
 
-  /// Save storage to file
+  /// Save storage changes to journal file
   void store() const;
 
   /// Is the list requires store
   bool need_store() const { return m_need_store; }
 
 private:
-  /// Load storage from file
+  /// Load storage from journal file
   void load();
 
+  /// Add new processed block without journaling
+  void add_last_processed_block_impl(uint64_t index, const crypto::hash& hash);
+
+  /// Remove processed block without journaling
+  void remove_last_processed_block_impl();
+
   typedef std::unordered_map<std::string, size_t> supernode_stake_index_map;
 
+  /// State of stake transaction for a block
+  enum stake_transaction_state
+  {
+    stake_transaction_state_excluded, //transaction is not used for stakes
+    stake_transaction_state_obsolete, //transaction indicates supernode presence with zero amount
+    stake_transaction_state_valid,    //transaction amount is added to supernode stake
+  };
+
+  /// Aggregated stake of a supernode built from stake transactions active at the index block
+  struct supernode_stake_aggregate
+  {
+    std::set<size_t> txs;                    //indexes of valid and obsolete stake transactions
+    uint64_t amount;                         //sum of valid stake transactions amounts
+    std::multiset<uint64_t> first_blocks;    //first valid blocks of valid stake transactions
+    std::multiset<uint64_t> last_blocks;     //last valid blocks (exclusive) of valid stake transactions
+
+    supernode_stake_aggregate() : amount() {}
+  };
+
+  typedef std::unordered_map<std::string, supernode_stake_aggregate> supernode_stake_aggregate_map;
+  typedef std::map<uint64_t, std::vector<size_t>>                    stake_transaction_event_map;
+  typedef std::vector<unsigned char>                                 stake_transaction_state_array;
+
+  /// Get state of stake transaction for the block
+  static stake_transaction_state get_tx_state(const stake_transaction& tx, uint64_t block_number);
+
+  /// Register blocks where state of the transaction may change
+  void add_tx_events(size_t tx_index);
+
+  /// Apply new state of transaction to aggregated stakes
+  void set_tx_state(size_t tx_index, stake_transaction_state state);
+
+  /// Build index of stakes for the block from scratch
+  void build_stake_index(uint64_t block_number);
+
+  /// Move index of stakes to the block using only transactions which state changes in between
+  void move_stake_index(uint64_t block_number);
+
+  /// Reset index of stakes
+  void reset_stake_index();
+
+  /// Fill list of supernode stakes from index
+  void fill_supernode_stakes();
+
 private:
   std::string m_storage_file_name;
   uint64_t m_last_processed_block_index;
@@ -117,6 +173,13 @@ private:
   supernode_stake_index_map m_supernode_stake_indexes;
   uint64_t m_first_block_number;
   mutable bool m_need_store;
+  mutable StorageJournal m_journal;
+  size_t m_journal_first_tx_index;
+  bool m_stake_index_built;
+  uint64_t m_stake_index_block_number;
+  stake_transaction_event_map m_stake_tx_events;
+  stake_transaction_state_array m_stake_tx_states;
+  supernode_stake_aggregate_map m_supernode_stake_aggregates;
 };
 
 }
@@ -0,0 +1,265 @@
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#include <boost/crc.hpp>
+#include <boost/filesystem.hpp>
+
+#include "misc_log_ex.h"
+#include "storage_journal.h"
+
+#undef MONERO_DEFAULT_LOG_CATEGORY
+#define MONERO_DEFAULT_LOG_CATEGORY "storage.journal"
+
+using namespace cryptonote;
+
+namespace
+{
+
+const char     JOURNAL_MAGIC[8]   = {'G', 'R', 'F', 'T', 'J', 'R', 'N', 'L'};
+const size_t   JOURNAL_HEADER_SIZE = sizeof(JOURNAL_MAGIC) + sizeof(uint32_t);
+const size_t   RECORD_HEADER_SIZE  = 1 + sizeof(uint32_t); //type + payload size
+const size_t   RECORD_FOOTER_SIZE  = sizeof(uint32_t);     //checksum
+const uint32_t MAX_RECORD_SIZE     = 256 * 1024 * 1024;
+
+void write_uint32(std::string& buffer, uint32_t value)
+{
+  for (size_t i=0; i<sizeof(value); i++)
+    buffer.push_back(static_cast<char>((value >> (8 * i)) & 0xff));
+}
+
+uint32_t read_uint32(const char* buffer)
+{
+  uint32_t value = 0;
+
+  for (size_t i=0; i<sizeof(value); i++)
+    value |= uint32_t(static_cast<unsigned char>(buffer[i])) << (8 * i);
+
+  return value;
+}
+
+uint32_t get_checksum(const char* data, size_t size)
+{
+  boost::crc_32_type crc;
+  crc.process_bytes(data, size);
+  return crc.checksum();
+}
+
+std::string get_journal_header(uint32_t format_version)
+{
+  std::string header(JOURNAL_MAGIC, sizeof(JOURNAL_MAGIC));
+  write_uint32(header, format_version);
+  return header;
+}
+
+void serialize_record(std::string& buffer, StorageJournal::record_type type, const std::string& data)
+{
+  size_t offset = buffer.size();
+
+  buffer.push_back(static_cast<char>(type));
+  write_uint32(buffer, static_cast<uint32_t>(data.size()));
+  buffer.append(data);
+  write_uint32(buffer, get_checksum(buffer.data() + offset, buffer.size() - offset));
+}
+
+void write_file(const std::string& file_name, const std::string& buffer, bool append, bool sync)
+{
+  FILE* file = fopen(file_name.c_str(), append ? "ab" : "wb");
+
+  CHECK_AND_ASSERT_THROW_MES(file, "Error at opening journal file '" << file_name << "'");
+
+  bool success = fwrite(buffer.data(), 1, buffer.size(), file) == buffer.size() && !fflush(file);
+
+  if (success && sync)
+  {
+#ifdef _WIN32
+    success = !_commit(_fileno(file));
+#else
+    success = !fsync(fileno(file));
+#endif
+  }
+
+  success = !fclose(file) && success;
+
+  CHECK_AND_ASSERT_THROW_MES(success, "Error at writing journal file '" << file_name << "'");
+}
+
+}
+
+StorageJournal::StorageJournal(const std::string& file_name, uint32_t format_version, size_t compaction_threshold, sync_policy policy)
+  : m_file_name(file_name)
+  , m_format_version(format_version)
+  , m_compaction_threshold(compaction_threshold)
+  , m_sync_policy(policy)
+  , m_records_since_snapshot()
+  , m_compaction_requested(true)
+{
+}
+
+bool StorageJournal::load(record_array& records)
+{
+  records.clear();
+
+  m_pending_records.clear();
+  m_records_since_snapshot = 0;
+  m_compaction_requested   = true;
+
+  if (!boost::filesystem::exists(m_file_name))
+    return false;
+
+  std::ifstream istr(m_file_name, std::ios_base::binary | std::ios_base::in);
+
+  CHECK_AND_ASSERT_THROW_MES(istr.good(), "journal file '" << m_file_name << "' can't be opened");
+
+  char header[JOURNAL_HEADER_SIZE];
+
+  if (!istr.read(header, sizeof(header)) || memcmp(header, JOURNAL_MAGIC, sizeof(JOURNAL_MAGIC)) || read_uint32(header + sizeof(JOURNAL_MAGIC)) != m_format_version)
+  {
+    MWARNING("Journal file '" << m_file_name << "' has unknown format and will be ignored");
+    return false;
+  }
+
+    //find the last snapshot by scanning record headers only
+
+  uint64_t file_size = boost::filesystem::file_size(m_file_name),
+           offset = JOURNAL_HEADER_SIZE,
+           snapshot_offset = 0;
+
+  while (offset + RECORD_HEADER_SIZE + RECORD_FOOTER_SIZE <= file_size)
+  {
+    char record_header[RECORD_HEADER_SIZE];
+
+    istr.seekg(offset);
+
+    if (!istr.read(record_header, sizeof(record_header)))
+      break;
+
+    uint32_t size = read_uint32(record_header + 1);
+
+    if (size > MAX_RECORD_SIZE || offset + RECORD_HEADER_SIZE + size + RECORD_FOOTER_SIZE > file_size)
+      break;
+
+    if (record_header[0] == record_type_snapshot)
+      snapshot_offset = offset;
+
+    offset += RECORD_HEADER_SIZE + size + RECORD_FOOTER_SIZE;
+  }
+
+  if (!snapshot_offset)
+  {
+    MWARNING("Journal file '" << m_file_name << "' has no snapshot and will be ignored");
+    return false;
+  }
+
+    //read records from the last snapshot and verify checksums
+
+  uint64_t valid_end_offset = snapshot_offset;
+  std::string buffer(offset - snapshot_offset, '\0');
+
+  istr.clear();
+  istr.seekg(snapshot_offset);
+
+  if (!istr.read(&buffer[0], buffer.size()))
+    throw std::runtime_error("Error at reading journal file '" + m_file_name + "'");
+
+  for (size_t position=0; position<buffer.size();)
+  {
+    const char* record_data = buffer.data() + position;
+    uint32_t size = read_uint32(record_data + 1);
+    size_t record_size = RECORD_HEADER_SIZE + size + RECORD_FOOTER_SIZE;
+
+    if (get_checksum(record_data, RECORD_HEADER_SIZE + size) != read_uint32(record_data + RECORD_HEADER_SIZE + size))
+    {
+      MWARNING("Journal file '" << m_file_name << "' has a corrupted record at offset " << (snapshot_offset + position));
+      break;
+    }
+
+    record_type type = static_cast<record_type>(record_data[0]);
+
+    if (type != record_type_snapshot && type != record_type_block && type != record_type_tombstone)
+    {
+      MWARNING("Journal file '" << m_file_name << "' has a record of unknown type " << int(type) << " at offset " << (snapshot_offset + position));
+      break;
+    }
+
+    records.push_back(record{type, std::string(record_data + RECORD_HEADER_SIZE, size)});
+
+    position += record_size;
+    valid_end_offset = snapshot_offset + position;
+  }
+
+  istr.close();
+
+  if (records.empty())
+  {
+    MWARNING("Journal file '" << m_file_name << "' has no valid snapshot and will be ignored");
+    return false;
+  }
+
+    //drop incomplete tail which may remain after crash
+
+  if (valid_end_offset != file_size)
+  {
+    MWARNING("Truncate journal file '" << m_file_name << "' from " << file_size << " to " << valid_end_offset << " bytes");
+    boost::filesystem::resize_file(m_file_name, valid_end_offset);
+  }
+
+  m_records_since_snapshot = records.size() - 1;
+  m_compaction_requested   = false;
+
+  return true;
+}
+
+void StorageJournal::append(record_type type, const std::string& data)
+{
+  m_pending_records.push_back(record{type, data});
+}
+
+bool StorageJournal::need_compaction() const
+{
+  return m_compaction_requested || m_records_since_snapshot + m_pending_records.size() >= m_compaction_threshold;
+}
+
+void StorageJournal::flush()
+{
+  if (m_pending_records.empty())
+    return;
+
+  std::string buffer;
+
+  for (const record& r : m_pending_records)
+    serialize_record(buffer, r.type, r.data);
+
+  write_file(m_file_name, buffer, true, m_sync_policy == sync_policy_always);
+
+  m_records_since_snapshot += m_pending_records.size();
+
+  m_pending_records.clear();
+}
+
+void StorageJournal::compact(const std::string& snapshot_data)
+{
+  std::string buffer = get_journal_header(m_format_version);
+
+  serialize_record(buffer, record_type_snapshot, snapshot_data);
+
+    //write snapshot to a temporary file and replace journal atomically
+
+  std::string tmp_file_name = m_file_name + ".tmp";
+
+  write_file(tmp_file_name, buffer, false, m_sync_policy != sync_policy_none);
+
+  boost::filesystem::rename(tmp_file_name, m_file_name);
+
+  m_pending_records.clear();
+
+  m_records_since_snapshot = 0;
+  m_compaction_requested   = false;
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace cryptonote
+{
+
+/// Append-only journal of storage records with periodic compaction to a snapshot
+class StorageJournal
+{
+public:
+  enum record_type
+  {
+    record_type_snapshot  = 1, //full state of a storage
+    record_type_block     = 2, //changes for a new block
+    record_type_tombstone = 3, //removal of the latest block
+  };
+
+  enum sync_policy
+  {
+    sync_policy_none,      //rely on OS buffers
+    sync_policy_snapshot,  //fsync only compacted snapshots
+    sync_policy_always,    //fsync each flush of pending records
+  };
+
+  struct record
+  {
+    record_type type;
+    std::string data;
+  };
+
+  typedef std::vector<record> record_array;
+
+  StorageJournal(const std::string& file_name, uint32_t format_version, size_t compaction_threshold, sync_policy policy = sync_policy_snapshot);
+
+  /// Load records starting from the last snapshot (returns false if there is no valid journal)
+  bool load(record_array& records);
+
+  /// Add record to the pending list
+  void append(record_type type, const std::string& data);
+
+  /// Is the journal requires a new snapshot
+  bool need_compaction() const;
+
+  /// Request a new snapshot at next store
+  void request_compaction() { m_compaction_requested = true; }
+
+  /// Write pending records to the end of journal
+  void flush();
+
+  /// Replace journal with a single snapshot record
+  void compact(const std::string& snapshot_data);
+
+private:
+  std::string m_file_name;
+  uint32_t m_format_version;
+  size_t m_compaction_threshold;
+  sync_policy m_sync_policy;
+  size_t m_records_since_snapshot;
+  bool m_compaction_requested;
+  record_array m_pending_records;
+};
+
+}
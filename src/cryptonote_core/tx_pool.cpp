@@ -1440,28 +1440,31 @@ namespace cryptonote
       MERROR("Failed to validate rta tx, missing auth sample keys for tx: " << txid );
       return false;
     }
-#if 0  // don't validate signatures for rta mining
     if (rta_hdr.keys.size() != rta_signs.size()) {
       MERROR("Failed to validate rta tx: " << txid << ", keys.size() != signatures.size()");
       return false;
     }
 
+    std::vector<crypto::signature_check> checks;
+    checks.reserve(rta_signs.size());
+
     for (const auto &rta_sign : rta_signs) {
       // check if key index is in range
       if (rta_sign.key_index >= rta_hdr.keys.size()) {
         MERROR("signature: " << rta_sign.signature << " has wrong key index: " << rta_sign.key_index);
-        result = false;
-        break;
+        return false;
       }
 
+      checks.push_back({txid, rta_hdr.keys[rta_sign.key_index], rta_sign.signature});
+    }
 
-      result &= crypto::check_signature(txid, rta_hdr.keys[rta_sign.key_index], rta_sign.signature);
-      if (!result) {
-        MERROR("Failed to validate rta tx signature: " << epee::string_tools::pod_to_hex(txid) << " for key: " << rta_hdr.keys[rta_sign.key_index]);
-        break;
-      }
+    std::vector<size_t> failed_checks;
+    if (!crypto::check_signatures(checks, &failed_checks)) {
+      for (size_t i : failed_checks)
+        MERROR("Failed to validate rta tx signature: " << epee::string_tools::pod_to_hex(txid) << " for key: " << checks[i].pub);
+      return false;
     }
-#endif
+
     for (const crypto::public_key &key : rta_hdr.keys) {
       result &= validate_supernode(rta_hdr.auth_sample_height, key);
       if (!result) {
@@ -1475,7 +1478,12 @@ namespace cryptonote
 
   bool tx_memory_pool::validate_supernode(uint64_t height, const public_key &id) const
   {
-    supernode_stake * stake = const_cast<supernode_stake*>(m_stp->find_supernode_stake(height, epee::string_tools::pod_to_hex(id)));
+    // fast path: keys published by stake processor for the recent blocks
+    StakeTransactionProcessor::supernode_key_set_ptr keys = m_stp->get_supernode_keys(height);
+    if (keys)
+      return keys->count(id) != 0;
+
+    const supernode_stake * stake = m_stp->find_supernode_stake(height, epee::string_tools::pod_to_hex(id));
     return stake ? stake->amount >= config::graft::TIER1_STAKE_AMOUNT : false;
   };
 }
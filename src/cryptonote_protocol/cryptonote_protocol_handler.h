@@ -129,6 +129,8 @@ namespace cryptonote
     size_t get_synchronizing_connections_count();
     bool on_connection_synchronized();
     bool should_download_next_span(cryptonote_connection_context& context) const;
+    bool peer_has_span(const cryptonote_connection_context& context, const std::pair<uint64_t, uint64_t> &span) const;
+    bool peer_supports_pruning(const cryptonote_connection_context& context);
     void drop_connection(cryptonote_connection_context &context, bool add_fail, bool flush_all_spans);
     bool kick_idle_peers();
     int try_add_next_blocks(cryptonote_connection_context &context);
@@ -40,6 +40,7 @@
 #include <ctime>
 
 #include "cryptonote_basic/cryptonote_format_utils.h"
+#include "common/pruning.h"
 #include "profile_tools.h"
 #include "net/network_throttle-detail.hpp"
 
@@ -247,6 +248,7 @@ namespace cryptonote
       cnx.connection_id = epee::string_tools::pod_to_hex(cntxt.m_connection_id);
 
       cnx.height = cntxt.m_remote_blockchain_height;
+      cnx.pruning_seed = cntxt.m_pruning_seed;
 
       connections.push_back(cnx);
 
@@ -280,6 +282,7 @@ namespace cryptonote
     }
 
     context.m_remote_blockchain_height = hshd.current_height;
+    context.m_pruning_seed = hshd.pruning_seed;
 
     uint64_t target = m_core.get_target_blockchain_height();
     if (target == 0)
@@ -327,6 +330,7 @@ namespace cryptonote
     hshd.top_version = m_core.get_ideal_hard_fork_version(hshd.current_height);
     hshd.cumulative_difficulty = m_core.get_block_cumulative_difficulty(hshd.current_height);
     hshd.current_height +=1;
+    hshd.pruning_seed = m_core.get_blockchain_pruning_seed();
     return true;
   }
   //------------------------------------------------------------------------------------------------------------------------
@@ -811,6 +815,8 @@ namespace cryptonote
       drop_connection(context, false, false);
       return 1;
     }
+    if (!rsp.missed_ids.empty() && m_core.get_blockchain_pruning_seed() && !peer_supports_pruning(context))
+      LOG_PRINT_CCONTEXT_L1("peer without pruning support requested " << rsp.missed_ids.size() << " blocks we pruned, it will have to get them elsewhere");
     LOG_PRINT_CCONTEXT_L2("-->>NOTIFY_RESPONSE_GET_OBJECTS: blocks.size()=" << rsp.blocks.size() << ", txs.size()=" << rsp.txs.size()
                             << ", rsp.m_current_blockchain_height=" << rsp.current_blockchain_height << ", missed_ids.size()=" << rsp.missed_ids.size());
     post_notify<NOTIFY_RESPONSE_GET_OBJECTS>(rsp, context);
@@ -881,6 +887,17 @@ namespace cryptonote
     if (context.m_remote_blockchain_height > m_core.get_target_blockchain_height())
       m_core.set_target_blockchain_height(context.m_remote_blockchain_height);
 
+    if (!arg.missed_ids.empty() && context.m_pruning_seed && peer_supports_pruning(context))
+    {
+      // the peer pruned some of the span since its sync data, with the new height above
+      // peer_has_span won't pick it for that span again
+      MDEBUG(context << " pruned peer is missing " << arg.missed_ids.size() << " requested blocks, requesting the span elsewhere");
+      context.m_requested_objects.clear();
+      m_block_queue.flush_spans(context.m_connection_id);
+      try_add_next_blocks(context);
+      return 1;
+    }
+
     std::vector<crypto::hash> block_hashes;
     block_hashes.reserve(arg.blocks.size());
     const boost::posix_time::ptime now = boost::posix_time::microsec_clock::universal_time();
@@ -1322,6 +1339,25 @@ skip:
   }
   //------------------------------------------------------------------------------------------------------------------------
   template<class t_core>
+  bool t_cryptonote_protocol_handler<t_core>::peer_has_span(const cryptonote_connection_context& context, const std::pair<uint64_t, uint64_t> &span) const
+  {
+    // spans are much shorter than a pruning stripe, so checking both ends is enough
+    return tools::has_unpruned_block(span.first, context.m_remote_blockchain_height, context.m_pruning_seed) &&
+        tools::has_unpruned_block(span.first + span.second - 1, context.m_remote_blockchain_height, context.m_pruning_seed);
+  }
+  //------------------------------------------------------------------------------------------------------------------------
+  template<class t_core>
+  bool t_cryptonote_protocol_handler<t_core>::peer_supports_pruning(const cryptonote_connection_context& context)
+  {
+    uint32_t support_flags = 0;
+    m_p2p->for_connection(context.m_connection_id, [&](cryptonote_connection_context&, nodetool::peerid_type, uint32_t f)->bool{
+      support_flags = f;
+      return true;
+    });
+    return support_flags & P2P_SUPPORT_FLAG_PRUNING;
+  }
+  //------------------------------------------------------------------------------------------------------------------------
+  template<class t_core>
   bool t_cryptonote_protocol_handler<t_core>::request_missing_objects(cryptonote_connection_context& context, bool check_having_blocks, bool force_next_span)
   {
     // flush stale spans
@@ -1405,8 +1441,15 @@ skip:
       {
         MDEBUG(context << " checking for gap");
         span = m_block_queue.get_start_gap_span();
+        if (span.second > 0 && !tools::has_unpruned_block(span.first, context.m_remote_blockchain_height, context.m_pruning_seed))
+        {
+          MDEBUG(context << " gap at " << span.first << " is pruned on this peer");
+          span = std::make_pair(0, 0);
+        }
         if (span.second > 0)
         {
+          const uint64_t next_pruned = tools::get_next_pruned_block_height(span.first, context.m_remote_blockchain_height, context.m_pruning_seed);
+          span.second = std::min(span.second, next_pruned - span.first);
           const uint64_t first_block_height_known = context.m_last_response_height - context.m_needed_objects.size() + 1;
           const uint64_t last_block_height_known = context.m_last_response_height;
           const uint64_t first_block_height_needed = span.first;
@@ -1432,6 +1475,8 @@ skip:
           boost::uuids::uuid span_connection_id;
           boost::posix_time::ptime time;
           span = m_block_queue.get_next_span_if_scheduled(hashes, span_connection_id, time);
+          if (span.second > 0 && !peer_has_span(context, span))
+            span = std::make_pair(0, 0);
           if (span.second > 0)
           {
             is_next = true;
@@ -1467,7 +1512,8 @@ skip:
           context.m_needed_objects = std::vector<crypto::hash>(context.m_needed_objects.begin() + skip, context.m_needed_objects.end());
 
         const uint64_t first_block_height = context.m_last_response_height - context.m_needed_objects.size() + 1;
-        span = m_block_queue.reserve_span(first_block_height, context.m_last_response_height, count_limit, context.m_connection_id, context.m_needed_objects);
+        span = m_block_queue.reserve_span(first_block_height, context.m_last_response_height, count_limit, context.m_connection_id, context.m_needed_objects,
+            context.m_pruning_seed, context.m_remote_blockchain_height);
         MDEBUG(context << " span from " << first_block_height << ": " << span.first << "/" << span.second);
       }
       if (span.second == 0 && !force_next_span)
@@ -1477,6 +1523,8 @@ skip:
         boost::uuids::uuid span_connection_id;
         boost::posix_time::ptime time;
         span = m_block_queue.get_next_span_if_scheduled(hashes, span_connection_id, time);
+        if (span.second > 0 && !peer_has_span(context, span))
+          span = std::make_pair(0, 0);
         if (span.second > 0)
         {
           is_next = true;
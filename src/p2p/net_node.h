@@ -45,11 +45,20 @@
 #include "net_peerlist.h"
 #include "math_helper.h"
 #include "net_node_common.h"
+#include "rta_message_cache.h"
+#include "rta_relay_blob.h"
+#include "supernode_announce_aggregator.h"
+#include "supernode_delivery_queue.h"
+#include "supernode_list_encoder.h"
+#include "supernode_routes.h"
+#include "tunnel_metrics.h"
 #include "common/command_line.h"
 #include "net/jsonrpc_structs.h"
 #include "storages/http_abstract_invoke.h"
 
+#include <atomic>
 #include <map>
+#include <memory>
 #include <set>
 #include <unordered_map>
 #include <unordered_set>
@@ -65,22 +74,32 @@ namespace nodetool
   template<class base_type>
   struct p2p_connection_context_t: base_type //t_payload_net_handler::connection_context //public net_utils::connection_context_base
   {
-    p2p_connection_context_t(): peer_id(0), support_flags(0), m_in_timedsync(false) {}
+    p2p_connection_context_t(): peer_id(0), support_flags(0), m_in_timedsync(false), announce_tokens(P2P_ANNOUNCE_PEER_RATE, P2P_ANNOUNCE_PEER_BURST) {}
 
     peerid_type peer_id;
     uint32_t support_flags;
     bool m_in_timedsync;
+    token_bucket announce_tokens; //limits supernode announces accepted from the peer
   };
 
   struct local_supernode {
-    local_supernode(std::string host, uint64_t port, std::string uri) : http_host(std::move(host)), http_port(port), uri(std::move(uri)) {
-        client.set_server(http_host, std::to_string(http_port), {});
+    // sometimes supernode gets very busy so it doesn't respond within 1 second, increasing timeout to 3s
+    static constexpr size_t HTTP_TIMEOUT_MILLIS = 3 * 1000;
+    static constexpr size_t QUEUE_MAX_DEPTH = 1000;
+    // supernode doesn't accept JSON-RPC batches yet, so each message is posted separately
+    static constexpr size_t QUEUE_MAX_BATCH_SIZE = 1;
+
+    // HTTP_TIMEOUT_MILLIS is copied to a prvalue: milliseconds takes its argument by reference, which would
+    // ODR-use the constant, and it has no out-of-line definition under C++11
+    local_supernode(std::string host, uint64_t port, std::string uri)
+        : http_host(std::move(host)), http_port(port), uri(std::move(uri))
+        , queue(new supernode_delivery_queue(http_host, http_port, QUEUE_MAX_DEPTH, supernode_delivery_queue::drop_oldest,
+                                             QUEUE_MAX_BATCH_SIZE, std::chrono::milliseconds(size_t(HTTP_TIMEOUT_MILLIS)))) {
     }
 
     void update(const std::string &new_host, uint64_t new_port, const std::string &new_uri) {
         if (new_host != http_host || new_port != http_port) {
-            if (client.is_connected()) client.disconnect();
-            client.set_server(new_host, std::to_string(new_port), {});
+            queue->set_server(new_host, new_port);
             http_host = new_host;
             http_port = new_port;
             uri = new_uri;
@@ -90,7 +109,11 @@ namespace nodetool
     std::string http_host;
     uint64_t http_port;
     std::string uri;
-    epee::net_utils::http::http_simple_client client;
+    std::unique_ptr<supernode_delivery_queue> queue;
+    bool binary_updates = false; //supernode accepts binary snapshot + delta updates of stakes and blockchain based lists
+    bool binary_rta = false; //supernode sends RTA messages to binary endpoints and accepts them in binary as well
+    bool need_stakes_snapshot = true;
+    bool need_blockchain_based_list_snapshot = true;
   };
 
   template<class t_payload_net_handler>
@@ -120,6 +143,10 @@ namespace nodetool
     m_offline(false),
     m_save_graph(false),
     is_closing(false),
+    m_supernode_requests_cache(std::chrono::milliseconds(size_t(REQUEST_CACHE_TIME_MILLIS)), REQUEST_CACHE_MAX_SIZE),
+    m_announce_aggregator(std::chrono::milliseconds(P2P_ANNOUNCE_BATCH_WINDOW_MS), P2P_ANNOUNCE_BATCH_MAX_SIZE,
+                          std::chrono::seconds(DIFFICULTY_TARGET_V2)),
+    m_tunnel_metrics(new tunnel_metrics()),
     m_net_server( epee::net_utils::e_connection_type_P2P ) // this is a P2P connection of the main p2p node server, because this is class node_server<>
     {}
     virtual ~node_server()
@@ -183,6 +210,9 @@ namespace nodetool
 
     std::vector<cryptonote::route_data> get_tunnels() const;
 
+    /// Replace tunnel quality source used for multicast/unicast tunnel selection; call before run()
+    void set_tunnel_metrics(std::unique_ptr<i_tunnel_metrics> metrics) { m_tunnel_metrics = std::move(metrics); }
+
   private:
     const std::vector<std::string> m_seed_nodes_list =
     {
@@ -197,10 +227,11 @@ namespace nodetool
     CHAIN_LEVIN_NOTIFY_MAP2(p2p_connection_context); //move levin_commands_handler interface notify(...) callbacks into nothing
 
     BEGIN_INVOKE_MAP2(node_server)
-      HANDLE_NOTIFY_T2(COMMAND_SUPERNODE_ANNOUNCE, &node_server::handle_supernode_announce)
-      HANDLE_NOTIFY_T2(COMMAND_BROADCAST, &node_server::handle_broadcast)
-      HANDLE_NOTIFY_T2(COMMAND_MULTICAST, &node_server::handle_multicast)
-      HANDLE_NOTIFY_T2(COMMAND_UNICAST, &node_server::handle_unicast)
+      HANDLE_NOTIFY_T2_WITH_BUFF(COMMAND_SUPERNODE_ANNOUNCE, &node_server::handle_supernode_announce)
+      HANDLE_NOTIFY_T2_WITH_BUFF(COMMAND_SUPERNODE_ANNOUNCE_BATCH, &node_server::handle_supernode_announce_batch)
+      HANDLE_NOTIFY_T2_WITH_BUFF(COMMAND_BROADCAST, &node_server::handle_broadcast)
+      HANDLE_NOTIFY_T2_WITH_BUFF(COMMAND_MULTICAST, &node_server::handle_multicast)
+      HANDLE_NOTIFY_T2_WITH_BUFF(COMMAND_UNICAST, &node_server::handle_unicast)
 
       HANDLE_INVOKE_T2(COMMAND_HANDSHAKE, &node_server::handle_handshake)
       HANDLE_INVOKE_T2(COMMAND_TIMED_SYNC, &node_server::handle_timed_sync)
@@ -220,13 +251,13 @@ namespace nodetool
     bool multicast_send(int command, const std::string &data, const std::list<std::string> &addresses,
                         const std::list<peerid_type> &exclude_peerids = std::list<peerid_type>());
     uint64_t get_max_hop(const std::list<std::string> &addresses);
-    std::list<std::string> get_routes();
 
-    // sometimes supernode gets very busy so it doesn't respond within 1 second, increasing timeout to 3s
-    static constexpr size_t SUPERNODE_HTTP_TIMEOUT_MILLIS = 3 * 1000;
+    // RTA message ids are remembered for 2 minutes; under message storms older ids are forgotten earlier
+    static constexpr size_t REQUEST_CACHE_TIME_MILLIS = 2 * 60 * 1000;
+    static constexpr size_t REQUEST_CACHE_MAX_SIZE = 1000000;
+
     template<class request_struct>
-    int post_request_to_supernode(local_supernode &supernode, const std::string &method, const typename request_struct::request &body,
-                                  const std::string &endpoint = std::string())
+    static bool serialize_supernode_request(const std::string &method, const typename request_struct::request &body, std::string &json)
     {
         boost::value_initialized<epee::json_rpc::request<typename request_struct::request> > init_req;
         epee::json_rpc::request<typename request_struct::request>& req = static_cast<epee::json_rpc::request<typename request_struct::request> &>(init_req);
@@ -234,40 +265,96 @@ namespace nodetool
         req.id = 0;
         req.method = method;
         req.params = body;
+        return epee::serialization::store_t_to_json(req, json);
+    }
 
-        std::string uri = "/" + method;
-        if (!endpoint.empty())
-        {
-            uri = endpoint;
-        }
-        typename request_struct::response resp = AUTO_VAL_INIT(resp);
-        bool r = epee::net_utils::invoke_http_json(supernode.uri + uri,
-                                                   req, resp, supernode.client,
-                                                   std::chrono::milliseconds(size_t(SUPERNODE_HTTP_TIMEOUT_MILLIS)), "POST");
-        if (!r || resp.status == 0)
-        {
+    // requests are queued for asynchronous delivery, so a busy supernode doesn't block p2p handlers
+    template<class request_struct>
+    int post_request_to_supernode(local_supernode &supernode, const std::string &method, const typename request_struct::request &body,
+                                  const std::string &endpoint = std::string())
+    {
+        std::string json;
+        if (!serialize_supernode_request<request_struct>(method, body, json))
             return 0;
-        }
-        return 1;
+        return supernode.queue->push(supernode.uri + (endpoint.empty() ? "/" + method : endpoint), std::move(json)) ? 1 : 0;
     }
 
     template<class request_struct>
     int post_request_to_supernodes(const std::string &method, const typename request_struct::request &body,
                                    const std::string &endpoint = std::string())
     {
+        std::string json;
+        if (!serialize_supernode_request<request_struct>(method, body, json))
+            return 0;
+        const std::string uri = endpoint.empty() ? "/" + method : endpoint;
+        int ret = 0;
+        for (auto &supernode : m_supernodes)
+            ret += supernode.second.queue->push(supernode.second.uri + uri, json) ? 1 : 0;
+        return ret;
+    }
+
+    // binary RTA supernodes get the serialized request as is (p2p only fields like hop are skipped by their loader),
+    // others get JSON-RPC which is serialized at most once
+    template<class request_struct>
+    int post_rta_request_to_supernode(local_supernode &supernode, const std::string &method, const typename request_struct::request &body,
+                                      const std::string &blob, const std::string &endpoint, std::string &json)
+    {
+        const std::string uri = supernode.uri + (endpoint.empty() ? "/" + method : endpoint);
+        if (supernode.binary_rta)
+            return supernode.queue->push(uri + ".bin", blob, supernode_delivery_queue::binary) ? 1 : 0;
+        if (json.empty() && !serialize_supernode_request<request_struct>(method, body, json))
+            return 0;
+        return supernode.queue->push(uri, json) ? 1 : 0;
+    }
+
+    template<class request_struct>
+    int post_rta_request_to_supernodes(const std::string &method, const typename request_struct::request &body,
+                                       const std::string &blob, const std::string &endpoint)
+    {
+        std::string json;
         int ret = 0;
         for (auto &supernode : m_supernodes)
-            ret += post_request_to_supernode<request_struct>(supernode.second, method, body, endpoint);
+            ret += post_rta_request_to_supernode<request_struct>(supernode.second, method, body, blob, endpoint, json);
         return ret;
     }
 
-    void remove_old_request_cache();
+    // binary supernodes get a snapshot after registration or resync request and deltas afterwards, others get full JSON lists
+    template<class request_struct, class update_struct, class snapshot_getter>
+    void post_list_update_to_supernodes(const std::string &method, const typename request_struct::request &list,
+                                        const typename update_struct::request &delta, snapshot_getter get_snapshot,
+                                        bool local_supernode::*need_snapshot)
+    {
+        const std::string uri = "/" + method, binary_uri = uri + ".bin";
+        std::string json, delta_blob, snapshot_blob;
+        for (auto &sn : m_supernodes) {
+            local_supernode &supernode = sn.second;
+            if (!supernode.binary_updates) {
+                if (json.empty() && !serialize_supernode_request<request_struct>(method, list, json))
+                    continue;
+                supernode.queue->push(supernode.uri + uri, json);
+                continue;
+            }
+            std::string &blob = supernode.*need_snapshot ? snapshot_blob : delta_blob;
+            if (blob.empty()) {
+                if (supernode.*need_snapshot) {
+                    typename update_struct::request snapshot;
+                    get_snapshot(snapshot);
+                    epee::serialization::store_t_to_binary(snapshot, blob);
+                } else {
+                    epee::serialization::store_t_to_binary(delta, blob);
+                }
+            }
+            if (supernode.queue->push(supernode.uri + binary_uri, blob, supernode_delivery_queue::binary))
+                supernode.*need_snapshot = false;
+        }
+    }
 
     //----------------- commands handlers ----------------------------------------------
-    int handle_supernode_announce(int command, typename COMMAND_SUPERNODE_ANNOUNCE::request& arg, p2p_connection_context& context);
-    int handle_broadcast(int command, typename COMMAND_BROADCAST::request &arg, p2p_connection_context &context);
-    int handle_multicast(int command, typename COMMAND_MULTICAST::request &arg, p2p_connection_context &context);
-    int handle_unicast(int command, typename COMMAND_UNICAST::request &arg, p2p_connection_context &context);
+    int handle_supernode_announce(int command, typename COMMAND_SUPERNODE_ANNOUNCE::request& arg, const std::string &blob, p2p_connection_context& context);
+    int handle_supernode_announce_batch(int command, typename COMMAND_SUPERNODE_ANNOUNCE_BATCH::request& arg, const std::string &blob, p2p_connection_context& context);
+    int handle_broadcast(int command, typename COMMAND_BROADCAST::request &arg, const std::string &blob, p2p_connection_context &context);
+    int handle_multicast(int command, typename COMMAND_MULTICAST::request &arg, const std::string &blob, p2p_connection_context &context);
+    int handle_unicast(int command, typename COMMAND_UNICAST::request &arg, const std::string &blob, p2p_connection_context &context);
     int handle_handshake(int command, typename COMMAND_HANDSHAKE::request& arg, typename COMMAND_HANDSHAKE::response& rsp, p2p_connection_context& context);
     int handle_timed_sync(int command, typename COMMAND_TIMED_SYNC::request& arg, typename COMMAND_TIMED_SYNC::response& rsp, p2p_connection_context& context);
     int handle_ping(int command, COMMAND_PING::request& arg, COMMAND_PING::response& rsp, p2p_connection_context& context);
@@ -313,6 +400,12 @@ namespace nodetool
         const boost::program_options::variables_map& vm
       );
     bool idle_worker();
+    /// Update routes from the announce and queue it for batched relay
+    void process_supernode_announce(COMMAND_SUPERNODE_ANNOUNCE::request& arg, const p2p_connection_context& context);
+    /// Post collected announces to local supernodes and relay them to peers
+    bool flush_supernode_announces();
+    void post_announces_to_supernodes(const std::vector<supernode_announce_aggregator::entry>& batch);
+    void relay_announces(const std::vector<supernode_announce_aggregator::entry>& batch);
     bool handle_remote_peerlist(const std::list<peerlist_entry>& peerlist, time_t local_time, const epee::net_utils::connection_context_base& context);
     bool get_local_node_data(basic_node_data& node_data);
     // bool get_local_handshake_data(handshake_data& hshd);
@@ -454,8 +547,13 @@ namespace nodetool
 
     bool notify_peer_list(int command, const std::string& buf, const std::vector<peerlist_entry>& peers_to_send, bool try_connect = false);
 
-    void send_stakes_to_supernode();
-    void send_blockchain_based_list_to_supernode(uint64_t last_received_block_height);
+    /// Switch local supernode to binary RTA messages, called when it sends RTA messages to binary endpoints
+    void set_supernode_binary_rta(const std::string &supernode_public_id);
+
+    /// Push stakes to local supernodes; the requesting supernode gets a full snapshot
+    void send_stakes_to_supernode(const std::string &supernode_public_id, bool binary_updates);
+    /// Push blockchain based lists to local supernodes; the requesting supernode gets a full snapshot
+    void send_blockchain_based_list_to_supernode(const std::string &supernode_public_id, bool binary_updates, uint64_t last_received_block_height);
 
     uint64_t get_announce_bytes_in() const { return m_announce_bytes_in; }
     uint64_t get_announce_bytes_out() const { return m_announce_bytes_out; }
@@ -464,17 +562,28 @@ namespace nodetool
     uint64_t get_multicast_bytes_in() const { return m_multicast_bytes_in; }
     uint64_t get_multicast_bytes_out() const { return m_multicast_bytes_out; }
 
+    std::vector<std::pair<std::string, supernode_delivery_queue::stats>> get_supernode_queue_stats() {
+        boost::lock_guard<boost::recursive_mutex> guard(m_supernode_lock);
+        std::vector<std::pair<std::string, supernode_delivery_queue::stats>> result;
+        result.reserve(m_supernodes.size());
+        for (auto &sn : m_supernodes) {
+            result.emplace_back(sn.first, sn.second.queue->get_stats());
+        }
+        return result;
+    }
+
   private:
     void handle_stakes_update(uint64_t block_number, const cryptonote::StakeTransactionProcessor::supernode_stake_array& stakes);
     void handle_blockchain_based_list_update(uint64_t block_number, const cryptonote::StakeTransactionProcessor::supernode_tier_array& tiers);
 
   private:
-    std::multimap<int, std::string> m_supernode_requests_timestamps;
-    std::set<std::string> m_supernode_requests_cache;
-    std::map<std::string, nodetool::supernode_route> m_supernode_routes;
+    rta_message_cache m_supernode_requests_cache;
+    supernode_announce_aggregator m_announce_aggregator;
+    std::unique_ptr<i_tunnel_metrics> m_tunnel_metrics;
+    supernode_routes m_supernode_routes;
     std::unordered_map<std::string, local_supernode> m_supernodes;
+    supernode_list_encoder m_supernode_list_encoder; //guarded by m_supernode_lock
     boost::recursive_mutex m_supernode_lock;
-    boost::recursive_mutex m_request_cache_lock;
     std::vector<epee::net_utils::network_address> m_custom_seed_nodes;
 
     std::string m_config_folder;
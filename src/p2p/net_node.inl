@@ -68,7 +68,6 @@
 #define MIN_WANTED_SEED_NODES 12
 
 #define MAX_TUNNEL_PEERS (3u)
-#define REQUEST_CACHE_TIME 2 * 60 * 1000
 #define HOP_RETRIES_MULTIPLIER 2
 
 namespace nodetool
@@ -132,14 +131,31 @@ namespace nodetool
         } while (out.empty());
     }
     /*!
-     * helper to calculate p2p command size in bytes
+     * helper to pick the blob of received RTA request to pass on: the received one if it has only the fields of
+     * the request, otherwise the loaded request serialized again, so unknown fields are never forwarded
      */
     template <typename T>
-    size_t get_command_size(const T &arg)
+    const std::string &checked_rta_blob(const T &arg, const std::string &blob, std::string &buff)
     {
-        std::string buff;
+        if (check_binary_fields(blob, T::relay_fields()))
+            return blob;
         epee::serialization::store_t_to_binary(arg, buff);
-        return buff.size();
+        return buff;
+    }
+    /*!
+     * helper to prepare received RTA request for relaying: the checked blob is copied as is with hop counter
+     * decremented in place; only a blob in unexpected layout is serialized again
+     */
+    template <typename T>
+    void make_relay_blob(T &arg, const std::string &blob, std::string &buff)
+    {
+        arg.hop--;
+        buff = blob;
+        if (!decrement_binary_hop(buff))
+        {
+            buff.clear();
+            epee::serialization::store_t_to_binary(arg, buff);
+        }
     }
 
   }
@@ -341,6 +357,7 @@ namespace nodetool
     bool testnet = command_line::get_arg(vm, cryptonote::arg_testnet_on);
     bool stagenet = command_line::get_arg(vm, cryptonote::arg_stagenet_on);
     m_nettype = testnet ? cryptonote::TESTNET : stagenet ? cryptonote::STAGENET : cryptonote::MAINNET;
+    m_supernode_list_encoder.set_nettype(m_nettype);
 
     m_bind_ip = command_line::get_arg(vm, arg_p2p_bind_ip);
     m_port = command_line::get_arg(vm, arg_p2p_bind_port);
@@ -760,6 +777,7 @@ namespace nodetool
     int thrds_count = 10;
 
     m_net_server.add_idle_handler(boost::bind(&node_server<t_payload_net_handler>::idle_worker, this), 1000);
+    m_net_server.add_idle_handler(boost::bind(&node_server<t_payload_net_handler>::flush_supernode_announces, this), P2P_ANNOUNCE_BATCH_WINDOW_MS);
     m_net_server.add_idle_handler(boost::bind(&t_payload_net_handler::on_idle, &m_payload_handler), 1000);
 
     boost::thread::attributes attrs;
@@ -889,84 +907,78 @@ namespace nodetool
   {
       MDEBUG("P2P Request: multicast_send: Start tunneling for addresses: "
                    << boost::algorithm::join(addresses, ", "));
-      std::vector<peerlist_entry> tunnels;
+      supernode_route_table_ptr table = m_supernode_routes.get();
+
+      //per-thread scratch buffers, so fan-out doesn't allocate once they have grown to the table size
+      static thread_local std::vector<uint64_t> selected_mark;
+      static thread_local std::vector<size_t> selected;
+      static thread_local std::vector<std::pair<double, size_t>> candidates; //score, tunnel index
+      static thread_local uint64_t selected_generation = 0;
+      if (selected_mark.size() < table->tunnels.size())
+          selected_mark.resize(table->tunnels.size(), 0);
+      selected.clear();
+      ++selected_generation;
+      const uint64_t now = tunnel_metrics::now_ms();
+
+      for (const std::string &addr : addresses)
       {
-          std::map<std::string, nodetool::supernode_route> local_supernode_routes;
+          MDEBUG("P2P Request: multicast_send: looking for tunnel for " << addr);
+          auto it = table->routes.find(addr);
+          if (it == table->routes.end())
           {
-              MDEBUG("P2P Request: multicast_send: lock");
-              boost::lock_guard<boost::recursive_mutex> guard(m_supernode_lock);
-              MDEBUG("P2P Request: multicast_send: unlock");
-              local_supernode_routes = m_supernode_routes;
+              MWARNING("no tunnel found for address: " << addr);
+              continue;
           }
-          for (auto addr : addresses)
+          // prefer live tunnels with the lowest score
+          candidates.clear();
+          for (size_t index : it->second.tunnels)
           {
-              MDEBUG("P2P Request: multicast_send: looking for tunnel for " << addr);
-              auto it = local_supernode_routes.find(addr);
-              if (it == local_supernode_routes.end())
-              {
-                  MWARNING("no tunnel found for address: " << addr);
+              const supernode_route_table::tunnel &tunnel = table->tunnels[index];
+              // don't allow duplicate entries and skip disconnected peers
+              if (!tunnel.connected || selected_mark[index] == selected_generation)
                   continue;
-              }
-              // peers for address
-              std::vector<peerlist_entry> addr_tunnels = (*it).second.peers;
-              unsigned int count = 0;
-              for (auto peer_it = addr_tunnels.begin(); peer_it != addr_tunnels.end(); ++peer_it)
-              {
-                  peerlist_entry addr_tunnel = *peer_it;
-
-
-                  // check if peer connected connections
-                  boost::uuids::uuid dummy;
-                  if (!find_connection_id_by_peer(addr_tunnel, dummy))
-                    continue;
-
-                  // don't allow duplicate entries
-                  auto tunnel_it = std::find_if(tunnels.begin(), tunnels.end(),
-                                                [addr_tunnel](const peerlist_entry &entry) -> bool {
-                      return entry.id == addr_tunnel.id;
-                  });
-                  // check if our peer is in excluded peers
-                  auto exclude_it = std::find(exclude_peerids.begin(), exclude_peerids.end(),
-                                              addr_tunnel.id);
-                  if (tunnel_it == tunnels.end() && exclude_it == exclude_peerids.end())
-                  {
-                      MDEBUG("found tunnel for address: " << addr << ":  " << addr_tunnel.adr.str());
-                      tunnels.push_back(addr_tunnel);
-                      count++;
-                  }
-                  if (count >= MAX_TUNNEL_PEERS)
-                  {
-                      break;
-                  }
-              }
+              // check if our peer is in excluded peers
+              if (std::find(exclude_peerids.begin(), exclude_peerids.end(), tunnel.peer.id) != exclude_peerids.end())
+                  continue;
+              candidates.emplace_back(m_tunnel_metrics->get_score(tunnel.peer.id, now), index);
+          }
+          const size_t count = std::min<size_t>(candidates.size(), MAX_TUNNEL_PEERS);
+          std::partial_sort(candidates.begin(), candidates.begin() + count, candidates.end());
+          for (size_t i = 0; i < count; ++i)
+          {
+              const size_t index = candidates[i].second;
+              MDEBUG("found tunnel for address: " << addr << ":  " << table->tunnels[index].peer.adr.str() << ", score: " << candidates[i].first);
+              selected_mark[index] = selected_generation;
+              selected.push_back(index);
           }
       }
-      MDEBUG("P2P Request: multicast_send: End tunneling, tunnels found: " << tunnels.size());
-      m_multicast_bytes_out += data.size() * tunnels.size();
+      MDEBUG("P2P Request: multicast_send: End tunneling, tunnels found: " << selected.size());
+      m_multicast_bytes_out += data.size() * selected.size();
 
-      return notify_peer_list(command, data, tunnels);
+      for (size_t index : selected)
+      {
+          const supernode_route_table::tunnel &tunnel = table->tunnels[index];
+          if (!relay_notify(command, data, tunnel.connection_id))
+          {
+              MWARNING("P2P Request: multicast_send: sending to : " << tunnel.peer.adr.host_str() << " FAILED");
+              m_tunnel_metrics->on_delivery(tunnel.peer.id, false, now);
+          }
+      }
+      return true;
   }
 
   //-----------------------------------------------------------------------------------
   template<class t_payload_net_handler>
   uint64_t node_server<t_payload_net_handler>::get_max_hop(const std::list<std::string> &addresses)
   {
+      supernode_route_table_ptr table = m_supernode_routes.get();
       uint64_t max_hop = 0;
+      for (const std::string &addr : addresses)
       {
-          std::map<std::string, nodetool::supernode_route> local_supernode_routes;
+          auto it = table->routes.find(addr);
+          if (it != table->routes.end() && max_hop < it->second.max_hop)
           {
-              MDEBUG("P2P Request: multicast_send: lock");
-              boost::lock_guard<boost::recursive_mutex> guard(m_supernode_lock);
-              MDEBUG("P2P Request: multicast_send: unlock");
-              local_supernode_routes = m_supernode_routes;
-          }
-          for (auto addr : addresses)
-          {
-              auto it = local_supernode_routes.find(addr);
-              if (it != local_supernode_routes.end() && max_hop < (*it).second.max_hop)
-              {
-                  max_hop = (*it).second.max_hop;
-              }
+              max_hop = it->second.max_hop;
           }
       }
       return max_hop;
@@ -974,51 +986,39 @@ namespace nodetool
 
   //-----------------------------------------------------------------------------------
   template<class t_payload_net_handler>
-  std::list<std::string> node_server<t_payload_net_handler>::get_routes()
+  int node_server<t_payload_net_handler>::handle_supernode_announce(int command, COMMAND_SUPERNODE_ANNOUNCE::request& arg, const std::string &blob, p2p_connection_context& context)
   {
-      std::list<std::string> routes;
-      {
-          std::map<std::string, nodetool::supernode_route> local_supernode_routes;
-          {
-              MDEBUG("P2P Request: multicast_send: lock");
-              boost::lock_guard<boost::recursive_mutex> guard(m_supernode_lock);
-              MDEBUG("P2P Request: multicast_send: unlock");
-              local_supernode_routes = m_supernode_routes;
-          }
-          for (auto it = local_supernode_routes.begin(); it != local_supernode_routes.end(); ++it)
-          {
-              routes.push_back((*it).first);
-          }
+      MDEBUG("P2P Request: handle_supernode_announce: start");
+
+      m_announce_bytes_in += blob.size();
+
+      if (context.m_state != p2p_connection_context::state_normal) {
+          MWARNING(context << " invalid connection (no handshake)");
+          return 1;
       }
-      return routes;
-  }
 
-  //-----------------------------------------------------------------------------------
-  template<class t_payload_net_handler>
-  void node_server<t_payload_net_handler>::remove_old_request_cache()
-  {
-      int timestamp = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
-      for (auto it = m_supernode_requests_timestamps.begin(); it != m_supernode_requests_timestamps.end();)
-      {
-          if ((*it).first + REQUEST_CACHE_TIME < timestamp)
-          {
-              m_supernode_requests_cache.erase((*it).second);
-              it = m_supernode_requests_timestamps.erase(it);
-          }
-          else
-          {
-              break;
-          }
+#ifdef LOCK_RTA_SENDING
+    return 1;
+#endif
+      if (!context.announce_tokens.consume(supernode_announce_aggregator::now_ms())) {
+          MDEBUG(context << " P2P Request: handle_supernode_announce: rate limit exceeded, dropping announce of " << arg.supernode_public_id);
+          return 1;
       }
+
+      process_supernode_announce(arg, context);
+      // readers see the new routes from here on, without rebuilding on the send path
+      m_supernode_routes.publish();
+
+      MDEBUG("P2P Request: handle_supernode_announce: end");
+      return 1;
   }
 
-  //-----------------------------------------------------------------------------------
   template<class t_payload_net_handler>
-  int node_server<t_payload_net_handler>::handle_supernode_announce(int command, COMMAND_SUPERNODE_ANNOUNCE::request& arg, p2p_connection_context& context)
+  int node_server<t_payload_net_handler>::handle_supernode_announce_batch(int command, COMMAND_SUPERNODE_ANNOUNCE_BATCH::request& arg, const std::string &blob, p2p_connection_context& context)
   {
-      MDEBUG("P2P Request: handle_supernode_announce: start");
+      MDEBUG("P2P Request: handle_supernode_announce_batch: start, announces: " << arg.announces.size());
 
-      m_announce_bytes_in += get_command_size(arg);
+      m_announce_bytes_in += blob.size();
 
       if (context.m_state != p2p_connection_context::state_normal) {
           MWARNING(context << " invalid connection (no handshake)");
@@ -1028,8 +1028,28 @@ namespace nodetool
 #ifdef LOCK_RTA_SENDING
     return 1;
 #endif
-      static std::string supernode_endpoint("send_supernode_announce");
-      std::string supernode_str = arg.supernode_public_id;
+      const uint64_t now = supernode_announce_aggregator::now_ms();
+      size_t processed = 0;
+      for (auto &announce : arg.announces)
+      {
+          if (!context.announce_tokens.consume(now))
+              break;
+          process_supernode_announce(announce, context);
+          ++processed;
+      }
+      m_supernode_routes.publish();
+      if (processed < arg.announces.size())
+          MDEBUG(context << " P2P Request: handle_supernode_announce_batch: rate limit exceeded, dropped "
+                 << arg.announces.size() - processed << " announce(s)");
+
+      MDEBUG("P2P Request: handle_supernode_announce_batch: end");
+      return 1;
+  }
+
+  template<class t_payload_net_handler>
+  void node_server<t_payload_net_handler>::process_supernode_announce(COMMAND_SUPERNODE_ANNOUNCE::request& arg, const p2p_connection_context& context)
+  {
+      const std::string &supernode_str = arg.supernode_public_id;
 
       bool is_local;
       {
@@ -1044,129 +1064,128 @@ namespace nodetool
           if (!m_peerlist.find_peer(context.peer_id, pe))
           { // unknown peer, alternative handshake with it
               MDEBUG("unknown peer, alternative handshake with it " << context.peer_id);
-              return 1;
-          }
-          {
-              MDEBUG("P2P Request: handle_supernode_announce: lock");
-              boost::lock_guard<boost::recursive_mutex> guard(m_request_cache_lock);
-              MDEBUG("P2P Request: handle_supernode_announce: unlock");
-              remove_old_request_cache();
+              return;
           }
-          MDEBUG("P2P Request: handle_supernode_announce: lock");
-          boost::lock_guard<boost::recursive_mutex> guard(m_supernode_lock);
-          MDEBUG("P2P Request: handle_supernode_announce: unlock");
-
           MDEBUG("P2P Request: handle_supernode_announce: routes number - " << m_supernode_routes.size());
-          for (auto it2 = m_supernode_routes.begin(); it2 != m_supernode_routes.end(); ++it2)
-          {
-              MDEBUG("P2P Request: handle_supernode_announce: " << (*it2).first << " " << (*it2).second.peers.size());
-          }
 
-
-          auto it = m_supernode_routes.find(supernode_str);
-          if (it == m_supernode_routes.end())
+          if (!m_supernode_routes.update(supernode_str, arg.height, arg.hop, pe, time(nullptr)))
           {
-              std::vector<peerlist_entry> peer_vec;
-              peer_vec.push_back(pe);
-              nodetool::supernode_route route;
-              route.last_announce_height = arg.height;
-              route.last_announce_time = time(nullptr);
-              route.max_hop = arg.hop;
-              route.peers = peer_vec;
-              m_supernode_routes[supernode_str] = route;
+              MDEBUG("existing announce of " << supernode_str << ", height: " << arg.height);
+              return;
           }
-          else {
-              auto &route = it->second;
-#if 0
-              // this check is not correct in case stake transactions if older tx has greater lock time than newer one
-              if (route.last_announce_height > arg.height)
-              {
-                  MINFO("SUPERNODE_ANNOUNCE from " << context.peer_id
-                        << " too old, corrent route height " << (*it).second.last_announce_height);
-                  return 1;
-              }
-#endif
 
-              if (route.last_announce_height == arg.height && route.last_announce_time + DIFFICULTY_TARGET_V2 > (unsigned)time(nullptr))
-              {
-                  MDEBUG("existing announce, height: " << arg.height << ", last_announce_time: " << (*it).second.last_announce_time
-                         << ", current time: " << time(nullptr));
-                  auto peer_it = std::find_if(route.peers.begin(), route.peers.end(),
-                                              [pe](const peerlist_entry &p) -> bool { return pe.id == p.id; });
-                  if (peer_it == route.peers.end())
-                  {
-                      route.peers.push_back(pe);
-                      if (route.max_hop < arg.hop)
-                      {
-                          route.max_hop = arg.hop;
-                      }
-                  }
-                  return 1;
-              }
-              route.peers.clear();
-              route.peers.push_back(pe);
-              route.last_announce_height = arg.height;
-              route.last_announce_time = time(nullptr);
-              route.max_hop = arg.hop;
-          }
+          // neighbours get the announce with the next hop
+          arg.hop++;
       }
 
-      std::list<std::reference_wrapper<local_supernode>> post_to_sn;
-      {
-          LOG_PRINT_L3("P2P Request: handle_supernode_announce: lock");
-          boost::lock_guard<boost::recursive_mutex> guard(m_supernode_lock);
-          LOG_PRINT_L3("P2P Request: handle_supernode_announce: unlock");
-          for (auto &sn : m_supernodes) {
-              if (sn.first != supernode_str)
-                  post_to_sn.push_back(std::ref(sn.second));
-          }
-      }
-      for (auto &sn : post_to_sn) {
-          LOG_PRINT_L1("P2P Request: handle_supernode_announce: post to supernode");
-          post_request_to_supernode<cryptonote::COMMAND_RPC_SUPERNODE_ANNOUNCE>(sn, supernode_endpoint, arg);
-      }
+      if (!m_announce_aggregator.add(arg, !is_local))
+          MDEBUG("P2P Request: handle_supernode_announce: announce of " << supernode_str << " at height " << arg.height << " already queued");
+      else if (m_announce_aggregator.size() >= P2P_ANNOUNCE_BATCH_MAX_SIZE)
+          flush_supernode_announces();
+  }
 
-      if (!is_local) {
-          // Notify neighbours about new ANNOUNCE
-          arg.hop++;
-          MDEBUG("P2P Request: handle_supernode_announce: notify peers " << arg.hop);
+  template<class t_payload_net_handler>
+  bool node_server<t_payload_net_handler>::flush_supernode_announces()
+  {
+      std::vector<supernode_announce_aggregator::entry> batch;
+      if (!m_announce_aggregator.flush(batch))
+          return true;
 
-          std::list<boost::uuids::uuid> all_connections, random_connections;
-          m_net_server.get_config_object().foreach_connection([&](const p2p_connection_context& cntxt)
-          {
-            // skip ourself connections
-            if(cntxt.peer_id == m_config.m_peer_id)
-              return true;
-            all_connections.push_back(cntxt.m_connection_id);
-            return true;
-          });
+      MDEBUG("P2P Request: flush_supernode_announces: " << batch.size() << " announce(s)");
+      post_announces_to_supernodes(batch);
+      relay_announces(batch);
+      return true;
+  }
 
-          if (all_connections.empty()) {
-            MWARNING("P2P Request: no connections to relay announce");
-            return 1;
-          }
+  template<class t_payload_net_handler>
+  void node_server<t_payload_net_handler>::post_announces_to_supernodes(const std::vector<supernode_announce_aggregator::entry>& batch)
+  {
+      static const std::string supernode_endpoint("send_supernode_announce");
 
-          select_subset_with_probability(1.0 / all_connections.size(), all_connections, random_connections);
+      boost::lock_guard<boost::recursive_mutex> guard(m_supernode_lock);
+      // binary supernodes get one batch without their own announce, others get announces one by one serialized once
+      std::vector<std::string> jsons(batch.size());
+      for (auto &sn : m_supernodes) {
+          local_supernode &supernode = sn.second;
+          if (supernode.binary_rta) {
+              cryptonote::COMMAND_RPC_SUPERNODE_ANNOUNCES::request announces;
+              announces.announces.reserve(batch.size());
+              for (const auto &e : batch)
+                  if (e.value.supernode_public_id != sn.first)
+                      announces.announces.push_back(e.value);
+              if (announces.announces.empty())
+                  continue;
+              std::string blob;
+              epee::serialization::store_t_to_binary(announces, blob);
+              supernode.queue->push(supernode.uri + "/send_supernode_announces.bin", std::move(blob), supernode_delivery_queue::binary);
+              continue;
+          }
+          for (size_t i = 0; i < batch.size(); ++i) {
+              if (batch[i].value.supernode_public_id == sn.first)
+                  continue;
+              if (jsons[i].empty() && !serialize_supernode_request<cryptonote::COMMAND_RPC_SUPERNODE_ANNOUNCE>(supernode_endpoint, batch[i].value, jsons[i]))
+                  continue;
+              supernode.queue->push(supernode.uri + "/" + supernode_endpoint, jsons[i]);
+          }
+      }
+  }
 
-          std::string arg_buff;
-          epee::serialization::store_t_to_binary(arg, arg_buff);
+  template<class t_payload_net_handler>
+  void node_server<t_payload_net_handler>::relay_announces(const std::vector<supernode_announce_aggregator::entry>& batch)
+  {
+      COMMAND_SUPERNODE_ANNOUNCE_BATCH::request relay;
+      for (const auto &e : batch)
+          if (e.relay)
+              relay.announces.push_back(e.value);
+      if (relay.announces.empty())
+          return;
 
-          MDEBUG("P2P Request: handle_supernode_announce: relaying to neighbours: " << random_connections.size());
+      std::list<std::pair<boost::uuids::uuid, bool>> all_connections, random_connections;
+      m_net_server.get_config_object().foreach_connection([&](const p2p_connection_context& cntxt)
+      {
+        // skip ourself connections
+        if(cntxt.peer_id == m_config.m_peer_id)
+          return true;
+        all_connections.emplace_back(cntxt.m_connection_id, (cntxt.support_flags & P2P_SUPPORT_FLAG_ANNOUNCE_BATCH) != 0);
+        return true;
+      });
 
-          relay_notify_to_list(command, arg_buff, random_connections);
-          m_announce_bytes_out += arg_buff.size() * random_connections.size();
+      if (all_connections.empty()) {
+        MWARNING("P2P Request: no connections to relay announce");
+        return;
       }
 
-      MDEBUG("P2P Request: handle_supernode_announce: end");
-      return 1;
+      select_subset_with_probability(1.0 / all_connections.size(), all_connections, random_connections);
+      MDEBUG("P2P Request: relay_announces: relaying " << relay.announces.size() << " announce(s) to neighbours: " << random_connections.size());
+
+      // peers without batch support get announces one by one
+      std::string batch_blob;
+      std::vector<std::string> blobs;
+      for (const auto &c : random_connections) {
+          if (c.second) {
+              if (batch_blob.empty())
+                  epee::serialization::store_t_to_binary(relay, batch_blob);
+              if (relay_notify(COMMAND_SUPERNODE_ANNOUNCE_BATCH::ID, batch_blob, c.first))
+                  m_announce_bytes_out += batch_blob.size();
+              continue;
+          }
+          if (blobs.empty()) {
+              blobs.resize(relay.announces.size());
+              for (size_t i = 0; i < relay.announces.size(); ++i)
+                  epee::serialization::store_t_to_binary(relay.announces[i], blobs[i]);
+          }
+          for (const std::string &blob : blobs)
+              if (relay_notify(COMMAND_SUPERNODE_ANNOUNCE::ID, blob, c.first))
+                  m_announce_bytes_out += blob.size();
+      }
   }
 
   template<class t_payload_net_handler>
-  int node_server<t_payload_net_handler>::handle_broadcast(int command, typename COMMAND_BROADCAST::request &arg, p2p_connection_context &context)
+  int node_server<t_payload_net_handler>::handle_broadcast(int command, typename COMMAND_BROADCAST::request &arg, const std::string &blob, p2p_connection_context &context)
   {
       MDEBUG("P2P Request: handle_broadcast: start");
 
-      m_broadcast_bytes_in += get_command_size(arg);
+      m_broadcast_bytes_in += blob.size();
 
       if (context.m_state != p2p_connection_context::state_normal) {
           MWARNING(context << " invalid connection (no handshake)");
@@ -1177,54 +1196,51 @@ namespace nodetool
     return 1;
 #endif
 
+      if (!m_supernode_requests_cache.insert(arg.message_id))
+      {
+          MDEBUG("P2P Request: handle_broadcast: request found in cache, skipping");
+          return 1;
+      }
+      std::string checked_blob;
+      const std::string &rta_blob = checked_rta_blob(arg, blob, checked_blob);
+
       {
           MDEBUG("P2P Request: handle_broadcast: lock");
-          boost::unique_lock<boost::recursive_mutex> cache_guard(m_request_cache_lock, boost::defer_lock),
-              sn_guard(m_supernode_lock, boost::defer_lock);
-          boost::lock(cache_guard, sn_guard);
+          boost::lock_guard<boost::recursive_mutex> sn_guard(m_supernode_lock);
           MDEBUG("P2P Request: handle_broadcast: unlock");
           MDEBUG("P2P Request: handle_broadcast: sender_address: " << arg.sender_address
                        << ", our address(es): " << join_supernodes_addresses(", "));
-          if (m_supernode_requests_cache.find(arg.message_id) == m_supernode_requests_cache.end())
-          {
-              MDEBUG("P2P Request: handle_broadcast: post to supernodes");
-              m_supernode_requests_cache.insert(arg.message_id);
-              int timestamp = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
-              m_supernode_requests_timestamps.insert(std::make_pair(timestamp, arg.message_id));
+          MDEBUG("P2P Request: handle_broadcast: post to supernodes");
 
-              post_request_to_supernodes<cryptonote::COMMAND_RPC_BROADCAST>("broadcast", arg, arg.callback_uri);
+          post_rta_request_to_supernodes<cryptonote::COMMAND_RPC_BROADCAST>("broadcast", arg, rta_blob, arg.callback_uri);
 
-              if (arg.hop > 0)
-              {
-                  MDEBUG("P2P Request: handle_broadcast: notify broadcast from " << arg.sender_address
-                               << " to peers. Hop level: " << arg.hop);
-                  arg.hop--;
-                  std::string buff;
-                  epee::serialization::store_t_to_binary(arg, buff);
+          if (arg.hop > 0)
+          {
+              MDEBUG("P2P Request: handle_broadcast: notify broadcast from " << arg.sender_address
+                           << " to peers. Hop level: " << arg.hop);
+              std::string buff;
+              make_relay_blob(arg, rta_blob, buff);
 
-                  m_broadcast_bytes_out += buff.size() * get_connections_count();
+              m_broadcast_bytes_out += buff.size() * get_connections_count();
 
-                  relay_notify_to_all(command, buff, context);
-              }
-              else
-              {
-                  MDEBUG("P2P Request: handle_broadcast: hop counter ended for broadcast from "
-                               << arg.sender_address);
-              }
+              relay_notify_to_all(command, buff, context);
+          }
+          else
+          {
+              MDEBUG("P2P Request: handle_broadcast: hop counter ended for broadcast from "
+                           << arg.sender_address);
           }
-          MDEBUG("P2P Request: handle_broadcast: clean request cache");
-          remove_old_request_cache();
       }
       MDEBUG("P2P Request: handle_broadcast: end");
       return 1;
   }
 
   template<class t_payload_net_handler>
-  int node_server<t_payload_net_handler>::handle_multicast(int command, typename COMMAND_MULTICAST::request &arg, p2p_connection_context &context)
+  int node_server<t_payload_net_handler>::handle_multicast(int command, typename COMMAND_MULTICAST::request &arg, const std::string &blob, p2p_connection_context &context)
   {
       MDEBUG("P2P Request: handle_multicast: start");
 
-      m_multicast_bytes_in += get_command_size(arg);
+      m_multicast_bytes_in += blob.size();
 
       if (context.m_state != p2p_connection_context::state_normal) {
           MWARNING(context << " invalid connection (no handshake)");
@@ -1237,71 +1253,67 @@ namespace nodetool
 
       std::list<std::string> addresses = arg.receiver_addresses;
       bool forward = false;
+      if (!m_supernode_requests_cache.insert(arg.message_id))
+      {
+          MDEBUG("P2P Request: handle_multicast: request found in cache, skipping");
+          return 1;
+      }
+      std::string checked_blob;
+      const std::string &rta_blob = checked_rta_blob(arg, blob, checked_blob);
+
       {
           MDEBUG("P2P Request: handle_multicast: lock");
-          boost::unique_lock<boost::recursive_mutex> cache_guard(m_request_cache_lock, boost::defer_lock),
-              sn_guard(m_supernode_lock, boost::defer_lock);
-          boost::lock(cache_guard, sn_guard);
+          boost::lock_guard<boost::recursive_mutex> sn_guard(m_supernode_lock);
 
           MDEBUG("P2P Request: handle_multicast: unlock");
           MDEBUG("P2P Request: handle_multicast: sender_address: " << arg.sender_address
                        << ", receiver_addresses: " << boost::algorithm::join(arg.receiver_addresses, ", ")
                        << ", our address(es): " << join_supernodes_addresses(", "));
-          if (m_supernode_requests_cache.find(arg.message_id) == m_supernode_requests_cache.end())
-          {
-              MDEBUG("P2P Request: handle_multicast: post to supernodes");
-              m_supernode_requests_cache.insert(arg.message_id);
-              int timestamp = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
-              m_supernode_requests_timestamps.insert(std::make_pair(timestamp, arg.message_id));
-              for (auto it = addresses.begin(); it != addresses.end(); ) {
-                  auto snit = m_supernodes.find(*it);
-                  if (snit != m_supernodes.end()) {
-                      MDEBUG("P2P Request: handle_multicast: posting to local supernode " << snit->first);
-                      post_request_to_supernode<cryptonote::COMMAND_RPC_MULTICAST>(snit->second, "multicast", arg, arg.callback_uri);
-                      it = addresses.erase(it);
-                  } else {
-                      ++it;
-                  }
+          MDEBUG("P2P Request: handle_multicast: post to supernodes");
+          std::string json;
+          for (auto it = addresses.begin(); it != addresses.end(); ) {
+              auto snit = m_supernodes.find(*it);
+              if (snit != m_supernodes.end()) {
+                  MDEBUG("P2P Request: handle_multicast: posting to local supernode " << snit->first);
+                  post_rta_request_to_supernode<cryptonote::COMMAND_RPC_MULTICAST>(snit->second, "multicast", arg, rta_blob, arg.callback_uri, json);
+                  it = addresses.erase(it);
+              } else {
+                  ++it;
               }
+          }
 
-              if (arg.hop > 0)
-              {
-                  forward = true;
-              }
-              else
-              {
-                  MDEBUG("P2P Request: handle_multicast: hop counter ended for multicast from "
-                               << arg.sender_address);
-              }
+          if (arg.hop > 0)
+          {
+              forward = true;
           }
           else
           {
-              MDEBUG("P2P Request: handle_multicast: request found in cache, skipping");
+              MDEBUG("P2P Request: handle_multicast: hop counter ended for multicast from "
+                           << arg.sender_address);
           }
-          MDEBUG("P2P Request: handle_multicast: clean request cache");
-          remove_old_request_cache();
       }
       if (forward)
       {
           MDEBUG("P2P Request: handle_multicast: notify multicast from " << arg.sender_address
                        << " to peers. Hop level: " << arg.hop);
-          arg.hop--;
           std::list<peerid_type> exclude_peers;
           exclude_peers.push_back(context.peer_id);
 
           std::string buff;
-          epee::serialization::store_t_to_binary(arg, buff);
+          make_relay_blob(arg, rta_blob, buff);
           multicast_send(command, buff, addresses, exclude_peers);
       }
+      // only a new message handled to the end counts, duplicates arrive over every tunnel
+      m_tunnel_metrics->on_delivery(context.peer_id, true, tunnel_metrics::now_ms());
       MDEBUG("P2P Request: handle_multicast: end");
       return 1;
   }
 
   template<class t_payload_net_handler>
-  int node_server<t_payload_net_handler>::handle_unicast(int command, typename COMMAND_UNICAST::request &arg, p2p_connection_context &context)
+  int node_server<t_payload_net_handler>::handle_unicast(int command, typename COMMAND_UNICAST::request &arg, const std::string &blob, p2p_connection_context &context)
   {
       MDEBUG("P2P Request: handle_unicast: start");
-      m_multicast_bytes_in += get_command_size(arg);
+      m_multicast_bytes_in += blob.size();
       if (context.m_state != p2p_connection_context::state_normal) {
           MWARNING(context << " invalid connection (no handshake)");
           return 1;
@@ -1313,50 +1325,44 @@ namespace nodetool
 
       std::string address = arg.receiver_address;
       bool forward = false;
+      if (!m_supernode_requests_cache.insert(arg.message_id))
+      {
+          MDEBUG("P2P Request: handle_unicast: request found in cache, skipping");
+          return 1;
+      }
+      std::string checked_blob;
+      const std::string &rta_blob = checked_rta_blob(arg, blob, checked_blob);
+
       {
           MDEBUG("P2P Request: handle_unicast: lock");
-          boost::unique_lock<boost::recursive_mutex> cache_guard(m_request_cache_lock, boost::defer_lock),
-              sn_guard(m_supernode_lock, boost::defer_lock);
-          boost::lock(cache_guard, sn_guard);
+          boost::lock_guard<boost::recursive_mutex> sn_guard(m_supernode_lock);
           MDEBUG("P2P Request: handle_unicast: unlock");
           MDEBUG("P2P Request: handle_unicast: sender_address: " << arg.sender_address
                        << ", receiver_address: " << arg.receiver_address
                        << ", our address(es): " << join_supernodes_addresses(", "));
-          if (m_supernode_requests_cache.find(arg.message_id) == m_supernode_requests_cache.end())
+          MDEBUG("P2P Request: handle_unicast: post to supernodes");
+          auto it = m_supernodes.find(address);
+          bool local_sn = it != m_supernodes.end();
+          if (local_sn) {
+              MDEBUG("P2P Request: handle_unicast: sending to local supernode " << address);
+              std::string json;
+              post_rta_request_to_supernode<cryptonote::COMMAND_RPC_UNICAST>(it->second, "unicast", arg, rta_blob, arg.callback_uri, json);
+          }
+          else if (arg.hop > 0)
           {
-              MDEBUG("P2P Request: handle_unicast: post to supernodes");
-              m_supernode_requests_cache.insert(arg.message_id);
-              int timestamp = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
-              m_supernode_requests_timestamps.insert(std::make_pair(timestamp, arg.message_id));
-              auto it = m_supernodes.find(address);
-              bool local_sn = it != m_supernodes.end();
-              if (local_sn) {
-                  MDEBUG("P2P Request: handle_unicast: sending to local supernode " << address);
-                  post_request_to_supernode<cryptonote::COMMAND_RPC_UNICAST>(it->second, "unicast", arg, arg.callback_uri);
-              }
-              else if (arg.hop > 0)
-              {
-                  forward = true;
-              }
-              else
-              {
-                  MDEBUG("P2P Request: handle_unicast: hop counter ended for unicast from "
-                               << arg.sender_address);
-              }
+              forward = true;
           }
           else
           {
-              MDEBUG("P2P Request: handle_unicast: request found in cache, skipping");
+              MDEBUG("P2P Request: handle_unicast: hop counter ended for unicast from "
+                           << arg.sender_address);
           }
-          MDEBUG("P2P Request: handle_unicast: clean request cache");
-          remove_old_request_cache();
       }
 
       if (forward)
       {
           MDEBUG("P2P Request: handle_unicast: notify unicast from " << arg.sender_address
                        << " to " << arg.receiver_address << ". Hop level: " << arg.hop);
-          arg.hop--;
           std::list<std::string> addresses;
           addresses.push_back(address);
 
@@ -1364,9 +1370,10 @@ namespace nodetool
           exclude_peers.push_back(context.peer_id);
 
           std::string buff;
-          epee::serialization::store_t_to_binary(arg, buff);
+          make_relay_blob(arg, rta_blob, buff);
           multicast_send(command, buff, addresses, exclude_peers);
       }
+      m_tunnel_metrics->on_delivery(context.peer_id, true, tunnel_metrics::now_ms());
       MDEBUG("P2P Request: handle_unicast: end");
       return 1;
   }
@@ -1425,6 +1432,9 @@ namespace nodetool
           hsh_result = false;
           return;
         }
+        // the peer may be a tunnel of a known route
+        m_supernode_routes.on_connection(context.peer_id, context.m_connection_id);
+        m_supernode_routes.publish();
         LOG_DEBUG_CC(context, " COMMAND_HANDSHAKE INVOKED OK");
       }else
       {
@@ -1459,15 +1469,21 @@ namespace nodetool
     typename COMMAND_TIMED_SYNC::request arg = AUTO_VAL_INIT(arg);
     m_payload_handler.get_payload_sync_data(arg.payload_data);
 
+    const uint64_t started = tunnel_metrics::now_ms();
     bool r = epee::net_utils::async_invoke_remote_command2<typename COMMAND_TIMED_SYNC::response>(context_.m_connection_id, COMMAND_TIMED_SYNC::ID, arg, m_net_server.get_config_object(),
-      [this](int code, const typename COMMAND_TIMED_SYNC::response& rsp, p2p_connection_context& context)
+      [this, started](int code, const typename COMMAND_TIMED_SYNC::response& rsp, p2p_connection_context& context)
     {
       context.m_in_timedsync = false;
+      const uint64_t now = tunnel_metrics::now_ms();
       if(code < 0)
       {
         LOG_WARNING_CC(context, "COMMAND_TIMED_SYNC invoke failed. (" << code <<  ", " << epee::levin::get_err_descr(code) << ")");
+        if (context.peer_id)
+          m_tunnel_metrics->on_delivery(context.peer_id, false, now);
         return;
       }
+      if (context.peer_id)
+        m_tunnel_metrics->on_latency(context.peer_id, now - started, now);
 
       if(!handle_remote_peerlist(rsp.local_peerlist_new, rsp.local_time, context))
       {
@@ -2407,6 +2423,9 @@ namespace nodetool
     //associate peer_id with this connection
     context.peer_id = arg.node_data.peer_id;
     context.m_in_timedsync = false;
+    // the peer may be a tunnel of a known route
+    m_supernode_routes.on_connection(context.peer_id, context.m_connection_id);
+    m_supernode_routes.publish();
 
     if(arg.node_data.peer_id != m_config.m_peer_id && arg.node_data.my_port)
     {
@@ -2569,9 +2588,8 @@ namespace nodetool
 
       std::string data_blob;
       epee::serialization::store_t_to_binary(req, data_blob);
-      std::vector<uint8_t> data_vec(data_blob.begin(), data_blob.end());
       crypto::hash message_hash;
-      if (!tools::sha256sum(data_vec.data(), data_vec.size(), message_hash))
+      if (!tools::sha256sum(reinterpret_cast<const uint8_t*>(data_blob.data()), data_blob.size(), message_hash))
       {
           LOG_ERROR("RTA Broadcast: wrong data format for hashing!");
           return;
@@ -2582,7 +2600,7 @@ namespace nodetool
           LOG_PRINT_L3("P2P Request: do_broadcast: lock");
           boost::lock_guard<boost::recursive_mutex> guard(m_supernode_lock);
           LOG_PRINT_L3("P2P Request: do_broadcast: unlock");
-          post_request_to_supernodes<cryptonote::COMMAND_RPC_BROADCAST>("broadcast", req, req.callback_uri);
+          post_rta_request_to_supernodes<cryptonote::COMMAND_RPC_BROADCAST>("broadcast", req, data_blob, req.callback_uri);
       }
 
 #ifdef LOCK_RTA_SENDING
@@ -2594,20 +2612,10 @@ namespace nodetool
       p2p_req.callback_uri = req.callback_uri;
       p2p_req.data = req.data;
       p2p_req.wait_answer = req.wait_answer;
-      p2p_req.hop = HOP_RETRIES_MULTIPLIER * get_max_hop(get_routes());
+      p2p_req.hop = HOP_RETRIES_MULTIPLIER * m_supernode_routes.get()->max_hop;
       p2p_req.message_id = epee::string_tools::pod_to_hex(message_hash);
 
-      {
-          MDEBUG("P2P Request: do_broadcast: lock");
-          boost::lock_guard<boost::recursive_mutex> guard(m_request_cache_lock);
-          MDEBUG("P2P Request: do_broadcast: unlock");
-          m_supernode_requests_cache.insert(p2p_req.message_id);
-          int timestamp = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
-          m_supernode_requests_timestamps.insert(std::make_pair(timestamp, p2p_req.message_id));
-
-          MDEBUG("P2P Request: do_broadcast: clean request cache");
-          remove_old_request_cache();
-      }
+      m_supernode_requests_cache.insert(p2p_req.message_id);
 
       MDEBUG("P2P Request: do_broadcast: prepare peerlist");
 
@@ -2669,9 +2677,8 @@ namespace nodetool
 
       std::string data_blob;
       epee::serialization::store_t_to_binary(req, data_blob);
-      std::vector<uint8_t> data_vec(data_blob.begin(), data_blob.end());
       crypto::hash message_hash;
-      if (!tools::sha256sum(data_vec.data(), data_vec.size(), message_hash))
+      if (!tools::sha256sum(reinterpret_cast<const uint8_t*>(data_blob.data()), data_blob.size(), message_hash))
       {
           LOG_ERROR("RTA Multicast: wrong data format for hashing!");
           return;
@@ -2683,11 +2690,12 @@ namespace nodetool
           MDEBUG("P2P Request: do_multicast: lock");
           boost::unique_lock<boost::recursive_mutex> guard(m_supernode_lock);
           MDEBUG("P2P Request: do_multicast: unlock");
+          std::string json;
           for (auto &addr : req.receiver_addresses) {
               auto it = m_supernodes.find(addr);
               if (it != m_supernodes.end()) {
                   MDEBUG("P2P Request: do_multicast: multicast to " << addr);
-                  post_request_to_supernode<cryptonote::COMMAND_RPC_MULTICAST>(it->second, "multicast", req, req.callback_uri);
+                  post_rta_request_to_supernode<cryptonote::COMMAND_RPC_MULTICAST>(it->second, "multicast", req, data_blob, req.callback_uri, json);
               }
               else {
                   remaining_addresses.push_back(addr);
@@ -2713,17 +2721,7 @@ namespace nodetool
       p2p_req.hop = HOP_RETRIES_MULTIPLIER * get_max_hop(p2p_req.receiver_addresses);
       p2p_req.message_id = epee::string_tools::pod_to_hex(message_hash);
 
-      {
-          MDEBUG("P2P Request: do_multicast: lock");
-          boost::lock_guard<boost::recursive_mutex> guard(m_request_cache_lock);
-          MDEBUG("P2P Request: do_multicast: unlock");
-          m_supernode_requests_cache.insert(p2p_req.message_id);
-          int timestamp = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
-          m_supernode_requests_timestamps.insert(std::make_pair(timestamp, p2p_req.message_id));
-
-          MDEBUG("P2P Request: do_multicast: clean request cache");
-          remove_old_request_cache();
-      }
+      m_supernode_requests_cache.insert(p2p_req.message_id);
 
       MDEBUG("P2P Request: do_multicast: multicast send");
       std::string blob;
@@ -2749,9 +2747,8 @@ namespace nodetool
 
       std::string data_blob;
       epee::serialization::store_t_to_binary(req, data_blob);
-      std::vector<uint8_t> data_vec(data_blob.begin(), data_blob.end());
       crypto::hash message_hash;
-      if (!tools::sha256sum(data_vec.data(), data_vec.size(), message_hash))
+      if (!tools::sha256sum(reinterpret_cast<const uint8_t*>(data_blob.data()), data_blob.size(), message_hash))
       {
           LOG_ERROR("RTA Unicast: wrong data format for hashing!");
           return;
@@ -2766,7 +2763,8 @@ namespace nodetool
           auto it = m_supernodes.find(addr);
           if (it != m_supernodes.end()) {
               LOG_PRINT_L2("P2P Request: do_unicast: unicast to local supernode " << addr);
-              post_request_to_supernode<cryptonote::COMMAND_RPC_UNICAST>(it->second, "unicast", req, req.callback_uri);
+              std::string json;
+              post_rta_request_to_supernode<cryptonote::COMMAND_RPC_UNICAST>(it->second, "unicast", req, data_blob, req.callback_uri, json);
               LOG_PRINT_L2("P2P request: do_unicast: End (unicast recipient was local)");
               return;
           }
@@ -2781,17 +2779,7 @@ namespace nodetool
       p2p_req.hop = HOP_RETRIES_MULTIPLIER * get_max_hop(addresses);
       p2p_req.message_id = epee::string_tools::pod_to_hex(message_hash);
 
-      {
-          MDEBUG("P2P Request: do_unicast: lock");
-          boost::lock_guard<boost::recursive_mutex> guard(m_request_cache_lock);
-          MDEBUG("P2P Request: do_unicast: unlock");
-          m_supernode_requests_cache.insert(p2p_req.message_id);
-          int timestamp = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
-          m_supernode_requests_timestamps.insert(std::make_pair(timestamp, p2p_req.message_id));
-
-          MDEBUG("P2P Request: do_unicast: clean request cache");
-          remove_old_request_cache();
-      }
+      m_supernode_requests_cache.insert(p2p_req.message_id);
 
       MDEBUG("P2P Request: do_unicast: unicast send");
       std::string blob;
@@ -2804,21 +2792,32 @@ namespace nodetool
   template<class t_payload_net_handler>
   std::vector<cryptonote::route_data> node_server<t_payload_net_handler>::get_tunnels() const
   {
+      supernode_route_table_ptr table = m_supernode_routes.get();
       std::vector<cryptonote::route_data> tunnels;
-      for (auto it = m_supernode_routes.begin(); it != m_supernode_routes.end(); ++it)
+      tunnels.reserve(table->routes.size());
+      const uint64_t now = tunnel_metrics::now_ms();
+      for (auto it = table->routes.begin(); it != table->routes.end(); ++it)
       {
           cryptonote::route_data route;
           route.address = it->first;
           route.last_announce_height = it->second.last_announce_height;
+          route.last_announce_time = it->second.last_announce_time;
           route.max_hop = it->second.max_hop;
           std::vector<cryptonote::peer_data> peers;
-          for (auto pit = it->second.peers.begin(); pit != it->second.peers.end(); ++pit)
+          for (size_t index : it->second.tunnels)
           {
+              const peerlist_entry &pe = table->tunnels[index].peer;
+              const i_tunnel_metrics::peer_stats stats = m_tunnel_metrics->get_stats(pe.id, now);
               cryptonote::peer_data peer;
-              peer.host = pit->adr.host_str();
-              peer.port = pit->adr.template as<epee::net_utils::ipv4_network_address>().port();
-              peer.id = pit->id;
-              peer.last_seen = pit->last_seen;
+              peer.host = pe.adr.host_str();
+              peer.port = pe.adr.template as<epee::net_utils::ipv4_network_address>().port();
+              peer.id = pe.id;
+              peer.last_seen = pe.last_seen;
+              peer.connected = table->tunnels[index].connected;
+              peer.latency_ms = stats.latency_ms;
+              peer.delivered = stats.delivered;
+              peer.failed = stats.failed;
+              peer.score = stats.score;
               peers.push_back(peer);
           }
           route.peers = peers;
@@ -2864,6 +2863,13 @@ namespace nodetool
 
     m_payload_handler.on_connection_close(context);
 
+    // tunnels through this peer are no longer reachable
+    if (context.peer_id) {
+      m_supernode_routes.on_connection_close(context.peer_id, context.m_connection_id);
+      m_supernode_routes.publish();
+      m_tunnel_metrics->remove(context.peer_id);
+    }
+
     MINFO("["<< epee::net_utils::print_connection_context(context) << "] CLOSE CONNECTION");
   }
 
@@ -3173,32 +3179,30 @@ namespace nodetool
 
     MDEBUG("handle_stakes_update to supernode for block #" << block_height);
 
-    cryptonote::COMMAND_RPC_SUPERNODE_STAKES::request request;
+    cryptonote::COMMAND_RPC_SUPERNODE_STAKES_UPDATE::request delta;
 
-    request.block_height = block_height;
+    m_supernode_list_encoder.update_stakes(block_height, stakes, delta);
 
-    request.stakes.reserve(stakes.size());
+    MDEBUG("handle_stakes_update: " << delta.stakes.size() << " stake(s) changed, " << delta.removed_supernodes.size() << " removed");
 
-    for (const cryptonote::supernode_stake& src_stake : stakes)
-    {
-      cryptonote::COMMAND_RPC_SUPERNODE_STAKES::supernode_stake dst_stake;
-
-      dst_stake.amount = src_stake.amount;
-      dst_stake.tier = src_stake.tier;
-      dst_stake.block_height = src_stake.block_height;
-      dst_stake.unlock_time = src_stake.unlock_time;
-      dst_stake.supernode_public_id = src_stake.supernode_public_id;
-      dst_stake.supernode_public_address = cryptonote::get_account_address_as_str(m_nettype, false, src_stake.supernode_public_address);
-
-      request.stakes.emplace_back(std::move(dst_stake));
-    }
-
-    post_request_to_supernodes<cryptonote::COMMAND_RPC_SUPERNODE_STAKES>(supernode_endpoint, request);
+    post_list_update_to_supernodes<cryptonote::COMMAND_RPC_SUPERNODE_STAKES, cryptonote::COMMAND_RPC_SUPERNODE_STAKES_UPDATE>(
+      supernode_endpoint, m_supernode_list_encoder.get_stakes(), delta,
+      [this](cryptonote::COMMAND_RPC_SUPERNODE_STAKES_UPDATE::request& snapshot) { m_supernode_list_encoder.get_stakes_snapshot(snapshot); },
+      &local_supernode::need_stakes_snapshot);
   }
 
   template<class t_payload_net_handler>
-  void node_server<t_payload_net_handler>::send_stakes_to_supernode()
+  void node_server<t_payload_net_handler>::send_stakes_to_supernode(const std::string &supernode_public_id, bool binary_updates)
   {
+    {
+      boost::lock_guard<boost::recursive_mutex> guard(m_supernode_lock);
+      auto it = m_supernodes.find(supernode_public_id);
+      if (it != m_supernodes.end()) {
+        it->second.binary_updates = binary_updates;
+        it->second.need_stakes_snapshot = true;
+      }
+    }
+
     m_payload_handler.get_core().invoke_update_stakes_handler();
   }
 
@@ -3214,37 +3218,39 @@ namespace nodetool
 
     MDEBUG("handle_blockchain_based_list_update to supernode for block #" << block_height);
 
-    cryptonote::COMMAND_RPC_SUPERNODE_BLOCKCHAIN_BASED_LIST::request request;
-
-    request.block_height = block_height;
-
-    for (size_t i=0; i<tiers.size(); i++)
-    {
-      const cryptonote::StakeTransactionProcessor::supernode_tier_array::value_type& src_tier = tiers[i];
-      cryptonote::COMMAND_RPC_SUPERNODE_BLOCKCHAIN_BASED_LIST::tier                  dst_tier;
-
-      dst_tier.supernodes.reserve(src_tier.size());
+    cryptonote::COMMAND_RPC_SUPERNODE_BLOCKCHAIN_BASED_LIST_UPDATE::request delta;
 
-      for (const cryptonote::BlockchainBasedList::supernode& src_supernode : src_tier)
-      {
-        cryptonote::COMMAND_RPC_SUPERNODE_BLOCKCHAIN_BASED_LIST::supernode dst_supernode;
+    m_supernode_list_encoder.update_blockchain_based_list(block_height, tiers, delta);
 
-        dst_supernode.supernode_public_id      = src_supernode.supernode_public_id;
-        dst_supernode.supernode_public_address = cryptonote::get_account_address_as_str(m_nettype, false, src_supernode.supernode_public_address);
-        dst_supernode.amount                   = src_supernode.amount;
+    post_list_update_to_supernodes<cryptonote::COMMAND_RPC_SUPERNODE_BLOCKCHAIN_BASED_LIST, cryptonote::COMMAND_RPC_SUPERNODE_BLOCKCHAIN_BASED_LIST_UPDATE>(
+      supernode_endpoint, m_supernode_list_encoder.get_blockchain_based_list(), delta,
+      [this](cryptonote::COMMAND_RPC_SUPERNODE_BLOCKCHAIN_BASED_LIST_UPDATE::request& snapshot) { m_supernode_list_encoder.get_blockchain_based_list_snapshot(snapshot); },
+      &local_supernode::need_blockchain_based_list_snapshot);
+  }
 
-        dst_tier.supernodes.emplace_back(std::move(dst_supernode));
+  template<class t_payload_net_handler>
+  void node_server<t_payload_net_handler>::send_blockchain_based_list_to_supernode(const std::string &supernode_public_id, bool binary_updates, uint64_t last_received_block_height)
+  {
+    {
+      boost::lock_guard<boost::recursive_mutex> guard(m_supernode_lock);
+      auto it = m_supernodes.find(supernode_public_id);
+      if (it != m_supernodes.end()) {
+        it->second.binary_updates = binary_updates;
+        it->second.need_blockchain_based_list_snapshot = true;
       }
-
-      request.tiers.emplace_back(std::move(dst_tier));
     }
 
-    post_request_to_supernodes<cryptonote::COMMAND_RPC_SUPERNODE_BLOCKCHAIN_BASED_LIST>(supernode_endpoint, request);
+    m_payload_handler.get_core().invoke_update_blockchain_based_list_handler(last_received_block_height);
   }
 
   template<class t_payload_net_handler>
-  void node_server<t_payload_net_handler>::send_blockchain_based_list_to_supernode(uint64_t last_received_block_height)
+  void node_server<t_payload_net_handler>::set_supernode_binary_rta(const std::string &supernode_public_id)
   {
-    m_payload_handler.get_core().invoke_update_blockchain_based_list_handler(last_received_block_height);
+    boost::lock_guard<boost::recursive_mutex> guard(m_supernode_lock);
+    auto it = m_supernodes.find(supernode_public_id);
+    if (it != m_supernodes.end() && !it->second.binary_rta) {
+      MDEBUG("local supernode " << supernode_public_id << " switched to binary RTA messages");
+      it->second.binary_rta = true;
+    }
   }
 }
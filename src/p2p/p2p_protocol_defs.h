@@ -198,6 +198,20 @@ namespace nodetool
       struct response : public cryptonote::COMMAND_RPC_SUPERNODE_ANNOUNCE::response { };
   };
 
+  struct COMMAND_SUPERNODE_ANNOUNCE_BATCH
+  {
+      const static int ID = P2P_COMMANDS_POOL_BASE + 24;
+
+      struct request
+      {
+          std::vector<COMMAND_SUPERNODE_ANNOUNCE::request> announces;
+
+          BEGIN_KV_SERIALIZE_MAP()
+            KV_SERIALIZE(announces)
+          END_KV_SERIALIZE_MAP()
+      };
+  };
+
   struct COMMAND_BROADCAST
   {
       const static int ID = P2P_COMMANDS_POOL_BASE + 21;
@@ -215,6 +229,13 @@ namespace nodetool
             KV_SERIALIZE(hop)
             KV_SERIALIZE(message_id)
           END_KV_SERIALIZE_MAP()
+
+          //top level fields of the serialized request, keep in sync with the map above
+          static const std::vector<std::string>& relay_fields()
+          {
+            static const std::vector<std::string> fields = {"sender_address", "callback_uri", "data", "wait_answer", "hop", "message_id"};
+            return fields;
+          }
       };
 
       struct response : public cryptonote::COMMAND_RPC_BROADCAST::response { };
@@ -238,6 +259,13 @@ namespace nodetool
             KV_SERIALIZE(hop)
             KV_SERIALIZE(message_id)
           END_KV_SERIALIZE_MAP()
+
+          //top level fields of the serialized request, keep in sync with the map above
+          static const std::vector<std::string>& relay_fields()
+          {
+            static const std::vector<std::string> fields = {"receiver_addresses", "sender_address", "callback_uri", "data", "wait_answer", "hop", "message_id"};
+            return fields;
+          }
       };
 
       struct response : public cryptonote::COMMAND_RPC_MULTICAST::response { };
@@ -261,6 +289,13 @@ namespace nodetool
             KV_SERIALIZE(hop)
             KV_SERIALIZE(message_id)
           END_KV_SERIALIZE_MAP()
+
+          //top level fields of the serialized request, keep in sync with the map above
+          static const std::vector<std::string>& relay_fields()
+          {
+            static const std::vector<std::string> fields = {"receiver_address", "sender_address", "callback_uri", "data", "wait_answer", "hop", "message_id"};
+            return fields;
+          }
       };
 
       struct response : public cryptonote::COMMAND_RPC_UNICAST::response { };
@@ -0,0 +1,200 @@
+// Copyright (c) 2019, The Graft Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "rta_message_cache.h"
+
+#include <boost/thread/lock_guard.hpp>
+
+#include <algorithm>
+#include <cstring>
+
+#include "crypto/hash.h"
+#include "string_tools.h"
+
+namespace nodetool
+{
+  rta_message_cache::rta_message_cache(std::chrono::milliseconds ttl, size_t max_size, size_t shards_count, size_t buckets_count)
+    : m_shards_count(shards_count ? shards_count : 1)
+  {
+    if (!buckets_count)
+      buckets_count = 1;
+
+    m_bucket_ms      = std::max<uint64_t>(1, ttl.count() / buckets_count);
+    m_max_shard_size = std::max<size_t>(1, max_size / m_shards_count);
+
+    m_shards.reset(new shard[m_shards_count]);
+
+    for (size_t i=0; i<m_shards_count; i++)
+    {
+      m_shards[i].buckets.resize(buckets_count + 1); //one more bucket for ids older than ttl by less than one bucket
+      m_shards[i].epoch = 0;
+    }
+  }
+
+  rta_message_cache::message_digest rta_message_cache::get_digest(const std::string& message_id)
+  {
+    message_digest digest;
+    static_assert(sizeof(digest) <= sizeof(crypto::hash), "digest is too large");
+
+      //message ids are hex encoded hashes, so they may be used without hashing
+
+    if (message_id.size() == sizeof(crypto::hash) * 2 && epee::string_tools::hex_to_pod(message_id.substr(0, sizeof(digest) * 2), digest))
+      return digest;
+
+    crypto::hash hash = crypto::cn_fast_hash(message_id.data(), message_id.size());
+    memcpy(digest.data(), hash.data, sizeof(digest));
+    return digest;
+  }
+
+  uint64_t rta_message_cache::now_ms()
+  {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+  }
+
+  rta_message_cache::shard& rta_message_cache::get_shard(const message_digest& digest) const
+  {
+    return m_shards[digest[1] % m_shards_count];
+  }
+
+  void rta_message_cache::drop_bucket(shard& s, bucket& b)
+  {
+    for (const message_digest& digest : b.digests)
+    {
+      digest_map::iterator it = s.digests.find(digest);
+
+      if (it != s.digests.end() && it->second == b.epoch)
+        s.digests.erase(it);
+    }
+
+    b.digests.clear();
+  }
+
+  void rta_message_cache::advance(shard& s, uint64_t epoch)
+  {
+    if (epoch <= s.epoch)
+      return;
+
+    const size_t buckets_count = s.buckets.size();
+    const uint64_t first_epoch = epoch - std::min<uint64_t>(epoch - s.epoch, buckets_count) + 1;
+
+    for (uint64_t e=first_epoch; e<=epoch; e++)
+    {
+      bucket& b = s.buckets[e % buckets_count];
+
+      drop_bucket(s, b);
+
+      b.epoch = e;
+    }
+
+    s.epoch = epoch;
+  }
+
+  void rta_message_cache::evict_oldest(shard& s)
+  {
+    const size_t buckets_count = s.buckets.size();
+
+    for (size_t i=1; i<buckets_count; i++)
+    {
+      bucket& b = s.buckets[(s.epoch + i) % buckets_count];
+
+      if (b.digests.empty())
+        continue;
+
+      drop_bucket(s, b);
+      return;
+    }
+
+      //only the current bucket is filled: forget the older half of its ids
+
+    bucket& b = s.buckets[s.epoch % buckets_count];
+    const size_t count = std::max<size_t>(1, b.digests.size() / 2);
+
+    for (size_t i=0; i<count; i++)
+      s.digests.erase(b.digests[i]);
+
+    b.digests.erase(b.digests.begin(), b.digests.begin() + count);
+  }
+
+  bool rta_message_cache::insert(const std::string& message_id)
+  {
+    return insert(message_id, now_ms());
+  }
+
+  bool rta_message_cache::insert(const std::string& message_id, uint64_t now)
+  {
+    const message_digest digest = get_digest(message_id);
+    const uint64_t epoch = now / m_bucket_ms;
+    shard& s = get_shard(digest);
+
+    boost::lock_guard<boost::mutex> guard(s.lock);
+
+    advance(s, epoch);
+
+    if (s.digests.count(digest))
+      return false;
+
+      //keep memory bounded under message storms: forget the oldest ids earlier than ttl
+
+    while (s.digests.size() >= m_max_shard_size && !s.digests.empty())
+      evict_oldest(s);
+
+    bucket& b = s.buckets[s.epoch % s.buckets.size()];
+
+    s.digests.emplace(digest, b.epoch);
+    b.digests.push_back(digest);
+
+    return true;
+  }
+
+  bool rta_message_cache::contains(const std::string& message_id) const
+  {
+    const message_digest digest = get_digest(message_id);
+    const uint64_t epoch = now_ms() / m_bucket_ms;
+    const shard& s = get_shard(digest);
+
+    boost::lock_guard<boost::mutex> guard(s.lock);
+
+    digest_map::const_iterator it = s.digests.find(digest);
+
+    return it != s.digests.end() && it->second + s.buckets.size() > epoch;
+  }
+
+  size_t rta_message_cache::size() const
+  {
+    size_t result = 0;
+
+    for (size_t i=0; i<m_shards_count; i++)
+    {
+      boost::lock_guard<boost::mutex> guard(m_shards[i].lock);
+      result += m_shards[i].digests.size();
+    }
+
+    return result;
+  }
+}
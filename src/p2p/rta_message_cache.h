@@ -0,0 +1,105 @@
+// Copyright (c) 2019, The Graft Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#pragma once
+
+#include <boost/thread/mutex.hpp>
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace nodetool
+{
+  /// Cache of recently relayed RTA message ids used to drop duplicates. Ids are reduced to fixed size
+  /// digests and spread over independently locked shards; each shard keeps ids in time buckets, so
+  /// expiration drops a whole bucket at once and the number of remembered ids is bounded.
+  class rta_message_cache
+  {
+  public:
+    rta_message_cache(std::chrono::milliseconds ttl, size_t max_size, size_t shards_count = 16, size_t buckets_count = 12);
+
+    /// Remember message id; returns false if the id has been already seen during ttl
+    bool insert(const std::string& message_id);
+    bool insert(const std::string& message_id, uint64_t now_ms);
+
+    /// Check whether message id has been seen during ttl
+    bool contains(const std::string& message_id) const;
+
+    /// Number of remembered ids
+    size_t size() const;
+
+  private:
+    typedef std::array<uint64_t, 2> message_digest;
+
+    struct message_digest_hash
+    {
+      size_t operator()(const message_digest& digest) const { return static_cast<size_t>(digest[0]); }
+    };
+
+    typedef std::unordered_map<message_digest, uint64_t, message_digest_hash> digest_map; //digest -> bucket epoch
+
+    struct bucket
+    {
+      uint64_t epoch;
+      std::vector<message_digest> digests;
+    };
+
+    struct shard
+    {
+      mutable boost::mutex lock;
+      digest_map digests;
+      std::vector<bucket> buckets;
+      uint64_t epoch; //epoch of the newest bucket
+    };
+
+    static message_digest get_digest(const std::string& message_id);
+    static uint64_t now_ms();
+
+    shard& get_shard(const message_digest& digest) const;
+
+    /// Move shard to the epoch dropping expired buckets
+    void advance(shard& s, uint64_t epoch);
+
+    /// Drop the oldest non-empty bucket of shard
+    void evict_oldest(shard& s);
+
+    void drop_bucket(shard& s, bucket& b);
+
+  private:
+    uint64_t m_bucket_ms;
+    size_t m_max_shard_size;
+    std::unique_ptr<shard[]> m_shards;
+    size_t m_shards_count;
+  };
+}
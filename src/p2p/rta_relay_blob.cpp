@@ -0,0 +1,274 @@
+// Copyright (c) 2019, The Graft Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "rta_relay_blob.h"
+
+#include <cstring>
+
+#include "storages/portable_storage_base.h"
+
+namespace nodetool
+{
+  namespace
+  {
+    const char* const HOP_FIELD = "hop";
+    //two signatures and format version, see portable_storage::storage_block_header
+    const size_t HEADER_SIZE = 2 * sizeof(uint32_t) + sizeof(uint8_t);
+    const size_t MAX_DEPTH = 100;
+
+    /// Bounds checked cursor over a portable storage blob; only skips values, never copies them
+    class blob_walker
+    {
+    public:
+      blob_walker(const std::string& blob) : m_data(reinterpret_cast<const uint8_t*>(blob.data())), m_size(blob.size()), m_pos(0), m_depth(0) {}
+
+      size_t pos() const { return m_pos; }
+      bool at_end() const { return m_pos == m_size; }
+
+      bool skip(size_t count)
+      {
+        if (count > m_size - m_pos)
+          return false;
+        m_pos += count;
+        return true;
+      }
+
+      bool read_byte(uint8_t& value)
+      {
+        if (m_pos >= m_size)
+          return false;
+        value = m_data[m_pos++];
+        return true;
+      }
+
+      bool read_varint(uint64_t& value)
+      {
+        if (m_pos >= m_size)
+          return false;
+        const size_t width = size_t(1) << (m_data[m_pos] & PORTABLE_RAW_SIZE_MARK_MASK);
+        if (width > m_size - m_pos)
+          return false;
+        uint64_t raw = 0;
+        for (size_t i = 0; i < width; ++i)
+          raw |= uint64_t(m_data[m_pos + i]) << (8 * i);
+        m_pos += width;
+        value = raw >> 2;
+        return true;
+      }
+
+      bool skip_header()
+      {
+        uint32_t signature_a, signature_b;
+        if (m_size < HEADER_SIZE)
+          return false;
+        memcpy(&signature_a, m_data, sizeof(signature_a));
+        memcpy(&signature_b, m_data + sizeof(signature_a), sizeof(signature_b));
+        if (signature_a != PORTABLE_STORAGE_SIGNATUREA || signature_b != PORTABLE_STORAGE_SIGNATUREB ||
+            m_data[HEADER_SIZE - 1] != PORTABLE_STORAGE_FORMAT_VER)
+          return false;
+        m_pos = HEADER_SIZE;
+        return true;
+      }
+
+      bool read_name(const char*& name, size_t& length)
+      {
+        uint8_t name_length;
+        if (!read_byte(name_length) || name_length > m_size - m_pos)
+          return false;
+        name = reinterpret_cast<const char*>(m_data + m_pos);
+        length = name_length;
+        m_pos += name_length;
+        return true;
+      }
+
+      bool skip_value(uint8_t type)
+      {
+        if (type & SERIALIZE_FLAG_ARRAY)
+        {
+          uint64_t count;
+          if (!read_varint(count))
+            return false;
+          type &= ~SERIALIZE_FLAG_ARRAY;
+          const size_t size = pod_size(type);
+          if (size)
+            return count <= (m_size - m_pos) / size && skip(count * size);
+          while (count--)
+            if (!skip_value(type))
+              return false;
+          return true;
+        }
+
+        const size_t size = pod_size(type);
+        if (size)
+          return skip(size);
+        switch (type)
+        {
+        case SERIALIZE_TYPE_STRING:
+        {
+          uint64_t length;
+          return read_varint(length) && skip(length);
+        }
+        case SERIALIZE_TYPE_OBJECT:
+          return skip_section();
+        default:
+          //nested arrays are never used by RTA requests
+          return false;
+        }
+      }
+
+      bool skip_section()
+      {
+        if (++m_depth > MAX_DEPTH)
+          return false;
+        uint64_t count;
+        if (!read_varint(count))
+          return false;
+        while (count--)
+        {
+          const char* name;
+          size_t length;
+          uint8_t type;
+          if (!read_name(name, length) || !read_byte(type) || !skip_value(type))
+            return false;
+        }
+        --m_depth;
+        return true;
+      }
+
+    private:
+      static size_t pod_size(uint8_t type)
+      {
+        switch (type)
+        {
+        case SERIALIZE_TYPE_INT64:
+        case SERIALIZE_TYPE_UINT64:
+        case SERIALIZE_TYPE_DUOBLE:
+          return 8;
+        case SERIALIZE_TYPE_INT32:
+        case SERIALIZE_TYPE_UINT32:
+          return 4;
+        case SERIALIZE_TYPE_INT16:
+        case SERIALIZE_TYPE_UINT16:
+          return 2;
+        case SERIALIZE_TYPE_INT8:
+        case SERIALIZE_TYPE_UINT8:
+        case SERIALIZE_TYPE_BOOL:
+          return 1;
+        default:
+          return 0;
+        }
+      }
+
+      const uint8_t* m_data;
+      size_t m_size;
+      size_t m_pos;
+      size_t m_depth;
+    };
+
+    bool find_hop(const std::string& blob, size_t& offset)
+    {
+      uint8_t type;
+      return find_binary_field(blob, HOP_FIELD, type, offset) && type == SERIALIZE_TYPE_UINT64;
+    }
+  }
+
+  bool find_binary_field(const std::string& blob, const std::string& name, uint8_t& type, size_t& offset)
+  {
+    blob_walker walker(blob);
+    uint64_t count;
+    if (!walker.skip_header() || !walker.read_varint(count))
+      return false;
+    while (count--)
+    {
+      const char* field_name;
+      size_t length;
+      if (!walker.read_name(field_name, length) || !walker.read_byte(type))
+        return false;
+      if (length == name.size() && !memcmp(field_name, name.data(), length) && !(type & SERIALIZE_FLAG_ARRAY))
+      {
+        offset = walker.pos();
+        return walker.skip_value(type);
+      }
+      if (!walker.skip_value(type))
+        return false;
+    }
+    return false;
+  }
+
+  bool check_binary_fields(const std::string& blob, const std::vector<std::string>& names)
+  {
+    if (names.size() > 64)
+      return false;
+    blob_walker walker(blob);
+    uint64_t count;
+    if (!walker.skip_header() || !walker.read_varint(count))
+      return false;
+    uint64_t seen = 0;
+    while (count--)
+    {
+      const char* field_name;
+      size_t length;
+      uint8_t type;
+      if (!walker.read_name(field_name, length) || !walker.read_byte(type))
+        return false;
+      size_t i = 0;
+      while (i < names.size() && (names[i].size() != length || memcmp(field_name, names[i].data(), length)))
+        ++i;
+      if (i == names.size() || (seen & (uint64_t(1) << i)))
+        return false;
+      seen |= uint64_t(1) << i;
+      if (!walker.skip_value(type))
+        return false;
+    }
+    return walker.at_end();
+  }
+
+  bool get_binary_hop(const std::string& blob, uint64_t& hop)
+  {
+    size_t offset;
+    if (!find_hop(blob, offset))
+      return false;
+    memcpy(&hop, blob.data() + offset, sizeof(hop));
+    return true;
+  }
+
+  bool decrement_binary_hop(std::string& blob)
+  {
+    size_t offset;
+    if (!find_hop(blob, offset))
+      return false;
+    uint64_t hop;
+    memcpy(&hop, &blob[offset], sizeof(hop));
+    if (hop == 0)
+      return false;
+    --hop;
+    memcpy(&blob[offset], &hop, sizeof(hop));
+    return true;
+  }
+}
@@ -0,0 +1,53 @@
+// Copyright (c) 2019, The Graft Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace nodetool
+{
+  /// Finds a top level field of a portable storage binary blob without loading the whole storage.
+  /// On success type is the serialized type of the field and offset points to the first byte of its value.
+  bool find_binary_field(const std::string& blob, const std::string& name, uint8_t& type, size_t& offset);
+
+  /// Checks that a blob is a well formed portable storage with top level fields from names only, each at most
+  /// once and with nothing after them, so relaying it as is forwards no more than serializing the loaded request
+  bool check_binary_fields(const std::string& blob, const std::vector<std::string>& names);
+
+  /// Reads hop counter of a serialized RTA request (COMMAND_BROADCAST, COMMAND_MULTICAST, COMMAND_UNICAST)
+  bool get_binary_hop(const std::string& blob, uint64_t& hop);
+
+  /// Decrements hop counter of a serialized RTA request in place, so the request can be relayed
+  /// without being serialized again; returns false if the blob has no hop counter or it is already zero
+  bool decrement_binary_hop(std::string& blob);
+}
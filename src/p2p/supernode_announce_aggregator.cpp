@@ -0,0 +1,143 @@
+// Copyright (c) 2019, The Graft Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "supernode_announce_aggregator.h"
+
+#include <boost/thread/lock_guard.hpp>
+
+#include <algorithm>
+
+namespace nodetool
+{
+  token_bucket::token_bucket(double rate, double burst)
+    : m_rate(rate)
+    , m_burst(burst)
+    , m_tokens(burst)
+    , m_last_ms()
+  {
+  }
+
+  bool token_bucket::consume(uint64_t now_ms, double tokens)
+  {
+    if (now_ms > m_last_ms)
+    {
+      m_tokens = std::min(m_burst, m_tokens + m_rate * (now_ms - m_last_ms) / 1000.0);
+      m_last_ms = now_ms;
+    }
+
+    if (m_tokens < tokens)
+      return false;
+
+    m_tokens -= tokens;
+    return true;
+  }
+
+  supernode_announce_aggregator::supernode_announce_aggregator(std::chrono::milliseconds window, size_t max_batch_size, std::chrono::milliseconds memory)
+    : m_window_ms(window.count())
+    , m_max_batch_size(max_batch_size ? max_batch_size : 1)
+    , m_memory_ms(memory.count())
+    , m_first_queued_ms()
+    , m_last_cleanup_ms()
+  {
+  }
+
+  uint64_t supernode_announce_aggregator::now_ms()
+  {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+  }
+
+  bool supernode_announce_aggregator::add(const announce& value, bool relay)
+  {
+    return add(value, relay, now_ms());
+  }
+
+  bool supernode_announce_aggregator::add(const announce& value, bool relay, uint64_t now_ms)
+  {
+    boost::lock_guard<boost::mutex> guard(m_lock);
+
+    auto flushed_it = m_flushed.find(value.supernode_public_id);
+    if (flushed_it != m_flushed.end() && flushed_it->second.height >= value.height && flushed_it->second.time_ms + m_memory_ms > now_ms)
+      return false;
+
+    auto queued_it = m_queued.find(value.supernode_public_id);
+    if (queued_it != m_queued.end())
+    {
+      entry& queued = m_queue[queued_it->second];
+      if (queued.value.height >= value.height)
+        return false;
+      queued.value = value;
+      queued.relay = relay;
+      return true;
+    }
+
+    if (m_queue.empty())
+      m_first_queued_ms = now_ms;
+
+    m_queued.emplace(value.supernode_public_id, m_queue.size());
+    m_queue.push_back(entry{value, relay});
+    return true;
+  }
+
+  bool supernode_announce_aggregator::flush(std::vector<entry>& batch)
+  {
+    return flush(now_ms(), batch);
+  }
+
+  bool supernode_announce_aggregator::flush(uint64_t now_ms, std::vector<entry>& batch)
+  {
+    boost::lock_guard<boost::mutex> guard(m_lock);
+
+    if (m_last_cleanup_ms + m_memory_ms <= now_ms)
+    {
+      for (auto it = m_flushed.begin(); it != m_flushed.end();)
+      {
+        if (it->second.time_ms + m_memory_ms <= now_ms) it = m_flushed.erase(it);
+        else                                            ++it;
+      }
+      m_last_cleanup_ms = now_ms;
+    }
+
+    if (m_queue.empty() || (m_first_queued_ms + m_window_ms > now_ms && m_queue.size() < m_max_batch_size))
+      return false;
+
+    for (const entry& e : m_queue)
+      m_flushed[e.value.supernode_public_id] = flushed_height{e.value.height, now_ms};
+
+    batch.clear();
+    batch.swap(m_queue);
+    m_queued.clear();
+    return true;
+  }
+
+  size_t supernode_announce_aggregator::size() const
+  {
+    boost::lock_guard<boost::mutex> guard(m_lock);
+    return m_queue.size();
+  }
+}
@@ -0,0 +1,106 @@
+// Copyright (c) 2019, The Graft Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#pragma once
+
+#include <boost/thread/mutex.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "p2p_protocol_defs.h"
+
+namespace nodetool
+{
+  /// Token bucket: tokens are refilled at rate per second up to burst. Not thread safe.
+  class token_bucket
+  {
+  public:
+    token_bucket(double rate, double burst);
+
+    /// Take tokens if available
+    bool consume(uint64_t now_ms, double tokens = 1);
+
+  private:
+    double m_rate;
+    double m_burst;
+    double m_tokens;
+    uint64_t m_last_ms;
+  };
+
+  /// Collects supernode announces over a short window, so they are relayed to peers and posted to local supernodes
+  /// in batches. Announces are deduplicated by (supernode id, height): a queued announce is replaced only by a higher one,
+  /// and an announce already flushed is not queued again while it is remembered.
+  class supernode_announce_aggregator
+  {
+  public:
+    typedef COMMAND_SUPERNODE_ANNOUNCE::request announce;
+
+    struct entry
+    {
+      announce value;
+      bool relay; //relay to peers; local announces are sent to peers by their origin
+    };
+
+    supernode_announce_aggregator(std::chrono::milliseconds window, size_t max_batch_size, std::chrono::milliseconds memory);
+
+    /// Queue announce; returns false for a duplicate
+    bool add(const announce& value, bool relay, uint64_t now_ms);
+    bool add(const announce& value, bool relay);
+
+    /// Take queued announces once the window since the first one has passed or the batch is full
+    bool flush(uint64_t now_ms, std::vector<entry>& batch);
+    bool flush(std::vector<entry>& batch);
+
+    /// Number of queued announces
+    size_t size() const;
+
+    static uint64_t now_ms();
+
+  private:
+    struct flushed_height
+    {
+      uint64_t height;
+      uint64_t time_ms;
+    };
+
+    uint64_t m_window_ms;
+    size_t m_max_batch_size;
+    uint64_t m_memory_ms;
+    mutable boost::mutex m_lock;
+    std::vector<entry> m_queue;
+    std::unordered_map<std::string, size_t> m_queued; //supernode id -> index in m_queue
+    std::unordered_map<std::string, flushed_height> m_flushed; //supernode id -> last flushed height
+    uint64_t m_first_queued_ms;
+    uint64_t m_last_cleanup_ms;
+  };
+}
@@ -0,0 +1,226 @@
+// Copyright (c) 2019, The Graft Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "supernode_delivery_queue.h"
+
+#include "misc_log_ex.h"
+
+#undef MONERO_DEFAULT_LOG_CATEGORY
+#define MONERO_DEFAULT_LOG_CATEGORY "net.p2p"
+
+namespace nodetool
+{
+  supernode_delivery_queue::supernode_delivery_queue(const std::string& host, uint64_t port, size_t max_depth, overflow_policy policy,
+                                                     size_t max_batch_size, std::chrono::milliseconds timeout)
+    : m_max_depth(max_depth ? max_depth : 1)
+    , m_policy(policy)
+    , m_max_batch_size(max_batch_size ? max_batch_size : 1)
+    , m_timeout(timeout)
+    , m_stats()
+    , m_total_latency_ms()
+    , m_stopped(false)
+  {
+    m_client.set_server(host, std::to_string(port), {});
+    m_worker = boost::thread(&supernode_delivery_queue::run, this);
+  }
+
+  supernode_delivery_queue::~supernode_delivery_queue()
+  {
+    try
+    {
+      stop();
+    }
+    catch (...)
+    {
+      MERROR("Exception at supernode delivery queue stop");
+    }
+  }
+
+  void supernode_delivery_queue::set_server(const std::string& host, uint64_t port)
+  {
+    m_client.set_server(host, std::to_string(port), {});
+  }
+
+  bool supernode_delivery_queue::push(const std::string& uri, std::string body, content_type type)
+  {
+    {
+      boost::lock_guard<boost::mutex> guard(m_lock);
+
+      if (m_stopped)
+        return false;
+
+      if (m_messages.size() >= m_max_depth)
+      {
+        m_stats.dropped++;
+
+        if (m_policy == drop_newest)
+          return false;
+
+        m_messages.pop_front();
+      }
+
+      m_messages.push_back({uri, std::move(body), type, std::chrono::steady_clock::now()});
+      m_stats.queued++;
+    }
+
+    m_cond.notify_one();
+
+    return true;
+  }
+
+  supernode_delivery_queue::stats supernode_delivery_queue::get_stats() const
+  {
+    boost::lock_guard<boost::mutex> guard(m_lock);
+    stats result = m_stats;
+    result.depth = m_messages.size();
+    return result;
+  }
+
+  void supernode_delivery_queue::stop()
+  {
+    {
+      boost::lock_guard<boost::mutex> guard(m_lock);
+
+      if (m_stopped)
+        return;
+
+      m_stopped = true;
+      m_messages.clear();
+    }
+
+    m_cond.notify_all();
+
+    if (m_worker.joinable())
+      m_worker.join();
+  }
+
+  void supernode_delivery_queue::run()
+  {
+    std::vector<message> batch;
+
+    for (;;)
+    {
+      {
+        boost::unique_lock<boost::mutex> guard(m_lock);
+
+        while (!m_stopped && m_messages.empty())
+          m_cond.wait(guard);
+
+        if (m_stopped)
+          return;
+
+          //take consecutive JSON messages for the same uri
+
+        batch.clear();
+
+        while (!m_messages.empty() && batch.size() < m_max_batch_size)
+        {
+          const message& next = m_messages.front();
+
+          if (!batch.empty() && (next.type != json || batch.front().type != json || next.uri != batch.front().uri))
+            break;
+
+          batch.emplace_back(std::move(m_messages.front()));
+          m_messages.pop_front();
+        }
+      }
+
+      deliver(batch);
+    }
+  }
+
+  void supernode_delivery_queue::deliver(std::vector<message>& batch)
+  {
+    std::string body;
+
+    if (batch.size() == 1)
+    {
+      body = std::move(batch.front().body);
+    }
+    else
+    {
+        //JSON-RPC 2.0 batch request
+
+      size_t size = batch.size() + 1;
+
+      for (const message& msg : batch)
+        size += msg.body.size();
+
+      body.reserve(size);
+      body += '[';
+
+      for (size_t i=0; i<batch.size(); i++)
+      {
+        if (i)
+          body += ',';
+        body += batch[i].body;
+      }
+
+      body += ']';
+    }
+
+    epee::net_utils::http::fields_list additional_params;
+    additional_params.push_back(std::make_pair("Content-Type", batch.front().type == binary ? "application/octet-stream" : "application/json; charset=utf-8"));
+
+    const epee::net_utils::http::http_response_info* response = nullptr;
+    bool ok = m_client.invoke(batch.front().uri, "POST", body, m_timeout, &response, std::move(additional_params));
+
+    if (ok && (!response || response->m_response_code != 200))
+    {
+      MDEBUG("Post to supernode " << batch.front().uri << " failed with response code " << (response ? response->m_response_code : 0));
+      ok = false;
+    }
+
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+    boost::lock_guard<boost::mutex> guard(m_lock);
+
+    m_stats.posts++;
+
+    if (!ok)
+    {
+      m_stats.failed += batch.size();
+      return;
+    }
+
+    for (const message& msg : batch)
+    {
+      uint64_t latency = std::chrono::duration_cast<std::chrono::milliseconds>(now - msg.queue_time).count();
+
+      m_stats.delivered++;
+      m_stats.last_latency_ms = latency;
+      m_total_latency_ms += latency;
+
+      if (latency > m_stats.max_latency_ms)
+        m_stats.max_latency_ms = latency;
+    }
+
+    m_stats.avg_latency_ms = m_total_latency_ms / m_stats.delivered;
+  }
+}
@@ -0,0 +1,121 @@
+// Copyright (c) 2019, The Graft Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#pragma once
+
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "net/http_client.h"
+
+namespace nodetool
+{
+  /// Outbound queue of posts to a local supernode. Messages are delivered by a dedicated worker
+  /// over a persistent keep-alive connection, so a slow supernode never blocks the p2p threads.
+  class supernode_delivery_queue
+  {
+  public:
+    enum overflow_policy
+    {
+      drop_newest, //reject new messages while the queue is full
+      drop_oldest, //evict the oldest queued message to make room for the new one
+    };
+
+    enum content_type
+    {
+      json,   //JSON-RPC request; consecutive requests to the same uri may be merged to a batch
+      binary, //epee portable storage binary, always posted separately
+    };
+
+    struct stats
+    {
+      uint64_t depth;          //messages waiting for delivery
+      uint64_t queued;         //messages accepted to the queue
+      uint64_t delivered;      //messages successfully posted
+      uint64_t failed;         //messages which post has failed
+      uint64_t dropped;        //messages dropped because of queue overflow
+      uint64_t posts;          //HTTP posts issued (several messages may share one post)
+      uint64_t last_latency_ms; //queueing + delivery time of the last delivered message
+      uint64_t avg_latency_ms;
+      uint64_t max_latency_ms;
+    };
+
+    supernode_delivery_queue(const std::string& host, uint64_t port, size_t max_depth, overflow_policy policy,
+                             size_t max_batch_size, std::chrono::milliseconds timeout);
+    ~supernode_delivery_queue();
+
+    supernode_delivery_queue(const supernode_delivery_queue&) = delete;
+    supernode_delivery_queue& operator=(const supernode_delivery_queue&) = delete;
+
+    /// Change supernode address (connection is reopened on next delivery)
+    void set_server(const std::string& host, uint64_t port);
+
+    /// Queue a serialized request for delivery to uri (returns false if the message was dropped)
+    bool push(const std::string& uri, std::string body, content_type type = json);
+
+    /// Delivery counters
+    stats get_stats() const;
+
+    /// Stop the worker; queued messages are discarded
+    void stop();
+
+  private:
+    struct message
+    {
+      std::string uri;
+      std::string body;
+      content_type type;
+      std::chrono::steady_clock::time_point queue_time;
+    };
+
+    void run();
+    void deliver(std::vector<message>& batch);
+
+  private:
+    size_t m_max_depth;
+    overflow_policy m_policy;
+    size_t m_max_batch_size;
+    std::chrono::milliseconds m_timeout;
+    epee::net_utils::http::http_simple_client m_client;
+    mutable boost::mutex m_lock;
+    boost::condition_variable m_cond;
+    std::deque<message> m_messages;
+    stats m_stats;
+    uint64_t m_total_latency_ms;
+    bool m_stopped;
+    boost::thread m_worker;
+  };
+}
@@ -0,0 +1,248 @@
+// Copyright (c) 2019, The Graft Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "supernode_list_encoder.h"
+
+#include <unordered_set>
+
+#include "cryptonote_basic/cryptonote_basic_impl.h"
+
+namespace nodetool
+{
+  namespace
+  {
+    typedef cryptonote::COMMAND_RPC_SUPERNODE_STAKES::supernode_stake          rpc_stake;
+    typedef cryptonote::COMMAND_RPC_SUPERNODE_BLOCKCHAIN_BASED_LIST::supernode rpc_supernode;
+
+    bool operator==(const rpc_stake& s1, const rpc_stake& s2)
+    {
+      return s1.amount == s2.amount && s1.tier == s2.tier && s1.block_height == s2.block_height && s1.unlock_time == s2.unlock_time &&
+             s1.supernode_public_id == s2.supernode_public_id && s1.supernode_public_address == s2.supernode_public_address;
+    }
+
+    bool operator==(const rpc_supernode& s1, const rpc_supernode& s2)
+    {
+      return s1.amount == s2.amount && s1.supernode_public_id == s2.supernode_public_id &&
+             s1.supernode_public_address == s2.supernode_public_address;
+    }
+  }
+
+  supernode_list_encoder::supernode_list_encoder()
+    : m_nettype(cryptonote::MAINNET)
+    , m_stakes()
+    , m_stakes_sequence()
+    , m_blockchain_based_list()
+    , m_blockchain_based_list_sequence()
+  {
+  }
+
+  void supernode_list_encoder::set_nettype(cryptonote::network_type nettype)
+  {
+    if (m_nettype == nettype)
+      return;
+
+    m_nettype = nettype;
+    m_addresses.clear();
+  }
+
+  const std::string& supernode_list_encoder::get_address(const std::string& supernode_public_id, const cryptonote::account_public_address& address)
+  {
+    encoded_address& result = m_addresses[supernode_public_id];
+
+    if (result.second.empty() || !(result.first == address))
+    {
+      result.first  = address;
+      result.second = cryptonote::get_account_address_as_str(m_nettype, false, address);
+    }
+
+    return result.second;
+  }
+
+  void supernode_list_encoder::update_stakes(uint64_t block_height, const supernode_stake_array& stakes, stakes_update& delta)
+  {
+    std::unordered_map<std::string, size_t> prev_stakes;
+
+    prev_stakes.reserve(m_stakes.stakes.size());
+
+    for (size_t i=0; i<m_stakes.stakes.size(); i++)
+      prev_stakes.emplace(m_stakes.stakes[i].supernode_public_id, i);
+
+    stakes_request new_stakes;
+
+    new_stakes.block_height = block_height;
+    new_stakes.stakes.reserve(stakes.size());
+
+    delta = stakes_update();
+    delta.sequence = ++m_stakes_sequence;
+    delta.block_height = block_height;
+    delta.snapshot = false;
+
+    for (const cryptonote::supernode_stake& src_stake : stakes)
+    {
+      rpc_stake dst_stake;
+
+      dst_stake.amount = src_stake.amount;
+      dst_stake.tier = src_stake.tier;
+      dst_stake.block_height = src_stake.block_height;
+      dst_stake.unlock_time = src_stake.unlock_time;
+      dst_stake.supernode_public_id = src_stake.supernode_public_id;
+      dst_stake.supernode_public_address = get_address(src_stake.supernode_public_id, src_stake.supernode_public_address);
+
+      auto it = prev_stakes.find(dst_stake.supernode_public_id);
+
+      if (it == prev_stakes.end())
+      {
+        delta.stakes.push_back(dst_stake);
+      }
+      else
+      {
+        if (!(m_stakes.stakes[it->second] == dst_stake))
+          delta.stakes.push_back(dst_stake);
+
+        prev_stakes.erase(it);
+      }
+
+      new_stakes.stakes.emplace_back(std::move(dst_stake));
+    }
+
+      //remaining previous stakes are gone
+
+    delta.removed_supernodes.reserve(prev_stakes.size());
+
+    for (const auto& prev_stake : prev_stakes)
+      delta.removed_supernodes.push_back(prev_stake.first);
+
+    m_stakes = std::move(new_stakes);
+
+      //forget addresses of supernodes without stakes
+
+    if (m_addresses.size() > m_stakes.stakes.size())
+    {
+      std::unordered_set<std::string> ids;
+
+      ids.reserve(m_stakes.stakes.size());
+
+      for (const rpc_stake& stake : m_stakes.stakes)
+        ids.insert(stake.supernode_public_id);
+
+      for (auto it = m_addresses.begin(); it != m_addresses.end();)
+      {
+        if (ids.count(it->first)) ++it;
+        else                      it = m_addresses.erase(it);
+      }
+    }
+  }
+
+  void supernode_list_encoder::get_stakes_snapshot(stakes_update& snapshot) const
+  {
+    snapshot = stakes_update();
+    snapshot.sequence = m_stakes_sequence;
+    snapshot.block_height = m_stakes.block_height;
+    snapshot.snapshot = true;
+    snapshot.stakes = m_stakes.stakes;
+  }
+
+  void supernode_list_encoder::update_blockchain_based_list(uint64_t block_height, const supernode_tier_array& tiers, blockchain_based_list_update& delta)
+  {
+    typedef cryptonote::COMMAND_RPC_SUPERNODE_BLOCKCHAIN_BASED_LIST::tier rpc_tier;
+    typedef cryptonote::COMMAND_RPC_SUPERNODE_BLOCKCHAIN_BASED_LIST_UPDATE::tier rpc_tier_delta;
+
+    blockchain_based_list_request new_list;
+
+    new_list.block_height = block_height;
+    new_list.tiers.reserve(tiers.size());
+
+    delta = blockchain_based_list_update();
+    delta.sequence = ++m_blockchain_based_list_sequence;
+    delta.block_height = block_height;
+    delta.snapshot = false;
+    delta.tiers.reserve(tiers.size());
+
+    std::unordered_map<std::string, uint32_t> prev_positions;
+
+    for (size_t i=0; i<tiers.size(); i++)
+    {
+      static const std::vector<rpc_supernode> empty_tier;
+
+      const cryptonote::BlockchainBasedList::supernode_array& src_tier = tiers[i];
+      const std::vector<rpc_supernode>& prev_tier = i < m_blockchain_based_list.tiers.size() ? m_blockchain_based_list.tiers[i].supernodes : empty_tier;
+
+      prev_positions.clear();
+
+      for (size_t j=0; j<prev_tier.size(); j++)
+        prev_positions.emplace(prev_tier[j].supernode_public_id, uint32_t(j));
+
+      rpc_tier dst_tier;
+      rpc_tier_delta dst_tier_delta;
+
+      dst_tier.supernodes.reserve(src_tier.size());
+      dst_tier_delta.positions.reserve(src_tier.size());
+
+      for (const cryptonote::BlockchainBasedList::supernode& src_supernode : src_tier)
+      {
+        rpc_supernode dst_supernode;
+
+        dst_supernode.supernode_public_id      = src_supernode.supernode_public_id;
+        dst_supernode.supernode_public_address = get_address(src_supernode.supernode_public_id, src_supernode.supernode_public_address);
+        dst_supernode.amount                   = src_supernode.amount;
+
+        auto it = prev_positions.find(dst_supernode.supernode_public_id);
+
+        if (it != prev_positions.end() && prev_tier[it->second] == dst_supernode)
+        {
+          dst_tier_delta.positions.push_back(it->second);
+        }
+        else
+        {
+          dst_tier_delta.positions.push_back(uint32_t(prev_tier.size() + dst_tier_delta.supernodes.size()));
+          dst_tier_delta.supernodes.push_back(dst_supernode);
+        }
+
+        dst_tier.supernodes.emplace_back(std::move(dst_supernode));
+      }
+
+      new_list.tiers.emplace_back(std::move(dst_tier));
+      delta.tiers.emplace_back(std::move(dst_tier_delta));
+    }
+
+    m_blockchain_based_list = std::move(new_list);
+  }
+
+  void supernode_list_encoder::get_blockchain_based_list_snapshot(blockchain_based_list_update& snapshot) const
+  {
+    snapshot = blockchain_based_list_update();
+    snapshot.sequence = m_blockchain_based_list_sequence;
+    snapshot.block_height = m_blockchain_based_list.block_height;
+    snapshot.snapshot = true;
+    snapshot.tiers.resize(m_blockchain_based_list.tiers.size());
+
+    for (size_t i=0; i<m_blockchain_based_list.tiers.size(); i++)
+      snapshot.tiers[i].supernodes = m_blockchain_based_list.tiers[i].supernodes;
+  }
+}
@@ -0,0 +1,93 @@
+// Copyright (c) 2019, The Graft Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "cryptonote_core/blockchain_based_list.h"
+#include "cryptonote_core/stake_transaction_storage.h"
+#include "rpc/core_rpc_server_commands_defs.h"
+
+namespace nodetool
+{
+  /// Converts stakes and blockchain based lists to supernode RPC requests. The last converted lists are kept,
+  /// so every update also yields a delta against the previous update. Supernode addresses are base58 encoded
+  /// once per stake. Not thread safe.
+  class supernode_list_encoder
+  {
+  public:
+    typedef std::vector<cryptonote::supernode_stake>                                   supernode_stake_array;
+    typedef cryptonote::BlockchainBasedList::supernode_tier_array                    supernode_tier_array;
+    typedef cryptonote::COMMAND_RPC_SUPERNODE_STAKES::request                          stakes_request;
+    typedef cryptonote::COMMAND_RPC_SUPERNODE_STAKES_UPDATE::request                   stakes_update;
+    typedef cryptonote::COMMAND_RPC_SUPERNODE_BLOCKCHAIN_BASED_LIST::request           blockchain_based_list_request;
+    typedef cryptonote::COMMAND_RPC_SUPERNODE_BLOCKCHAIN_BASED_LIST_UPDATE::request    blockchain_based_list_update;
+
+    supernode_list_encoder();
+
+    /// Network type used for address encoding
+    void set_nettype(cryptonote::network_type nettype);
+
+    /// Apply stakes of the block and build delta against previously applied stakes
+    void update_stakes(uint64_t block_height, const supernode_stake_array& stakes, stakes_update& delta);
+
+    /// Last applied stakes
+    const stakes_request& get_stakes() const { return m_stakes; }
+
+    /// Snapshot of last applied stakes
+    void get_stakes_snapshot(stakes_update& snapshot) const;
+
+    /// Apply blockchain based list of the block and build delta against previously applied list
+    void update_blockchain_based_list(uint64_t block_height, const supernode_tier_array& tiers, blockchain_based_list_update& delta);
+
+    /// Last applied blockchain based list
+    const blockchain_based_list_request& get_blockchain_based_list() const { return m_blockchain_based_list; }
+
+    /// Snapshot of last applied blockchain based list
+    void get_blockchain_based_list_snapshot(blockchain_based_list_update& snapshot) const;
+
+  private:
+    const std::string& get_address(const std::string& supernode_public_id, const cryptonote::account_public_address& address);
+
+  private:
+    typedef std::pair<cryptonote::account_public_address, std::string> encoded_address;
+
+    cryptonote::network_type m_nettype;
+    std::unordered_map<std::string, encoded_address> m_addresses; //base58 addresses by supernode public id
+    stakes_request m_stakes;
+    uint64_t m_stakes_sequence;
+    blockchain_based_list_request m_blockchain_based_list;
+    uint64_t m_blockchain_based_list_sequence;
+  };
+}
@@ -0,0 +1,140 @@
+// Copyright (c) 2019, The Graft Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "supernode_routes.h"
+
+#include <boost/thread/lock_guard.hpp>
+
+#include <algorithm>
+
+namespace nodetool
+{
+  supernode_routes::supernode_routes()
+    : m_changed(false)
+    , m_version(0)
+    , m_table(std::make_shared<supernode_route_table>())
+  {
+  }
+
+  bool supernode_routes::update(const std::string &id, uint64_t height, uint64_t hop, const peerlist_entry &pe, uint64_t now)
+  {
+    boost::lock_guard<boost::mutex> lock(m_lock);
+    auto it = m_routes.find(id);
+    if (it != m_routes.end())
+    {
+      supernode_route &route = it->second;
+      if (route.last_announce_height == height && route.last_announce_time + DIFFICULTY_TARGET_V2 > now)
+      {
+        auto peer_it = std::find_if(route.peers.begin(), route.peers.end(),
+                                    [&pe](const peerlist_entry &p) { return pe.id == p.id; });
+        if (peer_it == route.peers.end())
+        {
+          route.peers.push_back(pe);
+          route.max_hop = std::max(route.max_hop, hop);
+          m_changed = true;
+        }
+        return false;
+      }
+    }
+
+    supernode_route &route = m_routes[id];
+    route.last_announce_height = height;
+    route.last_announce_time = now;
+    route.max_hop = hop;
+    route.peers.assign(1, pe);
+    m_changed = true;
+    return true;
+  }
+
+  void supernode_routes::on_connection(uint64_t peer_id, const boost::uuids::uuid &connection_id)
+  {
+    boost::lock_guard<boost::mutex> lock(m_lock);
+    m_connections.emplace(peer_id, connection_id);
+    m_changed = true;
+  }
+
+  void supernode_routes::on_connection_close(uint64_t peer_id, const boost::uuids::uuid &connection_id)
+  {
+    boost::lock_guard<boost::mutex> lock(m_lock);
+    auto range = m_connections.equal_range(peer_id);
+    for (auto it = range.first; it != range.second; ++it)
+    {
+      if (it->second == connection_id)
+      {
+        m_connections.erase(it);
+        m_changed = true;
+        break;
+      }
+    }
+  }
+
+  void supernode_routes::publish()
+  {
+    boost::lock_guard<boost::mutex> lock(m_lock);
+    if (!m_changed)
+      return;
+
+    std::shared_ptr<supernode_route_table> table = std::make_shared<supernode_route_table>();
+    std::unordered_map<uint64_t, size_t> tunnel_indices;
+    table->routes.reserve(m_routes.size());
+    for (const auto &item : m_routes)
+    {
+      supernode_route_table::route &route = table->routes[item.first];
+      route.last_announce_height = item.second.last_announce_height;
+      route.last_announce_time = item.second.last_announce_time;
+      route.max_hop = item.second.max_hop;
+      route.tunnels.reserve(item.second.peers.size());
+      for (const peerlist_entry &pe : item.second.peers)
+      {
+        auto index_it = tunnel_indices.find(pe.id);
+        if (index_it == tunnel_indices.end())
+        {
+          supernode_route_table::tunnel tunnel;
+          tunnel.peer = pe;
+          auto conn_it = m_connections.find(pe.id);
+          tunnel.connected = conn_it != m_connections.end();
+          tunnel.connection_id = tunnel.connected ? conn_it->second : boost::uuids::uuid();
+          index_it = tunnel_indices.emplace(pe.id, table->tunnels.size()).first;
+          table->tunnels.push_back(tunnel);
+        }
+        route.tunnels.push_back(index_it->second);
+      }
+      table->max_hop = std::max(table->max_hop, route.max_hop);
+    }
+    table->version = ++m_version;
+    m_changed = false;
+    std::atomic_store(&m_table, supernode_route_table_ptr(table));
+  }
+
+  size_t supernode_routes::size() const
+  {
+    boost::lock_guard<boost::mutex> lock(m_lock);
+    return m_routes.size();
+  }
+}
@@ -0,0 +1,102 @@
+// Copyright (c) 2019, The Graft Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#pragma once
+
+#include <boost/thread/mutex.hpp>
+#include <boost/uuid/uuid.hpp>
+
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "p2p_protocol_defs.h"
+
+namespace nodetool
+{
+  /// Immutable snapshot of supernode routes used for multicast/unicast fan-out.
+  /// Tunnel peers are stored once with their connection id resolved at build time; routes refer to them by index.
+  struct supernode_route_table {
+    struct tunnel {
+      peerlist_entry peer;
+      boost::uuids::uuid connection_id;
+      bool connected;
+    };
+
+    struct route {
+      uint64_t last_announce_height;
+      uint64_t last_announce_time;
+      uint64_t max_hop;
+      std::vector<size_t> tunnels; //indices in supernode_route_table::tunnels
+    };
+
+    uint64_t version = 0;
+    uint64_t max_hop = 0; //max hop over all routes
+    std::vector<tunnel> tunnels;
+    std::unordered_map<std::string, route> routes;
+  };
+
+  typedef std::shared_ptr<const supernode_route_table> supernode_route_table_ptr;
+
+  /// Supernode routes learned from announces, and the connections of their tunnel peers.
+  /// Writers update them and publish a new supernode_route_table; readers only load the published one.
+  class supernode_routes
+  {
+  public:
+    supernode_routes();
+
+    /// Announce of supernode id at height came through peer pe. Returns true if it (re)started the route and
+    /// should be relayed, false if it is a repeat of the current announce, which only adds pe as another tunnel.
+    bool update(const std::string &id, uint64_t height, uint64_t hop, const peerlist_entry &pe, uint64_t now);
+
+    /// Peer completed a handshake on the connection
+    void on_connection(uint64_t peer_id, const boost::uuids::uuid &connection_id);
+
+    /// Connection of the peer was closed
+    void on_connection_close(uint64_t peer_id, const boost::uuids::uuid &connection_id);
+
+    /// Build and publish a new table if routes or connections changed since the last one
+    void publish();
+
+    /// Last published table
+    supernode_route_table_ptr get() const { return std::atomic_load(&m_table); }
+
+    size_t size() const;
+
+  private:
+    mutable boost::mutex m_lock;
+    std::map<std::string, supernode_route> m_routes;
+    std::unordered_multimap<uint64_t, boost::uuids::uuid> m_connections; //peer id -> connection id
+    bool m_changed;
+    uint64_t m_version;
+    supernode_route_table_ptr m_table; //accessed only via std::atomic_load / std::atomic_store
+  };
+}
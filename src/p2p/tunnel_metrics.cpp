@@ -0,0 +1,130 @@
+// Copyright (c) 2019, The Graft Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "tunnel_metrics.h"
+
+#include <boost/thread/lock_guard.hpp>
+
+#include <cmath>
+
+namespace nodetool
+{
+  namespace
+  {
+    //weight of the prior latency, i.e. one sample is as strong as the prior
+    const double PRIOR_WEIGHT = 1.0;
+  }
+
+  tunnel_metrics::tunnel_metrics(std::chrono::milliseconds half_life, double prior_latency_ms, double failure_penalty)
+    : m_half_life_ms(half_life.count() > 0 ? half_life.count() : 1)
+    , m_prior_latency_ms(prior_latency_ms)
+    , m_failure_penalty(failure_penalty)
+  {
+  }
+
+  uint64_t tunnel_metrics::now_ms()
+  {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+  }
+
+  void tunnel_metrics::decay(samples& s, uint64_t now_ms) const
+  {
+    if (now_ms <= s.updated_ms)
+      return;
+
+    const double factor = std::exp2(-double(now_ms - s.updated_ms) / m_half_life_ms);
+
+    s.latency_sum    *= factor;
+    s.latency_weight *= factor;
+    s.delivered      *= factor;
+    s.failed         *= factor;
+    s.updated_ms      = now_ms;
+  }
+
+  i_tunnel_metrics::peer_stats tunnel_metrics::make_stats(const samples& s) const
+  {
+    peer_stats stats;
+
+    stats.latency_ms = (s.latency_sum + PRIOR_WEIGHT * m_prior_latency_ms) / (s.latency_weight + PRIOR_WEIGHT);
+    stats.delivered  = s.delivered;
+    stats.failed     = s.failed;
+    stats.score      = stats.latency_ms * (1 + m_failure_penalty * s.failed / (s.delivered + s.failed + 1));
+
+    return stats;
+  }
+
+  void tunnel_metrics::on_latency(uint64_t peer_id, uint64_t latency_ms, uint64_t now_ms)
+  {
+    boost::lock_guard<boost::mutex> guard(m_lock);
+
+    samples& s = m_peers.emplace(peer_id, samples{0, 0, 0, 0, now_ms}).first->second;
+
+    decay(s, now_ms);
+
+    s.latency_sum    += latency_ms;
+    s.latency_weight += 1;
+  }
+
+  void tunnel_metrics::on_delivery(uint64_t peer_id, bool delivered, uint64_t now_ms)
+  {
+    boost::lock_guard<boost::mutex> guard(m_lock);
+
+    samples& s = m_peers.emplace(peer_id, samples{0, 0, 0, 0, now_ms}).first->second;
+
+    decay(s, now_ms);
+
+    if (delivered) s.delivered += 1;
+    else           s.failed    += 1;
+  }
+
+  double tunnel_metrics::get_score(uint64_t peer_id, uint64_t now_ms) const
+  {
+    return get_stats(peer_id, now_ms).score;
+  }
+
+  i_tunnel_metrics::peer_stats tunnel_metrics::get_stats(uint64_t peer_id, uint64_t now_ms) const
+  {
+    boost::lock_guard<boost::mutex> guard(m_lock);
+
+    auto it = m_peers.find(peer_id);
+
+    if (it == m_peers.end())
+      return make_stats(samples{0, 0, 0, 0, now_ms});
+
+    decay(it->second, now_ms);
+
+    return make_stats(it->second);
+  }
+
+  void tunnel_metrics::remove(uint64_t peer_id)
+  {
+    boost::lock_guard<boost::mutex> guard(m_lock);
+    m_peers.erase(peer_id);
+  }
+}
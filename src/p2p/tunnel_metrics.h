@@ -0,0 +1,104 @@
+// Copyright (c) 2019, The Graft Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#pragma once
+
+#include <boost/thread/mutex.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <unordered_map>
+
+namespace nodetool
+{
+  /// Source of tunnel quality used to pick tunnel peers for multicast and unicast fan-out
+  struct i_tunnel_metrics
+  {
+    struct peer_stats
+    {
+      double latency_ms; //decayed average round trip, unknown latency is reported as the prior
+      double delivered;  //decayed number of successful deliveries
+      double failed;     //decayed number of failed deliveries
+      double score;      //lower is better
+    };
+
+    virtual ~i_tunnel_metrics() {}
+
+    /// Round trip to the peer was measured
+    virtual void on_latency(uint64_t peer_id, uint64_t latency_ms, uint64_t now_ms) = 0;
+
+    /// Message was delivered through the peer or the peer failed to take it
+    virtual void on_delivery(uint64_t peer_id, bool delivered, uint64_t now_ms) = 0;
+
+    /// Tunnel score of the peer, lower is better; peers without samples get a neutral score
+    virtual double get_score(uint64_t peer_id, uint64_t now_ms) const = 0;
+
+    virtual peer_stats get_stats(uint64_t peer_id, uint64_t now_ms) const = 0;
+
+    /// Forget the peer
+    virtual void remove(uint64_t peer_id) = 0;
+  };
+
+  /// Default tunnel metrics: samples decay exponentially with half life, so stale peers drift back to the prior
+  /// latency. Score is the expected latency penalized by the failure ratio.
+  class tunnel_metrics: public i_tunnel_metrics
+  {
+  public:
+    tunnel_metrics(std::chrono::milliseconds half_life = std::chrono::minutes(5), double prior_latency_ms = 500, double failure_penalty = 4);
+
+    void on_latency(uint64_t peer_id, uint64_t latency_ms, uint64_t now_ms) override;
+    void on_delivery(uint64_t peer_id, bool delivered, uint64_t now_ms) override;
+    double get_score(uint64_t peer_id, uint64_t now_ms) const override;
+    peer_stats get_stats(uint64_t peer_id, uint64_t now_ms) const override;
+    void remove(uint64_t peer_id) override;
+
+    static uint64_t now_ms();
+
+  private:
+    struct samples
+    {
+      double latency_sum;
+      double latency_weight;
+      double delivered;
+      double failed;
+      uint64_t updated_ms;
+    };
+
+    /// Decay samples to now_ms
+    void decay(samples& s, uint64_t now_ms) const;
+    peer_stats make_stats(const samples& s) const;
+
+  private:
+    double m_half_life_ms;
+    double m_prior_latency_ms;
+    double m_failure_penalty;
+    mutable boost::mutex m_lock;
+    mutable std::unordered_map<uint64_t, samples> m_peers;
+  };
+}
@@ -215,6 +215,8 @@ namespace cryptonote
     }
     res.database_size = m_core.get_blockchain_storage().get_db().get_database_size();
     res.update_available = m_core.is_update_available();
+    if (!m_core.get_blockchain_storage().get_db().get_output_cache_stats(res.output_cache_hits, res.output_cache_misses, res.output_cache_size))
+      res.output_cache_hits = res.output_cache_misses = res.output_cache_size = 0;
     return true;
   }
   //------------------------------------------------------------------------------------------------------------------------------
@@ -250,6 +252,12 @@ namespace cryptonote
       res.status = "Failed";
       return false;
     }
+    if (bs.empty() && res.start_height < res.current_height)
+    {
+      // only full blobs can be missing, see Blockchain::find_blockchain_supplement
+      res.status = "Failed: blockchain is pruned, full transactions of block " + std::to_string(res.start_height) + " are not available, use prune=true";
+      return true;
+    }
 
     size_t pruned_size = 0, unpruned_size = 0, ntxes = 0;
     res.blocks.reserve(bs.size());
@@ -622,6 +630,57 @@ namespace cryptonote
     return true;
   }
   //------------------------------------------------------------------------------------------------------------------------------
+  bool core_rpc_server::on_get_transactions_bin(const COMMAND_RPC_GET_TRANSACTIONS_BIN::request& req, COMMAND_RPC_GET_TRANSACTIONS_BIN::response& res)
+  {
+    PERF_TIMER(on_get_transactions_bin);
+    bool ok;
+    if (use_bootstrap_daemon_if_necessary<COMMAND_RPC_GET_TRANSACTIONS_BIN>(invoke_http_mode::BIN, "/get_transactions.bin", req, res, ok))
+      return ok;
+
+    std::vector<blobdata> blobs;
+    std::vector<crypto::hash> missed_txs;
+    if (!m_core.get_blockchain_storage().get_transactions_blobs(req.txs_hashes, blobs, missed_txs, req.prune))
+    {
+      res.status = "Failed";
+      return true;
+    }
+
+    // found blobs come in the order of the request
+    const std::unordered_set<crypto::hash> missed(missed_txs.begin(), missed_txs.end());
+    std::vector<blobdata>::iterator blob = blobs.begin();
+    for (const crypto::hash &h: req.txs_hashes)
+    {
+      COMMAND_RPC_GET_TRANSACTIONS_BIN::entry e;
+      e.tx_hash = h;
+      if (missed.find(h) == missed.end())
+      {
+        if (blob == blobs.end())
+        {
+          res.status = "Failed: internal error - txs is empty";
+          return true;
+        }
+        e.tx_blob = std::move(*blob++);
+        e.in_pool = false;
+        e.block_height = m_core.get_blockchain_storage().get_db().get_tx_block_height(h);
+      }
+      else if (m_core.get_pool_transaction(h, e.tx_blob))
+      {
+        e.in_pool = true;
+        e.block_height = std::numeric_limits<uint64_t>::max();
+      }
+      else
+      {
+        res.missed_tx.push_back(h);
+        continue;
+      }
+      res.txs.push_back(std::move(e));
+    }
+
+    LOG_PRINT_L2(res.txs.size() << " transactions found, " << res.missed_tx.size() << " not found");
+    res.status = CORE_RPC_STATUS_OK;
+    return true;
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
   bool core_rpc_server::on_is_key_image_spent(const COMMAND_RPC_IS_KEY_IMAGE_SPENT::request& req, COMMAND_RPC_IS_KEY_IMAGE_SPENT::response& res, bool request_has_rpc_origin)
   {
     PERF_TIMER(on_is_key_image_spent);
@@ -1616,6 +1675,8 @@ namespace cryptonote
     }
     res.database_size = m_core.get_blockchain_storage().get_db().get_database_size();
     res.update_available = m_core.is_update_available();
+    if (!m_core.get_blockchain_storage().get_db().get_output_cache_stats(res.output_cache_hits, res.output_cache_misses, res.output_cache_size))
+      res.output_cache_hits = res.output_cache_misses = res.output_cache_size = 0;
     return true;
   }
   //------------------------------------------------------------------------------------------------------------------------------
@@ -2219,7 +2280,7 @@ namespace cryptonote
       LOG_PRINT_L0("RPC Request: on_supernode_stakes: start");
       // send p2p stakes
       m_p2p.add_supernode(req.supernode_public_id, req.network_address);
-      m_p2p.send_stakes_to_supernode();
+      m_p2p.send_stakes_to_supernode(req.supernode_public_id, req.binary_updates);
       res.status = 0;
       LOG_PRINT_L0("RPC Request: on_supernode_stakes: end");
       return true;
@@ -2231,7 +2292,7 @@ namespace cryptonote
       LOG_PRINT_L0("RPC Request: on_supernode_blockchain_based_list: start");
       // send p2p stake txs
       m_p2p.add_supernode(req.supernode_public_id, req.network_address);
-      m_p2p.send_blockchain_based_list_to_supernode(req.last_received_block_height);
+      m_p2p.send_blockchain_based_list_to_supernode(req.supernode_public_id, req.binary_updates, req.last_received_block_height);
       res.status = 0;
       LOG_PRINT_L0("RPC Request: on_supernode_blockchain_based_list: end");
       return true;
@@ -2316,6 +2377,46 @@ namespace cryptonote
       return true;
   }
 
+  //------------------------------------------------------------------------------------------------------------------------------
+  bool core_rpc_server::on_supernode_announce_bin(const COMMAND_RPC_SUPERNODE_ANNOUNCE::request &req, COMMAND_RPC_SUPERNODE_ANNOUNCE::response &res)
+  {
+      json_rpc::error error_resp;
+      if (!on_supernode_announce(req, res, error_resp))
+          res.status = error_resp.code;
+      m_p2p.set_supernode_binary_rta(req.supernode_public_id);
+      return true;
+  }
+
+  //------------------------------------------------------------------------------------------------------------------------------
+  bool core_rpc_server::on_broadcast_bin(const COMMAND_RPC_BROADCAST::request &req, COMMAND_RPC_BROADCAST::response &res)
+  {
+      m_p2p.set_supernode_binary_rta(req.sender_address);
+      json_rpc::error error_resp;
+      if (!on_broadcast(req, res, error_resp))
+          res.status = error_resp.code;
+      return true;
+  }
+
+  //------------------------------------------------------------------------------------------------------------------------------
+  bool core_rpc_server::on_multicast_bin(const COMMAND_RPC_MULTICAST::request &req, COMMAND_RPC_MULTICAST::response &res)
+  {
+      m_p2p.set_supernode_binary_rta(req.sender_address);
+      json_rpc::error error_resp;
+      if (!on_multicast(req, res, error_resp))
+          res.status = error_resp.code;
+      return true;
+  }
+
+  //------------------------------------------------------------------------------------------------------------------------------
+  bool core_rpc_server::on_unicast_bin(const COMMAND_RPC_UNICAST::request &req, COMMAND_RPC_UNICAST::response &res)
+  {
+      m_p2p.set_supernode_binary_rta(req.sender_address);
+      json_rpc::error error_resp;
+      if (!on_unicast(req, res, error_resp))
+          res.status = error_resp.code;
+      return true;
+  }
+
   //------------------------------------------------------------------------------------------------------------------------------
   bool core_rpc_server::on_get_tunnels(const COMMAND_RPC_TUNNEL_DATA::request &req, COMMAND_RPC_TUNNEL_DATA::response &res, json_rpc::error &error_resp)
   {
@@ -2339,6 +2440,21 @@ namespace cryptonote
       res.broadcast_bytes_out = m_p2p.get_broadcast_bytes_out();
       res.multicast_bytes_in = m_p2p.get_multicast_bytes_in();
       res.multicast_bytes_out = m_p2p.get_multicast_bytes_out();
+      for (const auto &queue : m_p2p.get_supernode_queue_stats())
+      {
+          COMMAND_RPC_RTA_STATS::supernode_queue dst;
+          dst.address = queue.first;
+          dst.depth = queue.second.depth;
+          dst.queued = queue.second.queued;
+          dst.delivered = queue.second.delivered;
+          dst.failed = queue.second.failed;
+          dst.dropped = queue.second.dropped;
+          dst.posts = queue.second.posts;
+          dst.last_latency_ms = queue.second.last_latency_ms;
+          dst.avg_latency_ms = queue.second.avg_latency_ms;
+          dst.max_latency_ms = queue.second.max_latency_ms;
+          res.supernode_queues.push_back(std::move(dst));
+      }
       return true;
   }
 
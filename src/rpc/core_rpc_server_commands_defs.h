@@ -54,7 +54,7 @@ namespace cryptonote
 // advance which version they will stop working with
 // Don't go over 32767 for any of these
 #define CORE_RPC_VERSION_MAJOR 2
-#define CORE_RPC_VERSION_MINOR 1
+#define CORE_RPC_VERSION_MINOR 5
 #define MAKE_CORE_RPC_VERSION(major,minor) (((major)<<16)|(minor))
 #define CORE_RPC_VERSION MAKE_CORE_RPC_VERSION(CORE_RPC_VERSION_MAJOR, CORE_RPC_VERSION_MINOR)
 
@@ -627,6 +627,52 @@ namespace cryptonote
     };
   };
 
+  //-----------------------------------------------
+  // binary version of get_transactions: raw hashes and tx blobs, no hex or json
+  struct COMMAND_RPC_GET_TRANSACTIONS_BIN
+  {
+    struct request
+    {
+      std::vector<crypto::hash> txs_hashes;
+      bool prune;
+
+      BEGIN_KV_SERIALIZE_MAP()
+        KV_SERIALIZE_CONTAINER_POD_AS_BLOB(txs_hashes)
+        KV_SERIALIZE_OPT(prune, false)
+      END_KV_SERIALIZE_MAP()
+    };
+
+    struct entry
+    {
+      crypto::hash tx_hash;
+      blobdata tx_blob;
+      bool in_pool;
+      uint64_t block_height;
+
+      BEGIN_KV_SERIALIZE_MAP()
+        KV_SERIALIZE_VAL_POD_AS_BLOB(tx_hash)
+        KV_SERIALIZE(tx_blob)
+        KV_SERIALIZE(in_pool)
+        KV_SERIALIZE(block_height)
+      END_KV_SERIALIZE_MAP()
+    };
+
+    struct response
+    {
+      std::vector<entry> txs;
+      std::vector<crypto::hash> missed_tx;
+      std::string status;
+      bool untrusted;
+
+      BEGIN_KV_SERIALIZE_MAP()
+        KV_SERIALIZE(txs)
+        KV_SERIALIZE_CONTAINER_POD_AS_BLOB(missed_tx)
+        KV_SERIALIZE(status)
+        KV_SERIALIZE(untrusted)
+      END_KV_SERIALIZE_MAP()
+    };
+  };
+
   //-----------------------------------------------
   struct COMMAND_RPC_IS_KEY_IMAGE_SPENT
   {
@@ -900,6 +946,9 @@ namespace cryptonote
       bool was_bootstrap_ever_used;
       uint64_t database_size;
       bool update_available;
+      uint64_t output_cache_hits;
+      uint64_t output_cache_misses;
+      uint64_t output_cache_size;
 
       BEGIN_KV_SERIALIZE_MAP()
         KV_SERIALIZE(status)
@@ -934,6 +983,9 @@ namespace cryptonote
         KV_SERIALIZE(was_bootstrap_ever_used)
         KV_SERIALIZE(database_size)
         KV_SERIALIZE(update_available)
+        KV_SERIALIZE_OPT(output_cache_hits, (uint64_t)0)
+        KV_SERIALIZE_OPT(output_cache_misses, (uint64_t)0)
+        KV_SERIALIZE_OPT(output_cache_size, (uint64_t)0)
       END_KV_SERIALIZE_MAP()
     };
   };
@@ -2236,9 +2288,11 @@ namespace cryptonote
     {
       std::string supernode_public_id;
       std::string network_address;
+      bool        binary_updates; //supernode accepts binary snapshot + delta updates (COMMAND_RPC_SUPERNODE_STAKES_UPDATE)
       BEGIN_KV_SERIALIZE_MAP()
         KV_SERIALIZE(supernode_public_id)
         KV_SERIALIZE(network_address)
+        KV_SERIALIZE_OPT(binary_updates, false)
       END_KV_SERIALIZE_MAP()
     };
 
@@ -2290,6 +2344,35 @@ namespace cryptonote
     };
   };
 
+  /// Binary stakes update: a full snapshot followed by per-block deltas against the previous update.
+  /// Supernode requests resync (COMMAND_RPC_SUPERNODE_GET_STAKES) when it detects a gap in sequence numbers.
+  struct COMMAND_RPC_SUPERNODE_STAKES_UPDATE
+  {
+    struct request
+    {
+      uint64_t sequence;
+      uint64_t block_height;
+      bool snapshot; //stakes contains all stakes, otherwise only new and changed ones
+      std::vector<COMMAND_RPC_SUPERNODE_STAKES::supernode_stake> stakes;
+      std::vector<std::string> removed_supernodes; //public ids of supernodes which stakes are gone
+      BEGIN_KV_SERIALIZE_MAP()
+        KV_SERIALIZE(sequence)
+        KV_SERIALIZE(block_height)
+        KV_SERIALIZE(snapshot)
+        KV_SERIALIZE(stakes)
+        KV_SERIALIZE(removed_supernodes)
+      END_KV_SERIALIZE_MAP()
+    };
+
+    struct response
+    {
+      int64_t status;
+      BEGIN_KV_SERIALIZE_MAP()
+        KV_SERIALIZE(status)
+      END_KV_SERIALIZE_MAP()
+    };
+  };
+
   struct COMMAND_RPC_SUPERNODE_GET_BLOCKCHAIN_BASED_LIST
   {
     struct request
@@ -2297,10 +2380,12 @@ namespace cryptonote
       std::string supernode_public_id;
       std::string network_address;
       uint64_t    last_received_block_height;
+      bool        binary_updates; //supernode accepts binary snapshot + delta updates (COMMAND_RPC_SUPERNODE_BLOCKCHAIN_BASED_LIST_UPDATE)
       BEGIN_KV_SERIALIZE_MAP()
         KV_SERIALIZE(supernode_public_id)
         KV_SERIALIZE(network_address)
         KV_SERIALIZE(last_received_block_height)
+        KV_SERIALIZE_OPT(binary_updates, false)
       END_KV_SERIALIZE_MAP()
     };
 
@@ -2354,6 +2439,45 @@ namespace cryptonote
     };
   };
 
+  /// Binary blockchain based list update: a full snapshot followed by per-block deltas against the previous update.
+  /// Supernode requests resync (COMMAND_RPC_SUPERNODE_GET_BLOCKCHAIN_BASED_LIST) when it detects a gap in sequence numbers.
+  struct COMMAND_RPC_SUPERNODE_BLOCKCHAIN_BASED_LIST_UPDATE
+  {
+    struct tier
+    {
+      //for each supernode of the tier: its position in the previous list of the tier, or previous list size + index in supernodes;
+      //empty for snapshots (all supernodes are in supernodes)
+      std::vector<uint32_t> positions;
+      std::vector<COMMAND_RPC_SUPERNODE_BLOCKCHAIN_BASED_LIST::supernode> supernodes;
+      BEGIN_KV_SERIALIZE_MAP()
+        KV_SERIALIZE_CONTAINER_POD_AS_BLOB(positions)
+        KV_SERIALIZE(supernodes)
+      END_KV_SERIALIZE_MAP()
+    };
+
+    struct request
+    {
+      uint64_t sequence;
+      uint64_t block_height;
+      bool snapshot;
+      std::vector<tier> tiers;
+      BEGIN_KV_SERIALIZE_MAP()
+        KV_SERIALIZE(sequence)
+        KV_SERIALIZE(block_height)
+        KV_SERIALIZE(snapshot)
+        KV_SERIALIZE(tiers)
+      END_KV_SERIALIZE_MAP()
+    };
+
+    struct response
+    {
+      int64_t status;
+      BEGIN_KV_SERIALIZE_MAP()
+        KV_SERIALIZE(status)
+      END_KV_SERIALIZE_MAP()
+    };
+  };
+
   struct COMMAND_RPC_SUPERNODE_ANNOUNCE
   {
     struct request
@@ -2381,6 +2505,18 @@ namespace cryptonote
     };
   };
 
+  struct COMMAND_RPC_SUPERNODE_ANNOUNCES
+  {
+    struct request
+    {
+      std::vector<COMMAND_RPC_SUPERNODE_ANNOUNCE::request> announces;
+
+      BEGIN_KV_SERIALIZE_MAP()
+        KV_SERIALIZE(announces)
+      END_KV_SERIALIZE_MAP()
+    };
+  };
+
   struct COMMAND_RPC_BROADCAST
   {
     struct request
@@ -2466,11 +2602,21 @@ namespace cryptonote
       uint16_t port;
       uint64_t id;
       int64_t last_seen;
+      bool connected;
+      double latency_ms; //decayed average round trip
+      double delivered;  //decayed number of messages delivered through the peer
+      double failed;     //decayed number of failed deliveries
+      double score;      //tunnel score, lower is better
       BEGIN_KV_SERIALIZE_MAP()
         KV_SERIALIZE(host)
         KV_SERIALIZE(port)
         KV_SERIALIZE(id)
         KV_SERIALIZE(last_seen)
+        KV_SERIALIZE(connected)
+        KV_SERIALIZE(latency_ms)
+        KV_SERIALIZE(delivered)
+        KV_SERIALIZE(failed)
+        KV_SERIALIZE(score)
       END_KV_SERIALIZE_MAP()
   };
 
@@ -2520,6 +2666,32 @@ namespace cryptonote
       END_KV_SERIALIZE_MAP()
     };
 
+    struct supernode_queue
+    {
+      std::string address;
+      uint64_t depth;
+      uint64_t queued;
+      uint64_t delivered;
+      uint64_t failed;
+      uint64_t dropped;
+      uint64_t posts;
+      uint64_t last_latency_ms;
+      uint64_t avg_latency_ms;
+      uint64_t max_latency_ms;
+      BEGIN_KV_SERIALIZE_MAP()
+        KV_SERIALIZE(address)
+        KV_SERIALIZE(depth)
+        KV_SERIALIZE(queued)
+        KV_SERIALIZE(delivered)
+        KV_SERIALIZE(failed)
+        KV_SERIALIZE(dropped)
+        KV_SERIALIZE(posts)
+        KV_SERIALIZE(last_latency_ms)
+        KV_SERIALIZE(avg_latency_ms)
+        KV_SERIALIZE(max_latency_ms)
+      END_KV_SERIALIZE_MAP()
+    };
+
     struct response
     {
       uint64_t announce_bytes_in;
@@ -2528,6 +2700,7 @@ namespace cryptonote
       uint64_t broadcast_bytes_out;
       uint64_t multicast_bytes_in;
       uint64_t multicast_bytes_out;
+      std::vector<supernode_queue> supernode_queues;
       BEGIN_KV_SERIALIZE_MAP()
         KV_SERIALIZE(announce_bytes_in)
         KV_SERIALIZE(announce_bytes_out)
@@ -2535,6 +2708,7 @@ namespace cryptonote
         KV_SERIALIZE(broadcast_bytes_out)
         KV_SERIALIZE(multicast_bytes_in)
         KV_SERIALIZE(multicast_bytes_out)
+        KV_SERIALIZE(supernode_queues)
       END_KV_SERIALIZE_MAP()
     };
   };
@@ -56,6 +56,10 @@ bool supernode::BaseRTAObject::CheckSign(const string& wallet, const string& sig
 	return m_Servant->IsSignValid( TransactionRecord.MessageForSign(), wallet, sign );
 }
 
+void supernode::BaseRTAObject::Post(boost::function<void ()> task) {
+	m_Strand.Post( std::move(task) );
+}
+
 void supernode::BaseRTAObject::MarkForDelete() {
 	boost::lock_guard<boost::recursive_mutex> lock(m_HanlderIdxGuard);
 	m_ReadyForDelete = true;
@@ -34,7 +34,8 @@
 #include "SubNetBroadcast.h"
 #include "DAPI_RPC_Server.h"
 #include "FSN_ServantBase.h"
-#include "DAPI_RPC_Client.h"
+#include "DAPI_RPC_ClientPool.h"
+#include "WorkerPool.h"
 #include <string>
 using namespace std;
 
@@ -50,6 +51,8 @@ namespace supernode {
 		virtual void Set(const FSN_ServantBase* ser, DAPI_RPC_Server* dapi);
 		virtual ~BaseRTAObject();
 		void MarkForDelete();
+		// runs task on the shared pool, tasks of one payment never run concurrently
+		void Post(boost::function<void ()> task);
 
 		boost::posix_time::ptime TimeMark;
 
@@ -60,10 +63,8 @@ namespace supernode {
 
 		template<class IN_t, class OUT_t>
 		bool SendDAPICall(const string& ip, const string& port, const string& method, IN_t& req, OUT_t& resp) {
-			DAPI_RPC_Client call;
-			call.Set(ip, port);
 			req.PaymentID = TransactionRecord.PaymentID;
-			return call.Invoke(method, req, resp);
+			return DAPI_RPC_ClientPool::Instance().Invoke(ip, port, method, req, resp);
 		}
 
 		bool CheckSign(const string& wallet, const string& sign);
@@ -83,6 +84,7 @@ namespace supernode {
 
 		protected:
 		SubNetBroadcast m_SubNetBroadcast;
+		WorkerPool::Strand m_Strand;
 		const FSN_ServantBase* m_Servant = nullptr;
 		DAPI_RPC_Server* m_DAPIServer = nullptr;
 
@@ -36,3 +36,17 @@ void supernode::DAPI_RPC_Client::Set(string ip, string port) {
 	boost::optional<epee::net_utils::http::login> http_login{};
 	set_server(ss, http_login);
 }
+
+bool supernode::DAPI_RPC_NetClient::is_connected() {
+	if( !blocked_mode_client::is_connected() ) return false;
+	if(m_ssl) return true;
+	// server sends nothing between responses, so a readable socket was closed (or broken) by it
+	boost::asio::ip::tcp::socket& socket = get_socket();
+	boost::system::error_code ec, ignored;
+	char byte;
+	socket.non_blocking(true, ec);
+	if(ec) return false;
+	socket.receive(boost::asio::buffer(&byte, 1), boost::asio::socket_base::message_peek, ec);
+	socket.non_blocking(false, ignored);
+	return ec==boost::asio::error::would_block;
+}
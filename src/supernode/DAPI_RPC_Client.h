@@ -41,7 +41,18 @@ using namespace std;
 
 namespace supernode {
 
-	class DAPI_RPC_Client : public epee::net_utils::http::http_simple_client {
+	/*!
+	 * \brief The DAPI_RPC_NetClient class - blocking client which also treats the connection as lost once
+	 * the server has closed it, so an idle keep-alive connection is reconnected before a request is written
+	 */
+	class DAPI_RPC_NetClient : public epee::net_utils::blocked_mode_client {
+		public:
+		explicit DAPI_RPC_NetClient(boost::shared_ptr<boost::asio::io_service> ios) : blocked_mode_client(ios) {}
+
+		bool is_connected();
+	};
+
+	class DAPI_RPC_Client : public epee::net_utils::http::http_simple_client_template<DAPI_RPC_NetClient> {
 		public:
 
 		void Set(string ip, string port);
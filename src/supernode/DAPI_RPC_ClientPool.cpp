@@ -0,0 +1,216 @@
+// Copyright (c) 2019, The Graft Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "DAPI_RPC_ClientPool.h"
+#include <algorithm>
+
+namespace supernode {
+
+DAPI_RPC_ClientPool& DAPI_RPC_ClientPool::Instance() {
+	static DAPI_RPC_ClientPool pool;
+	return pool;
+}
+
+boost::shared_ptr<DAPI_RPC_ClientPool::SEndpoint> DAPI_RPC_ClientPool::Endpoint(const string& ip, const string& port) {
+	const string key = ip+string(":")+port;
+	boost::lock_guard<boost::mutex> lock(m_EndpointsGuard);
+	boost::shared_ptr<SEndpoint>& ep = m_Endpoints[key];
+	if(!ep) {
+		ep.reset( new SEndpoint() );
+		ep->IP = ip;
+		ep->Port = port;
+	}
+	return ep;
+}
+
+DAPI_RPC_ClientPool::SLease DAPI_RPC_ClientPool::Acquire(const string& ip, const string& port) {
+	SLease lease;
+	lease.Endpoint = Endpoint(ip, port);
+	SEndpoint& ep = *lease.Endpoint;
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	{
+		boost::lock_guard<boost::mutex> lock(ep.Guard);
+		ep.Calls++;
+		if( ep.ConsecutiveFailures>=BreakerFailures ) {
+			// open circuit, only one trial call after BreakerOpenTime
+			if( now<ep.OpenUntil || ep.TrialInFlight ) {
+				ep.Failures++;
+				return lease;
+			}
+			ep.TrialInFlight = true;
+			lease.Trial = true;
+		}
+
+		EvictIdle(ep, now);
+		if( !ep.Idle.empty() ) {
+			lease.Client = std::move(ep.Idle.back().Client);
+			ep.Idle.pop_back();
+			if( lease.Client->is_connected() ) ep.Reused++;
+		}
+	}
+
+	if(!lease.Client) {
+		lease.Client.reset( new DAPI_RPC_Client() );
+		lease.Client->Set(ip, port);
+	}
+
+	bool sweep = false, log = false;
+	{
+		boost::lock_guard<boost::mutex> lock(m_EndpointsGuard);
+		if( now-m_LastEviction>=IdleTimeout ) {
+			m_LastEviction = now;
+			sweep = true;
+		}
+		if( now-m_LastMetricsLog>=MetricsLogInterval ) {
+			m_LastMetricsLog = now;
+			log = true;
+		}
+	}
+	if(sweep) EvictIdle();
+	if(log) LogMetrics();
+
+	return lease;
+}
+
+void DAPI_RPC_ClientPool::Release(SLease& lease, bool ok, bool connectFailed, std::chrono::microseconds latency) {
+	SEndpoint& ep = *lease.Endpoint;
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	boost::lock_guard<boost::mutex> lock(ep.Guard);
+	if(lease.Trial) ep.TrialInFlight = false;
+
+	if(ok) {
+		ep.ConsecutiveFailures = 0;
+		if( ep.Latencies.size()<s_LatencySamples ) {
+			ep.Latencies.push_back( static_cast<uint32_t>( std::min<int64_t>(latency.count(), UINT32_MAX) ) );
+		} else {
+			ep.Latencies[ep.LatencyPos] = static_cast<uint32_t>( std::min<int64_t>(latency.count(), UINT32_MAX) );
+			ep.LatencyPos = (ep.LatencyPos+1) % size_t(s_LatencySamples);
+		}
+		if( ep.Idle.size()<MaxIdlePerEndpoint ) {
+			SIdleClient idle;
+			idle.Client = std::move(lease.Client);
+			idle.Since = now;
+			ep.Idle.push_back( std::move(idle) );
+		}
+		return;
+	}
+
+	// connection state is unknown after failed call, it is not returned to the pool
+	ep.Failures++;
+	if( !connectFailed ) {
+		// endpoint is reachable, the call itself failed
+		ep.ConsecutiveFailures = 0;
+		return;
+	}
+	if( ++ep.ConsecutiveFailures>=BreakerFailures ) {
+		if( ep.ConsecutiveFailures==BreakerFailures ) MWARNING("DAPI endpoint " << ep.IP << ":" << ep.Port << " is not available, circuit is open");
+		ep.OpenUntil = now+BreakerOpenTime;
+		ep.Idle.clear();
+	}
+}
+
+bool DAPI_RPC_ClientPool::IsAvailable(const string& ip, const string& port) {
+	boost::shared_ptr<SEndpoint> ep = Endpoint(ip, port);
+	boost::lock_guard<boost::mutex> lock(ep->Guard);
+	return ep->ConsecutiveFailures<BreakerFailures || std::chrono::steady_clock::now()>=ep->OpenUntil;
+}
+
+void DAPI_RPC_ClientPool::EvictIdle(SEndpoint& ep, std::chrono::steady_clock::time_point now) {
+	ep.Idle.erase( std::remove_if(ep.Idle.begin(), ep.Idle.end(), [this, now](const SIdleClient& idle) {
+		return now-idle.Since>=IdleTimeout;
+	}), ep.Idle.end() );
+}
+
+void DAPI_RPC_ClientPool::EvictIdle() {
+	vector< boost::shared_ptr<SEndpoint> > endpoints;
+	{
+		boost::lock_guard<boost::mutex> lock(m_EndpointsGuard);
+		for(auto& a : m_Endpoints) endpoints.push_back(a.second);
+	}
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	for(auto& ep : endpoints) {
+		boost::lock_guard<boost::mutex> lock(ep->Guard);
+		EvictIdle(*ep, now);
+	}
+}
+
+vector<DAPI_RPC_ClientPool::SEndpointMetrics> DAPI_RPC_ClientPool::Metrics() {
+	vector< boost::shared_ptr<SEndpoint> > endpoints;
+	{
+		boost::lock_guard<boost::mutex> lock(m_EndpointsGuard);
+		for(auto& a : m_Endpoints) endpoints.push_back(a.second);
+	}
+
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	vector<SEndpointMetrics> ret;
+	for(auto& ep : endpoints) {
+		SEndpointMetrics m;
+		vector<uint32_t> latencies;
+		{
+			boost::lock_guard<boost::mutex> lock(ep->Guard);
+			m.IP = ep->IP;
+			m.Port = ep->Port;
+			m.Calls = ep->Calls;
+			m.Reused = ep->Reused;
+			m.Failures = ep->Failures;
+			m.Open = ep->ConsecutiveFailures>=BreakerFailures && now<ep->OpenUntil;
+			latencies = ep->Latencies;
+		}
+		if( !latencies.empty() ) {
+			std::sort(latencies.begin(), latencies.end());
+			m.P50 = std::chrono::microseconds( latencies[(latencies.size()-1)*50/100] );
+			m.P99 = std::chrono::microseconds( latencies[(latencies.size()-1)*99/100] );
+		}
+		ret.push_back(m);
+	}
+	return ret;
+}
+
+void DAPI_RPC_ClientPool::LogMetrics() {
+	uint64_t calls = 0, reused = 0;
+	for(const SEndpointMetrics& m : Metrics()) {
+		LOG_PRINT_L2("DAPI endpoint " << m.IP << ":" << m.Port << ": calls " << m.Calls << ", reused " << m.Reused
+				<< ", failures " << m.Failures << ", p50 " << m.P50.count() << " us, p99 " << m.P99.count() << " us"
+				<< (m.Open ? ", circuit open" : ""));
+		calls += m.Calls;
+		reused += m.Reused;
+	}
+	if(calls) LOG_PRINT_L2("DAPI client pool reuse ratio " << double(reused)/calls);
+}
+
+double DAPI_RPC_ClientPool::ReuseRatio() {
+	uint64_t calls = 0, reused = 0;
+	for(const SEndpointMetrics& m : Metrics()) {
+		calls += m.Calls;
+		reused += m.Reused;
+	}
+	return calls ? double(reused)/calls : 0.0;
+}
+
+}
@@ -0,0 +1,159 @@
+// Copyright (c) 2019, The Graft Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#ifndef DAPI_RPC_CLIENT_POOL_H_
+#define DAPI_RPC_CLIENT_POOL_H_
+
+#include "DAPI_RPC_Client.h"
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+using namespace std;
+
+namespace supernode {
+
+	/*!
+	 * \brief The DAPI_RPC_ClientPool class - process-wide pool of keep-alive DAPI connections, keyed by (ip, port)
+	 *
+	 * Idle connections are reused by following calls and evicted after IdleTimeout. Failed calls are not
+	 * retried, since DAPI calls are not idempotent. Endpoint that refuses connections BreakerFailures times
+	 * in a row is not called for BreakerOpenTime (circuit is open), after that one trial call decides
+	 * whether it is closed again.
+	 */
+	class DAPI_RPC_ClientPool {
+		public:
+		static DAPI_RPC_ClientPool& Instance();
+
+		size_t MaxIdlePerEndpoint = 8;
+		std::chrono::seconds IdleTimeout = std::chrono::seconds(30);
+		unsigned BreakerFailures = 4;
+		std::chrono::seconds BreakerOpenTime = std::chrono::seconds(10);
+		std::chrono::seconds MetricsLogInterval = std::chrono::seconds(60);
+
+		struct SEndpointMetrics {
+			string IP;
+			string Port;
+			uint64_t Calls = 0;
+			uint64_t Reused = 0;// calls made over already open connection
+			uint64_t Failures = 0;
+			std::chrono::microseconds P50 = std::chrono::microseconds(0);
+			std::chrono::microseconds P99 = std::chrono::microseconds(0);
+			bool Open = false;// circuit is open, calls fail without connecting
+		};
+
+		template<class IN_t, class OUT_t>
+		bool Invoke(const string& ip, const string& port, const string& method, const IN_t& in, OUT_t& out,
+				std::chrono::milliseconds timeout = std::chrono::seconds(5), bool* wasConnected = nullptr) {
+			SLease lease = Acquire(ip, port);
+			if( !lease.Client ) {
+				if(wasConnected) *wasConnected = false;
+				return false;
+			}
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			bool connectFailed = false;
+			// not retried: once the request is written the server may have applied it
+			bool ret = Call(lease, method, in, out, timeout, connectFailed);
+			bool connected = lease.Client->WasConnected;
+			Release(lease, ret, connectFailed, std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now()-start));
+			if(wasConnected) *wasConnected = connected;
+			return ret;
+		}
+
+		// false while circuit of endpoint is open
+		bool IsAvailable(const string& ip, const string& port);
+
+		vector<SEndpointMetrics> Metrics();
+		// share of calls made over already open connection
+		double ReuseRatio();
+		// close connections idle longer than IdleTimeout
+		void EvictIdle();
+		// writes Metrics() and ReuseRatio() to the log, done every MetricsLogInterval by calls through the pool
+		void LogMetrics();
+
+		protected:
+		static const size_t s_LatencySamples = 256;
+
+		struct SIdleClient {
+			std::unique_ptr<DAPI_RPC_Client> Client;
+			std::chrono::steady_clock::time_point Since;
+		};
+
+		struct SEndpoint {
+			string IP;
+			string Port;
+			boost::mutex Guard;
+			vector<SIdleClient> Idle;
+			unsigned ConsecutiveFailures = 0;
+			std::chrono::steady_clock::time_point OpenUntil;
+			bool TrialInFlight = false;
+			uint64_t Calls = 0;
+			uint64_t Reused = 0;
+			uint64_t Failures = 0;
+			vector<uint32_t> Latencies;// ring of last s_LatencySamples latencies, us
+			size_t LatencyPos = 0;
+		};
+
+		struct SLease {
+			boost::shared_ptr<SEndpoint> Endpoint;
+			std::unique_ptr<DAPI_RPC_Client> Client;
+			bool Trial = false;
+		};
+
+		template<class IN_t, class OUT_t>
+		static bool Call(SLease& lease, const string& method, const IN_t& in, OUT_t& out, std::chrono::milliseconds timeout, bool& connectFailed) {
+			// connect separately, only refused connections count toward the circuit breaker;
+			// idle connection closed by the server is not connected any more and is replaced here
+			connectFailed = false;
+			lease.Client->WasConnected = false;
+			if( !lease.Client->is_connected() && !lease.Client->connect(timeout) ) {
+				connectFailed = true;
+				return false;
+			}
+			return lease.Client->Invoke<IN_t, OUT_t>(method, in, out, timeout);
+		}
+
+		SLease Acquire(const string& ip, const string& port);
+		void Release(SLease& lease, bool ok, bool connectFailed, std::chrono::microseconds latency);
+		boost::shared_ptr<SEndpoint> Endpoint(const string& ip, const string& port);
+		void EvictIdle(SEndpoint& ep, std::chrono::steady_clock::time_point now);
+
+		protected:
+		boost::mutex m_EndpointsGuard;
+		unordered_map< string, boost::shared_ptr<SEndpoint> > m_Endpoints;
+		std::chrono::steady_clock::time_point m_LastEviction;
+		std::chrono::steady_clock::time_point m_LastMetricsLog;
+	};
+
+}
+
+#endif /* DAPI_RPC_CLIENT_POOL_H_ */
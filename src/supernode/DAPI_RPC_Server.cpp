@@ -31,6 +31,7 @@
 using namespace std;
 #include "DAPI_RPC_Server.h"
 #include "healthcheckapi.h"
+#include "WorkerPool.h"
 
 bool supernode::DAPI_RPC_Server::handle_http_request(const epee::net_utils::http::http_request_info& query_info, epee::net_utils::http::http_response_info& response, connection_context& m_conn_context) {
 	//LOG_PRINT_L4("HTTP [" << m_conn_context.m_remote_address.host_str() << "] " << query_info.m_http_method_str << " " << query_info.m_URI);
@@ -44,6 +45,14 @@ bool supernode::DAPI_RPC_Server::handle_http_request(const epee::net_utils::http
 	response.m_additional_fields.push_back( make_pair("Access-Control-Max-Age", "1728000") );
 	response.m_additional_fields.push_back( make_pair("Access-Control-Allow-Headers", "X-Requested-With, Content-Type, Origin, Cache-Control, Pragma, Authorization, Accept, Accept-Encoding") );
 
+	// shed load before parsing, clients retry later
+	if( WorkerPool::Instance().Overloaded() ) {
+		response.m_response_code = 503;
+		response.m_response_comment = "Service Unavailable";
+		response.m_additional_fields.push_back( make_pair("Retry-After", "1") );
+		return true;
+	}
+
 	if( !HandleRequest(query_info, response, m_conn_context) ) {
 		response.m_response_code = 500;
 		response.m_response_comment = "Internal server error";
@@ -95,28 +104,12 @@ bool supernode::DAPI_RPC_Server::HandleRequest(const epee::net_utils::http::http
 
     ps.get_value("id", id_, nullptr);
 
+    // read PaymentID straight from the parsed storage, the handler gets the same storage
     std::string payment_id;
-    {
-    	epee::json_rpc::request<SubNetData> resp;
-    	if( resp.load(ps) ) payment_id = resp.params.PaymentID;
-    }
-
-
+    epee::serialization::portable_storage::hsection params = ps.open_section("params", nullptr);
+    if(params) ps.get_value("PaymentID", payment_id, params);
 
-    SCallHandler* handler = nullptr;
-
-    {
-    	boost::lock_guard<boost::recursive_mutex> lock(m_Handlers_Guard);
-    	for(unsigned i=0;i<m_vHandlers.size();i++) {
-    		SHandlerData& hh = m_vHandlers[i];
-
-    		if(hh.Name!=callback_name) continue;
-    		if(hh.PaymentID.size() &&  hh.PaymentID!=payment_id) continue;
-
-    		handler = hh.Handler;
-    		break;
-    	}
-    }
+    SCallHandlerPtr handler = FindHandler(callback_name, payment_id);
     LOG_PRINT_L2(response_info.m_body);
 
     if(!handler) { LOG_ERROR("handler not found for: "<<callback_name); return false; }
@@ -147,20 +140,63 @@ void supernode::DAPI_RPC_Server::Start() { run(m_NumThreads); }
 
 void supernode::DAPI_RPC_Server::Stop() { send_stop_signal(); }
 
+string supernode::DAPI_RPC_Server::HandlerKey(const string& method, const string& payment_id) {
+	string key;
+	key.reserve( method.size()+payment_id.size()+1 );
+	key += method;
+	key += '\n';
+	key += payment_id;
+	return key;
+}
+
+supernode::DAPI_RPC_Server::SHandlersShard& supernode::DAPI_RPC_Server::Shard(const string& key) {
+	return m_Handlers[ std::hash<string>()(key) % s_HandlersShards ];
+}
+
+supernode::DAPI_RPC_Server::SCallHandlerPtr supernode::DAPI_RPC_Server::FindHandler(const string& method, const string& payment_id) {
+	for(int global=payment_id.empty()?1:0;global<2;global++) {
+		const string key = HandlerKey( method, global?string():payment_id );
+		SHandlersShard& shard = Shard(key);
+		boost::shared_lock<boost::shared_mutex> lock(shard.Guard);
+		auto it = shard.Handlers.find(key);
+		if( it!=shard.Handlers.end() ) return it->second.front().Handler;
+	}
+	return SCallHandlerPtr();
+}
+
 int supernode::DAPI_RPC_Server::AddHandlerData(const SHandlerData& h) {
-	boost::lock_guard<boost::recursive_mutex> lock(m_Handlers_Guard);
-	int idx = m_HandlerIdx;
-	m_HandlerIdx++;
-	m_vHandlers.push_back(h);
-	m_vHandlers.rbegin()->Idx = idx;
-	return idx;
+	SHandlerData hh = h;
+	hh.Idx = m_HandlerIdx++;
+	const string key = HandlerKey(hh.Name, hh.PaymentID);
+	{
+		boost::lock_guard<boost::mutex> lock(m_HandlerKeys_Guard);
+		m_HandlerKeys[hh.Idx] = key;
+	}
+
+	SHandlersShard& shard = Shard(key);
+	boost::unique_lock<boost::shared_mutex> lock(shard.Guard);
+	shard.Handlers[key].push_back(hh);
+	return hh.Idx;
 }
 
 void supernode::DAPI_RPC_Server::RemoveHandler(int idx) {
-	boost::lock_guard<boost::recursive_mutex> lock(m_Handlers_Guard);
-	for(unsigned i=0;i<m_vHandlers.size();i++) if( m_vHandlers[i].Idx==idx ) {
-		m_vHandlers.erase( m_vHandlers.begin()+i );
+	string key;
+	{
+		boost::lock_guard<boost::mutex> lock(m_HandlerKeys_Guard);
+		auto it = m_HandlerKeys.find(idx);
+		if( it==m_HandlerKeys.end() ) return;
+		key = std::move(it->second);
+		m_HandlerKeys.erase(it);
+	}
+
+	SHandlersShard& shard = Shard(key);
+	boost::unique_lock<boost::shared_mutex> lock(shard.Guard);
+	auto it = shard.Handlers.find(key);
+	if( it==shard.Handlers.end() ) return;
+	vector<SHandlerData>& hh = it->second;
+	for(unsigned i=0;i<hh.size();i++) if( hh[i].Idx==idx ) {
+		hh.erase( hh.begin()+i );
 		break;
 	}
+	if( hh.empty() ) shard.Handlers.erase(it);
 }
-
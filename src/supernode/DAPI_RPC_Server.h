@@ -37,7 +37,11 @@
 #include <boost/program_options/variables_map.hpp>
 #include "net/http_server_impl_base.h"
 #include "FSN_Servant.h"
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/shared_mutex.hpp>
+#include <atomic>
 #include <string>
+#include <unordered_map>
 using namespace std;
 
 namespace supernode {
@@ -58,6 +62,7 @@ namespace supernode {
 		protected:
 		class SCallHandler {
 			public:
+			virtual ~SCallHandler() {}
 			virtual bool Process(epee::serialization::portable_storage& in, string& out_js)=0;
 		};
 		template<class IN_t, class OUT_t>
@@ -84,19 +89,27 @@ namespace supernode {
 			boost::function<bool (const IN_t&, OUT_t&)> Handler;
 		};
 
+		typedef boost::shared_ptr<SCallHandler> SCallHandlerPtr;
+
 		struct SHandlerData {
-			SCallHandler* Handler = nullptr;
+			SCallHandlerPtr Handler;
 			string Name;
 			int Idx = -1;
 			string PaymentID;
 		};
 
+		// handlers keyed by (method, payment id); for the same key the first added one is called
+		struct SHandlersShard {
+			boost::shared_mutex Guard;
+			unordered_map< string, vector<SHandlerData> > Handlers;
+		};
+
 
 		public:
 		template<class IN_t, class OUT_t>
 		int AddHandler( const string& method, boost::function<bool (const IN_t&, OUT_t&)> handler ) {
 			SHandlerData hh;
-			hh.Handler = new STemplateHandler<IN_t, OUT_t>(handler);
+			hh.Handler.reset( new STemplateHandler<IN_t, OUT_t>(handler) );
 			hh.Name = method;
 			return AddHandlerData(hh);
 		}
@@ -108,7 +121,7 @@ namespace supernode {
 		template<class IN_t, class OUT_t>
 		int Add_UUID_MethodHandler( string paymentid, const string& method, boost::function<bool (const IN_t&, OUT_t&)> handler ) {
 			SHandlerData hh;
-			hh.Handler = new STemplateHandler<IN_t, OUT_t>(handler);
+			hh.Handler.reset( new STemplateHandler<IN_t, OUT_t>(handler) );
 			hh.Name = method;
 			hh.PaymentID = paymentid;
 			return AddHandlerData(hh);
@@ -123,11 +136,17 @@ namespace supernode {
 		bool handle_http_request(const epee::net_utils::http::http_request_info& query_info, epee::net_utils::http::http_response_info& response, connection_context& m_conn_context) override;
 		bool HandleRequest(const epee::net_utils::http::http_request_info& query_info, epee::net_utils::http::http_response_info& response_info, connection_context& m_conn_context);
 		int AddHandlerData(const SHandlerData& h);
+		// handler registered for payment id, or global one for the method
+		SCallHandlerPtr FindHandler(const string& method, const string& payment_id);
+		static string HandlerKey(const string& method, const string& payment_id);
+		SHandlersShard& Shard(const string& key);
 
 		protected:
-		boost::recursive_mutex m_Handlers_Guard;
-		vector<SHandlerData> m_vHandlers;
-		int m_HandlerIdx = 0;
+		static const size_t s_HandlersShards = 16;
+		SHandlersShard m_Handlers[s_HandlersShards];
+		boost::mutex m_HandlerKeys_Guard;
+		unordered_map<int, string> m_HandlerKeys;// idx -> key, for RemoveHandler
+		std::atomic<int> m_HandlerIdx{0};
 
 		protected:
 		int m_NumThreads = 5;
@@ -30,7 +30,7 @@
 #include "FSN_ActualList.h"
 #include "P2P_Broadcast.h"
 #include "DAPI_RPC_Server.h"
-#include "DAPI_RPC_Client.h"
+#include "DAPI_RPC_ClientPool.h"
 #include <unistd.h>
 
 static const unsigned s_AuditTime = 50*60*1000;//50 min
@@ -53,8 +53,6 @@ FSN_ActualList::FSN_ActualList(FSN_ServantBase* servant, P2P_Broadcast* p2p, DAP
 void FSN_ActualList::Start() {
 	CheckIfIamFSN(true);// may be very slow operation
 
-	m_Work.Workers(10);
-
 	m_Running = true;
 	m_Thread = new boost::thread(&FSN_ActualList::Run, this);
 }
@@ -62,7 +60,6 @@ void FSN_ActualList::Start() {
 void FSN_ActualList::Stop() {
 	m_Running = false;
 	m_Thread->join();
-	m_Work.Stop();
 }
 
 void FSN_ActualList::GetFSNList(const rpc_command::BROADCAST_NEAR_GET_ACTUAL_FSN_LIST::request& in, rpc_command::BROADCAST_NEAR_GET_ACTUAL_FSN_LIST::response& out) {
@@ -166,7 +163,7 @@ boost::shared_ptr<FSN_Data> FSN_ActualList::_OnAddFSN(const rpc_command::BROADCA
 }
 
 void FSN_ActualList::OnAddFSN(const rpc_command::BROADCACT_ADD_FULL_SUPER_NODE& in ) {
-	m_Work.Service.post( [this, in](){
+	WorkerPool::Instance().Post( [this, in](){
 		OnAddFSNFromWorker(in);
 	} );
 }
@@ -182,7 +179,7 @@ void FSN_ActualList::OnAddFSNFromWorker(const rpc_command::BROADCACT_ADD_FULL_SU
 }
 
 void FSN_ActualList::OnLostFSNStatus(const rpc_command::BROADCACT_LOST_STATUS_FULL_SUPER_NODE& in) {
-	m_Work.Service.post( [this, in](){
+	WorkerPool::Instance().Post( [this, in](){
 		OnLostFSNStatusFromWorker(in);
 	} );
 }
@@ -200,20 +197,19 @@ bool FSN_ActualList::CheckWalletOwner(boost::shared_ptr<FSN_Data> data, const st
 	in.Str = GenStrForSign( data->IP, data->Port, wa );
 	in.WalletAddr = wa;
 
-	DAPI_RPC_Client call;
-	call.Set(data->IP, data->Port);
-	if( !call.Invoke(dapi_call::FSN_CheckWalletOwnership, in, out) ) return false;
+	if( !DAPI_RPC_ClientPool::Instance().Invoke(data->IP, data->Port, dapi_call::FSN_CheckWalletOwnership, in, out) ) return false;
 	return m_Servant->IsSignValid(in.Str, in.WalletAddr, out.Sign);
 
 }
 
 bool FSN_ActualList::CheckIsFSN(boost::shared_ptr<FSN_Data> data) {
+	// stake balance is a lookup in the shared scanner table, check it before the ownership round trips
+	uint64_t bal = m_Servant->GetWalletBalance( m_Servant->GetCurrentBlockHeight(), data->Stake );
+	if( bal <= s_MinStakeBalance ) return false;
+
 	if( !CheckWalletOwner(data, data->Stake.Addr) ) return false;
 	if( !CheckWalletOwner(data, data->Miner.Addr) ) return false;
-
-
-	uint64_t bal = m_Servant->GetWalletBalance( m_Servant->GetCurrentBlockHeight(), data->Stake );
-    return bal > s_MinStakeBalance;
+	return true;
 }
 
 bool FSN_ActualList::FSN_CheckWalletOwnership(const rpc_command::FSN_CHECK_WALLET_OWNERSHIP::request& in, rpc_command::FSN_CHECK_WALLET_OWNERSHIP::response& out) {
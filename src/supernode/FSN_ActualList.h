@@ -73,7 +73,6 @@ protected:
     bool m_Running = false;
     boost::thread* m_Thread = nullptr;
 
-    WorkerPool m_Work;
     boost::posix_time::ptime m_AuditStartAt;
 
 };
@@ -44,7 +44,6 @@ static unsigned s_AuthSampleSize = 8;
 namespace supernode {
 
 namespace consts {
-    static const string DEFAULT_FSN_WALLETS_DIR = "/tmp/graft/fsn_data/wallets_vo";
     static const int    DEFAULT_FSN_WALLET_REFRESH_INTERVAL_MS = 5000;
 }
 
@@ -116,22 +115,16 @@ FSN_Servant::FSN_Servant(const FSN_Servant &other)
 }
 
 FSN_Servant::FSN_Servant(const string &bdb_path, const string &node_addr, const string &node_login, const string &node_password,
-                         const string &fsn_wallets_dir, network_type nettype)
-    : m_fsnWalletsDir(fsn_wallets_dir)
+                         const string &/*fsn_wallets_dir*/, network_type nettype)
 {
     FSN_ServantBase::m_nettype      = nettype;
     FSN_ServantBase::m_nodelogin    = node_login;
     FSN_ServantBase::m_nodePassword = node_password;
     SetNodeAddress(node_addr);
 
-    if (m_fsnWalletsDir.empty())
-        m_fsnWalletsDir = consts::DEFAULT_FSN_WALLETS_DIR;
-
-    // create directory for "view only wallets" if not exists
-    if (!boost::filesystem::exists(m_fsnWalletsDir)) {
-        if (!boost::filesystem::create_directories(m_fsnWalletsDir))
-            throw std::runtime_error("Error creating FSN view only wallets directory");
-    }
+    // one scanner pulls each block once for all FSN stake wallets
+    m_scanner.reset(new FSN_ViewKeyScanner(node_addr, node_login, node_password, nettype));
+    m_scanner->Start(std::chrono::milliseconds(consts::DEFAULT_FSN_WALLET_REFRESH_INTERVAL_MS));
 //FIXME: Commented since blockchain loading disabled.
 //    if (!initBlockchain(bdb_path, nettype))
 //        throw std::runtime_error("Failed to open blockchain");
@@ -234,32 +227,33 @@ bool FSN_Servant::IsSignValid(const string &message, const string &address, cons
 
 uint64_t FSN_Servant::GetWalletBalance(uint64_t block_num, const FSN_WalletData& wallet) const
 {
-    // create or open view-only wallet;
-    Monero::Wallet * w = initViewOnlyWallet(wallet, m_nettype);
-    uint64_t result = w->unlockedBalance(block_num);
-
+    uint64_t result = 0;
+    if (!m_scanner)
+        return result;
+    if (!m_scanner->HasAccount(wallet.Addr)) {
+        // No luck, somehow caller requested the address we don't scan yet
+        if (!m_scanner->AddAccount(wallet))
+            return 0;
+        m_scanner->Refresh();
+    }
+    m_scanner->UnlockedBalance(wallet.Addr, block_num, result);
     return result;
 }
 
 void FSN_Servant::AddFsnAccount(boost::shared_ptr<FSN_Data> fsn) {
 	FSN_ServantBase::AddFsnAccount(fsn);
-    // create view-only wallet for stake account
-    initViewOnlyWallet(fsn->Stake, m_nettype);
+    // track stake account
+    if (m_scanner)
+        m_scanner->AddAccount(fsn->Stake);
 }
 
 bool FSN_Servant::RemoveFsnAccount(boost::shared_ptr<FSN_Data> fsn) {
-    boost::lock_guard<boost::recursive_mutex> lock(All_FSN_Guard);// we use one mutex for All_FSN && for m_viewOnlyWallets
+    boost::lock_guard<boost::recursive_mutex> lock(All_FSN_Guard);
 
     if( !FSN_ServantBase::RemoveFsnAccount(fsn) ) return false;
 
-    // TODO: RAII based (scoped) locks
-    const auto &it = m_viewOnlyWallets.find(fsn->Stake.Addr);
-    if (it != m_viewOnlyWallets.end()) {
-        Monero::Wallet * w = it->second;
-        Monero::WalletManagerFactory::getWalletManager()->closeWallet(w);
-        m_viewOnlyWallets.erase(it);
-    } else {
-        LOG_ERROR("Internal error: All_FSN doesn't have corresponding wallet: " << fsn->Stake.Addr);
+    if (m_scanner && !m_scanner->RemoveAccount(fsn->Stake.Addr)) {
+        LOG_ERROR("Internal error: All_FSN doesn't have corresponding scanned account: " << fsn->Stake.Addr);
     }
 
     return true;
@@ -376,53 +370,6 @@ Wallet *FSN_Servant::initWallet(Wallet * existingWallet, const string &path, con
     return wallet;
 }
 
-Wallet *FSN_Servant::initViewOnlyWallet(const FSN_WalletData &walletData, network_type nettype) const
-{
-
-    if (walletData.Addr.empty()) {
-        LOG_ERROR("Adding wallet with empty address");
-        return nullptr;
-    }
-
-    const auto & walletIter = m_viewOnlyWallets.find(walletData.Addr);
-    if (walletIter != m_viewOnlyWallets.end())
-        return walletIter->second;
-
-    // No luck, somehow caller requested the address we don't have view-only wallet yet
-    boost::filesystem::path wallet_path (m_fsnWalletsDir);
-    wallet_path /= walletData.Addr;
-    Monero::Wallet * w = nullptr;
-    Monero::WalletManager * wmgr = Monero::WalletManagerFactory::getWalletManager();
-
-    if (!wmgr->walletExists(wallet_path.string())) {
-        // create new view only wallet
-        w = wmgr->createWalletFromKeys(wallet_path.string(), "English",
-                                       static_cast<Monero::NetworkType>(nettype), 0, walletData.Addr, walletData.ViewKey);
-    } else {
-        // open existing
-        w = wmgr->openWallet(wallet_path.string(), "", static_cast<Monero::NetworkType>(nettype));
-    }
-
-    if (!w)
-        throw std::runtime_error(std::string("unable to open/create view only wallet: " + wmgr->errorString()));
-
-
-    if (!w->init(GetNodeAddress(), 0)) {
-        MERROR("Can't connect to a daemon.");
-    } else {
-        w->setAutoRefreshInterval(consts::DEFAULT_FSN_WALLET_REFRESH_INTERVAL_MS);
-        w->startRefresh();
-        w->refresh();
-    }
-
-    // add wallet to map
-    m_viewOnlyWallets[walletData.Addr] = w;
-    // TODO: should have opened wallets in sync with the All_FSN ???
-    return w;
-}
-
-
-
 FSN_WalletData FSN_Servant::walletData(Wallet *wallet)
 {
     FSN_WalletData result = FSN_WalletData(wallet->address(), wallet->secretViewKey());
@@ -31,6 +31,7 @@
 #define FSN_SERVANT_H_
 
 #include "FSN_ServantBase.h"
+#include "FSN_ViewKeyScanner.h"
 #include <cryptonote_core/cryptonote_core.h>
 #include <wallet/api/wallet2_api.h>
 #include <boost/thread/mutex.hpp>
@@ -105,7 +106,7 @@ public:
      */
     bool IsSignValid(const string& message, const string &address, const string &signature) const  override;
 
-    // calc balance from chain begin to block_num
+    // calc balance from chain begin to block_num, reads shared view-key scanner table
     uint64_t GetWalletBalance(uint64_t block_num, const FSN_WalletData& wallet) const  override;
 
     virtual void AddFsnAccount(boost::shared_ptr<FSN_Data> fsn) override;
@@ -123,27 +124,19 @@ private:
     bool initBlockchain(const std::string &dbpath, cryptonote::network_type nettype);
 
     Monero::Wallet * initWallet(Monero::Wallet *existingWallet, const string &path, const string &password, cryptonote::network_type nettype);
-    /*!
-     * \brief initViewOnlyWallet - creates new or opens existing view only wallet
-     * \brief walletData         - address and viewkey
-     * \param nettype            - network type (mainnet/testnet/stagenet)
-     * \return                   - pointer to Monero::Wallet obj
-     */
-    Monero::Wallet * initViewOnlyWallet(const FSN_WalletData &walletData, cryptonote::network_type nettype) const;
     static FSN_WalletData walletData(Monero::Wallet * wallet);
 
     Monero::Wallet * getMyWalletByAddress(const std::string &address) const;
 
 private:
-    // directory where view-only wallets for other FSNs will be stored
-    std::string                  m_fsnWalletsDir;
     cryptonote::BlockchainDB   * m_bdb     = nullptr;
     cryptonote::Blockchain     * m_bc      = nullptr;
     cryptonote::tx_memory_pool * m_mempool = nullptr;
 
     mutable Monero::Wallet *m_stakeWallet = nullptr;
     mutable Monero::Wallet *m_minerWallet = nullptr;
-    mutable std::map<std::string, Monero::Wallet*> m_viewOnlyWallets;
+    // incoming outputs of all FSN stake wallets
+    std::unique_ptr<FSN_ViewKeyScanner> m_scanner;
 
 };
 
@@ -0,0 +1,357 @@
+// Copyright (c) 2019, The Graft Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "FSN_ViewKeyScanner.h"
+#include "rpc/core_rpc_server_commands_defs.h"
+#include "storages/http_abstract_invoke.h"
+#include "cryptonote_basic/cryptonote_format_utils.h"
+#include "cryptonote_core/cryptonote_tx_utils.h"
+#include "ringct/rctOps.h"
+
+#include <algorithm>
+#include <limits>
+#include <ctime>
+
+using namespace cryptonote;
+
+namespace supernode {
+
+FSN_ViewKeyScanner::FSN_ViewKeyScanner(const std::string &daemon_addr, const std::string &daemon_login, const std::string &daemon_pass,
+                                       network_type nettype)
+    : m_nettype(nettype)
+    , m_rpc_timeout(std::chrono::seconds(30))
+{
+    boost::optional<epee::net_utils::http::login> login{};
+    if (!daemon_login.empty() && !daemon_pass.empty()) {
+        login.emplace(daemon_login, daemon_pass);
+    }
+    if (!m_http_client.set_server(daemon_addr, login)) {
+        throw std::runtime_error("can't connect to node: " + daemon_addr);
+    }
+
+    // the chain is anchored at the genesis block, it is never scanned
+    block genesis;
+    if (!generate_genesis_block(genesis, get_config(m_nettype).GENESIS_TX, get_config(m_nettype).GENESIS_NONCE)) {
+        throw std::runtime_error("can't generate genesis block");
+    }
+    m_block_hashes.push_back(get_block_hash(genesis));
+}
+
+FSN_ViewKeyScanner::~FSN_ViewKeyScanner()
+{
+    Stop();
+}
+
+bool FSN_ViewKeyScanner::AddAccount(const FSN_WalletData &wallet)
+{
+    address_parse_info info;
+    if (!get_account_address_from_str(info, m_nettype, wallet.Addr)) {
+        LOG_ERROR("Error parsing address: " << wallet.Addr);
+        return false;
+    }
+
+    account acc;
+    crypto::public_key view_public_key;
+    if (!epee::string_tools::hex_to_pod(wallet.ViewKey, acc.view_key)
+            || !crypto::secret_key_to_public_key(acc.view_key, view_public_key)
+            || view_public_key != info.address.m_view_public_key) {
+        LOG_ERROR("View key doesn't match address: " << wallet.Addr);
+        return false;
+    }
+    acc.address = info.address;
+    acc.scanned_height = 1;
+
+    boost::lock_guard<boost::mutex> lock(m_lock);
+    m_accounts.emplace(wallet.Addr, std::move(acc));
+    return true;
+}
+
+bool FSN_ViewKeyScanner::RemoveAccount(const std::string &address)
+{
+    boost::lock_guard<boost::mutex> lock(m_lock);
+    return m_accounts.erase(address) > 0;
+}
+
+bool FSN_ViewKeyScanner::HasAccount(const std::string &address) const
+{
+    boost::lock_guard<boost::mutex> lock(m_lock);
+    return m_accounts.find(address) != m_accounts.end();
+}
+
+bool FSN_ViewKeyScanner::UnlockedBalance(const std::string &address, uint64_t block_num, uint64_t &balance) const
+{
+    const uint64_t now = static_cast<uint64_t>(time(nullptr));
+    boost::lock_guard<boost::mutex> lock(m_lock);
+    const auto it = m_accounts.find(address);
+    if (it == m_accounts.end())
+        return false;
+
+    balance = 0;
+    for (const received_output &out : it->second.outputs) {
+        if (out.height + CRYPTONOTE_DEFAULT_TX_SPENDABLE_AGE > block_num)
+            continue;
+        if (out.unlock_time < CRYPTONOTE_MAX_BLOCK_NUMBER) {
+            if (out.unlock_time > block_num + CRYPTONOTE_LOCKED_TX_ALLOWED_DELTA_BLOCKS)
+                continue;
+        } else if (out.unlock_time > now + CRYPTONOTE_LOCKED_TX_ALLOWED_DELTA_SECONDS_V2) {
+            continue;
+        }
+        balance += out.amount;
+    }
+    return true;
+}
+
+bool FSN_ViewKeyScanner::Refresh()
+{
+    boost::lock_guard<boost::mutex> refresh_lock(m_refresh_lock);
+
+    bool done = false;
+    bool result = true;
+    // a full-chain scan takes many batches, Stop() must not wait for all of them
+    while (result && !done && !stopRequested()) {
+        std::vector<scan_key> keys;
+        uint64_t from = m_block_hashes.size();
+        {
+            boost::lock_guard<boost::mutex> lock(m_lock);
+            if (m_accounts.empty())
+                return true;
+            keys.reserve(m_accounts.size());
+            for (const auto &a : m_accounts) {
+                keys.push_back({a.first, a.second.address, a.second.view_key, a.second.scanned_height, {}});
+                from = std::min(from, a.second.scanned_height);
+            }
+        }
+
+        uint64_t reorg_height = std::numeric_limits<uint64_t>::max();
+        result = scanBlocks(std::max<uint64_t>(from, 1), keys, reorg_height, done);
+
+        // partial results are applied on error too, they are consistent with m_block_hashes
+        boost::lock_guard<boost::mutex> lock(m_lock);
+        if (reorg_height != std::numeric_limits<uint64_t>::max()) {
+            for (auto &a : m_accounts) {
+                auto &outputs = a.second.outputs;
+                outputs.erase(std::remove_if(outputs.begin(), outputs.end(),
+                                             [reorg_height](const received_output &out) { return out.height >= reorg_height; }),
+                              outputs.end());
+                a.second.scanned_height = std::min(a.second.scanned_height, reorg_height);
+            }
+        }
+        for (scan_key &key : keys) {
+            auto it = m_accounts.find(key.address_str);
+            if (it == m_accounts.end())
+                continue; // removed while scanning
+            it->second.outputs.insert(it->second.outputs.end(), key.found.begin(), key.found.end());
+            it->second.scanned_height = std::max(it->second.scanned_height, key.scanned_height);
+        }
+    }
+    return result;
+}
+
+void FSN_ViewKeyScanner::Start(std::chrono::milliseconds interval)
+{
+    Stop();
+    m_stop = false;
+    m_thread = boost::thread([this, interval]() { refreshLoop(interval); });
+}
+
+void FSN_ViewKeyScanner::Stop()
+{
+    {
+        boost::lock_guard<boost::mutex> lock(m_stop_lock);
+        m_stop = true;
+    }
+    m_stop_cond.notify_all();
+    if (m_thread.joinable())
+        m_thread.join();
+}
+
+bool FSN_ViewKeyScanner::stopRequested()
+{
+    boost::lock_guard<boost::mutex> lock(m_stop_lock);
+    return m_stop;
+}
+
+void FSN_ViewKeyScanner::refreshLoop(std::chrono::milliseconds interval)
+{
+    boost::unique_lock<boost::mutex> lock(m_stop_lock);
+    while (!m_stop) {
+        lock.unlock();
+        if (!Refresh())
+            MWARNING("Failed to refresh FSN accounts from the daemon");
+        lock.lock();
+        m_stop_cond.wait_for(lock, boost::chrono::milliseconds(interval.count()), [this]() { return m_stop; });
+    }
+}
+
+bool FSN_ViewKeyScanner::scanBlocks(uint64_t from, std::vector<scan_key> &keys, uint64_t &reorg_height, bool &done)
+{
+    COMMAND_RPC_GET_BLOCKS_FAST::request req;
+    COMMAND_RPC_GET_BLOCKS_FAST::response res;
+    req.block_ids = shortChainHistory(from);
+    req.start_height = 0;
+    // outputs and encrypted amounts are in the pruned blobs, so pruned daemons can serve them
+    req.prune = true;
+    req.no_miner_tx = false;
+
+    bool r = epee::net_utils::invoke_http_bin("/getblocks.bin", req, res, m_http_client, m_rpc_timeout);
+    if (!r || res.status != CORE_RPC_STATUS_OK) {
+        LOG_ERROR("/getblocks.bin error");
+        return false;
+    }
+
+    std::vector<size_t> active;
+    std::vector<crypto::secret_key> view_keys;
+    std::vector<crypto::key_derivation> derivations;
+    for (size_t i = 0; i < res.blocks.size(); ++i) {
+        const uint64_t height = res.start_height + i;
+        block b;
+        if (!parse_and_validate_block_from_blob(res.blocks[i].block, b)) {
+            LOG_ERROR("failed to parse block at height " << height);
+            return false;
+        }
+
+        const crypto::hash hash = get_block_hash(b);
+        if (height < m_block_hashes.size() && m_block_hashes[height] != hash) {
+            if (height == 0) {
+                LOG_ERROR("daemon has different genesis block");
+                return false;
+            }
+            MWARNING("Blockchain reorganization detected at height " << height);
+            m_block_hashes.resize(height);
+            reorg_height = std::min(reorg_height, height);
+            for (scan_key &key : keys)
+                key.scanned_height = std::min(key.scanned_height, height);
+        }
+        if (height == m_block_hashes.size()) {
+            m_block_hashes.push_back(hash);
+        } else if (height > m_block_hashes.size()) {
+            LOG_ERROR("daemon returned block " << height << " not connected to the known chain");
+            return false;
+        }
+
+        active.clear();
+        view_keys.clear();
+        for (size_t k = 0; k < keys.size(); ++k) {
+            if (keys[k].scanned_height <= height) {
+                active.push_back(k);
+                view_keys.push_back(keys[k].view_key);
+            }
+        }
+        if (active.empty())
+            continue;
+
+        std::vector<transaction> txs(res.blocks[i].txs.size());
+        for (size_t t = 0; t < txs.size(); ++t) {
+            if (!parse_and_validate_tx_base_from_blob(res.blocks[i].txs[t], txs[t])) {
+                LOG_ERROR("failed to parse tx in block " << height);
+                return false;
+            }
+        }
+
+        scanTransaction(b.miner_tx, height, active, keys, view_keys, derivations);
+        for (const transaction &tx : txs)
+            scanTransaction(tx, height, active, keys, view_keys, derivations);
+
+        for (size_t k : active)
+            keys[k].scanned_height = height + 1;
+    }
+
+    done = res.start_height + res.blocks.size() >= res.current_height;
+    return true;
+}
+
+void FSN_ViewKeyScanner::scanTransaction(const transaction &tx, uint64_t height, const std::vector<size_t> &active,
+                                         std::vector<scan_key> &keys, std::vector<crypto::secret_key> &view_keys,
+                                         std::vector<crypto::key_derivation> &derivations) const
+{
+    const crypto::public_key tx_pub_key = get_tx_pub_key_from_extra(tx);
+    if (tx_pub_key == crypto::null_pkey)
+        return;
+    //one decompression of the tx key for all the view keys
+    if (!crypto::generate_key_derivations(tx_pub_key, view_keys, derivations))
+        return;
+    const std::vector<crypto::public_key> additional_tx_pub_keys = get_additional_tx_pub_keys_from_extra(tx);
+
+    for (size_t o = 0; o < tx.vout.size(); ++o) {
+        if (tx.vout[o].target.type() != typeid(txout_to_key))
+            continue;
+        const crypto::public_key &out_key = boost::get<txout_to_key>(tx.vout[o].target).key;
+
+        for (size_t a = 0; a < active.size(); ++a) {
+            scan_key &key = keys[active[a]];
+            crypto::key_derivation derivation = derivations[a];
+            crypto::public_key derived;
+            bool match = crypto::derive_public_key(derivation, o, key.address.m_spend_public_key, derived) && derived == out_key;
+            if (!match && additional_tx_pub_keys.size() == tx.vout.size()) {
+                match = crypto::generate_key_derivation(additional_tx_pub_keys[o], key.view_key, derivation)
+                        && crypto::derive_public_key(derivation, o, key.address.m_spend_public_key, derived)
+                        && derived == out_key;
+            }
+            if (!match)
+                continue;
+
+            uint64_t amount = tx.vout[o].amount;
+            if (tx.version >= 2 && !is_coinbase(tx)) {
+                if (o >= tx.rct_signatures.ecdhInfo.size() || o >= tx.rct_signatures.outPk.size())
+                    break;
+                crypto::secret_key scalar;
+                crypto::derivation_to_scalar(derivation, o, scalar);
+                rct::ecdhTuple ecdh = tx.rct_signatures.ecdhInfo[o];
+                rct::ecdhDecode(ecdh, rct::sk2rct(scalar));
+                // the amount is accepted only if it opens the output commitment
+                if (!rct::equalKeys(rct::commit(rct::h2d(ecdh.amount), ecdh.mask), tx.rct_signatures.outPk[o].mask)) {
+                    MWARNING("Output " << o << " of a tx in block " << height << " has invalid encrypted amount");
+                    break;
+                }
+                amount = rct::h2d(ecdh.amount);
+            }
+            key.found.push_back({height, tx.unlock_time, amount});
+            break;
+        }
+    }
+}
+
+std::list<crypto::hash> FSN_ViewKeyScanner::shortChainHistory(uint64_t from) const
+{
+    //first 10 blocks go sequentially, next in pow(2,n) offsets, the last one is always the genesis
+    std::list<crypto::hash> ids;
+    uint64_t current = std::min<uint64_t>(from, m_block_hashes.size()) - 1;
+    uint64_t step = 1;
+    for (size_t i = 0;; ++i) {
+        ids.push_back(m_block_hashes[current]);
+        if (current == 0)
+            break;
+        if (i >= 10)
+            step *= 2;
+        current = current > step ? current - step : 0;
+    }
+    return ids;
+}
+
+}
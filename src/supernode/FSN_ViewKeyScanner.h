@@ -0,0 +1,140 @@
+// Copyright (c) 2019, The Graft Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#ifndef FSN_VIEWKEYSCANNER_H_
+#define FSN_VIEWKEYSCANNER_H_
+
+#include "supernode_common_struct.h"
+#include "net/http_client.h"
+#include "cryptonote_basic/cryptonote_basic.h"
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/thread.hpp>
+#include <unordered_map>
+#include <chrono>
+#include <list>
+#include <string>
+#include <vector>
+
+namespace supernode {
+
+/*!
+ * \brief The FSN_ViewKeyScanner class - tracks incoming outputs of many (address, view key) accounts.
+ *
+ * Every block is pulled from the daemon once and each transaction key is tried against all
+ * registered view keys at once; matched outputs are kept in a compact in-memory table which is
+ * used for the stake balance checks instead of one view-only wallet per FSN.
+ */
+class FSN_ViewKeyScanner
+{
+public:
+    FSN_ViewKeyScanner(const std::string &daemon_addr, const std::string &daemon_login, const std::string &daemon_pass,
+                       cryptonote::network_type nettype);
+    ~FSN_ViewKeyScanner();
+
+    /*!
+     * \brief AddAccount - registers account, it will be scanned from the genesis on the next refresh
+     * \return           - false if address or view key can't be parsed or don't match
+     */
+    bool AddAccount(const FSN_WalletData &wallet);
+    bool RemoveAccount(const std::string &address);
+    bool HasAccount(const std::string &address) const;
+
+    /*!
+     * \brief UnlockedBalance - sum of incoming outputs of account which are unlocked at block_num
+     * \return                - false if account is not registered
+     */
+    bool UnlockedBalance(const std::string &address, uint64_t block_num, uint64_t &balance) const;
+
+    /*!
+     * \brief Refresh - pulls new blocks from the daemon and scans them for all registered accounts,
+     *                 returns early between batches after Stop()
+     * \return        - false on daemon communication error
+     */
+    bool Refresh();
+
+    //background refresh
+    void Start(std::chrono::milliseconds interval);
+    void Stop();
+
+private:
+    struct received_output
+    {
+        uint64_t height;
+        uint64_t unlock_time;
+        uint64_t amount;
+    };
+
+    struct account
+    {
+        cryptonote::account_public_address address;
+        crypto::secret_key view_key;
+        // next block to scan
+        uint64_t scanned_height;
+        std::vector<received_output> outputs;
+    };
+
+    struct scan_key
+    {
+        std::string address_str;
+        cryptonote::account_public_address address;
+        crypto::secret_key view_key;
+        uint64_t scanned_height;
+        std::vector<received_output> found;
+    };
+
+    bool scanBlocks(uint64_t from, std::vector<scan_key> &keys, uint64_t &reorg_height, bool &done);
+    void scanTransaction(const cryptonote::transaction &tx, uint64_t height, const std::vector<size_t> &active,
+                         std::vector<scan_key> &keys, std::vector<crypto::secret_key> &view_keys,
+                         std::vector<crypto::key_derivation> &derivations) const;
+    std::list<crypto::hash> shortChainHistory(uint64_t from) const;
+    bool stopRequested();
+    void refreshLoop(std::chrono::milliseconds interval);
+
+private:
+    cryptonote::network_type m_nettype;
+    epee::net_utils::http::http_simple_client m_http_client;
+    std::chrono::seconds m_rpc_timeout;
+
+    mutable boost::mutex m_lock;
+    std::unordered_map<std::string, account> m_accounts;
+
+    // guards the refresh state below, only one refresh runs at a time
+    boost::mutex m_refresh_lock;
+    std::vector<crypto::hash> m_block_hashes;
+
+    boost::mutex m_stop_lock;
+    boost::condition_variable m_stop_cond;
+    bool m_stop = false;
+    boost::thread m_thread;
+};
+
+}
+
+#endif /* FSN_VIEWKEYSCANNER_H_ */
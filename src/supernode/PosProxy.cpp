@@ -32,7 +32,6 @@
 
 void supernode::PosProxy::Init() {
     BaseClientProxy::Init();
-    m_Work.Workers(10);
 	m_DAPIServer->ADD_DAPI_HANDLER(Sale, rpc_command::POS_SALE, PosProxy);
 	// TODO: add all other handlers
 }
@@ -54,7 +53,7 @@ bool supernode::PosProxy::Sale(const rpc_command::POS_SALE::request& in, rpc_com
     }
 	Add(data);
 
-	m_Work.Service.post( [data](){
+	data->Post( [data](){
 		data->ContinueInit();
 	} );
 
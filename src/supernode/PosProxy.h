@@ -32,7 +32,6 @@
 
 #include "PosSaleObject.h"
 #include "baseclientproxy.h"
-#include "WorkerPool.h"
 
 namespace supernode {
     class PosProxy : public BaseClientProxy {
@@ -42,10 +41,6 @@ namespace supernode {
 		protected:
 		void Init() override;
 
-
-        protected:
-        WorkerPool m_Work;
-
 	};
 }
 
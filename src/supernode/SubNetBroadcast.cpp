@@ -30,17 +30,11 @@
 #include "SubNetBroadcast.h"
 #include "supernode_helpers.h"
 
-static const unsigned s_MaxNotAvailCount = 4;
-
-supernode::SubNetBroadcast::SubNetBroadcast(unsigned workerThreads)  {
-	m_Work.Workers(workerThreads);
-
-}
+supernode::SubNetBroadcast::SubNetBroadcast() {}
 
 supernode::SubNetBroadcast::~SubNetBroadcast() {
 	for(auto a : m_MyHandlers) m_DAPIServer->RemoveHandler(a);
 	m_MyHandlers.clear();
-	m_Work.Stop();
 }
 
 vector< pair<string, string> > supernode::SubNetBroadcast::Members() {
@@ -84,19 +78,5 @@ void supernode::SubNetBroadcast::Set( DAPI_RPC_Server* pa, string subnet_id, con
 	}
 }
 
-void supernode::SubNetBroadcast::IncNoConnectAndRemove(const string& ip, const string& port) {
-	boost::lock_guard<boost::recursive_mutex> lock(m_MembersGuard);
-	for(unsigned i=0;i<m_Members.size();i++) if( m_Members[i].IP==ip && m_Members[i].Port==port ) {
-		m_Members[i].NotAvailCount++;
-		if( m_Members[i].NotAvailCount>=s_MaxNotAvailCount ) {
-			m_Members.erase( m_Members.begin()+i );
-		}
-		break;
-	}
-
-
-}
-
-
 
 
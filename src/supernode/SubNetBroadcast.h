@@ -32,7 +32,12 @@
 
 #include "supernode_common_struct.h"
 #include <string>
-#include "DAPI_RPC_Client.h"
+#include <atomic>
+#include <future>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/function.hpp>
+#include <boost/thread/mutex.hpp>
+#include "DAPI_RPC_ClientPool.h"
 #include "DAPI_RPC_Server.h"
 #include "WorkerPool.h"
 using namespace std;
@@ -41,9 +46,17 @@ namespace supernode {
 
 	class DAPI_RPC_Server;
 
+	// result of one fan-out call
+	template<class OUT_t>
+	struct SubNetReply {
+		vector<OUT_t> Out;// successful responses, in members order
+		unsigned Members = 0;// number of members the call was sent to
+		bool QuorumReached = false;
+	};
+
 	class SubNetBroadcast {
 		public:
-		SubNetBroadcast(unsigned workerThreads=10);
+		SubNetBroadcast();
 		virtual ~SubNetBroadcast();
 		// all messages will send with subnet_id
 		// and handler will recieve only messages with subnet_id
@@ -56,7 +69,6 @@ namespace supernode {
 			SMember(const string& ip, const string& p) { IP = ip; Port = p; }
 			string IP;
 			string Port;
-			unsigned NotAvailCount = 0;
 		};
 
 		vector< pair<string, string> > Members();//port, ip
@@ -67,64 +79,79 @@ namespace supernode {
 		bool AllowSendSefl = true;
 
 		public:
+		/*!
+		 * \brief SendAsync - sends call to all members, doesn't block
+		 * \param quorum    - number of successful responses needed, 0 means all members
+		 * \param deadline  - reply is completed with responses received so far when it passes
+		 * \param done      - optional callback, called once with the same reply as the future
+		 * \return          - future completed when quorum is reached, all calls finished or deadline passed
+		 */
 		template<class IN_t, class OUT_t>
-		bool Send( const string& method, const IN_t& in, vector<OUT_t>& out, bool reqAllResps=true ) {
-			if(m_SendsCount) throw string("m_SendsCount not zero");
-
-			m_MembersGuard.lock();
-
-			out.resize( m_Members.size() );
-			vector<int> rets;
-			rets.resize( m_Members.size(), 0 );
-			m_SendsCount = m_Members.size();
+		std::future< SubNetReply<OUT_t> > SendAsync( const string& method, const IN_t& in, unsigned quorum, std::chrono::milliseconds deadline,
+				boost::function<void (const SubNetReply<OUT_t>&)> done = boost::function<void (const SubNetReply<OUT_t>&)>() ) {
+			vector<SMember> members;
+			{
+				boost::lock_guard<boost::recursive_mutex> lock(m_MembersGuard);
+				members = m_Members;
+			}
 
+			boost::shared_ptr< SendState<OUT_t> > state( new SendState<OUT_t>(members.size(), quorum, done) );
+			std::future< SubNetReply<OUT_t> > ret = state->Promise.get_future();
+			if( members.empty() ) {
+				state->Complete();
+				return ret;
+			}
 
-			for(unsigned i=0;i<m_Members.size();i++) {
-				OUT_t* outp = &out[i];
-				int* retp = &rets[i];
-				string ip = m_Members[i].IP;
-				string port = m_Members[i].Port;
-				m_Work.Service.post(
-					[this, method, in, outp, retp, ip, port]() {
-					DoCallInThread<IN_t, OUT_t>(method, in, outp, retp, ip, port);
+			WorkerPool& pool = WorkerPool::Instance();
+			state->Timer.reset( new boost::asio::steady_timer(pool.TimerService(), deadline) );
+			state->Timer->async_wait( [state](const boost::system::error_code& ec) {
+				if(!ec) state->Complete();
+			} );
+
+			// calls may outlive this object, so they don't touch it
+			const unsigned retries = RetryCount;
+			const std::chrono::milliseconds timeout = CallTimeout;
+			for(unsigned i=0;i<members.size();i++) {
+				SMember member = members[i];
+				pool.Post(
+					[method, in, state, i, member, retries, timeout]() {
+					OUT_t out;
+					bool ok = DoCall<IN_t, OUT_t>(method, in, out, member, retries, timeout);
+					state->OnResult(i, ok, out);
 				} );
 			}
 
-			m_MembersGuard.unlock();
-
-			while(m_SendsCount) boost::this_thread::sleep_for(boost::chrono::milliseconds(100));
-
-			bool ret = true;
+			return ret;
+		}
 
-			if(reqAllResps) {
-				for(unsigned i=0;i<m_Members.size();i++) if( rets[i]==0 ) {
-					ret = false; break;
-				}
-				if(!ret) out.clear();
-			} else {
-				 vector<OUT_t> vv;
-				 for(unsigned i=0;i<out.size();i++) if( rets[i]!=0 ) vv.push_back( out[i] );
-				 out = vv;
+		template<class IN_t, class OUT_t>
+		bool Send( const string& method, const IN_t& in, vector<OUT_t>& out, bool reqAllResps=true ) {
+			// every call finishes within RetryCount timeouts, deadline is only a safety net
+			std::chrono::milliseconds deadline = CallTimeout*(RetryCount+1);
+			std::future< SubNetReply<OUT_t> > f = SendAsync<IN_t, OUT_t>(method, in, 0, deadline);
+			WorkerPool::Instance().Wait(f);
+			SubNetReply<OUT_t> reply = f.get();
+
+			out = std::move(reply.Out);
+			if(reqAllResps && !reply.QuorumReached) {
+				out.clear();
+				return false;
 			}
-
-			return ret;
+			return true;
 		}
 
 		template<class IN_t>
 		void Send( const string& method, const IN_t& in) {
-			if(m_SendsCount) throw string("m_SendsCount not zero");
-
-			rpc_command::P2P_DUMMY_RESP* outp = &m_DummyOut;
-			int* retp = &m_DummyRet;
-
 			boost::lock_guard<boost::recursive_mutex> lock(m_MembersGuard);
 
+			const unsigned retries = RetryCount;
+			const std::chrono::milliseconds timeout = CallTimeout;
 			for(unsigned i=0;i<m_Members.size();i++) {
-				string ip = m_Members[i].IP;
-				string port = m_Members[i].Port;
-				m_Work.Service.post(
-					[this, method, in, outp, retp, ip, port]() {
-					DoCallInThread<IN_t, rpc_command::P2P_DUMMY_RESP>(method, in, outp, retp, ip, port);
+				SMember member = m_Members[i];
+				WorkerPool::Instance().Post(
+					[method, in, member, retries, timeout]() {
+					rpc_command::P2P_DUMMY_RESP out;
+					DoCall<IN_t, rpc_command::P2P_DUMMY_RESP>(method, in, out, member, retries, timeout);
 				} );
 			}//for
 		}
@@ -137,32 +164,64 @@ namespace supernode {
 		}
 		#define ADD_SUBNET_HANDLER(method, data, class_owner) AddHandler<data::request, data::response>( dapi_call::method, bind( &class_owner::method, this, _1, _2) );
 
-		public:
+		protected:
 		template<class IN_t, class OUT_t>
-		void DoCallInThread(string method, const IN_t in, OUT_t* outo, int* ret, string ip, string port) {
-			bool localcOk = false;
-			bool wasNoConnect = false;
-			for(unsigned k=0;k<RetryCount;k++) {
-				DAPI_RPC_Client client;
-				client.Set( ip, port );
-				if( !client.Invoke<IN_t, OUT_t>(method, in, *outo, CallTimeout) ) {
-					wasNoConnect = wasNoConnect || !client.WasConnected;
-					boost::this_thread::sleep_for(boost::chrono::milliseconds(10));
-					continue;
-				}
-				localcOk = true;
-				break;
+		static bool DoCall(const string& method, const IN_t& in, OUT_t& out, const SMember& member, unsigned retries, std::chrono::milliseconds timeout) {
+			// unavailable members are skipped by the pool circuit breaker without connecting
+			DAPI_RPC_ClientPool& pool = DAPI_RPC_ClientPool::Instance();
+			for(unsigned k=0;k<retries;k++) {
+				if(k) boost::this_thread::sleep_for(boost::chrono::milliseconds(10));
+				if( pool.Invoke<IN_t, OUT_t>(member.IP, member.Port, method, in, out, timeout) ) return true;
 			}//for K
-			*ret = localcOk?1:0;
-			if(!localcOk && wasNoConnect) IncNoConnectAndRemove(ip, port);
-
-			if(m_SendsCount) m_SendsCount--;
+			return false;
 		}//do work
 
+		template<class OUT_t>
+		struct SendState {
+			SendState(size_t members, unsigned quorum, boost::function<void (const SubNetReply<OUT_t>&)> done)
+				: Out(members), Ok(members, 0), Quorum(quorum ? std::min<size_t>(quorum, members) : members), Callback(done) {}
+
+			void OnResult(unsigned i, bool ok, OUT_t& out) {
+				if(ok) {
+					{
+						boost::lock_guard<boost::mutex> lock(Guard);
+						Out[i] = std::move(out);
+						Ok[i] = 1;
+					}
+					if( ++Succeeded>=Quorum ) Complete();
+				}
+				if( ++Finished==Out.size() ) Complete();
+			}
+
+			void Complete() {
+				if( Done.exchange(true) ) return;
+				if(Timer) Timer->cancel();
+
+				SubNetReply<OUT_t> reply;
+				{
+					boost::lock_guard<boost::mutex> lock(Guard);
+					for(unsigned i=0;i<Out.size();i++) if( Ok[i] ) reply.Out.push_back( Out[i] );
+				}
+				reply.Members = Out.size();
+				reply.QuorumReached = reply.Out.size()>=Quorum;
+				if(Callback) Callback(reply);
+				Promise.set_value( std::move(reply) );
+			}
+
+			boost::mutex Guard;
+			vector<OUT_t> Out;
+			vector<char> Ok;
+			const size_t Quorum;
+			std::atomic<unsigned> Succeeded{0};
+			std::atomic<unsigned> Finished{0};
+			std::atomic<bool> Done{false};
+			boost::function<void (const SubNetReply<OUT_t>&)> Callback;
+			boost::shared_ptr<boost::asio::steady_timer> Timer;
+			std::promise< SubNetReply<OUT_t> > Promise;
+		};
 
 		protected:
 		void _AddMember(const string& ip, const string& port);
-		void IncNoConnectAndRemove(const string& ip, const string& port);
 
 		protected:
 		DAPI_RPC_Server* m_DAPIServer = nullptr;
@@ -171,16 +230,6 @@ namespace supernode {
 		string m_PaymentID;
 		vector<int> m_MyHandlers;
 
-		protected:
-		int m_SendsCount = 0;
-	    WorkerPool m_Work;
-
-		protected:
-		rpc_command::P2P_DUMMY_RESP m_DummyOut;
-		int m_DummyRet=0;
-
-
-
 };
 
 
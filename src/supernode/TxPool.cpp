@@ -33,11 +33,103 @@
 #include "cryptonote_basic/cryptonote_format_utils.h"
 
 #include <exception>
+#include <future>
 
 using namespace std;
 
 namespace supernode {
 
+class TxPool::cache
+{
+public:
+    size_t max_txs = 4096;
+    std::chrono::milliseconds negative_ttl = std::chrono::seconds(2);
+    std::chrono::milliseconds pool_ttl = std::chrono::seconds(2);
+
+    struct slot
+    {
+        crypto::hash hash;
+        tx_entry_ptr entry;
+        // pool membership is rechecked after this time
+        std::chrono::steady_clock::time_point expires;
+    };
+
+    boost::mutex lock;
+    // most recently used first
+    std::list<slot> lru;
+    std::unordered_map<crypto::hash, std::list<slot>::iterator> entries;
+    // hashes the daemon doesn't know, until expiration time
+    std::unordered_map<crypto::hash, std::chrono::steady_clock::time_point> missing;
+    // lookups in progress, other callers wait for them instead of asking the daemon again
+    std::unordered_map<crypto::hash, std::shared_future<tx_entry_ptr>> inflight;
+
+    // on a stale hit the parsed transaction is returned in tx, only pool membership has to be fetched again
+    bool find(const crypto::hash &hash, tx_entry_ptr &entry, tx_ptr &tx)
+    {
+        const auto now = std::chrono::steady_clock::now();
+        auto it = entries.find(hash);
+        if (it != entries.end()) {
+            lru.splice(lru.begin(), lru, it->second);
+            if (now < it->second->expires) {
+                entry = it->second->entry;
+                return true;
+            }
+            tx = it->second->entry->tx;
+            return false;
+        }
+        auto m = missing.find(hash);
+        if (m != missing.end()) {
+            if (now < m->second) {
+                entry.reset();
+                return true;
+            }
+            missing.erase(m);
+        }
+        return false;
+    }
+
+    void put(const crypto::hash &hash, const tx_entry_ptr &entry)
+    {
+        const auto now = std::chrono::steady_clock::now();
+        if (!entry) {
+            entries_erase(hash);
+            if (missing.size() >= max_txs) {
+                for (auto it = missing.begin(); it != missing.end();)
+                    it = now < it->second ? std::next(it) : missing.erase(it);
+                if (missing.size() >= max_txs)
+                    missing.clear();
+            }
+            missing[hash] = now + negative_ttl;
+            return;
+        }
+
+        missing.erase(hash);
+        auto it = entries.find(hash);
+        if (it != entries.end()) {
+            it->second->entry = entry;
+            it->second->expires = now + pool_ttl;
+            lru.splice(lru.begin(), lru, it->second);
+            return;
+        }
+        lru.push_front(slot{hash, entry, now + pool_ttl});
+        entries[hash] = lru.begin();
+        while (entries.size() > max_txs) {
+            entries.erase(lru.back().hash);
+            lru.pop_back();
+        }
+    }
+
+private:
+    void entries_erase(const crypto::hash &hash)
+    {
+        auto it = entries.find(hash);
+        if (it != entries.end()) {
+            lru.erase(it->second);
+            entries.erase(it);
+        }
+    }
+};
+
 TxPool::TxPool(const std::string &daemon_addr, const std::string &daemon_login, const std::string &daemon_pass)
   : m_rpc_timeout(std::chrono::seconds(30))
 {
@@ -58,6 +150,21 @@ TxPool::~TxPool()
 
 }
 
+TxPool::cache &TxPool::sharedCache()
+{
+    static cache c;
+    return c;
+}
+
+void TxPool::setCacheLimits(size_t max_txs, std::chrono::milliseconds negative_ttl, std::chrono::milliseconds pool_ttl)
+{
+    cache &c = sharedCache();
+    boost::lock_guard<boost::mutex> lock(c.lock);
+    c.max_txs = std::max<size_t>(max_txs, 1);
+    c.negative_ttl = negative_ttl;
+    c.pool_ttl = pool_ttl;
+}
+
 bool TxPool::get(const string &hash_str, cryptonote::transaction &out_tx)
 {
     crypto::hash hash;
@@ -66,56 +173,129 @@ bool TxPool::get(const string &hash_str, cryptonote::transaction &out_tx)
         return false;
     }
 
-    // get the pool state
-    cryptonote::COMMAND_RPC_GET_TRANSACTION_POOL_HASHES_BIN::request req;
-    cryptonote::COMMAND_RPC_GET_TRANSACTION_POOL_HASHES_BIN::response res;
-
-    bool r = epee::net_utils::invoke_http_json("/get_transaction_pool_hashes.bin", req, res, m_http_client, m_rpc_timeout);
-    if (!r) {
-        LOG_ERROR("/get_transaction_pool_hashes.bin error");
-        return r;
-    }
+    std::unordered_map<crypto::hash, cryptonote::transaction> txs;
+    if (!get(std::vector<crypto::hash>{hash}, txs))
+        return false;
 
-    MDEBUG("got pool");
-    const auto it = std::find(res.tx_hashes.begin(), res.tx_hashes.end(), hash);
-    if (it == res.tx_hashes.end()) {
+    auto it = txs.find(hash);
+    if (it == txs.end()) {
        MWARNING("tx: " << hash_str << " was not found in pool");
        return false;
     }
+    out_tx = std::move(it->second);
+    return true;
+}
 
-    // get full tx
-    cryptonote::COMMAND_RPC_GET_TRANSACTIONS::request req_tx;
-    cryptonote::COMMAND_RPC_GET_TRANSACTIONS::response res_tx;
-    req_tx.txs_hashes.push_back(hash_str);
-
-    req_tx.decode_as_json = false;
-    r = epee::net_utils::invoke_http_json("/gettransactions", req_tx, res_tx, m_http_client, m_rpc_timeout);
-    if (!r && res.status != CORE_RPC_STATUS_OK) {
-        LOG_ERROR("/getransactions error");
-        return false;
+bool TxPool::get(const std::vector<crypto::hash> &hashes, std::unordered_map<crypto::hash, cryptonote::transaction> &out_txs)
+{
+    cache &c = sharedCache();
+    std::vector<std::pair<crypto::hash, tx_entry_ptr>> hits;
+    std::vector<std::pair<crypto::hash, std::shared_future<tx_entry_ptr>>> waits;
+    std::unordered_map<crypto::hash, std::promise<tx_entry_ptr>> promises;
+    std::vector<crypto::hash> to_fetch;
+    std::unordered_map<crypto::hash, tx_ptr> parsed;
+    {
+        boost::lock_guard<boost::mutex> lock(c.lock);
+        for (const crypto::hash &hash : hashes) {
+            tx_entry_ptr entry;
+            tx_ptr tx;
+            if (c.find(hash, entry, tx)) {
+                hits.emplace_back(hash, entry);
+                continue;
+            }
+            auto it = c.inflight.find(hash);
+            if (it != c.inflight.end()) {
+                waits.emplace_back(hash, it->second);
+                continue;
+            }
+            if (promises.count(hash))
+                continue;
+            c.inflight.emplace(hash, promises[hash].get_future().share());
+            to_fetch.push_back(hash);
+            if (tx)
+                parsed[hash] = tx;
+        }
     }
 
-    // parse transaction
-    if (res_tx.txs.size() != 1) {
-        LOG_ERROR("Wrong number of tx returned: " << res_tx.txs.size());
-        return false;
-    }
+    auto take = [&out_txs](const crypto::hash &hash, const tx_entry_ptr &entry) {
+        if (entry && entry->in_pool)
+            out_txs[hash] = *entry->tx;
+    };
 
-    cryptonote::blobdata bd;
-    crypto::hash tx_hash, tx_prefix_hash;
-    if (!epee::string_tools::parse_hexstr_to_binbuff(res_tx.txs[0].as_hex, bd)) {
-        LOG_ERROR("failed to parse tx from hex");
-        return false;
+    for (const auto &hit : hits)
+        take(hit.first, hit.second);
+
+    bool result = true;
+    if (!to_fetch.empty()) {
+        std::unordered_map<crypto::hash, tx_entry_ptr> fetched;
+        try {
+            result = fetch(to_fetch, parsed, fetched);
+        } catch (const std::exception &e) {
+            LOG_ERROR("/get_transactions.bin error: " << e.what());
+            result = false;
+        }
+        if (!result)
+            fetched.clear();
+
+        {
+            boost::lock_guard<boost::mutex> lock(c.lock);
+            for (const crypto::hash &hash : to_fetch) {
+                // failed lookups are not cached, the next caller asks the daemon again
+                if (result)
+                    c.put(hash, fetched[hash]);
+                c.inflight.erase(hash);
+            }
+        }
+        for (const crypto::hash &hash : to_fetch) {
+            const tx_entry_ptr &entry = fetched[hash];
+            promises[hash].set_value(entry);
+            take(hash, entry);
+        }
     }
 
-    if (!cryptonote::parse_and_validate_tx_from_blob(bd, out_tx, tx_hash, tx_prefix_hash)) {
-        LOG_ERROR("failed to parse tx from blob");
+    for (auto &wait : waits)
+        take(wait.first, wait.second.get());
+
+    return result;
+}
+
+bool TxPool::fetch(const std::vector<crypto::hash> &hashes, const std::unordered_map<crypto::hash, tx_ptr> &parsed,
+                   std::unordered_map<crypto::hash, tx_entry_ptr> &out)
+{
+    cryptonote::COMMAND_RPC_GET_TRANSACTIONS_BIN::request req;
+    cryptonote::COMMAND_RPC_GET_TRANSACTIONS_BIN::response res;
+    req.txs_hashes = hashes;
+    req.prune = false;
+
+    bool r = epee::net_utils::invoke_http_bin("/get_transactions.bin", req, res, m_http_client, m_rpc_timeout);
+    if (!r || res.status != CORE_RPC_STATUS_OK) {
+        LOG_ERROR("/get_transactions.bin error");
         return false;
     }
+    MDEBUG("got " << res.txs.size() << " of " << hashes.size() << " transactions");
 
-    if (hash != tx_hash) {
-        LOG_ERROR("wrong tx received from daemon");
-        return false;
+    for (const auto &e : res.txs) {
+        boost::shared_ptr<tx_entry> entry(new tx_entry());
+        entry->in_pool = e.in_pool;
+        auto it = parsed.find(e.tx_hash);
+        if (it != parsed.end()) {
+            // already parsed and checked against its hash, only pool membership is refreshed
+            entry->tx = it->second;
+            out[e.tx_hash] = entry;
+            continue;
+        }
+        boost::shared_ptr<cryptonote::transaction> tx(new cryptonote::transaction());
+        crypto::hash tx_hash, tx_prefix_hash;
+        if (!cryptonote::parse_and_validate_tx_from_blob(e.tx_blob, *tx, tx_hash, tx_prefix_hash)) {
+            LOG_ERROR("failed to parse tx from blob");
+            return false;
+        }
+        if (tx_hash != e.tx_hash) {
+            LOG_ERROR("wrong tx received from daemon");
+            return false;
+        }
+        entry->tx = tx;
+        out[tx_hash] = entry;
     }
     return true;
 }
@@ -123,7 +303,6 @@ bool TxPool::get(const string &hash_str, cryptonote::transaction &out_tx)
 bool TxPool::init(const string &daemon_address, boost::optional<epee::net_utils::http::login> daemon_login)
 {
     return m_http_client.set_server(daemon_address, daemon_login);
-    return false;
 }
 
 } // namespace
@@ -33,7 +33,11 @@
 #include <string>
 #include <vector>
 #include <chrono>
+#include <list>
+#include <unordered_map>
 #include <boost/optional.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
 
 #include "net/http_client.h"
 #include "net/http_auth.h"
@@ -42,17 +46,54 @@
 
 namespace supernode {
 
+/*!
+ * \brief The TxPool class - access to transactions of daemon's pool.
+ *
+ * Parsed transactions are kept in a process-wide LRU cache shared by all TxPool objects. Pool membership of a
+ * cached transaction and missing hashes are remembered for a short time only. Concurrent lookups of the same hash wait for one daemon call, cache misses are
+ * fetched in one /get_transactions.bin call.
+ */
 class TxPool
 {
 public:
     TxPool(const std::string &daemon_addr, const std::string &daemon_login, const std::string &daemon_pass);
     virtual ~TxPool();
     bool get(const std::string &hash_str, cryptonote::transaction &out_tx);
+    /*!
+     * \brief get     - looks up many transactions at once
+     * \param hashes  - transaction hashes
+     * \param out_txs - transactions found in pool
+     * \return        - false on daemon communication error
+     */
+    bool get(const std::vector<crypto::hash> &hashes, std::unordered_map<crypto::hash, cryptonote::transaction> &out_txs);
+
+    static void setCacheLimits(size_t max_txs, std::chrono::milliseconds negative_ttl,
+                               std::chrono::milliseconds pool_ttl = std::chrono::seconds(2));
 
 
 protected:
     bool init(const std::string &daemon_address, boost::optional<epee::net_utils::http::login> daemon_login);
 
+    typedef boost::shared_ptr<const cryptonote::transaction> tx_ptr;
+    struct tx_entry
+    {
+        tx_ptr tx;
+        bool in_pool;
+    };
+    // null means transaction is not known to the daemon
+    typedef boost::shared_ptr<const tx_entry> tx_entry_ptr;
+
+    /*!
+     * \brief fetch   - asks the daemon for cache misses, unknown hashes are left out of \p out
+     * \param parsed  - transactions already parsed by earlier lookups, only their pool membership is needed
+     * \return        - false on daemon communication error
+     */
+    virtual bool fetch(const std::vector<crypto::hash> &hashes, const std::unordered_map<crypto::hash, tx_ptr> &parsed,
+                       std::unordered_map<crypto::hash, tx_entry_ptr> &out);
+
+private:
+    class cache;
+    static cache &sharedCache();
 
 private:
     epee::net_utils::http::http_simple_client m_http_client;
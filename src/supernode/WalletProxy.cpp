@@ -32,7 +32,6 @@
 
 void supernode::WalletProxy::Init() {
     BaseClientProxy::Init();
-    m_Work.Workers(10);
 	m_DAPIServer->ADD_DAPI_HANDLER(Pay, rpc_command::WALLET_PAY, WalletProxy);
 	m_DAPIServer->ADD_DAPI_HANDLER(WalletGetPosData, rpc_command::WALLET_GET_POS_DATA, WalletProxy);
 	m_DAPIServer->ADD_DAPI_HANDLER(WalletRejectPay, rpc_command::WALLET_REJECT_PAY, WalletProxy);
@@ -58,7 +57,7 @@ bool supernode::WalletProxy::Pay(const rpc_command::WALLET_PAY::request& in, rpc
 	data->BeforStart();
 	Add(data);
 
-	m_Work.Service.post( [data, in](){
+	data->Post( [data, in](){
 	    if (!data->Init(in)) {
 	        LOG_ERROR("Failed to init WalletPayObject");
 	        return;
@@ -76,7 +75,5 @@ bool supernode::WalletProxy::WalletGetPosData(const rpc_command::WALLET_GET_POS_
 
 	boost::shared_ptr<FSN_Data> data = *vv.begin();
 
-	DAPI_RPC_Client call;
-	call.Set(data->IP, data->Port);
-	return call.Invoke(dapi_call::WalletProxyGetPosData, in, out);
+	return DAPI_RPC_ClientPool::Instance().Invoke(data->IP, data->Port, dapi_call::WalletProxyGetPosData, in, out);
 }
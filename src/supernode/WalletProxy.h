@@ -33,7 +33,6 @@
 
 #include "WalletPayObject.h"
 #include "baseclientproxy.h"
-#include "WorkerPool.h"
 
 class WalletProxyTest_SendTx_Test;
 
@@ -49,9 +48,6 @@ namespace supernode {
         void Init() override;
         friend class ::WalletProxyTest_SendTx_Test;
 
-        protected:
-        WorkerPool m_Work;
-
 	};
 }
 
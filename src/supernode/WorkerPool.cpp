@@ -6,22 +6,159 @@
  */
 
 #include <supernode/WorkerPool.h>
+#include <algorithm>
 
 namespace supernode {
 
-WorkerPool::WorkerPool() : Work(Service) {
+namespace {
+	unsigned s_Threads = 32;
+	size_t s_QueueLimit = 1024;
+
+	// pool and queue index of the current thread, if it is a pool thread
+	thread_local WorkerPool* t_Pool = nullptr;
+	thread_local unsigned t_Queue = 0;
 }
 
+WorkerPool& WorkerPool::Instance() {
+	static WorkerPool pool(s_Threads, s_QueueLimit);
+	return pool;
+}
 
-void WorkerPool::Workers(int cnt) {
-	for(int i=0;i<cnt;i++) {
-		Threadpool.create_thread( boost::bind(&boost::asio::io_service::run, &Service) );
-	}
+void WorkerPool::Configure(unsigned threads, size_t queueLimit) {
+	s_Threads = threads;
+	s_QueueLimit = queueLimit;
+}
+
+WorkerPool::WorkerPool(unsigned threads, size_t queueLimit) : QueueLimit(queueLimit) {
+	threads = std::max(threads, 1u);
+	for(unsigned i=0;i<threads;i++) m_Queues.emplace_back( new SQueue() );
+	for(unsigned i=0;i<threads;i++) m_Threads.create_thread( boost::bind(&WorkerPool::Run, this, i) );
+
+	m_TimerWork.reset( new boost::asio::io_service::work(m_TimerService) );
+	m_TimerThread = boost::thread( [this]() { m_TimerService.run(); } );
 }
 
+WorkerPool::~WorkerPool() { Stop(); }
+
 void WorkerPool::Stop() {
-	Service.stop();
-	Threadpool.join_all();
+	{
+		boost::lock_guard<boost::mutex> lock(m_SleepGuard);
+		if(m_Stop) return;
+		m_Stop = true;
+	}
+	m_Wakeup.notify_all();
+	m_Threads.join_all();
+
+	m_TimerWork.reset();
+	m_TimerService.stop();
+	if( m_TimerThread.joinable() ) m_TimerThread.join();
+}
+
+bool WorkerPool::TryPost(Task task) {
+	if( Overloaded() ) return false;
+	Push( std::move(task) );
+	return true;
+}
+
+void WorkerPool::Post(Task task) { Push( std::move(task) ); }
+
+bool WorkerPool::OnPoolThread() const { return t_Pool==this; }
+
+bool WorkerPool::Overloaded() const { return m_Pending>=QueueLimit; }
+
+size_t WorkerPool::Pending() const { return m_Pending; }
+
+unsigned WorkerPool::Threads() const { return m_Queues.size(); }
+
+boost::asio::io_service& WorkerPool::TimerService() { return m_TimerService; }
+
+void WorkerPool::Push(Task&& task) {
+	// pool threads keep their follow-up work local, others spread it round robin
+	unsigned idx = t_Pool==this ? t_Queue : m_Next++ % m_Queues.size();
+	{
+		// counted under the queue lock, so Pop never decrements before the increment
+		SQueue& q = *m_Queues[idx];
+		boost::lock_guard<boost::mutex> lock(q.Guard);
+		q.Tasks.push_back( std::move(task) );
+		m_Pending++;
+	}
+	// a thread that just saw m_Pending==0 is waiting before the notification
+	{ boost::lock_guard<boost::mutex> lock(m_SleepGuard); }
+	m_Wakeup.notify_one();
+}
+
+bool WorkerPool::Pop(unsigned self, Task& task) {
+	// own queue from the front, the others from the back
+	for(unsigned k=0;k<m_Queues.size();k++) {
+		SQueue& q = *m_Queues[ (self+k) % m_Queues.size() ];
+		boost::lock_guard<boost::mutex> lock(q.Guard);
+		if( q.Tasks.empty() ) continue;
+		if(k==0) {
+			task = std::move( q.Tasks.front() );
+			q.Tasks.pop_front();
+		} else {
+			task = std::move( q.Tasks.back() );
+			q.Tasks.pop_back();
+		}
+		m_Pending--;
+		return true;
+	}
+	return false;
+}
+
+bool WorkerPool::RunOne() {
+	Task task;
+	if( !Pop(t_Queue, task) ) return false;
+	task();
+	return true;
+}
+
+void WorkerPool::Run(unsigned self) {
+	t_Pool = this;
+	t_Queue = self;
+	while(true) {
+		Task task;
+		if( Pop(self, task) ) {
+			task();
+			continue;
+		}
+
+		boost::unique_lock<boost::mutex> lock(m_SleepGuard);
+		while( !m_Stop && m_Pending==0 ) m_Wakeup.wait(lock);
+		if(m_Stop) return;
+	}
+}
+
+WorkerPool::Strand::Strand(WorkerPool& pool) : m_Pool(pool), m_State( new SState() ) {}
+
+void WorkerPool::Strand::Post(Task task) {
+	{
+		boost::lock_guard<boost::mutex> lock(m_State->Guard);
+		m_State->Tasks.push_back( std::move(task) );
+		if(m_State->Running) return;
+		m_State->Running = true;
+	}
+	WorkerPool* pool = &m_Pool;
+	boost::shared_ptr<SState> state = m_State;
+	m_Pool.Post( [pool, state]() { Drain(pool, state); } );
+}
+
+void WorkerPool::Strand::Drain(WorkerPool* pool, boost::shared_ptr<SState> state) {
+	Task task;
+	{
+		boost::lock_guard<boost::mutex> lock(state->Guard);
+		task = std::move( state->Tasks.front() );
+		state->Tasks.pop_front();
+	}
+	task();
+
+	// one task per turn, so a busy payment doesn't hold a thread
+	boost::lock_guard<boost::mutex> lock(state->Guard);
+	if( state->Tasks.empty() ) {
+		state->Running = false;
+		return;
+	}
+	pool->Post( [pool, state]() { Drain(pool, state); } );
 }
 
 } /* namespace supernode */
@@ -32,26 +32,111 @@
 
 #include <boost/asio/io_service.hpp>
 #include <boost/bind.hpp>
+#include <boost/function.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
 #include <boost/thread/thread.hpp>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <future>
+#include <memory>
+#include <vector>
 
 
 namespace supernode {
 
+/*!
+ * \brief The WorkerPool class - process-wide executor shared by all supernode objects
+ *
+ * Fixed number of threads, each with its own task queue; idle threads steal tasks from the others.
+ * Tasks may block on DAPI calls, so the pool is sized for blocking work, not for CPU count.
+ * QueueLimit bounds the number of waiting tasks: TryPost fails and DAPI server answers 503 above it.
+ */
 class WorkerPool {
 public:
-	WorkerPool();
-	void Workers(int cnt);
+	typedef boost::function<void ()> Task;
+
+	static WorkerPool& Instance();
+	// sets up process-wide pool, must be called before first Instance() call
+	static void Configure(unsigned threads, size_t queueLimit);
+
+	WorkerPool(unsigned threads, size_t queueLimit);
+	~WorkerPool();
+
+	// queues task, fails when QueueLimit tasks are already waiting
+	bool TryPost(Task task);
+	// queues task regardless of QueueLimit, for work of already accepted requests
+	void Post(Task task);
+	// blocks until future is ready; a pool thread runs queued tasks meanwhile,
+	// so callers waiting for their own fan-out can't starve the pool
+	template<class T>
+	void Wait(const std::future<T>& f) {
+		if( !OnPoolThread() ) {
+			f.wait();
+			return;
+		}
+		while( f.wait_for(std::chrono::seconds(0))!=std::future_status::ready ) {
+			if( !RunOne() ) f.wait_for(std::chrono::milliseconds(1));
+		}
+	}
+	bool OnPoolThread() const;
+	bool Overloaded() const;
+	size_t Pending() const;
+	unsigned Threads() const;
+	// for timers only, handlers must not block
+	boost::asio::io_service& TimerService();
 	void Stop();
 
+	// tasks posted to one strand run one at a time in posting order, on any pool thread
+	class Strand {
+	public:
+		explicit Strand(WorkerPool& pool = WorkerPool::Instance());
+		void Post(Task task);
+
+	protected:
+		struct SState {
+			boost::mutex Guard;
+			std::deque<Task> Tasks;
+			bool Running = false;
+		};
+		static void Drain(WorkerPool* pool, boost::shared_ptr<SState> state);
+
+	protected:
+		WorkerPool& m_Pool;
+		boost::shared_ptr<SState> m_State;
+	};
+
 public:
-    boost::asio::io_service Service;
-    boost::thread_group Threadpool;
-    boost::asio::io_service::work Work;
+	const size_t QueueLimit;
+
+protected:
+	struct SQueue {
+		boost::mutex Guard;
+		std::deque<Task> Tasks;
+	};
+
+	void Push(Task&& task);
+	bool Pop(unsigned self, Task& task);
+	bool RunOne();
+	void Run(unsigned self);
+
+protected:
+	std::vector< std::unique_ptr<SQueue> > m_Queues;
+	boost::thread_group m_Threads;
+	std::atomic<size_t> m_Pending{0};
+	std::atomic<unsigned> m_Next{0};
+	boost::mutex m_SleepGuard;
+	boost::condition_variable m_Wakeup;
+	bool m_Stop = false;
+
+	boost::asio::io_service m_TimerService;
+	std::unique_ptr<boost::asio::io_service::work> m_TimerWork;
+	boost::thread m_TimerThread;
 
 };
 
 }
 
 #endif
-
-
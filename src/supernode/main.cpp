@@ -91,6 +91,7 @@ int main(int argc, const char** argv) {
 	// -------------------------------- DAPI -------------------------------------------
 	const boost::property_tree::ptree& dapi_conf = config.get_child("dapi");
 	supernode::rpc_command::SetDAPIVersion( dapi_conf.get<string>("version") );
+	supernode::WorkerPool::Configure( dapi_conf.get<unsigned>("workers", 32), dapi_conf.get<size_t>("queue_limit", 1024) );
 	supernode::DAPI_RPC_Server dapi_server;
 	dapi_server.Set( dapi_conf.get<string>("ip"), dapi_conf.get<string>("port"), dapi_conf.get<int>("threads") );
 
@@ -0,0 +1,263 @@
+// Copyright (c) 2019, The Graft Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include <cstring>
+#include "chacha20_poly1305.h"
+#include "memwipe.h"
+
+namespace {
+
+inline uint32_t load32(const uint8_t* p)
+{
+    return uint32_t(p[0]) | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16) | (uint32_t(p[3]) << 24);
+}
+
+inline void store32(uint8_t* p, uint32_t v)
+{
+    p[0] = uint8_t(v); p[1] = uint8_t(v >> 8); p[2] = uint8_t(v >> 16); p[3] = uint8_t(v >> 24);
+}
+
+inline uint32_t rotl32(uint32_t v, int n)
+{
+    return (v << n) | (v >> (32 - n));
+}
+
+#define QUARTERROUND(a, b, c, d) \
+    a += b; d = rotl32(d ^ a, 16); \
+    c += d; b = rotl32(b ^ c, 12); \
+    a += b; d = rotl32(d ^ a, 8);  \
+    c += d; b = rotl32(b ^ c, 7)
+
+//one 64 byte block of IETF ChaCha20 key stream (32 bit counter, 96 bit nonce)
+void chacha20Block(const uint8_t* key, uint32_t counter, const uint8_t* nonce, uint8_t* out)
+{
+    uint32_t in[16] = {0x61707865, 0x3320646e, 0x79622d32, 0x6b206574};
+    for(int i = 0; i < 8; ++i)
+        in[4 + i] = load32(key + 4 * i);
+    in[12] = counter;
+    for(int i = 0; i < 3; ++i)
+        in[13 + i] = load32(nonce + 4 * i);
+
+    uint32_t x[16];
+    memcpy(x, in, sizeof(x));
+    for(int i = 0; i < 10; ++i)
+    {
+        QUARTERROUND(x[0], x[4], x[8],  x[12]);
+        QUARTERROUND(x[1], x[5], x[9],  x[13]);
+        QUARTERROUND(x[2], x[6], x[10], x[14]);
+        QUARTERROUND(x[3], x[7], x[11], x[15]);
+        QUARTERROUND(x[0], x[5], x[10], x[15]);
+        QUARTERROUND(x[1], x[6], x[11], x[12]);
+        QUARTERROUND(x[2], x[7], x[8],  x[13]);
+        QUARTERROUND(x[3], x[4], x[9],  x[14]);
+    }
+    for(int i = 0; i < 16; ++i)
+        store32(out + 4 * i, x[i] + in[i]);
+
+    memwipe(x, sizeof(x));
+    memwipe(in, sizeof(in));
+}
+
+#undef QUARTERROUND
+
+//xors data with the key stream starting from block 1, block 0 is the Poly1305 key
+void chacha20Xor(const uint8_t* key, const uint8_t* nonce, const uint8_t* in, size_t size, uint8_t* out)
+{
+    uint8_t block[64];
+    for(uint32_t counter = 1; size; ++counter)
+    {
+        chacha20Block(key, counter, nonce, block);
+        size_t n = size < sizeof(block) ? size : sizeof(block);
+        for(size_t i = 0; i < n; ++i)
+            out[i] = in[i] ^ block[i];
+        in += n;
+        out += n;
+        size -= n;
+    }
+    memwipe(block, sizeof(block));
+}
+
+//Poly1305 with 26 bit limbs; the AEAD construction pads every part to 16 bytes, so only full blocks are fed
+class Poly1305
+{
+public:
+    explicit Poly1305(const uint8_t* key)
+    {
+        r[0] = load32(key + 0) & 0x3ffffff;
+        r[1] = (load32(key + 3) >> 2) & 0x3ffff03;
+        r[2] = (load32(key + 6) >> 4) & 0x3ffc0ff;
+        r[3] = (load32(key + 9) >> 6) & 0x3f03fff;
+        r[4] = (load32(key + 12) >> 8) & 0x00fffff;
+        for(int i = 0; i < 5; ++i)
+            h[i] = 0;
+        for(int i = 0; i < 4; ++i)
+            pad[i] = load32(key + 16 + 4 * i);
+    }
+
+    ~Poly1305()
+    {
+        memwipe(r, sizeof(r));
+        memwipe(h, sizeof(h));
+        memwipe(pad, sizeof(pad));
+    }
+
+    //feeds data zero padded to a multiple of 16 bytes
+    void updatePadded(const uint8_t* data, size_t size)
+    {
+        for(; size >= 16; data += 16, size -= 16)
+            block(data);
+        if(size)
+        {
+            uint8_t last[16] = {0};
+            memcpy(last, data, size);
+            block(last);
+        }
+    }
+
+    void finish(uint8_t* mac)
+    {
+        const uint32_t mask = 0x3ffffff;
+        uint32_t h0 = h[0], h1 = h[1], h2 = h[2], h3 = h[3], h4 = h[4], c;
+
+        c = h1 >> 26; h1 &= mask; h2 += c;
+        c = h2 >> 26; h2 &= mask; h3 += c;
+        c = h3 >> 26; h3 &= mask; h4 += c;
+        c = h4 >> 26; h4 &= mask; h0 += c * 5;
+        c = h0 >> 26; h0 &= mask; h1 += c;
+
+        //g = h - p, used if h >= p
+        uint32_t g0 = h0 + 5; c = g0 >> 26; g0 &= mask;
+        uint32_t g1 = h1 + c; c = g1 >> 26; g1 &= mask;
+        uint32_t g2 = h2 + c; c = g2 >> 26; g2 &= mask;
+        uint32_t g3 = h3 + c; c = g3 >> 26; g3 &= mask;
+        uint32_t g4 = h4 + c - (1u << 26);
+
+        uint32_t select = (g4 >> 31) - 1;
+        h0 = (h0 & ~select) | (g0 & select);
+        h1 = (h1 & ~select) | (g1 & select);
+        h2 = (h2 & ~select) | (g2 & select);
+        h3 = (h3 & ~select) | (g3 & select);
+        h4 = (h4 & ~select) | (g4 & select);
+
+        uint32_t w0 = h0 | (h1 << 26);
+        uint32_t w1 = (h1 >> 6) | (h2 << 20);
+        uint32_t w2 = (h2 >> 12) | (h3 << 14);
+        uint32_t w3 = (h3 >> 18) | (h4 << 8);
+
+        uint64_t f = uint64_t(w0) + pad[0];              store32(mac + 0, uint32_t(f));
+        f = uint64_t(w1) + pad[1] + (f >> 32);           store32(mac + 4, uint32_t(f));
+        f = uint64_t(w2) + pad[2] + (f >> 32);           store32(mac + 8, uint32_t(f));
+        f = uint64_t(w3) + pad[3] + (f >> 32);           store32(mac + 12, uint32_t(f));
+    }
+
+private:
+    void block(const uint8_t* m)
+    {
+        const uint32_t mask = 0x3ffffff;
+        const uint32_t s1 = r[1] * 5, s2 = r[2] * 5, s3 = r[3] * 5, s4 = r[4] * 5;
+
+        uint64_t h0 = h[0] + (load32(m + 0) & mask);
+        uint64_t h1 = h[1] + ((load32(m + 3) >> 2) & mask);
+        uint64_t h2 = h[2] + ((load32(m + 6) >> 4) & mask);
+        uint64_t h3 = h[3] + ((load32(m + 9) >> 6) & mask);
+        uint64_t h4 = h[4] + ((load32(m + 12) >> 8) | (1u << 24));
+
+        uint64_t d0 = h0 * r[0] + h1 * s4 + h2 * s3 + h3 * s2 + h4 * s1;
+        uint64_t d1 = h0 * r[1] + h1 * r[0] + h2 * s4 + h3 * s3 + h4 * s2;
+        uint64_t d2 = h0 * r[2] + h1 * r[1] + h2 * r[0] + h3 * s4 + h4 * s3;
+        uint64_t d3 = h0 * r[3] + h1 * r[2] + h2 * r[1] + h3 * r[0] + h4 * s4;
+        uint64_t d4 = h0 * r[4] + h1 * r[3] + h2 * r[2] + h3 * r[1] + h4 * r[0];
+
+        uint64_t c = d0 >> 26; h[0] = uint32_t(d0) & mask;
+        d1 += c; c = d1 >> 26; h[1] = uint32_t(d1) & mask;
+        d2 += c; c = d2 >> 26; h[2] = uint32_t(d2) & mask;
+        d3 += c; c = d3 >> 26; h[3] = uint32_t(d3) & mask;
+        d4 += c; c = d4 >> 26; h[4] = uint32_t(d4) & mask;
+        h[0] += uint32_t(c) * 5;
+        h[1] += h[0] >> 26;
+        h[0] &= mask;
+    }
+
+    uint32_t r[5];
+    uint32_t h[5];
+    uint32_t pad[4];
+};
+
+void computeTag(const uint8_t* key, const uint8_t* nonce, const uint8_t* aad, size_t aadSize,
+                const uint8_t* cipher, size_t cipherSize, uint8_t* tag)
+{
+    uint8_t block0[64];
+    chacha20Block(key, 0, nonce, block0);
+
+    Poly1305 poly(block0);
+    memwipe(block0, sizeof(block0));
+
+    poly.updatePadded(aad, aadSize);
+    poly.updatePadded(cipher, cipherSize);
+
+    uint8_t sizes[16];
+    store32(sizes + 0, uint32_t(uint64_t(aadSize)));
+    store32(sizes + 4, uint32_t(uint64_t(aadSize) >> 32));
+    store32(sizes + 8, uint32_t(uint64_t(cipherSize)));
+    store32(sizes + 12, uint32_t(uint64_t(cipherSize) >> 32));
+    poly.updatePadded(sizes, sizeof(sizes));
+
+    poly.finish(tag);
+}
+
+} //namespace
+
+namespace graft { namespace crypto_tools {
+
+void chacha20Poly1305Seal(const uint8_t* key, const uint8_t* nonce, const uint8_t* aad, size_t aadSize,
+                          const uint8_t* plain, size_t plainSize, uint8_t* cipher)
+{
+    chacha20Xor(key, nonce, plain, plainSize, cipher);
+    computeTag(key, nonce, aad, aadSize, cipher, plainSize, cipher + plainSize);
+}
+
+bool chacha20Poly1305Open(const uint8_t* key, const uint8_t* nonce, const uint8_t* aad, size_t aadSize,
+                          const uint8_t* cipher, size_t plainSize, uint8_t* plain)
+{
+    uint8_t tag[16];
+    computeTag(key, nonce, aad, aadSize, cipher, plainSize, tag);
+
+    //constant time compare
+    uint8_t diff = 0;
+    for(size_t i = 0; i < sizeof(tag); ++i)
+        diff |= tag[i] ^ cipher[plainSize + i];
+    if(diff)
+        return false;
+
+    chacha20Xor(key, nonce, cipher, plainSize, plain);
+    return true;
+}
+
+} //namespace crypto_tools
+} //namespace graft
@@ -0,0 +1,58 @@
+// Copyright (c) 2019, The Graft Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace graft { namespace crypto_tools {
+
+/*!
+ * Portable ChaCha20-Poly1305 AEAD (RFC 8439), for builds where OpenSSL has no EVP_chacha20_poly1305 (older than 1.1).
+ * key is 32 bytes, nonce is 12 bytes, the tag is 16 bytes.
+ */
+
+/*!
+ * \brief chacha20Poly1305Seal - encrypts plain and authenticates it together with aad
+ * \param cipher - receives plainSize bytes of encrypted data followed by the tag
+ */
+void chacha20Poly1305Seal(const uint8_t* key, const uint8_t* nonce, const uint8_t* aad, size_t aadSize,
+                          const uint8_t* plain, size_t plainSize, uint8_t* cipher);
+
+/*!
+ * \brief chacha20Poly1305Open - checks the tag and decrypts
+ * \param cipher - plainSize bytes of encrypted data followed by the tag
+ * \return false if authentication fails, plain is not written then
+ */
+bool chacha20Poly1305Open(const uint8_t* key, const uint8_t* nonce, const uint8_t* aad, size_t aadSize,
+                          const uint8_t* cipher, size_t plainSize, uint8_t* plain);
+
+} //namespace crypto_tools
+} //namespace graft
@@ -28,8 +28,21 @@
 //
 
 #include <boost/endian/conversion.hpp>
+#include <openssl/evp.h>
+#include <algorithm>
+#include <climits>
+#include <cstddef>
+#include <cstring>
+#include <memory>
 #include "cryptmsg.h"
+#include "chacha20_poly1305.h"
 #include "crypto/chacha.h"
+#include "crypto/hash.h"
+#include "memwipe.h"
+
+extern "C" {
+#include "crypto/crypto-ops.h"
+}
 
 namespace {
 
@@ -237,35 +250,286 @@ size_t decryptMsg(size_t inputSize, const uint8_t* input, const crypto::secret_k
     return 0;
 }
 
+/*
+ * Version 2 of the message.
+ *
+ * Per-recipient keys are derived from the ECDH shared secret with Keccak instead of CryptoNight,
+ * data are sealed with ChaCha20-Poly1305 (96-bit nonce), and each XEntry carries a tag derived from the shared secret
+ * instead of Bhash, so a recipient finds its entry with a binary search over entries sorted by tag and decrypts once.
+ *
+ * The result has following structure [magic:32][version:8][R:32][count of XEntrys:16][XEntry]...[XEntry][nonce:96][x encrypted data][mac:128]
+ * magic - cMagicV2, it can't be plainSize of v1 message so v1 and v2 messages are distinguished by it
+ * [XEntry] - [tag:64][rBX] pair for each recipient
+ * [rBX] - session key x sealed with recipient key (zero nonce, the key is unique per message and recipient)
+ * head (magic, version, R and count) is authenticated together with the data
+ */
+
+constexpr uint32_t cMagicV2 = 0xFFFFFFFF;
+constexpr uint8_t cVersion2 = 2;
+constexpr size_t cNonceSize = 12;
+constexpr size_t cMacSize = 16;
+constexpr size_t cKeySize = 32;
+
+#pragma pack(push, 1)
+
+struct XEntryV2
+{
+    uint64_t tag; //recipient tag derived from shared secret
+    uint8_t cipherX[cKeySize + cMacSize]; //sealed session key
+};
+
+struct CryptoMessageHeadV2
+{
+    uint32_t magic; //cMagicV2
+    uint8_t version; //cVersion2
+    crypto::public_key R; //random key used to encrypt session key
+    uint16_t count; //recipients count
+    XEntryV2 xentries[1];
+};
+
+#pragma pack(pop)
+
+constexpr size_t cHeadV2AadSize = offsetof(CryptoMessageHeadV2, xentries);
+
+static_assert(sizeof(cMagicV2) == sizeof(CryptoMessageHead::plainSize), "v2 magic must overlap v1 plain size");
+
+#if OPENSSL_VERSION_NUMBER < 0x10100000 || defined(LIBRESSL_VERSION_TEXT)
+//EVP_chacha20_poly1305 needs OpenSSL 1.1, use the portable implementation
+class Aead
+{
+public:
+    //cipher receives plain_size bytes of encrypted data followed by mac
+    bool seal(const uint8_t* key, const uint8_t* nonce, const uint8_t* aad, size_t aad_size, const uint8_t* plain, size_t plain_size, uint8_t* cipher)
+    {
+        graft::crypto_tools::chacha20Poly1305Seal(key, nonce, aad, aad_size, plain, plain_size, cipher);
+        return true;
+    }
+
+    //cipher contains plain_size bytes of encrypted data followed by mac; returns false if authentication fails
+    bool open(const uint8_t* key, const uint8_t* nonce, const uint8_t* aad, size_t aad_size, const uint8_t* cipher, size_t plain_size, uint8_t* plain)
+    {
+        return graft::crypto_tools::chacha20Poly1305Open(key, nonce, aad, aad_size, cipher, plain_size, plain);
+    }
+};
+#else
+//ChaCha20-Poly1305 context reused for all seal/open operations of a message
+class Aead
+{
+public:
+    Aead() : m_ctx(EVP_CIPHER_CTX_new(), &EVP_CIPHER_CTX_free) {}
+
+    //cipher receives plain_size bytes of encrypted data followed by mac
+    bool seal(const uint8_t* key, const uint8_t* nonce, const uint8_t* aad, size_t aad_size, const uint8_t* plain, size_t plain_size, uint8_t* cipher)
+    {
+        int len = 0;
+        return m_ctx && plain_size <= INT_MAX
+            && EVP_EncryptInit_ex(m_ctx.get(), EVP_chacha20_poly1305(), nullptr, nullptr, nullptr) == 1
+            && EVP_CIPHER_CTX_ctrl(m_ctx.get(), EVP_CTRL_AEAD_SET_IVLEN, cNonceSize, nullptr) == 1
+            && EVP_EncryptInit_ex(m_ctx.get(), nullptr, nullptr, key, nonce) == 1
+            && (!aad_size || EVP_EncryptUpdate(m_ctx.get(), nullptr, &len, aad, int(aad_size)) == 1)
+            && EVP_EncryptUpdate(m_ctx.get(), cipher, &len, plain, int(plain_size)) == 1
+            && EVP_EncryptFinal_ex(m_ctx.get(), cipher + len, &len) == 1
+            && EVP_CIPHER_CTX_ctrl(m_ctx.get(), EVP_CTRL_AEAD_GET_TAG, cMacSize, cipher + plain_size) == 1;
+    }
+
+    //cipher contains plain_size bytes of encrypted data followed by mac; returns false if authentication fails
+    bool open(const uint8_t* key, const uint8_t* nonce, const uint8_t* aad, size_t aad_size, const uint8_t* cipher, size_t plain_size, uint8_t* plain)
+    {
+        int len = 0;
+        return m_ctx && plain_size <= INT_MAX
+            && EVP_DecryptInit_ex(m_ctx.get(), EVP_chacha20_poly1305(), nullptr, nullptr, nullptr) == 1
+            && EVP_CIPHER_CTX_ctrl(m_ctx.get(), EVP_CTRL_AEAD_SET_IVLEN, cNonceSize, nullptr) == 1
+            && EVP_DecryptInit_ex(m_ctx.get(), nullptr, nullptr, key, nonce) == 1
+            && (!aad_size || EVP_DecryptUpdate(m_ctx.get(), nullptr, &len, aad, int(aad_size)) == 1)
+            && EVP_DecryptUpdate(m_ctx.get(), plain, &len, cipher, int(plain_size)) == 1
+            && EVP_CIPHER_CTX_ctrl(m_ctx.get(), EVP_CTRL_AEAD_SET_TAG, cMacSize, const_cast<uint8_t*>(cipher + plain_size)) == 1
+            && EVP_DecryptFinal_ex(m_ctx.get(), plain + len, &len) == 1;
+    }
+
+private:
+    std::unique_ptr<EVP_CIPHER_CTX, decltype(&EVP_CIPHER_CTX_free)> m_ctx;
+};
+#endif
+
+//recipient key and tag from shared secret rB == bR
+void deriveRecipientKey(const crypto::key_derivation& shared, const crypto::public_key& R, crypto::hash& key, uint64_t& tag)
+{
+#pragma pack(push, 1)
+    struct
+    {
+        char domain[16];
+        crypto::key_derivation shared;
+        crypto::public_key R;
+    } buf;
+#pragma pack(pop)
+
+    buf.shared = shared;
+    buf.R = R;
+
+    memcpy(buf.domain, "graft-cryptmsg-k", sizeof(buf.domain));
+    crypto::cn_fast_hash(&buf, sizeof(buf), key);
+
+    crypto::hash tag_hash;
+    memcpy(buf.domain, "graft-cryptmsg-t", sizeof(buf.domain));
+    crypto::cn_fast_hash(&buf, sizeof(buf), tag_hash);
+    memcpy(&tag, &tag_hash, sizeof(tag));
+
+    memwipe(&buf, sizeof(buf));
+}
+
+size_t encryptMsgV2(size_t inputSize, const uint8_t* input, size_t BkeysCount, const crypto::public_key* Bkeys, size_t outputSize, uint8_t* output)
+{
+    if(!inputSize || !BkeysCount || BkeysCount > UINT16_MAX)
+        return 0;
+
+    //prepare
+    size_t msgHeadSize = sizeof(CryptoMessageHeadV2) + (BkeysCount - 1) * sizeof(XEntryV2);
+    size_t msgSize = msgHeadSize + cNonceSize + inputSize + cMacSize;
+    if(outputSize < msgSize)
+        return msgSize;
+    if(!input || !Bkeys || !output)
+        return 0;
+
+    //fill head
+    CryptoMessageHeadV2& head = *reinterpret_cast<CryptoMessageHeadV2*>(output);
+    head.magic = native_to_little(cMagicV2);
+    head.version = cVersion2;
+    crypto::secret_key r;
+    crypto::generate_keys(head.R, r);
+    head.count = native_to_little(uint16_t(BkeysCount));
+
+    //generate session key x
+    uint8_t x[cKeySize];
+    crypto::generate_random_bytes_thread_safe(sizeof(x), x);
+
+    Aead aead;
+    bool ok = true;
+
+    //fill XEntry for each B
+    const crypto::public_key* pB = Bkeys;
+    XEntryV2* pxe = head.xentries;
+    for(size_t i=0; i<BkeysCount && ok; ++i, ++pxe, ++pB)
+    {
+        XEntryV2& xe = *pxe;
+        crypto::key_derivation rB;
+        ok = crypto::generate_key_derivation(*pB, r, rB);
+        if(!ok) break;
+        crypto::hash key;
+        uint64_t tag;
+        deriveRecipientKey(rB, head.R, key, tag);
+        xe.tag = native_to_little(tag);
+        static const uint8_t zero_nonce[cNonceSize] = {};
+        ok = aead.seal(reinterpret_cast<const uint8_t*>(&key), zero_nonce, nullptr, 0, x, sizeof(x), xe.cipherX);
+        memwipe(&key, sizeof(key));
+    }
+
+    if(ok)
+    {
+        //recipients find their entries by binary search
+        std::sort(head.xentries, head.xentries + BkeysCount, [](const XEntryV2& e1, const XEntryV2& e2) {
+            return little_to_native(e1.tag) < little_to_native(e2.tag);
+        });
+
+        //seal input with x
+        uint8_t* nonce = output + msgHeadSize;
+        crypto::generate_random_bytes_thread_safe(cNonceSize, nonce);
+        ok = aead.seal(x, nonce, output, cHeadV2AadSize, input, inputSize, nonce + cNonceSize);
+    }
+
+    memwipe(x, sizeof(x));
+    return ok ? msgSize : 0;
+}
+
+size_t decryptMsgV2(size_t inputSize, const uint8_t* input, const crypto::secret_key& bkey, size_t outputSize, uint8_t* output)
+{
+    if(!input || inputSize <= sizeof(CryptoMessageHeadV2))
+        return 0;
+    //prepare
+    const CryptoMessageHeadV2& head = *reinterpret_cast<const CryptoMessageHeadV2*>(input);
+    if(little_to_native(head.magic) != cMagicV2 || head.version != cVersion2)
+        return 0;
+    size_t head_count = little_to_native(head.count);
+    if(!head_count)
+        return 0;
+    size_t msgHeadSize = sizeof(CryptoMessageHeadV2) + (head_count - 1) * sizeof(XEntryV2);
+    if(inputSize < msgHeadSize + cNonceSize + cMacSize + 1)
+        return 0;
+    size_t plainSize = inputSize - msgHeadSize - cNonceSize - cMacSize;
+    if(outputSize < plainSize)
+        return plainSize;
+    if(!output)
+        return 0;
+
+    if(sc_check(reinterpret_cast<const unsigned char*>(&bkey)) != 0)
+        return 0; //corrupted key
+
+    //get recipient key and tag from bR
+    crypto::key_derivation bR;
+    if(!crypto::generate_key_derivation(head.R, bkey, bR))
+        return 0;
+    crypto::hash key;
+    uint64_t tag;
+    deriveRecipientKey(bR, head.R, key, tag);
+
+    //find XEntry by tag
+    const XEntryV2* begin = head.xentries;
+    const XEntryV2* end = head.xentries + head_count;
+    const XEntryV2* pxe = std::lower_bound(begin, end, tag, [](const XEntryV2& e, uint64_t t) {
+        return little_to_native(e.tag) < t;
+    });
+
+    Aead aead;
+    size_t result = 0;
+    for(; pxe != end && little_to_native(pxe->tag) == tag; ++pxe)
+    {
+        static const uint8_t zero_nonce[cNonceSize] = {};
+        uint8_t x[cKeySize];
+        if(!aead.open(reinterpret_cast<const uint8_t*>(&key), zero_nonce, nullptr, 0, pxe->cipherX, sizeof(x), x))
+            continue;
+        //decrypt with session key
+        const uint8_t* nonce = input + msgHeadSize;
+        if(aead.open(x, nonce, input, cHeadV2AadSize, nonce + cNonceSize, plainSize, output))
+            result = plainSize;
+        memwipe(x, sizeof(x));
+        break;
+    }
+    memwipe(&key, sizeof(key));
+    return result;
+}
+
 } //namespace
 
 namespace graft { namespace crypto_tools {
 
-void encryptMessage(const std::string& input, const std::vector<crypto::public_key>& Bkeys, std::string& output)
+void encryptMessage(const std::string& input, const std::vector<crypto::public_key>& Bkeys, std::string& output, MessageVersion version)
 {
     assert(!input.empty());
+    auto encrypt = version == MessageVersion::V2 ? encryptMsgV2 : encryptMsg;
     //get output size
-    size_t size = encryptMsg( input.size(), nullptr, Bkeys.size(), nullptr, 0, nullptr);
+    size_t size = encrypt( input.size(), nullptr, Bkeys.size(), nullptr, 0, nullptr);
     assert(0<size);
     output.resize(size);
     //encrypt
-    size_t res = encryptMsg( input.size(), reinterpret_cast<const uint8_t*>(input.data()),
-                             Bkeys.size(), &Bkeys[0],
+    size_t res = encrypt( input.size(), reinterpret_cast<const uint8_t*>(input.data()),
+                          Bkeys.size(), &Bkeys[0],
             output.size(), reinterpret_cast<uint8_t*>(&output[0]));
     assert(res == size);
 }
 
-void encryptMessage(const std::string& input, const crypto::public_key& Bkey, std::string& output)
+void encryptMessage(const std::string& input, const crypto::public_key& Bkey, std::string& output, MessageVersion version)
 {
     std::vector<crypto::public_key> v(1, Bkey);
-    encryptMessage(input, v, output);
+    encryptMessage(input, v, output, version);
 }
 
 bool decryptMessage(const std::string& input, const crypto::secret_key& bkey, std::string& output)
 {
     assert(!input.empty());
+    //v2 messages start with magic which is never a valid v1 plain size
+    bool v2 = input.size() >= sizeof(cMagicV2) && little_to_native(*reinterpret_cast<const uint32_t*>(input.data())) == cMagicV2;
+    auto decrypt = v2 ? decryptMsgV2 : decryptMsg;
     //get output size
-    size_t size = decryptMsg( input.size(), reinterpret_cast<const uint8_t*>(input.data()), bkey, 0, nullptr);
+    size_t size = decrypt( input.size(), reinterpret_cast<const uint8_t*>(input.data()), bkey, 0, nullptr);
     if(!size)
     {
         output.clear();
@@ -273,8 +537,8 @@ bool decryptMessage(const std::string& input, const crypto::secret_key& bkey, st
     }
     output.resize(size);
     //encrypt
-    size_t res = decryptMsg( input.size(), reinterpret_cast<const uint8_t*>(input.data()),
-                             bkey, output.size(), reinterpret_cast<uint8_t*>(&output[0]));
+    size_t res = decrypt( input.size(), reinterpret_cast<const uint8_t*>(input.data()),
+                          bkey, output.size(), reinterpret_cast<uint8_t*>(&output[0]));
     if(!res)
     {
         output.clear();
@@ -285,4 +549,3 @@ bool decryptMessage(const std::string& input, const crypto::secret_key& bkey, st
 }
 
 }} //namespace graft::crypto_tools
-
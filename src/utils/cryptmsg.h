@@ -34,14 +34,25 @@
 
 namespace graft { namespace crypto_tools {
 
+/*!
+ * \brief MessageVersion - format of encrypted message. decryptMessage accepts messages of all versions.
+ */
+enum class MessageVersion
+{
+    V1 = 1, //session key encrypted with CryptoNight-derived ChaCha8 keys, recipient entries found by trial decryption
+    V2 = 2, //Keccak-derived keys, ChaCha20-Poly1305 AEAD, recipient entry found by tag in one decryption
+};
+
 /*!
  * \brief encryptMessage - encrypts data for recipients using their B public keys (assumed public view keys).
  *
  * \param input - data to encrypt.
  * \param Bkeys - vector of B keys for each recipients.
  * \param output - resulting encripted message.
+ * \param version - message format, V1 unless all recipients support V2.
  */
-void encryptMessage(const std::string& input, const std::vector<crypto::public_key>& Bkeys, std::string& output);
+void encryptMessage(const std::string& input, const std::vector<crypto::public_key>& Bkeys, std::string& output,
+                    MessageVersion version = MessageVersion::V1);
 
 /*!
  * \brief encryptMessage - encrypts data for single recipient using B public keys (assumed public view key).
@@ -49,8 +60,10 @@ void encryptMessage(const std::string& input, const std::vector<crypto::public_k
  * \param input - data to encrypt.
  * \param Bkey - B keys of recipient.
  * \param output - resulting encripted message.
+ * \param version - message format, V1 unless the recipient supports V2.
  */
-void encryptMessage(const std::string& input, const crypto::public_key& Bkey, std::string& output);
+void encryptMessage(const std::string& input, const crypto::public_key& Bkey, std::string& output,
+                    MessageVersion version = MessageVersion::V1);
 
 /*!
  * \brief decryptMessage - (reverse of encryptMessage) decrypts data for one of the recipients using his secret key b.
@@ -0,0 +1,225 @@
+// Copyright (c) 2019, The Graft Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "ringct/rctOps.h"
+#include "chaingen.h"
+#include "block_batch.h"
+
+using namespace epee;
+using namespace crypto;
+using namespace cryptonote;
+
+//----------------------------------------------------------------------------------------------------------------------
+// Tests
+
+bool gen_block_batch_base::check_batch(cryptonote::core& c, size_t ev_index, const std::vector<test_event_entry>& events)
+{
+  DEFINE_TESTS_ERROR_CONTEXT("gen_block_batch_base::check_batch");
+
+  m_batch_index = ev_index;
+
+  std::vector<block_complete_entry> blocks;
+  block_complete_entry entry;
+  size_t txes_count = 0;
+  for (size_t i = ev_index + 1; i < events.size(); ++i)
+  {
+    if (typeid(std::vector<transaction>) == events[i].type())
+    {
+      for (const transaction &tx : boost::get<std::vector<transaction>>(events[i]))
+        entry.txs.push_back(t_serializable_object_to_blob(tx));
+    }
+    else if (typeid(block) == events[i].type())
+    {
+      entry.block = t_serializable_object_to_blob(boost::get<block>(events[i]));
+      txes_count += entry.txs.size();
+      blocks.push_back(entry);
+      entry = block_complete_entry();
+    }
+  }
+  CHECK_TEST_CONDITION(blocks.size() > 2);
+
+  Blockchain &bc = c.get_blockchain_storage();
+  const uint64_t height = c.get_current_blockchain_height();
+
+  CHECK_TEST_CONDITION(c.prepare_handle_incoming_blocks(blocks));
+
+  // every ring is in the chain already, so each tx of the batch gets its check started
+  const size_t expected_checks = tools::threadpool::getInstance().get_max_concurrency() > 1 ? txes_count : 0;
+  CHECK_EQ(bc.get_speculative_check_count(), expected_checks);
+
+  size_t added = 0;
+  for (const block_complete_entry &e : blocks)
+  {
+    std::vector<tx_verification_context> tvcs;
+    c.handle_incoming_txs(e.txs, tvcs, true, true, false);
+    block_verification_context bvc = AUTO_VAL_INIT(bvc);
+    c.handle_incoming_block(e.block, bvc, false);
+    if (bvc.m_verifivation_failed)
+      break;
+    CHECK_TEST_CONDITION(bvc.m_added_to_main_chain);
+    ++added;
+  }
+
+  // block N is added, N+1 is rejected and the checks for the blocks after it are gone
+  CHECK_EQ(added, 1u);
+  CHECK_EQ(bc.get_speculative_check_count(), 0u);
+  CHECK_TEST_CONDITION(c.cleanup_handle_incoming_blocks());
+  CHECK_EQ(c.get_current_blockchain_height(), height + 1);
+
+  return true;
+}
+
+bool gen_block_batch_bad_ring_signature::generate(std::vector<test_event_entry>& events) const
+{
+  uint64_t ts_start = 1338224400;
+
+  GENERATE_ACCOUNT(miner_account);
+  MAKE_GENESIS_BLOCK(events, blk_0, miner_account, ts_start);
+  MAKE_NEXT_BLOCK(events, blk_1, blk_0, miner_account);
+  REWIND_BLOCKS(events, blk_1r, blk_1, miner_account);
+  MAKE_ACCOUNT(events, alice_account);
+  MAKE_ACCOUNT(events, bob_account);
+  MAKE_ACCOUNT(events, carol_account);
+  MAKE_TX_LIST_START(events, txs_0, miner_account, alice_account, MK_COINS(1) + TESTS_DEFAULT_FEE, blk_1);
+  MAKE_TX_LIST(events, txs_0, miner_account, bob_account, MK_COINS(1) + TESTS_DEFAULT_FEE, blk_1);
+  MAKE_TX_LIST(events, txs_0, miner_account, carol_account, MK_COINS(1) + TESTS_DEFAULT_FEE, blk_1);
+  MAKE_NEXT_BLOCK_TX_LIST(events, blk_2, blk_1r, miner_account, txs_0);
+  REWIND_BLOCKS(events, blk_2r, blk_2, miner_account);
+
+  MAKE_TX(events, tx_0, alice_account, miner_account, MK_COINS(1), blk_2r);
+  events.pop_back();
+  MAKE_TX(events, tx_1, bob_account, miner_account, MK_COINS(1), blk_2r);
+  events.pop_back();
+  MAKE_TX(events, tx_2, carol_account, miner_account, MK_COINS(1), blk_2r);
+  events.pop_back();
+
+  // valid scalars, but not a signature of this prefix
+  crypto::signature &sig = tx_1.signatures[0][0];
+  std::swap(sig.c, sig.r);
+
+  DO_CALLBACK(events, "check_batch");
+  events.push_back(std::vector<transaction>(1, tx_0));
+  MAKE_NEXT_BLOCK_TX1(events, blk_3, blk_2r, miner_account, tx_0);
+  events.push_back(std::vector<transaction>(1, tx_1));
+  MAKE_NEXT_BLOCK_TX1(events, blk_4, blk_3, miner_account, tx_1);
+  events.push_back(std::vector<transaction>(1, tx_2));
+  MAKE_NEXT_BLOCK_TX1(events, blk_5, blk_4, miner_account, tx_2);
+
+  return true;
+}
+
+bool gen_block_batch_bad_mlsag::generate(std::vector<test_event_entry>& events) const
+{
+  uint64_t ts_start = 1338224400;
+
+  GENERATE_ACCOUNT(miner_account);
+  MAKE_GENESIS_BLOCK(events, blk_0, miner_account, ts_start);
+
+  // create 4 miner accounts, and have them mine the next 4 blocks
+  cryptonote::account_base miner_accounts[4];
+  const cryptonote::block *prev_block = &blk_0;
+  cryptonote::block blocks[4];
+  for (size_t n = 0; n < 4; ++n) {
+    miner_accounts[n].generate();
+    CHECK_AND_ASSERT_MES(generator.construct_block_manually(blocks[n], *prev_block, miner_accounts[n],
+        test_generator::bf_major_ver | test_generator::bf_minor_ver | test_generator::bf_timestamp | test_generator::bf_hf_version,
+        2, 2, prev_block->timestamp + DIFFICULTY_BLOCKS_ESTIMATE_TIMESPAN * 2, // v2 has blocks twice as long
+          crypto::hash(), 0, transaction(), std::vector<crypto::hash>(), 0, 0, 2),
+        false, "Failed to generate block");
+    events.push_back(blocks[n]);
+    prev_block = blocks + n;
+  }
+
+  // rewind
+  cryptonote::block blk_last = blocks[3];
+  for (size_t i = 0; i < CRYPTONOTE_MINED_MONEY_UNLOCK_WINDOW; ++i)
+  {
+    cryptonote::block blk;
+    CHECK_AND_ASSERT_MES(generator.construct_block_manually(blk, blk_last, miner_account,
+        test_generator::bf_major_ver | test_generator::bf_minor_ver | test_generator::bf_timestamp | test_generator::bf_hf_version,
+        2, 2, blk_last.timestamp + DIFFICULTY_BLOCKS_ESTIMATE_TIMESPAN * 2, // v2 has blocks twice as long
+        crypto::hash(), 0, transaction(), std::vector<crypto::hash>(), 0, 0, 2),
+        false, "Failed to generate block");
+    events.push_back(blk);
+    blk_last = blk;
+  }
+
+  // one rct tx per miner, each with a ring over the 4 coinbase outputs above
+  transaction txes[3];
+  for (size_t n = 0; n < 3; ++n)
+  {
+    std::vector<tx_source_entry> sources;
+
+    sources.resize(1);
+    tx_source_entry& src = sources.back();
+
+    const size_t index_in_tx = 5;
+    src.amount = 30000000000000;
+    for (int m = 0; m < 4; ++m) {
+      src.push_output(m, boost::get<txout_to_key>(blocks[m].miner_tx.vout[index_in_tx].target).key, src.amount);
+    }
+    src.real_out_tx_key = cryptonote::get_tx_pub_key_from_extra(blocks[n].miner_tx);
+    src.real_output = n;
+    src.real_output_in_tx_index = index_in_tx;
+    src.mask = rct::identity();
+    src.rct = false;
+
+    tx_destination_entry td;
+    td.addr = miner_accounts[n].get_keys().m_account_address;
+    td.amount = 7390000000000;
+    std::vector<tx_destination_entry> destinations(4, td); // 30 -> 7.39 * 4
+
+    crypto::secret_key tx_key;
+    std::vector<crypto::secret_key> additional_tx_keys;
+    std::unordered_map<crypto::public_key, cryptonote::subaddress_index> subaddresses;
+    subaddresses[miner_accounts[n].get_keys().m_account_address.m_spend_public_key] = {0,0};
+    bool r = construct_tx_and_get_tx_key(miner_accounts[n].get_keys(), subaddresses, sources, destinations, cryptonote::account_public_address{}, std::vector<uint8_t>(), txes[n], 0, tx_key, additional_tx_keys, true);
+    CHECK_AND_ASSERT_MES(r, false, "failed to construct transaction");
+  }
+
+  // the prefix and ring are untouched, only the MLSAG doesn't verify
+  CHECK_AND_ASSERT_MES(!txes[1].rct_signatures.p.MGs.empty(), false, "rct tx has no MLSAG");
+  txes[1].rct_signatures.p.MGs[0].cc = rct::skGen();
+
+  DO_CALLBACK(events, "check_batch");
+  for (size_t n = 0; n < 3; ++n)
+  {
+    events.push_back(std::vector<transaction>(1, txes[n]));
+    cryptonote::block blk;
+    CHECK_AND_ASSERT_MES(generator.construct_block_manually(blk, blk_last, miner_account,
+        test_generator::bf_major_ver | test_generator::bf_minor_ver | test_generator::bf_timestamp | test_generator::bf_tx_hashes | test_generator::bf_hf_version | test_generator::bf_max_outs,
+        4, 4, blk_last.timestamp + DIFFICULTY_BLOCKS_ESTIMATE_TIMESPAN * 2, // v2 has blocks twice as long
+        crypto::hash(), 0, transaction(), std::vector<crypto::hash>(1, get_transaction_hash(txes[n])), 0, 6, 4),
+        false, "Failed to generate block");
+    events.push_back(blk);
+    blk_last = blk;
+  }
+
+  return true;
+}
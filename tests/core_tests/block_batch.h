@@ -0,0 +1,84 @@
+// Copyright (c) 2019, The Graft Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#pragma once
+#include "chaingen.h"
+
+// Every event after the check_batch callback is handled as one batch of blocks, the
+// way the protocol handler does for a span: txes of a block, then the block.
+// The second block of the batch is bad and must take the speculative checks down with it.
+struct gen_block_batch_base : public test_chain_unit_base
+{
+  gen_block_batch_base()
+    : m_batch_index(0)
+  {
+    REGISTER_CALLBACK_METHOD(gen_block_batch_base, check_batch);
+  }
+
+  bool check_tx_verification_context(const cryptonote::tx_verification_context& tvc, bool tx_added, size_t /*event_idx*/, const cryptonote::transaction& /*tx*/)
+  {
+    return !tvc.m_verifivation_failed && tx_added;
+  }
+
+  bool check_tx_verification_context(const std::vector<cryptonote::tx_verification_context>& /*tvcs*/, size_t /*tx_added*/, size_t event_idx, const std::vector<cryptonote::transaction>& /*txs*/)
+  {
+    // only used for the batch, already handled by check_batch
+    return m_batch_index && event_idx > m_batch_index;
+  }
+
+  bool check_block_verification_context(const cryptonote::block_verification_context& bvc, size_t event_idx, const cryptonote::block& /*block*/)
+  {
+    if (m_batch_index && event_idx > m_batch_index)
+      return true;
+    return !bvc.m_verifivation_failed;
+  }
+
+  bool check_batch(cryptonote::core& c, size_t ev_index, const std::vector<test_event_entry>& events);
+
+private:
+  size_t m_batch_index;
+};
+
+struct gen_block_batch_bad_ring_signature : public gen_block_batch_base
+{
+  bool generate(std::vector<test_event_entry>& events) const;
+};
+
+struct gen_block_batch_bad_mlsag : public gen_block_batch_base
+{
+  bool generate(std::vector<test_event_entry>& events) const;
+};
+
+template<>
+struct get_test_options<gen_block_batch_bad_mlsag> {
+  const std::pair<uint8_t, uint64_t> hard_forks[4] = {std::make_pair(1, 0), std::make_pair(2, 1), std::make_pair(4, 65), std::make_pair(0, 0)};
+  const cryptonote::test_options test_options = {
+    hard_forks
+  };
+};
@@ -205,6 +205,9 @@ int main(int argc, char* argv[])
     GENERATE_AND_PLAY(gen_rct_tx_pre_rct_altered_extra);
     GENERATE_AND_PLAY(gen_rct_tx_rct_altered_extra);
 
+    GENERATE_AND_PLAY(gen_block_batch_bad_ring_signature);
+    GENERATE_AND_PLAY(gen_block_batch_bad_mlsag);
+
     GENERATE_AND_PLAY(gen_multisig_tx_valid_22_1_2);
     GENERATE_AND_PLAY(gen_multisig_tx_valid_22_1_2_many_inputs);
     GENERATE_AND_PLAY(gen_multisig_tx_valid_22_2_1);
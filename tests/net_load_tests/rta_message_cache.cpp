@@ -0,0 +1,179 @@
+// Copyright (c) 2019, The Graft Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/recursive_mutex.hpp>
+#include <boost/thread/thread.hpp>
+
+#include "gtest/gtest.h"
+
+#include "include_base_utils.h"
+#include "string_tools.h"
+#include "common/util.h"
+#include "crypto/hash.h"
+#include "p2p/rta_message_cache.h"
+
+namespace
+{
+  const size_t   MESSAGES_PER_SECOND   = 100000;
+  const size_t   REPLAY_SECONDS        = 30;
+  const size_t   THREADS_COUNT         = 4;
+  const size_t   DUPLICATES_PERCENT    = 25; //each message is received from several peers
+  const uint64_t REQUEST_CACHE_TIME_MS = 2 * 60 * 1000;
+  const size_t   REQUEST_CACHE_MAX_SIZE = 1000000;
+
+  /// Previous implementation of the message id cache: set + multimap of timestamps under one recursive mutex
+  class legacy_message_cache
+  {
+  public:
+    bool insert(const std::string& message_id, uint64_t now)
+    {
+      boost::lock_guard<boost::recursive_mutex> guard(m_lock);
+      bool result = false;
+      if (m_cache.find(message_id) == m_cache.end())
+      {
+        m_cache.insert(message_id);
+        m_timestamps.insert(std::make_pair(now, message_id));
+        result = true;
+      }
+      for (auto it = m_timestamps.begin(); it != m_timestamps.end();)
+      {
+        if (it->first + REQUEST_CACHE_TIME_MS >= now)
+          break;
+        m_cache.erase(it->second);
+        it = m_timestamps.erase(it);
+      }
+      return result;
+    }
+
+    size_t size() const { return m_cache.size(); }
+
+  private:
+    boost::recursive_mutex m_lock;
+    std::set<std::string> m_cache;
+    std::multimap<uint64_t, std::string> m_timestamps;
+  };
+
+  std::string make_message_id(size_t index)
+  {
+    return epee::string_tools::pod_to_hex(crypto::cn_fast_hash(&index, sizeof(index)));
+  }
+
+  /// Replays messages at MESSAGES_PER_SECOND of simulated time from several threads; returns wall time in seconds
+  template <class Cache>
+  double replay(Cache& cache, size_t& unique_count)
+  {
+    const size_t messages_count = MESSAGES_PER_SECOND * REPLAY_SECONDS;
+    std::vector<std::string> ids(messages_count);
+    for (size_t i = 0; i < messages_count; ++i)
+    {
+      if (i % 100 < DUPLICATES_PERCENT && i >= 1000)
+        ids[i] = ids[i - 1000];
+      else
+        ids[i] = make_message_id(i);
+    }
+
+    std::atomic<size_t> unique(0);
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<boost::thread> threads;
+    for (size_t t = 0; t < THREADS_COUNT; ++t)
+    {
+      threads.emplace_back([&, t]() {
+        size_t local_unique = 0;
+        for (size_t i = t; i < messages_count; i += THREADS_COUNT)
+        {
+          const uint64_t now = i * 1000 / MESSAGES_PER_SECOND;
+          if (cache.insert(ids[i], now))
+            ++local_unique;
+        }
+        unique += local_unique;
+      });
+    }
+    for (auto& thread : threads)
+      thread.join();
+
+    unique_count = unique;
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  }
+}
+
+TEST(rta_message_cache, replay_100k_messages_per_second)
+{
+  nodetool::rta_message_cache cache(std::chrono::milliseconds(REQUEST_CACHE_TIME_MS), REQUEST_CACHE_MAX_SIZE);
+  size_t unique = 0;
+  const double seconds = replay(cache, unique);
+  const double rate = MESSAGES_PER_SECOND * REPLAY_SECONDS / seconds;
+
+  std::cout << "rta_message_cache: " << rate << " msgs/s, unique " << unique << ", remembered " << cache.size() << std::endl;
+
+  ASSERT_GE(rate, MESSAGES_PER_SECOND);
+  ASSERT_LE(cache.size(), REQUEST_CACHE_MAX_SIZE);
+  ASSERT_LE(unique, MESSAGES_PER_SECOND * REPLAY_SECONDS * (100 - DUPLICATES_PERCENT) / 100 + 1000);
+}
+
+TEST(rta_message_cache, legacy_replay_100k_messages_per_second)
+{
+  legacy_message_cache cache;
+  size_t unique = 0;
+  const double seconds = replay(cache, unique);
+
+  std::cout << "legacy cache: " << MESSAGES_PER_SECOND * REPLAY_SECONDS / seconds << " msgs/s, unique " << unique
+    << ", remembered " << cache.size() << std::endl;
+}
+
+TEST(rta_message_cache, expiration)
+{
+  nodetool::rta_message_cache cache(std::chrono::milliseconds(1200), 1000, 4, 12);
+
+  ASSERT_TRUE(cache.insert("a", 0));
+  ASSERT_FALSE(cache.insert("a", 500));
+  ASSERT_FALSE(cache.insert("a", 1200));
+  ASSERT_TRUE(cache.insert("a", 1400));
+
+  for (size_t i = 0; i < 5000; ++i)
+    cache.insert(make_message_id(i), 2000);
+  ASSERT_LE(cache.size(), 1000);
+}
+
+int main(int argc, char** argv)
+{
+  tools::on_startup();
+  mlog_configure(mlog_get_default_log_path("net_load_tests_rta_cache.log"), true);
+
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
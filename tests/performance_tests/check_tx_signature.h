@@ -171,3 +171,68 @@ private:
   cryptonote::account_base m_alice;
   std::vector<cryptonote::transaction> m_txes;
 };
+
+// rct semantics of the txes of a span of synced blocks, verified one block at a time
+// or as a single batch for the whole span
+template<size_t a_blocks, size_t a_txes_per_block, bool a_span_batch>
+class test_check_blocks_rct_semantics : private multi_tx_test_base<2>
+{
+public:
+  static const size_t loop_count = a_blocks >= 100 ? 2 : a_blocks >= 10 ? 10 : 50;
+  static const size_t blocks = a_blocks;
+  static const size_t txes_per_block = a_txes_per_block;
+  static const bool span_batch = a_span_batch;
+
+  typedef multi_tx_test_base<2> base_class;
+
+  bool init()
+  {
+    using namespace cryptonote;
+
+    if (!base_class::init())
+      return false;
+
+    m_alice.generate();
+
+    std::vector<tx_destination_entry> destinations;
+    destinations.push_back(tx_destination_entry(this->m_source_amount - 1, m_alice.get_keys().m_account_address, false));
+    destinations.push_back(tx_destination_entry(1, m_alice.get_keys().m_account_address, false));
+
+    crypto::secret_key tx_key;
+    std::vector<crypto::secret_key> additional_tx_keys;
+    std::unordered_map<crypto::public_key, cryptonote::subaddress_index> subaddresses;
+    subaddresses[this->m_miners[this->real_source_idx].get_keys().m_account_address.m_spend_public_key] = {0,0};
+
+    // proving is slow, and verification cost does not depend on the proofs being distinct
+    m_txes.resize(txes_per_block);
+    for (size_t n = 0; n < m_txes.size(); ++n)
+    {
+      if (!construct_tx_and_get_tx_key(this->m_miners[this->real_source_idx].get_keys(), subaddresses, this->m_sources, destinations, cryptonote::account_public_address{}, std::vector<uint8_t>(), m_txes[n], 0, tx_key, additional_tx_keys, true, rct::RangeProofPaddedBulletproof))
+        return false;
+    }
+
+    return true;
+  }
+
+  bool test()
+  {
+    std::vector<const rct::rctSig*> rvv;
+    rvv.reserve(blocks * txes_per_block);
+    for (size_t b = 0; b < blocks; ++b)
+    {
+      for (const cryptonote::transaction &tx: m_txes)
+        rvv.push_back(&tx.rct_signatures);
+      if (!span_batch)
+      {
+        if (!rct::verRctSemanticsSimple(rvv))
+          return false;
+        rvv.clear();
+      }
+    }
+    return rvv.empty() || rct::verRctSemanticsSimple(rvv);
+  }
+
+private:
+  cryptonote::account_base m_alice;
+  std::vector<cryptonote::transaction> m_txes;
+};
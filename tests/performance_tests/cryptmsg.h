@@ -0,0 +1,93 @@
+// Copyright (c) 2019, The Graft Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "crypto/crypto.h"
+#include "utils/cryptmsg.h"
+
+// encryption of a message for an auth sample
+template<size_t recipients, graft::crypto_tools::MessageVersion version>
+class test_cryptmsg_encrypt
+{
+public:
+  static const size_t loop_count = version == graft::crypto_tools::MessageVersion::V1 ? 10 : 1000;
+
+  bool init()
+  {
+    m_keys.resize(recipients);
+    for (crypto::public_key &B : m_keys)
+    {
+      crypto::secret_key b;
+      crypto::generate_keys(B, b);
+    }
+    m_data.assign(1024, 'x');
+    return true;
+  }
+
+  bool test()
+  {
+    graft::crypto_tools::encryptMessage(m_data, m_keys, m_message, version);
+    return !m_message.empty();
+  }
+
+private:
+  std::vector<crypto::public_key> m_keys;
+  std::string m_data;
+  std::string m_message;
+};
+
+// decryption of a message by its last recipient
+template<size_t recipients, graft::crypto_tools::MessageVersion version>
+class test_cryptmsg_decrypt
+{
+public:
+  static const size_t loop_count = version == graft::crypto_tools::MessageVersion::V1 ? 100 : 1000;
+
+  bool init()
+  {
+    std::vector<crypto::public_key> keys(recipients);
+    for (crypto::public_key &B : keys)
+      crypto::generate_keys(B, m_key);
+    graft::crypto_tools::encryptMessage(std::string(1024, 'x'), keys, m_message, version);
+    return true;
+  }
+
+  bool test()
+  {
+    return graft::crypto_tools::decryptMessage(m_message, m_key, m_data);
+  }
+
+private:
+  crypto::secret_key m_key;
+  std::string m_message;
+  std::string m_data;
+};
@@ -61,6 +61,9 @@
 #include "bulletproof.h"
 #include "crypto_ops.h"
 #include "multiexp.h"
+#include "stake_transaction_storage.h"
+#include "cryptmsg.h"
+#include "rta_relay.h"
 
 namespace po = boost::program_options;
 
@@ -177,6 +180,13 @@ int main(int argc, char** argv)
   TEST_PERFORMANCE4(filter, p, test_check_tx_signature_aggregated_bulletproofs, 2, 2, 56, 16);
   TEST_PERFORMANCE4(filter, p, test_check_tx_signature_aggregated_bulletproofs, 10, 2, 56, 16);
 
+  TEST_PERFORMANCE3(filter, p, test_check_blocks_rct_semantics, 1, 4, false); // 4 2-output txes per block, verified per block
+  TEST_PERFORMANCE3(filter, p, test_check_blocks_rct_semantics, 1, 4, true); // same, verified per span
+  TEST_PERFORMANCE3(filter, p, test_check_blocks_rct_semantics, 10, 4, false);
+  TEST_PERFORMANCE3(filter, p, test_check_blocks_rct_semantics, 10, 4, true);
+  TEST_PERFORMANCE3(filter, p, test_check_blocks_rct_semantics, 100, 4, false);
+  TEST_PERFORMANCE3(filter, p, test_check_blocks_rct_semantics, 100, 4, true);
+
   TEST_PERFORMANCE0(filter, p, test_is_out_to_acc);
   TEST_PERFORMANCE0(filter, p, test_is_out_to_acc_precomp);
   TEST_PERFORMANCE0(filter, p, test_generate_key_image_helper);
@@ -190,6 +200,11 @@ int main(int argc, char** argv)
   TEST_PERFORMANCE1(filter, p, test_signature, false);
   TEST_PERFORMANCE1(filter, p, test_signature, true);
 
+  TEST_PERFORMANCE2(filter, p, test_check_signatures, 8, false);
+  TEST_PERFORMANCE2(filter, p, test_check_signatures, 8, true);
+  TEST_PERFORMANCE2(filter, p, test_check_signatures, 256, false);
+  TEST_PERFORMANCE2(filter, p, test_check_signatures, 256, true);
+
   TEST_PERFORMANCE2(filter, p, test_wallet2_expand_subaddresses, 50, 200);
 
   TEST_PERFORMANCE0(filter, p, test_cn_slow_hash);
@@ -245,6 +260,28 @@ int main(int argc, char** argv)
   TEST_PERFORMANCE3(filter, p, test_ringct_mlsag, 1, 10, true);
   TEST_PERFORMANCE3(filter, p, test_ringct_mlsag, 1, 100, true);
 
+  TEST_PERFORMANCE1(filter, p, test_stake_transaction_storage, false); // full rebuild of stakes
+  TEST_PERFORMANCE1(filter, p, test_stake_transaction_storage, true); // incremental update of stakes
+
+  TEST_PERFORMANCE2(filter, p, test_cryptmsg_encrypt, 8, graft::crypto_tools::MessageVersion::V1);
+  TEST_PERFORMANCE2(filter, p, test_cryptmsg_encrypt, 8, graft::crypto_tools::MessageVersion::V2);
+  TEST_PERFORMANCE2(filter, p, test_cryptmsg_encrypt, 16, graft::crypto_tools::MessageVersion::V1);
+  TEST_PERFORMANCE2(filter, p, test_cryptmsg_encrypt, 16, graft::crypto_tools::MessageVersion::V2);
+  TEST_PERFORMANCE2(filter, p, test_cryptmsg_encrypt, 32, graft::crypto_tools::MessageVersion::V1);
+  TEST_PERFORMANCE2(filter, p, test_cryptmsg_encrypt, 32, graft::crypto_tools::MessageVersion::V2);
+
+  TEST_PERFORMANCE2(filter, p, test_cryptmsg_decrypt, 8, graft::crypto_tools::MessageVersion::V1);
+  TEST_PERFORMANCE2(filter, p, test_cryptmsg_decrypt, 8, graft::crypto_tools::MessageVersion::V2);
+  TEST_PERFORMANCE2(filter, p, test_cryptmsg_decrypt, 16, graft::crypto_tools::MessageVersion::V1);
+  TEST_PERFORMANCE2(filter, p, test_cryptmsg_decrypt, 16, graft::crypto_tools::MessageVersion::V2);
+  TEST_PERFORMANCE2(filter, p, test_cryptmsg_decrypt, 32, graft::crypto_tools::MessageVersion::V1);
+  TEST_PERFORMANCE2(filter, p, test_cryptmsg_decrypt, 32, graft::crypto_tools::MessageVersion::V2);
+
+  TEST_PERFORMANCE2(filter, p, test_rta_relay, 1024, true); // serialize the request again
+  TEST_PERFORMANCE2(filter, p, test_rta_relay, 1024, false); // relay the received blob
+  TEST_PERFORMANCE2(filter, p, test_rta_relay, 16384, true);
+  TEST_PERFORMANCE2(filter, p, test_rta_relay, 16384, false);
+
   TEST_PERFORMANCE1(filter, p, test_crypto_ops, op_sc_add);
   TEST_PERFORMANCE1(filter, p, test_crypto_ops, op_sc_sub);
   TEST_PERFORMANCE1(filter, p, test_crypto_ops, op_sc_mul);
@@ -0,0 +1,74 @@
+// Copyright (c) 2019, The Graft Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#pragma once
+
+#include <string>
+
+#include "p2p/p2p_protocol_defs.h"
+#include "p2p/rta_relay_blob.h"
+#include "storages/portable_storage_template_helper.h"
+
+// preparing a received multicast for the next hop: decrement the hop counter of the loaded request and
+// serialize it again, or check the received blob and decrement the counter in a copy of it
+template<size_t data_size, bool reserialize>
+class test_rta_relay
+{
+public:
+  static const size_t loop_count = 10000;
+
+  bool init()
+  {
+    m_req.receiver_addresses.assign(8, std::string(95, 'G'));
+    m_req.sender_address = std::string(95, 'G');
+    m_req.callback_uri = "/cryptonode/callback";
+    m_req.data = std::string(data_size, 'x');
+    m_req.wait_answer = false;
+    m_req.hop = 16;
+    m_req.message_id = std::string(64, '0');
+    return epee::serialization::store_t_to_binary(m_req, m_blob);
+  }
+
+  bool test()
+  {
+    m_buff.clear();
+    if (reserialize)
+    {
+      m_req.hop--;
+      return epee::serialization::store_t_to_binary(m_req, m_buff);
+    }
+    if (!nodetool::check_binary_fields(m_blob, nodetool::COMMAND_MULTICAST::request::relay_fields()))
+      return false;
+    m_buff = m_blob;
+    return nodetool::decrement_binary_hop(m_buff);
+  }
+
+private:
+  nodetool::COMMAND_MULTICAST::request m_req;
+  std::string m_blob;
+  std::string m_buff;
+};
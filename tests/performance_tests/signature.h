@@ -66,3 +66,37 @@ private:
   crypto::hash message;
   crypto::signature m_signature;
 };
+
+template<size_t count, bool batch>
+class test_check_signatures
+{
+public:
+  static const size_t loop_count = 1000 / count + 10;
+
+  bool init()
+  {
+    m_checks.resize(count);
+    for (crypto::signature_check &check : m_checks)
+    {
+      cryptonote::keypair keys = cryptonote::keypair::generate(hw::get_device("default"));
+      check.prefix_hash = crypto::rand<crypto::hash>();
+      check.pub = keys.pub;
+      crypto::generate_signature(check.prefix_hash, keys.pub, keys.sec, check.sig);
+    }
+
+    return true;
+  }
+
+  bool test()
+  {
+    if (batch)
+      return crypto::check_signatures(m_checks);
+    for (const crypto::signature_check &check : m_checks)
+      if (!crypto::check_signature(check.prefix_hash, check.pub, check.sig))
+        return false;
+    return true;
+  }
+
+private:
+  std::vector<crypto::signature_check> m_checks;
+};
@@ -0,0 +1,96 @@
+// Copyright (c) 2019, The Graft Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#pragma once
+
+#include <memory>
+#include <random>
+
+#include <boost/filesystem.hpp>
+
+#include "cryptonote_core/stake_transaction_storage.h"
+#include "graft_rta_config.h"
+
+template<bool incremental>
+class test_stake_transaction_storage
+{
+public:
+  static const size_t loop_count = incremental ? 10000 : 10;
+  static const size_t stakes_count = 100000;
+  static const size_t supernodes_count = 2000;
+  static const uint64_t blocks_count = 50000;
+
+  bool init()
+  {
+    boost::filesystem::path path = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+
+    m_storage.reset(new cryptonote::StakeTransactionStorage(path.string(), 0));
+
+    std::mt19937_64 rng;
+
+    for (uint64_t block_height=1; block_height<=blocks_count; block_height++)
+    {
+      for (size_t i=stakes_count * (block_height - 1) / blocks_count, end=stakes_count * block_height / blocks_count; i<end; i++)
+      {
+        cryptonote::stake_transaction tx;
+
+        tx.hash                     = crypto::rand<crypto::hash>();
+        tx.amount                   = config::graft::TIER1_STAKE_AMOUNT / 2 + rng() % config::graft::TIER4_STAKE_AMOUNT;
+        tx.block_height             = block_height;
+        tx.unlock_time              = config::graft::STAKE_MIN_UNLOCK_TIME + rng() % config::graft::STAKE_MAX_UNLOCK_TIME_V15;
+        tx.supernode_public_id      = std::to_string(rng() % supernodes_count);
+        tx.supernode_public_address = cryptonote::account_public_address();
+
+        m_storage->add_tx(tx);
+      }
+
+      m_storage->add_last_processed_block(block_height, crypto::rand<crypto::hash>());
+    }
+
+    m_block_number = blocks_count / 2;
+
+    m_storage->update_supernode_stakes(m_block_number);
+
+    return true;
+  }
+
+  bool test()
+  {
+    m_block_number++;
+
+    if (incremental) m_storage->update_supernode_stakes(m_block_number);
+    else             m_storage->rebuild_supernode_stakes(m_block_number);
+
+    return !m_storage->get_supernode_stakes(m_block_number).empty();
+  }
+
+private:
+  std::unique_ptr<cryptonote::StakeTransactionStorage> m_storage;
+  uint64_t m_block_number;
+};
@@ -0,0 +1,218 @@
+// Copyright (c) 2019, The Graft Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "gtest/gtest.h"
+
+#include "supernode/DAPI_RPC_Server.h"
+#include "supernode/DAPI_RPC_ClientPool.h"
+
+#include <boost/atomic.hpp>
+#include <boost/thread/thread.hpp>
+#include <string>
+
+using namespace supernode;
+
+namespace {
+
+struct POOL_TEST_CALL {
+    struct request {
+        BEGIN_KV_SERIALIZE_MAP()
+            KV_SERIALIZE(Data)
+        END_KV_SERIALIZE_MAP()
+
+        int Data;
+    };
+    struct response {
+        BEGIN_KV_SERIALIZE_MAP()
+            KV_SERIALIZE(Data)
+        END_KV_SERIALIZE_MAP()
+
+        int Data;
+    };
+};
+
+DAPI_RPC_ClientPool::SEndpointMetrics EndpointMetrics(DAPI_RPC_ClientPool& pool, const std::string& ip, const std::string& port) {
+    for(const auto& m : pool.Metrics()) if( m.IP==ip && m.Port==port ) return m;
+    return DAPI_RPC_ClientPool::SEndpointMetrics();
+}
+
+}
+
+TEST(DAPI_RPC_ClientPool, reuses_connections)
+{
+    std::string ip = "127.0.0.1";
+    std::string port = "7556";
+
+    rpc_command::SetDAPIVersion("v1.0");
+    DAPI_RPC_Server dapi_server;
+    dapi_server.Set(ip, port, 5);
+    dapi_server.AddHandler<POOL_TEST_CALL::request, POOL_TEST_CALL::response>("PoolTestCall",
+        [](const POOL_TEST_CALL::request& in, POOL_TEST_CALL::response& out) { out.Data = in.Data*2; return true; });
+    boost::thread workerThread(&DAPI_RPC_Server::Start, &dapi_server);
+    boost::this_thread::sleep_for(boost::chrono::seconds(1));
+
+    DAPI_RPC_ClientPool& pool = DAPI_RPC_ClientPool::Instance();
+    const unsigned calls = 100;
+    for(unsigned i=0;i<calls;i++) {
+        POOL_TEST_CALL::request in;
+        POOL_TEST_CALL::response out;
+        in.Data = i;
+        out.Data = 0;
+        ASSERT_TRUE(pool.Invoke(ip, port, "PoolTestCall", in, out));
+        ASSERT_EQ(out.Data, 2*i);
+    }
+
+    DAPI_RPC_ClientPool::SEndpointMetrics m = EndpointMetrics(pool, ip, port);
+    ASSERT_EQ(m.Calls, calls);
+    ASSERT_GE(m.Reused, calls-1);
+    ASSERT_EQ(m.Failures, 0);
+    ASSERT_FALSE(m.Open);
+    ASSERT_GT(m.P50.count(), 0);
+    ASSERT_GE(m.P99, m.P50);
+
+    dapi_server.Stop();
+    workerThread.join();
+}
+
+TEST(DAPI_RPC_ClientPool, reconnects_closed_keep_alive)
+{
+    std::string ip = "127.0.0.1";
+    std::string port = "7558";
+
+    rpc_command::SetDAPIVersion("v1.0");
+    DAPI_RPC_ClientPool& pool = DAPI_RPC_ClientPool::Instance();
+    POOL_TEST_CALL::request in;
+    POOL_TEST_CALL::response out;
+
+    // the idle connection left in the pool is closed by the server restart
+    for(int i=0;i<2;i++) {
+        DAPI_RPC_Server dapi_server;
+        dapi_server.Set(ip, port, 5);
+        dapi_server.AddHandler<POOL_TEST_CALL::request, POOL_TEST_CALL::response>("PoolTestCall",
+            [](const POOL_TEST_CALL::request& in, POOL_TEST_CALL::response& out) { out.Data = in.Data*2; return true; });
+        boost::thread workerThread(&DAPI_RPC_Server::Start, &dapi_server);
+        boost::this_thread::sleep_for(boost::chrono::seconds(1));
+
+        in.Data = i;
+        out.Data = -1;
+        ASSERT_TRUE(pool.Invoke(ip, port, "PoolTestCall", in, out));
+        ASSERT_EQ(out.Data, 2*i);
+
+        dapi_server.Stop();
+        workerThread.join();
+    }
+    ASSERT_EQ(EndpointMetrics(pool, ip, port).Failures, 0);
+}
+
+TEST(DAPI_RPC_ClientPool, does_not_resend_written_request)
+{
+    std::string ip = "127.0.0.1";
+    std::string port = "7560";
+
+    rpc_command::SetDAPIVersion("v1.0");
+    boost::atomic<int> handled(0);
+    DAPI_RPC_Server dapi_server;
+    dapi_server.Set(ip, port, 5);
+    dapi_server.AddHandler<POOL_TEST_CALL::request, POOL_TEST_CALL::response>("PoolTestCall",
+        [&handled](const POOL_TEST_CALL::request& in, POOL_TEST_CALL::response& out) {
+            handled++;
+            if( in.Data<0 ) boost::this_thread::sleep_for(boost::chrono::seconds(2));
+            out.Data = in.Data*2;
+            return true;
+        });
+    boost::thread workerThread(&DAPI_RPC_Server::Start, &dapi_server);
+    boost::this_thread::sleep_for(boost::chrono::seconds(1));
+
+    DAPI_RPC_ClientPool& pool = DAPI_RPC_ClientPool::Instance();
+    POOL_TEST_CALL::request in;
+    POOL_TEST_CALL::response out;
+    in.Data = 1;
+    ASSERT_TRUE(pool.Invoke(ip, port, "PoolTestCall", in, out));
+
+    // the server got the request over the reused connection, but the response times out
+    in.Data = -1;
+    ASSERT_FALSE(pool.Invoke(ip, port, "PoolTestCall", in, out, std::chrono::seconds(1)));
+    boost::this_thread::sleep_for(boost::chrono::seconds(3));
+    ASSERT_EQ(handled, 2);
+
+    dapi_server.Stop();
+    workerThread.join();
+}
+
+TEST(DAPI_RPC_ClientPool, failed_calls_keep_circuit_closed)
+{
+    std::string ip = "127.0.0.1";
+    std::string port = "7559";
+
+    rpc_command::SetDAPIVersion("v1.0");
+    DAPI_RPC_Server dapi_server;
+    dapi_server.Set(ip, port, 5);
+    boost::thread workerThread(&DAPI_RPC_Server::Start, &dapi_server);
+    boost::this_thread::sleep_for(boost::chrono::seconds(1));
+
+    // endpoint is reachable, only the method is unknown
+    DAPI_RPC_ClientPool& pool = DAPI_RPC_ClientPool::Instance();
+    POOL_TEST_CALL::request in;
+    POOL_TEST_CALL::response out;
+    in.Data = 1;
+    for(unsigned i=0;i<pool.BreakerFailures+1;i++)
+        ASSERT_FALSE(pool.Invoke(ip, port, "NoSuchCall", in, out));
+    ASSERT_TRUE(pool.IsAvailable(ip, port));
+    ASSERT_FALSE(EndpointMetrics(pool, ip, port).Open);
+    ASSERT_EQ(EndpointMetrics(pool, ip, port).Failures, pool.BreakerFailures+1);
+
+    dapi_server.Stop();
+    workerThread.join();
+}
+
+TEST(DAPI_RPC_ClientPool, circuit_breaker)
+{
+    // nothing listens there
+    std::string ip = "127.0.0.1";
+    std::string port = "7557";
+
+    DAPI_RPC_ClientPool& pool = DAPI_RPC_ClientPool::Instance();
+    POOL_TEST_CALL::request in;
+    POOL_TEST_CALL::response out;
+    in.Data = 1;
+
+    for(unsigned i=0;i<pool.BreakerFailures;i++) {
+        bool connected = true;
+        ASSERT_FALSE(pool.Invoke(ip, port, "PoolTestCall", in, out, std::chrono::seconds(1), &connected));
+        ASSERT_FALSE(connected);
+    }
+    ASSERT_FALSE(pool.IsAvailable(ip, port));
+    ASSERT_TRUE(EndpointMetrics(pool, ip, port).Open);
+
+    // calls fail without connecting while the circuit is open
+    auto start = std::chrono::steady_clock::now();
+    ASSERT_FALSE(pool.Invoke(ip, port, "PoolTestCall", in, out));
+    ASSERT_LT(std::chrono::steady_clock::now()-start, std::chrono::milliseconds(100));
+    ASSERT_EQ(EndpointMetrics(pool, ip, port).Calls, pool.BreakerFailures+1);
+}
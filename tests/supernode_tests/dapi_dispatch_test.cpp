@@ -0,0 +1,168 @@
+// Copyright (c) 2019, The Graft Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "gtest/gtest.h"
+
+#include "supernode/DAPI_RPC_Server.h"
+
+#include <boost/thread/thread.hpp>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace supernode;
+
+namespace {
+
+// exposes request handling without running the http server
+class DispatchTestServer : public DAPI_RPC_Server {
+public:
+    bool Call(const std::string& method, const std::string& payment_id, std::string& out) {
+        rpc_command::RequestContainer<rpc_command::WALLET_GET_TRANSACTION_STATUS::request> req;
+        req.method = method;
+        req.params.PaymentID = payment_id;
+
+        epee::net_utils::http::http_request_info query;
+        query.m_URI = rpc_command::DAPI_URI;
+        query.m_http_method = epee::net_utils::http::http_method_post;
+        epee::serialization::store_t_to_json(req, query.m_body);
+
+        epee::net_utils::http::http_response_info response;
+        response.m_response_code = 200;
+        connection_context ctx;
+        if( !HandleRequest(query, response, ctx) || response.m_response_code!=200 ) return false;
+        out = response.m_body;
+        return true;
+    }
+};
+
+typedef rpc_command::WALLET_GET_TRANSACTION_STATUS::request status_request;
+typedef rpc_command::WALLET_GET_TRANSACTION_STATUS::response status_response;
+
+int AddStatusHandler(DAPI_RPC_Server& server, const std::string& payment_id, std::atomic<unsigned>& mismatches) {
+    return server.Add_UUID_MethodHandler<status_request, status_response>(payment_id, dapi_call::GetPayStatus,
+        [payment_id, &mismatches](const status_request& in, status_response& out) {
+            if( in.PaymentID!=payment_id ) ++mismatches;
+            out.Status = 1;
+            return true;
+        });
+}
+
+}
+
+TEST(DAPI_RPC_Server, dispatch_by_payment_id)
+{
+    DispatchTestServer server;
+    std::atomic<unsigned> mismatches{0};
+    std::string out;
+
+    ASSERT_FALSE(server.Call(dapi_call::GetPayStatus, "id-1", out));
+
+    int idx1 = AddStatusHandler(server, "id-1", mismatches);
+    int idx2 = AddStatusHandler(server, "id-2", mismatches);
+    ASSERT_TRUE(server.Call(dapi_call::GetPayStatus, "id-1", out));
+    ASSERT_TRUE(server.Call(dapi_call::GetPayStatus, "id-2", out));
+    ASSERT_FALSE(server.Call(dapi_call::GetPayStatus, "id-3", out));
+
+    // handler without payment id serves all payments without own handler
+    std::atomic<unsigned> global_calls{0};
+    int global = server.AddHandler<status_request, status_response>(dapi_call::GetPayStatus,
+        [&global_calls](const status_request& in, status_response& out) { ++global_calls; return true; });
+    ASSERT_TRUE(server.Call(dapi_call::GetPayStatus, "id-3", out));
+    ASSERT_TRUE(server.Call(dapi_call::GetPayStatus, "id-1", out));
+    ASSERT_EQ(global_calls, 1);
+
+    server.RemoveHandler(idx1);
+    server.RemoveHandler(idx1);
+    ASSERT_TRUE(server.Call(dapi_call::GetPayStatus, "id-1", out));
+    ASSERT_EQ(global_calls, 2);
+
+    server.RemoveHandler(global);
+    server.RemoveHandler(idx2);
+    ASSERT_FALSE(server.Call(dapi_call::GetPayStatus, "id-1", out));
+    ASSERT_FALSE(server.Call(dapi_call::GetPayStatus, "id-2", out));
+    ASSERT_EQ(mismatches, 0);
+}
+
+TEST(DAPI_RPC_Server, dispatch_load_10k_payments)
+{
+    const unsigned payments = 10000;
+    const unsigned threads = 4;
+    const unsigned calls_per_thread = 50000;
+
+    DispatchTestServer server;
+    std::atomic<unsigned> mismatches{0};
+    std::vector<std::string> ids(payments);
+    std::vector<int> idxs(payments);
+    for(unsigned i=0;i<payments;i++) {
+        ids[i] = "payment-" + std::to_string(i);
+        idxs[i] = AddStatusHandler(server, ids[i], mismatches);
+    }
+
+    // half of the payments keep finishing and restarting while requests are dispatched
+    std::atomic<bool> stop{false};
+    std::atomic<unsigned> failed{0};
+    boost::thread churn([&]() {
+        std::mt19937 rng(1);
+        while(!stop) {
+            unsigned i = payments/2 + rng() % (payments/2);
+            server.RemoveHandler(idxs[i]);
+            idxs[i] = AddStatusHandler(server, ids[i], mismatches);
+        }
+    });
+
+    auto start = std::chrono::steady_clock::now();
+    boost::thread_group group;
+    for(unsigned t=0;t<threads;t++) {
+        group.create_thread([&, t]() {
+            std::mt19937 rng(t + 100);
+            std::string out;
+            for(unsigned k=0;k<calls_per_thread;k++) {
+                unsigned i = rng() % (payments/2);
+                if( !server.Call(dapi_call::GetPayStatus, ids[i], out) ) ++failed;
+            }
+        });
+    }
+    group.join_all();
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+    stop = true;
+    churn.join();
+
+    std::cout << "dispatched " << threads*calls_per_thread << " calls over " << payments << " payments in "
+              << elapsed.count() << " ms" << std::endl;
+    ASSERT_EQ(failed, 0);
+    ASSERT_EQ(mismatches, 0);
+
+    for(unsigned i=0;i<payments;i++) server.RemoveHandler(idxs[i]);
+    std::string out;
+    ASSERT_FALSE(server.Call(dapi_call::GetPayStatus, ids[0], out));
+}
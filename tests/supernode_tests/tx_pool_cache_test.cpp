@@ -0,0 +1,232 @@
+// Copyright (c) 2019, The Graft Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "gtest/gtest.h"
+
+#include "supernode/TxPool.h"
+
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/thread.hpp>
+#include <unordered_set>
+
+using namespace supernode;
+
+namespace {
+
+crypto::hash MakeHash(uint8_t test, uint8_t n) {
+    crypto::hash hash = crypto::null_hash;
+    hash.data[0] = test;
+    hash.data[1] = n;
+    return hash;
+}
+
+// daemon stand-in: knows the hashes in Known, counts the lookups of every hash
+class FakeTxPool : public TxPool {
+public:
+    FakeTxPool() : TxPool("127.0.0.1:28281", "", "") {}
+
+    std::unordered_set<crypto::hash> Known;
+    bool Fail = false;
+    bool Block = false;// the next fetch waits for Release()
+
+    size_t Fetches(const crypto::hash& hash) {
+        boost::lock_guard<boost::mutex> lock(m_Guard);
+        return m_Fetches[hash];
+    }
+
+    size_t Calls() {
+        boost::lock_guard<boost::mutex> lock(m_Guard);
+        return m_Calls;
+    }
+
+    void WaitBlocked() {
+        boost::unique_lock<boost::mutex> lock(m_Guard);
+        while( !m_Blocked ) m_Cond.wait(lock);
+    }
+
+    void Release() {
+        boost::lock_guard<boost::mutex> lock(m_Guard);
+        Block = false;
+        m_Cond.notify_all();
+    }
+
+protected:
+    bool fetch(const std::vector<crypto::hash> &hashes, const std::unordered_map<crypto::hash, tx_ptr> &parsed,
+               std::unordered_map<crypto::hash, tx_entry_ptr> &out) override {
+        boost::unique_lock<boost::mutex> lock(m_Guard);
+        m_Calls++;
+        for(const crypto::hash& hash : hashes) m_Fetches[hash]++;
+        if( Block ) {
+            m_Blocked = true;
+            m_Cond.notify_all();
+            while( Block ) m_Cond.wait(lock);
+        }
+        if( Fail ) return false;
+        for(const crypto::hash& hash : hashes) {
+            if( !Known.count(hash) ) continue;
+            boost::shared_ptr<tx_entry> entry(new tx_entry());
+            auto it = parsed.find(hash);
+            if( it!=parsed.end() ) {
+                entry->tx = it->second;
+            } else {
+                boost::shared_ptr<cryptonote::transaction> tx(new cryptonote::transaction());
+                tx->unlock_time = hash.data[1];
+                entry->tx = tx;
+            }
+            entry->in_pool = true;
+            out[hash] = entry;
+        }
+        return true;
+    }
+
+private:
+    boost::mutex m_Guard;
+    boost::condition_variable m_Cond;
+    std::unordered_map<crypto::hash, size_t> m_Fetches;
+    size_t m_Calls = 0;
+    bool m_Blocked = false;
+};
+
+}
+
+TEST(TxPoolCache, lru_eviction_order)
+{
+    TxPool::setCacheLimits(3, std::chrono::seconds(2), std::chrono::hours(1));
+    FakeTxPool pool;
+    std::unordered_map<crypto::hash, cryptonote::transaction> txs;
+    const crypto::hash h1 = MakeHash(1, 1), h2 = MakeHash(1, 2), h3 = MakeHash(1, 3), h4 = MakeHash(1, 4);
+    pool.Known = {h1, h2, h3, h4};
+
+    // misses are fetched in one call
+    ASSERT_TRUE(pool.get({h1, h2, h3}, txs));
+    ASSERT_EQ(txs.size(), 3);
+    ASSERT_EQ(txs[h2].unlock_time, 2);
+    ASSERT_EQ(pool.Calls(), 1);
+
+    // h1 becomes the most recently used, so h2 is evicted by h4
+    ASSERT_TRUE(pool.get({h1}, txs));
+    ASSERT_TRUE(pool.get({h4}, txs));
+    ASSERT_TRUE(pool.get({h1, h3, h4}, txs));
+    ASSERT_EQ(pool.Fetches(h1), 1);
+    ASSERT_EQ(pool.Fetches(h3), 1);
+    ASSERT_EQ(pool.Fetches(h4), 1);
+
+    txs.clear();
+    ASSERT_TRUE(pool.get({h2}, txs));
+    ASSERT_EQ(txs.size(), 1);
+    ASSERT_EQ(pool.Fetches(h2), 2);
+}
+
+TEST(TxPoolCache, negative_entry_expires)
+{
+    TxPool::setCacheLimits(16, std::chrono::milliseconds(200), std::chrono::hours(1));
+    FakeTxPool pool;
+    std::unordered_map<crypto::hash, cryptonote::transaction> txs;
+    const crypto::hash h = MakeHash(2, 1);
+
+    // unknown hash is not an error, it is just not found
+    ASSERT_TRUE(pool.get({h}, txs));
+    ASSERT_TRUE(txs.empty());
+    ASSERT_TRUE(pool.get({h}, txs));
+    ASSERT_EQ(pool.Fetches(h), 1);
+
+    // the daemon gets the transaction, and is asked again once the negative entry expired
+    pool.Known.insert(h);
+    boost::this_thread::sleep_for(boost::chrono::milliseconds(300));
+    ASSERT_TRUE(pool.get({h}, txs));
+    ASSERT_EQ(pool.Fetches(h), 2);
+    ASSERT_EQ(txs.size(), 1);
+}
+
+TEST(TxPoolCache, stale_pool_membership_is_fetched_again)
+{
+    TxPool::setCacheLimits(16, std::chrono::seconds(2), std::chrono::milliseconds(100));
+    FakeTxPool pool;
+    std::unordered_map<crypto::hash, cryptonote::transaction> txs;
+    const crypto::hash h = MakeHash(3, 1);
+    pool.Known = {h};
+
+    ASSERT_TRUE(pool.get({h}, txs));
+    ASSERT_TRUE(pool.get({h}, txs));
+    ASSERT_EQ(pool.Fetches(h), 1);
+
+    // mined meanwhile
+    pool.Known.clear();
+    boost::this_thread::sleep_for(boost::chrono::milliseconds(200));
+    txs.clear();
+    ASSERT_TRUE(pool.get({h}, txs));
+    ASSERT_EQ(pool.Fetches(h), 2);
+    ASSERT_TRUE(txs.empty());
+}
+
+TEST(TxPoolCache, concurrent_lookups_are_coalesced)
+{
+    TxPool::setCacheLimits(16, std::chrono::seconds(2), std::chrono::hours(1));
+    FakeTxPool pool;
+    const crypto::hash h = MakeHash(4, 1);
+    pool.Known = {h};
+    pool.Block = true;
+
+    std::unordered_map<crypto::hash, cryptonote::transaction> first, second;
+    bool first_ok = false, second_ok = false;
+    boost::thread t1([&]() { first_ok = pool.get({h}, first); });
+    pool.WaitBlocked();
+    boost::thread t2([&]() { second_ok = pool.get({h}, second); });
+    // the second lookup finds the first one in flight and waits for it
+    boost::this_thread::sleep_for(boost::chrono::milliseconds(200));
+    pool.Release();
+    t1.join();
+    t2.join();
+
+    ASSERT_EQ(pool.Calls(), 1);
+    ASSERT_TRUE(first_ok);
+    ASSERT_TRUE(second_ok);
+    ASSERT_EQ(first.size(), 1);
+    ASSERT_EQ(second.size(), 1);
+    ASSERT_EQ(second[h].unlock_time, 1);
+}
+
+TEST(TxPoolCache, failed_fetch_is_not_cached)
+{
+    TxPool::setCacheLimits(16, std::chrono::hours(1), std::chrono::hours(1));
+    FakeTxPool pool;
+    std::unordered_map<crypto::hash, cryptonote::transaction> txs;
+    const crypto::hash h = MakeHash(5, 1);
+    pool.Known = {h};
+
+    pool.Fail = true;
+    ASSERT_FALSE(pool.get({h}, txs));
+    ASSERT_TRUE(txs.empty());
+
+    // neither a hit nor a missing hash, the daemon is asked again
+    pool.Fail = false;
+    ASSERT_TRUE(pool.get({h}, txs));
+    ASSERT_EQ(txs.size(), 1);
+    ASSERT_EQ(pool.Fetches(h), 2);
+}
@@ -0,0 +1,236 @@
+// Copyright (c) 2019, The Graft Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "gtest/gtest.h"
+
+#include "supernode/DAPI_RPC_Server.h"
+#include "supernode/SubNetBroadcast.h"
+#include "supernode/WorkerPool.h"
+
+#include <boost/thread/thread.hpp>
+#include <atomic>
+#include <future>
+#include <string>
+#include <vector>
+
+using namespace supernode;
+
+namespace {
+
+struct FLOW_TEST_CALL {
+    struct request {
+        BEGIN_KV_SERIALIZE_MAP()
+            KV_SERIALIZE(PaymentID)
+            KV_SERIALIZE(Step)
+        END_KV_SERIALIZE_MAP()
+
+        std::string PaymentID;
+        int Step;
+    };
+    struct response {
+        BEGIN_KV_SERIALIZE_MAP()
+            KV_SERIALIZE(Step)
+        END_KV_SERIALIZE_MAP()
+
+        int Step;
+    };
+};
+
+// exposes http entry point without running the http server
+class BackpressureTestServer : public DAPI_RPC_Server {
+public:
+    int Call() {
+        epee::net_utils::http::http_request_info query;
+        query.m_URI = rpc_command::DAPI_URI;
+        query.m_http_method = epee::net_utils::http::http_method_post;
+        epee::net_utils::http::http_response_info response;
+        connection_context ctx;
+        handle_http_request(query, response, ctx);
+        return response.m_response_code;
+    }
+};
+
+}
+
+TEST(WorkerPool, strand_keeps_order)
+{
+    const unsigned strands = 100;
+    const unsigned tasks = 100;
+
+    WorkerPool pool(8, 100000);
+    std::vector< std::unique_ptr<WorkerPool::Strand> > ss;
+    std::vector<unsigned> last(strands, 0);
+    std::vector< std::atomic<int> > running(strands);
+    std::atomic<unsigned> disorders{0}, overlaps{0}, done{0};
+
+    for(unsigned s=0;s<strands;s++) {
+        running[s] = 0;
+        ss.emplace_back( new WorkerPool::Strand(pool) );
+    }
+    for(unsigned k=1;k<=tasks;k++) {
+        for(unsigned s=0;s<strands;s++) {
+            ss[s]->Post( [&, s, k]() {
+                if( ++running[s]!=1 ) ++overlaps;
+                if( last[s]+1!=k ) ++disorders;
+                last[s] = k;
+                --running[s];
+                ++done;
+            } );
+        }
+    }
+
+    while( done<strands*tasks ) boost::this_thread::sleep_for(boost::chrono::milliseconds(1));
+    ASSERT_EQ(disorders, 0);
+    ASSERT_EQ(overlaps, 0);
+    pool.Stop();
+}
+
+TEST(WorkerPool, bounded_queue)
+{
+    WorkerPool pool(2, 4);
+    std::promise<void> release;
+    std::shared_future<void> released = release.get_future().share();
+    std::atomic<unsigned> started{0}, done{0};
+
+    // occupy both threads
+    for(unsigned i=0;i<2;i++) ASSERT_TRUE( pool.TryPost( [&, released]() { ++started; released.wait(); ++done; } ) );
+    while( started<2 ) boost::this_thread::sleep_for(boost::chrono::milliseconds(1));
+
+    for(unsigned i=0;i<4;i++) ASSERT_TRUE( pool.TryPost( [&]() { ++done; } ) );
+    ASSERT_TRUE(pool.Overloaded());
+    ASSERT_FALSE( pool.TryPost( [&]() { ++done; } ) );
+
+    // accepted work is still queued over the limit
+    pool.Post( [&]() { ++done; } );
+    ASSERT_EQ(pool.Pending(), 5);
+
+    release.set_value();
+    while( done<7 ) boost::this_thread::sleep_for(boost::chrono::milliseconds(1));
+    ASSERT_FALSE(pool.Overloaded());
+    pool.Stop();
+}
+
+TEST(WorkerPool, wait_runs_queued_tasks)
+{
+    // the only thread waits for a task queued behind it
+    WorkerPool pool(1, 100);
+    std::atomic<bool> done{false};
+    pool.Post( [&]() {
+        std::promise<void> p;
+        std::future<void> f = p.get_future();
+        pool.Post( [&]() { p.set_value(); } );
+        pool.Wait(f);
+        done = true;
+    } );
+
+    while( !done ) boost::this_thread::sleep_for(boost::chrono::milliseconds(1));
+    pool.Stop();
+}
+
+TEST(WorkerPool, dapi_returns_503_when_overloaded)
+{
+    WorkerPool& pool = WorkerPool::Instance();
+    BackpressureTestServer server;
+    ASSERT_NE(server.Call(), 503);
+
+    std::promise<void> release;
+    std::shared_future<void> released = release.get_future().share();
+    std::atomic<unsigned> done{0};
+    const size_t tasks = pool.Threads()+pool.QueueLimit;
+    for(size_t i=0;i<tasks;i++) pool.Post( [&, released]() { released.wait(); ++done; } );
+
+    ASSERT_EQ(server.Call(), 503);
+
+    release.set_value();
+    while( done<tasks ) boost::this_thread::sleep_for(boost::chrono::milliseconds(1));
+    ASSERT_NE(server.Call(), 503);
+}
+
+TEST(WorkerPool, concurrent_pay_sale_flows)
+{
+    const unsigned nodes = 4;
+    const unsigned payments = 200;
+    const std::string ip = "127.0.0.1";
+
+    // auth sample of local supernodes, each answers sale and pay steps
+    rpc_command::SetDAPIVersion("v1.0");
+    std::vector< std::unique_ptr<DAPI_RPC_Server> > servers;
+    boost::thread_group serverThreads;
+    std::vector<std::string> members;
+    for(unsigned i=0;i<nodes;i++) {
+        std::string port = std::to_string(7560+i);
+        servers.emplace_back( new DAPI_RPC_Server() );
+        servers.back()->Set(ip, port, 5);
+        for(const char* method : { "FlowTestSale", "FlowTestPay" }) {
+            servers.back()->AddHandler<FLOW_TEST_CALL::request, FLOW_TEST_CALL::response>(method,
+                [](const FLOW_TEST_CALL::request& in, FLOW_TEST_CALL::response& out) { out.Step = in.Step; return true; });
+        }
+        serverThreads.create_thread( boost::bind(&DAPI_RPC_Server::Start, servers.back().get()) );
+        members.push_back(ip+":"+port);
+    }
+    boost::this_thread::sleep_for(boost::chrono::seconds(1));
+
+    // sale then pay, steps of one payment are serialized by its strand
+    struct Flow {
+        WorkerPool::Strand Strand;
+        SubNetBroadcast SubNet;
+        int Step = 0;
+    };
+    std::vector< std::unique_ptr<Flow> > flows;
+    std::atomic<unsigned> finished{0}, failed{0};
+
+    for(unsigned p=0;p<payments;p++) {
+        flows.emplace_back( new Flow() );
+        Flow* flow = flows.back().get();
+        std::string payment_id = "flow-" + std::to_string(p);
+        flow->SubNet.Set(servers[0].get(), payment_id, members);
+
+        int step = 0;
+        for(const char* method : { "FlowTestSale", "FlowTestPay" }) {
+            step++;
+            flow->Strand.Post( [&, flow, payment_id, method, step]() {
+                if( flow->Step!=step-1 ) { ++failed; return; }
+                FLOW_TEST_CALL::request in;
+                in.PaymentID = payment_id;
+                in.Step = step;
+                vector<FLOW_TEST_CALL::response> out;
+                if( !flow->SubNet.Send(method, in, out) || out.size()!=nodes ) ++failed;
+                flow->Step = step;
+                if(step==2) ++finished;
+            } );
+        }
+    }
+    while( finished+failed<payments ) boost::this_thread::sleep_for(boost::chrono::milliseconds(1));
+    ASSERT_EQ(failed, 0);
+    ASSERT_EQ(finished, payments);
+
+    flows.clear();
+    for(auto& s : servers) s->Stop();
+    serverThreads.join_all();
+}
@@ -0,0 +1,130 @@
+// Copyright (c) 2019, The Graft Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include <random>
+
+#include <boost/filesystem.hpp>
+#include <gtest/gtest.h>
+
+#include "cryptonote_core/blockchain_based_list.h"
+#include "graft_rta_config.h"
+
+using namespace cryptonote;
+
+namespace
+{
+
+void add_block(StakeTransactionStorage& storage, std::mt19937_64& rng, uint64_t block_height)
+{
+  size_t txs_count = rng() % 8;
+
+  for (size_t i=0; i<txs_count; i++)
+  {
+    stake_transaction tx;
+
+    tx.hash                     = crypto::rand<crypto::hash>();
+    tx.amount                   = config::graft::TIER1_STAKE_AMOUNT + rng() % config::graft::TIER4_STAKE_AMOUNT;
+    tx.block_height             = block_height;
+    tx.unlock_time              = config::graft::STAKE_MIN_UNLOCK_TIME + rng() % 1000;
+    tx.supernode_public_id      = std::to_string(rng() % 300);
+    tx.supernode_public_address = account_public_address{crypto::rand<crypto::public_key>(), crypto::rand<crypto::public_key>()};
+
+    storage.add_tx(tx);
+  }
+
+  storage.add_last_processed_block(block_height, crypto::rand<crypto::hash>());
+}
+
+void check_equal(const BlockchainBasedList& list1, const BlockchainBasedList& list2)
+{
+  ASSERT_EQ(list1.block_height(), list2.block_height());
+  ASSERT_EQ(list1.history_depth(), list2.history_depth());
+
+  for (size_t depth=0; depth<list1.history_depth(); depth++)
+  {
+    const BlockchainBasedList::supernode_tier_array &tiers1 = list1.tiers(depth), &tiers2 = list2.tiers(depth);
+
+    ASSERT_EQ(tiers1.size(), tiers2.size());
+
+    for (size_t i=0; i<tiers1.size(); i++)
+    {
+      ASSERT_EQ(tiers1[i].size(), tiers2[i].size());
+
+      for (size_t j=0; j<tiers1[i].size(); j++)
+      {
+        const BlockchainBasedList::supernode &s1 = tiers1[i][j], &s2 = tiers2[i][j];
+
+        ASSERT_EQ(s1.supernode_public_id, s2.supernode_public_id);
+        ASSERT_EQ(s1.supernode_public_address, s2.supernode_public_address);
+        ASSERT_EQ(s1.amount, s2.amount);
+        ASSERT_EQ(s1.block_height, s2.block_height);
+        ASSERT_EQ(s1.unlock_time, s2.unlock_time);
+      }
+    }
+  }
+}
+
+}
+
+TEST(blockchain_based_list, journal_restores_history)
+{
+  boost::filesystem::path stakes_path = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path(),
+                          list_path   = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+  std::mt19937_64 rng;
+
+  StakeTransactionStorage stakes(stakes_path.string(), 0);
+  BlockchainBasedList list(list_path.string(), 0);
+
+  const uint64_t blocks_count = 1500;
+
+  for (uint64_t block_height=1; block_height<=blocks_count; block_height++)
+  {
+    add_block(stakes, rng, block_height);
+    list.apply_block(block_height, crypto::rand<crypto::hash>(), stakes);
+
+    if (block_height % 100 == 0)
+    {
+      list.remove_latest_block();
+      list.apply_block(block_height, crypto::rand<crypto::hash>(), stakes);
+    }
+
+    if (block_height % 7 == 0)
+      list.store();
+  }
+
+  ASSERT_FALSE(list.tiers(0)[0].empty());
+
+  list.store();
+
+  BlockchainBasedList loaded_list(list_path.string(), 0);
+
+  check_equal(list, loaded_list);
+
+  boost::filesystem::remove(list_path);
+}
@@ -29,8 +29,13 @@
 
 #include <gtest/gtest.h>
 #include "utils/cryptmsg.h"
+#include "utils/chacha20_poly1305.h"
+#include "string_tools.h"
 
-TEST(Utils, cryptoMessage)
+namespace
+{
+
+void checkCryptoMessage(graft::crypto_tools::MessageVersion version)
 {
     using namespace crypto;
 
@@ -45,7 +50,7 @@ TEST(Utils, cryptoMessage)
 
     std::string data = "12345qwertasdfgzxcvb";
     std::string message;
-    graft::crypto_tools::encryptMessage(data, vec_B, message);
+    graft::crypto_tools::encryptMessage(data, vec_B, message, version);
 
     for(const auto& b : vec_b)
     {
@@ -72,3 +77,81 @@ TEST(Utils, cryptoMessage)
         EXPECT_EQ(res, false);
     }
 }
+
+}
+
+TEST(Utils, cryptoMessage)
+{
+    checkCryptoMessage(graft::crypto_tools::MessageVersion::V1);
+}
+
+TEST(Utils, cryptoMessageV2)
+{
+    checkCryptoMessage(graft::crypto_tools::MessageVersion::V2);
+
+    using namespace crypto;
+
+    public_key B; secret_key b;
+    generate_keys(B,b);
+
+    std::string data = "12345qwertasdfgzxcvb";
+    std::string message, plain;
+    graft::crypto_tools::encryptMessage(data, B, message, graft::crypto_tools::MessageVersion::V2);
+
+    {//tampered data
+        std::string tampered = message;
+        tampered[tampered.size() - 20] ^= 0x01;
+        EXPECT_FALSE(graft::crypto_tools::decryptMessage(tampered, b, plain));
+    }
+    {//tampered head
+        std::string tampered = message;
+        tampered[10] ^= 0x01;
+        EXPECT_FALSE(graft::crypto_tools::decryptMessage(tampered, b, plain));
+    }
+    {//truncated
+        EXPECT_FALSE(graft::crypto_tools::decryptMessage(message.substr(0, message.size() - 1), b, plain));
+    }
+
+    EXPECT_TRUE(graft::crypto_tools::decryptMessage(message, b, plain));
+    EXPECT_EQ(plain, data);
+}
+
+TEST(Utils, chacha20Poly1305)
+{
+    //RFC 8439 2.8.2
+    std::string key, nonce, aad, expected;
+    ASSERT_TRUE(epee::string_tools::parse_hexstr_to_binbuff(std::string("808182838485868788898a8b8c8d8e8f909192939495969798999a9b9c9d9e9f"), key));
+    ASSERT_TRUE(epee::string_tools::parse_hexstr_to_binbuff(std::string("070000004041424344454647"), nonce));
+    ASSERT_TRUE(epee::string_tools::parse_hexstr_to_binbuff(std::string("50515253c0c1c2c3c4c5c6c7"), aad));
+    ASSERT_TRUE(epee::string_tools::parse_hexstr_to_binbuff(std::string(
+        "d31a8d34648e60db7b86afbc53ef7ec2a4aded51296e08fea9e2b5a736ee62d63dbea45e8ca9671282fafb69da92728b"
+        "1a71de0a9e060b2905d6a5b67ecd3b3692ddbd7f2d778b8c9803aee328091b58fab324e4fad675945585808b4831d7bc"
+        "3ff4def08e4b7a9de576d26586cec64b6116"
+        "1ae10b594f09e26a7e902ecbd0600691"), expected));
+    const std::string plain = "Ladies and Gentlemen of the class of '99: If I could offer you only one tip for the future, sunscreen would be it.";
+
+    auto bytes = [](const std::string& str) { return reinterpret_cast<const uint8_t*>(str.data()); };
+
+    std::string cipher(plain.size() + 16, '\0');
+    graft::crypto_tools::chacha20Poly1305Seal(bytes(key), bytes(nonce), bytes(aad), aad.size(), bytes(plain), plain.size(),
+                                              reinterpret_cast<uint8_t*>(&cipher[0]));
+    EXPECT_EQ(cipher, expected);
+
+    std::string decrypted(plain.size(), '\0');
+    EXPECT_TRUE(graft::crypto_tools::chacha20Poly1305Open(bytes(key), bytes(nonce), bytes(aad), aad.size(), bytes(cipher), plain.size(),
+                                                          reinterpret_cast<uint8_t*>(&decrypted[0])));
+    EXPECT_EQ(decrypted, plain);
+
+    {//tampered tag
+        std::string tampered = cipher;
+        tampered.back() ^= 1;
+        EXPECT_FALSE(graft::crypto_tools::chacha20Poly1305Open(bytes(key), bytes(nonce), bytes(aad), aad.size(), bytes(tampered), plain.size(),
+                                                               reinterpret_cast<uint8_t*>(&decrypted[0])));
+    }
+    {//tampered aad
+        std::string tampered = aad;
+        tampered[0] ^= 1;
+        EXPECT_FALSE(graft::crypto_tools::chacha20Poly1305Open(bytes(key), bytes(nonce), bytes(tampered), tampered.size(), bytes(cipher), plain.size(),
+                                                               reinterpret_cast<uint8_t*>(&decrypted[0])));
+    }
+}
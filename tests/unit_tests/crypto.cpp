@@ -26,11 +26,13 @@
 // STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
 // THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
+#include <algorithm>
 #include <cstdint>
 #include <gtest/gtest.h>
 #include <memory>
 #include <sstream>
 #include <string>
+#include <vector>
 
 #include "cryptonote_basic/cryptonote_basic_impl.h"
 
@@ -96,3 +98,58 @@ TEST(Crypto, verify_32)
     }
   }
 }
+
+TEST(Crypto, check_signatures)
+{
+  std::vector<crypto::signature_check> checks(16);
+  for (crypto::signature_check &check : checks)
+  {
+    crypto::secret_key sec;
+    crypto::generate_keys(check.pub, sec);
+    check.prefix_hash = crypto::rand<crypto::hash>();
+    crypto::generate_signature(check.prefix_hash, check.pub, sec, check.sig);
+  }
+
+  std::vector<size_t> failed;
+  ASSERT_TRUE(crypto::check_signatures(checks, &failed));
+  ASSERT_TRUE(failed.empty());
+  ASSERT_TRUE(crypto::check_signatures({}));
+
+  // invalidate some signatures: wrong message, wrong key and malformed scalar
+  checks[3].prefix_hash.data[0] ^= 1;
+  checks[7].pub = checks[8].pub;
+  memset(&checks[11].sig.c, 0xff, sizeof(checks[11].sig.c));
+
+  ASSERT_FALSE(crypto::check_signatures(checks, &failed));
+  ASSERT_EQ(failed, std::vector<size_t>({3, 7, 11}));
+
+  for (size_t i = 0; i < checks.size(); ++i)
+    ASSERT_EQ(crypto::check_signature(checks[i].prefix_hash, checks[i].pub, checks[i].sig), !std::count(failed.begin(), failed.end(), i));
+}
+
+TEST(Crypto, generate_key_derivations)
+{
+  crypto::public_key tx_pub;
+  crypto::secret_key tx_sec;
+  crypto::generate_keys(tx_pub, tx_sec);
+
+  std::vector<crypto::secret_key> view_keys(8);
+  for (crypto::secret_key &view_key : view_keys)
+  {
+    crypto::public_key view_pub;
+    crypto::generate_keys(view_pub, view_key);
+  }
+
+  std::vector<crypto::key_derivation> derivations;
+  ASSERT_TRUE(crypto::generate_key_derivations(tx_pub, view_keys, derivations));
+  ASSERT_EQ(derivations.size(), view_keys.size());
+  for (size_t i = 0; i < view_keys.size(); ++i)
+  {
+    crypto::key_derivation derivation;
+    ASSERT_TRUE(crypto::generate_key_derivation(tx_pub, view_keys[i], derivation));
+    ASSERT_EQ(0, memcmp(&derivations[i], &derivation, sizeof(derivation)));
+  }
+
+  ASSERT_TRUE(crypto::generate_key_derivations(tx_pub, {}, derivations));
+  ASSERT_TRUE(derivations.empty());
+}
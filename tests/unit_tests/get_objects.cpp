@@ -0,0 +1,207 @@
+// Copyright (c) 2019, The Graft Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "gtest/gtest.h"
+#include "cryptonote_core/cryptonote_core.h"
+#include "cryptonote_protocol/cryptonote_protocol_handler.h"
+#include "cryptonote_protocol/cryptonote_protocol_handler.inl"
+#include "common/pruning.h"
+
+namespace
+{
+  // answers NOTIFY_REQUEST_GET_OBJECTS the way Blockchain::handle_get_objects does on a
+  // pruned node for blocks out of its stripe
+  class pruned_core
+  {
+  public:
+    void on_synchronized(){}
+    void safesyncmode(const bool){}
+    uint64_t get_current_blockchain_height() const {return 1;}
+    void set_target_blockchain_height(uint64_t) {}
+    bool init(const boost::program_options::variables_map& vm) {return true ;}
+    bool deinit(){return true;}
+    bool get_short_chain_history(std::list<crypto::hash>& ids) const { ids.push_back(crypto::null_hash); return true; }
+    bool get_stat_info(cryptonote::core_stat_info& st_inf) const {return true;}
+    bool have_block(const crypto::hash& id) const {return false;}
+    void get_blockchain_top(uint64_t& height, crypto::hash& top_id)const{height=0;top_id=crypto::null_hash;}
+    bool handle_incoming_tx(const cryptonote::blobdata& tx_blob, cryptonote::tx_verification_context& tvc, bool keeped_by_block, bool relayed, bool do_not_relay) { return true; }
+    bool handle_incoming_txs(const std::vector<cryptonote::blobdata>& tx_blob, std::vector<cryptonote::tx_verification_context>& tvc, bool keeped_by_block, bool relayed, bool do_not_relay) { return true; }
+    bool handle_incoming_block(const cryptonote::blobdata& block_blob, cryptonote::block_verification_context& bvc, bool update_miner_blocktemplate = true) { return true; }
+    void pause_mine(){}
+    void resume_mine(){}
+    bool on_idle(){return true;}
+    bool find_blockchain_supplement(const std::list<crypto::hash>& qblock_ids, cryptonote::NOTIFY_RESPONSE_CHAIN_ENTRY::request& resp){return true;}
+    bool handle_get_objects(cryptonote::NOTIFY_REQUEST_GET_OBJECTS::request& arg, cryptonote::NOTIFY_RESPONSE_GET_OBJECTS::request& rsp, cryptonote::cryptonote_connection_context& context)
+    {
+      rsp.current_blockchain_height = height;
+      rsp.missed_ids = arg.blocks;
+      return true;
+    }
+    bool get_test_drop_download() const {return true;}
+    bool get_test_drop_download_height() const {return true;}
+    bool prepare_handle_incoming_blocks(const std::vector<cryptonote::block_complete_entry>  &blocks) { return true; }
+    bool cleanup_handle_incoming_blocks(bool force_sync = false) { return true; }
+    uint64_t get_target_blockchain_height() const { return height; }
+    size_t get_block_sync_size(uint64_t height) const { return BLOCKS_SYNCHRONIZING_DEFAULT_COUNT; }
+    virtual void on_transaction_relayed(const cryptonote::blobdata& tx) {}
+    cryptonote::network_type get_nettype() const { return cryptonote::MAINNET; }
+    bool get_pool_transaction(const crypto::hash& id, cryptonote::blobdata& tx_blob) const { return false; }
+    bool pool_has_tx(const crypto::hash &txid) const { return false; }
+    bool get_blocks(uint64_t start_offset, size_t count, std::vector<std::pair<cryptonote::blobdata, cryptonote::block>>& blocks, std::vector<cryptonote::blobdata>& txs) const { return false; }
+    bool get_transactions(const std::vector<crypto::hash>& txs_ids, std::vector<cryptonote::transaction>& txs, std::vector<crypto::hash>& missed_txs) const { return false; }
+    bool get_block_by_hash(const crypto::hash &h, cryptonote::block &blk, bool *orphan = NULL) const { return false; }
+    uint8_t get_ideal_hard_fork_version() const { return 0; }
+    uint8_t get_ideal_hard_fork_version(uint64_t height) const { return 0; }
+    uint32_t get_blockchain_pruning_seed() const { return pruning_seed; }
+    uint8_t get_hard_fork_version(uint64_t height) const { return 0; }
+    uint64_t get_earliest_ideal_height_for_version(uint8_t version) const { return 0; }
+    cryptonote::difficulty_type get_block_cumulative_difficulty(uint64_t height) const { return 0; }
+    bool fluffy_blocks_enabled() const { return false; }
+    uint64_t prevalidate_block_hashes(uint64_t height, const std::vector<crypto::hash> &hashes) { return 0; }
+    void stop() {}
+    void invoke_update_stakes_handler() {}
+    typedef cryptonote::StakeTransactionProcessor::supernode_stakes_update_handler supernode_stakes_update_handler;
+    void set_update_stakes_handler(const supernode_stakes_update_handler&) {}
+    void invoke_stake_transactions_update_handler() {}
+    typedef cryptonote::StakeTransactionProcessor::blockchain_based_list_update_handler blockchain_based_list_update_handler;
+    void set_update_blockchain_based_list_handler(const blockchain_based_list_update_handler&) {}
+    void invoke_update_blockchain_based_list_handler(uint64_t last_received_block_height) {}
+
+    uint64_t height = 100000;
+    uint32_t pruning_seed = tools::make_pruning_seed(1, CRYPTONOTE_PRUNING_LOG_STRIPES);
+  };
+
+  // a single peer connection, remembers what the protocol handler did with it
+  struct test_p2p: public nodetool::p2p_endpoint_stub<cryptonote::cryptonote_connection_context>
+  {
+    virtual bool invoke_notify_to_peer(int command, const std::string& req_buff, const epee::net_utils::connection_context_base& context)
+    {
+      notifies.emplace_back(command, req_buff);
+      return true;
+    }
+    virtual bool drop_connection(const epee::net_utils::connection_context_base& context)
+    {
+      ++drops;
+      return true;
+    }
+    virtual bool for_connection(const boost::uuids::uuid&, std::function<bool(cryptonote::cryptonote_connection_context&,nodetool::peerid_type,uint32_t)> f)
+    {
+      cryptonote::cryptonote_connection_context context;
+      return f(context, 0, support_flags);
+    }
+
+    uint32_t support_flags = 0;
+    std::vector<std::pair<int, std::string>> notifies;
+    size_t drops = 0;
+  };
+
+  typedef cryptonote::t_cryptonote_protocol_handler<pruned_core> protocol;
+
+  template<typename t_arg>
+  bool notify(protocol &handler, cryptonote::cryptonote_connection_context &context, const typename t_arg::request &arg)
+  {
+    std::string in_buff, out_buff;
+    bool handled = false;
+    if (!epee::serialization::store_t_to_binary(arg, in_buff))
+      return false;
+    handler.handle_invoke_map(true, t_arg::ID, in_buff, out_buff, context, handled);
+    return handled;
+  }
+
+  std::vector<crypto::hash> make_hashes(size_t n)
+  {
+    std::vector<crypto::hash> hashes(n);
+    for (size_t i = 0; i < n; ++i)
+      hashes[i] = crypto::cn_fast_hash(&i, sizeof(i));
+    return hashes;
+  }
+}
+
+TEST(get_objects, legacy_request_for_pruned_blocks_gets_reply)
+{
+  pruned_core core;
+  test_p2p p2p;
+  p2p.support_flags = P2P_SUPPORT_FLAG_FLUFFY_BLOCKS;
+  protocol handler(core, &p2p);
+  cryptonote::cryptonote_connection_context context;
+
+  cryptonote::NOTIFY_REQUEST_GET_OBJECTS::request req;
+  req.blocks = make_hashes(20);
+  ASSERT_TRUE(notify<cryptonote::NOTIFY_REQUEST_GET_OBJECTS>(handler, context, req));
+
+  ASSERT_EQ(0, p2p.drops);
+  ASSERT_EQ(1, p2p.notifies.size());
+  ASSERT_EQ((int)cryptonote::NOTIFY_RESPONSE_GET_OBJECTS::ID, p2p.notifies[0].first);
+  cryptonote::NOTIFY_RESPONSE_GET_OBJECTS::request rsp;
+  ASSERT_TRUE(epee::serialization::load_t_from_binary(rsp, p2p.notifies[0].second));
+  ASSERT_TRUE(rsp.blocks.empty());
+  ASSERT_EQ(req.blocks, rsp.missed_ids);
+  ASSERT_EQ(core.height, rsp.current_blockchain_height);
+}
+
+TEST(get_objects, missed_blocks_from_pruned_peer)
+{
+  pruned_core core;
+  test_p2p p2p;
+  p2p.support_flags = P2P_SUPPORT_FLAGS;
+  protocol handler(core, &p2p);
+  cryptonote::cryptonote_connection_context context;
+  context.m_state = cryptonote::cryptonote_connection_context::state_synchronizing;
+  context.m_pruning_seed = tools::make_pruning_seed(2, CRYPTONOTE_PRUNING_LOG_STRIPES);
+
+  cryptonote::NOTIFY_RESPONSE_GET_OBJECTS::request rsp;
+  rsp.missed_ids = make_hashes(20);
+  rsp.current_blockchain_height = core.height;
+  context.m_requested_objects.insert(rsp.missed_ids.begin(), rsp.missed_ids.end());
+  ASSERT_TRUE(notify<cryptonote::NOTIFY_RESPONSE_GET_OBJECTS>(handler, context, rsp));
+
+  // the span is requested elsewhere, the peer is kept
+  ASSERT_EQ(0, p2p.drops);
+  ASSERT_TRUE(context.m_requested_objects.empty());
+  ASSERT_EQ(core.height, context.m_remote_blockchain_height);
+}
+
+TEST(get_objects, missed_blocks_from_legacy_peer)
+{
+  pruned_core core;
+  test_p2p p2p;
+  p2p.support_flags = P2P_SUPPORT_FLAG_FLUFFY_BLOCKS;
+  protocol handler(core, &p2p);
+  cryptonote::cryptonote_connection_context context;
+  context.m_state = cryptonote::cryptonote_connection_context::state_synchronizing;
+
+  cryptonote::NOTIFY_RESPONSE_GET_OBJECTS::request rsp;
+  rsp.missed_ids = make_hashes(20);
+  rsp.current_blockchain_height = core.height;
+  context.m_requested_objects.insert(rsp.missed_ids.begin(), rsp.missed_ids.end());
+  ASSERT_TRUE(notify<cryptonote::NOTIFY_RESPONSE_GET_OBJECTS>(handler, context, rsp));
+
+  // a full node has no reason to miss blocks of the main chain
+  ASSERT_EQ(1, p2p.drops);
+}
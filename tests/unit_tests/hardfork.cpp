@@ -126,6 +126,10 @@ public:
   virtual bool get_txpool_tx_meta(const crypto::hash& txid, txpool_tx_meta_t &meta) const { return false; }
   virtual bool get_txpool_tx_blob(const crypto::hash& txid, cryptonote::blobdata &bd) const { return false; }
   virtual uint64_t get_database_size() const { return 0; }
+  virtual uint32_t get_blockchain_pruning_seed() const { return 0; }
+  virtual bool prune_blockchain(uint32_t pruning_seed = 0) { return true; }
+  virtual bool update_pruning() { return true; }
+  virtual bool check_pruning() { return true; }
   virtual cryptonote::blobdata get_txpool_tx_blob(const crypto::hash& txid) const { return ""; }
   virtual bool for_all_txpool_txes(std::function<bool(const crypto::hash&, const txpool_tx_meta_t&, const cryptonote::blobdata*)>, bool include_blob = false, bool include_unrelayed_txes = false) const { return false; }
 
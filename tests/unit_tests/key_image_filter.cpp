@@ -0,0 +1,277 @@
+// Copyright (c) 2019, The Graft Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include <fstream>
+#include <boost/filesystem.hpp>
+#include "gtest/gtest.h"
+
+#include "crypto/crypto.h"
+#include "blockchain_db/key_image_filter.h"
+
+namespace
+{
+  std::vector<crypto::key_image> make_key_images(size_t n)
+  {
+    std::vector<crypto::key_image> key_images(n);
+    for (auto &ki: key_images)
+      ki = crypto::rand<crypto::key_image>();
+    return key_images;
+  }
+
+  bool contains_all(const cryptonote::key_image_filter &filter, const std::vector<crypto::key_image> &key_images)
+  {
+    for (const auto &ki: key_images)
+      if (!filter.may_contain(ki))
+        return false;
+    return true;
+  }
+
+  // same as BlockchainLMDB does from the spent keys table
+  void rebuild(cryptonote::key_image_filter &filter, const std::vector<crypto::key_image> &key_images, uint64_t n_key_images)
+  {
+    cryptonote::key_image_filter rebuilt;
+    rebuilt.reset(n_key_images);
+    for (const auto &ki: key_images)
+      rebuilt.insert(ki);
+    filter.swap(rebuilt);
+  }
+
+  class key_image_filter_file : public ::testing::Test
+  {
+  protected:
+    key_image_filter_file()
+      : filename((boost::filesystem::temp_directory_path() / boost::filesystem::unique_path()).string())
+      , key_images(make_key_images(1000))
+      , top_hash(crypto::rand<crypto::hash>())
+    {
+      filter.reset(key_images.size());
+      for (const auto &ki: key_images)
+        filter.insert(ki);
+    }
+
+    ~key_image_filter_file()
+    {
+      boost::system::error_code ec;
+      boost::filesystem::remove(filename, ec);
+    }
+
+    void overwrite(size_t offset, const std::string &bytes)
+    {
+      std::fstream f(filename, std::ios::binary | std::ios::in | std::ios::out);
+      f.seekp(offset);
+      f.write(bytes.data(), bytes.size());
+    }
+
+    void flip(size_t offset)
+    {
+      std::fstream f(filename, std::ios::binary | std::ios::in | std::ios::out);
+      f.seekg(offset);
+      const char byte = f.get();
+      f.seekp(offset);
+      f.put(~byte);
+    }
+
+    bool load_fails()
+    {
+      cryptonote::key_image_filter loaded;
+      return !loaded.load(filename, top_hash, key_images.size()) && !loaded.enabled();
+    }
+
+    // magic, version, top block hash, key image count, size, word count
+    static constexpr size_t header_size = 8 + 4 + 32 + 3 * 8;
+
+    const std::string filename;
+    const std::vector<crypto::key_image> key_images;
+    const crypto::hash top_hash;
+    cryptonote::key_image_filter filter;
+  };
+}
+
+TEST(key_image_filter, disabled_until_reset)
+{
+  cryptonote::key_image_filter filter;
+  const crypto::key_image ki = crypto::rand<crypto::key_image>();
+  ASSERT_FALSE(filter.enabled());
+  ASSERT_TRUE(filter.may_contain(ki));
+  filter.insert(ki);
+  ASSERT_EQ(filter.size(), 0);
+
+  filter.reset(0);
+  ASSERT_TRUE(filter.enabled());
+  ASSERT_FALSE(filter.may_contain(ki));
+
+  filter.clear();
+  ASSERT_FALSE(filter.enabled());
+  ASSERT_TRUE(filter.may_contain(ki));
+}
+
+TEST(key_image_filter, no_false_negatives)
+{
+  const std::vector<crypto::key_image> key_images = make_key_images(100000);
+  cryptonote::key_image_filter filter;
+  filter.reset(key_images.size());
+  for (const auto &ki: key_images)
+    filter.insert(ki);
+  ASSERT_EQ(filter.size(), key_images.size());
+  ASSERT_FALSE(filter.full());
+  ASSERT_TRUE(contains_all(filter, key_images));
+
+  // a rebuild swapped in keeps everything, and the old filter is intact until dropped
+  cryptonote::key_image_filter old;
+  old.swap(filter);
+  rebuild(filter, key_images, key_images.size());
+  ASSERT_EQ(filter.size(), key_images.size());
+  ASSERT_TRUE(contains_all(filter, key_images));
+  ASSERT_TRUE(contains_all(old, key_images));
+
+  filter.swap(old);
+  ASSERT_TRUE(contains_all(filter, key_images));
+  ASSERT_TRUE(contains_all(old, key_images));
+}
+
+TEST(key_image_filter, false_positive_rate)
+{
+  const std::vector<crypto::key_image> key_images = make_key_images(100000);
+  cryptonote::key_image_filter filter;
+  filter.reset(key_images.size());
+  for (const auto &ki: key_images)
+    filter.insert(ki);
+
+  size_t false_positives = 0;
+  for (const auto &ki: make_key_images(100000))
+    false_positives += filter.may_contain(ki);
+  ASSERT_LT(false_positives, 1000);
+}
+
+TEST(key_image_filter, grows_when_full)
+{
+  cryptonote::key_image_filter filter;
+  filter.reset(0);
+
+  // inserted one by one, growing as add_spent_key does
+  std::vector<crypto::key_image> key_images;
+  size_t rebuilds = 0;
+  for (size_t i = 0; i < 150000; ++i)
+  {
+    key_images.push_back(crypto::rand<crypto::key_image>());
+    filter.insert(key_images.back());
+    if (filter.full())
+    {
+      rebuild(filter, key_images, 2 * filter.size());
+      ASSERT_FALSE(filter.full());
+      ++rebuilds;
+    }
+    ASSERT_TRUE(filter.may_contain(key_images.back()));
+  }
+  ASSERT_GT(rebuilds, 1);
+  ASSERT_EQ(filter.size(), key_images.size());
+  ASSERT_TRUE(contains_all(filter, key_images));
+
+  // still sized well after growing
+  size_t false_positives = 0;
+  for (const auto &ki: make_key_images(50000))
+    false_positives += filter.may_contain(ki);
+  ASSERT_LT(false_positives, 500);
+}
+
+TEST_F(key_image_filter_file, store_load)
+{
+  cryptonote::key_image_filter empty;
+  ASSERT_FALSE(empty.store(filename, top_hash, key_images.size()));
+
+  ASSERT_TRUE(filter.store(filename, top_hash, key_images.size()));
+  cryptonote::key_image_filter loaded;
+  ASSERT_TRUE(loaded.load(filename, top_hash, key_images.size()));
+  ASSERT_EQ(loaded.size(), key_images.size());
+  ASSERT_TRUE(contains_all(loaded, key_images));
+}
+
+TEST_F(key_image_filter_file, rejects_stale)
+{
+  ASSERT_TRUE(filter.store(filename, top_hash, key_images.size()));
+
+  cryptonote::key_image_filter loaded;
+  ASSERT_FALSE(loaded.load(filename, crypto::rand<crypto::hash>(), key_images.size()));
+  ASSERT_FALSE(loaded.load(filename, top_hash, key_images.size() + 1));
+  ASSERT_FALSE(loaded.load(filename, top_hash, key_images.size() - 1));
+  ASSERT_FALSE(loaded.enabled());
+  ASSERT_TRUE(loaded.may_contain(crypto::rand<crypto::key_image>()));
+}
+
+TEST_F(key_image_filter_file, rejects_truncated)
+{
+  ASSERT_TRUE(filter.store(filename, top_hash, key_images.size()));
+  const uint64_t file_size = boost::filesystem::file_size(filename);
+
+  for (uint64_t size: {file_size - 1, file_size - 32, (uint64_t)header_size + 64, (uint64_t)header_size, (uint64_t)20, (uint64_t)0})
+  {
+    boost::filesystem::resize_file(filename, size);
+    ASSERT_TRUE(load_fails()) << "size " << size;
+  }
+
+  ASSERT_TRUE(filter.store(filename, top_hash, key_images.size()));
+  boost::filesystem::resize_file(filename, file_size + 8);
+  ASSERT_TRUE(load_fails());
+}
+
+TEST_F(key_image_filter_file, rejects_corrupt)
+{
+  // bad magic
+  ASSERT_TRUE(filter.store(filename, top_hash, key_images.size()));
+  flip(0);
+  ASSERT_TRUE(load_fails());
+
+  // unknown version
+  ASSERT_TRUE(filter.store(filename, top_hash, key_images.size()));
+  flip(8);
+  ASSERT_TRUE(load_fails());
+
+  // word count not a power of two number of blocks
+  ASSERT_TRUE(filter.store(filename, top_hash, key_images.size()));
+  overwrite(header_size - 8, std::string("\x08\x20\0\0\0\0\0\0", 8));
+  ASSERT_TRUE(load_fails());
+
+  // word count far beyond the file, must not be allocated
+  ASSERT_TRUE(filter.store(filename, top_hash, key_images.size()));
+  overwrite(header_size - 8, std::string("\0\0\0\0\0\0\0\x01", 8));
+  ASSERT_TRUE(load_fails());
+
+  // changed bits in the payload, a cleared one could give false negatives
+  for (size_t offset: {header_size, header_size + 4096})
+  {
+    ASSERT_TRUE(filter.store(filename, top_hash, key_images.size()));
+    flip(offset);
+    ASSERT_TRUE(load_fails()) << "offset " << offset;
+  }
+
+  // damaged checksum
+  ASSERT_TRUE(filter.store(filename, top_hash, key_images.size()));
+  flip(boost::filesystem::file_size(filename) - 1);
+  ASSERT_TRUE(load_fails());
+}
@@ -0,0 +1,128 @@
+// Copyright (c) 2019, The Graft Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "gtest/gtest.h"
+
+#include "crypto/crypto.h"
+#include "blockchain_db/output_cache.h"
+
+namespace
+{
+  cryptonote::output_data_t make_output(uint64_t height)
+  {
+    cryptonote::output_data_t data;
+    data.pubkey = crypto::rand<crypto::public_key>();
+    data.unlock_time = 0;
+    data.height = height;
+    data.commitment = crypto::rand<rct::key>();
+    return data;
+  }
+}
+
+TEST(output_cache, get_put)
+{
+  cryptonote::output_cache cache;
+  cryptonote::output_data_t data;
+  const cryptonote::output_data_t out = make_output(10);
+  ASSERT_FALSE(cache.get(0, 5, data));
+  cache.put(0, 5, out, 1);
+  ASSERT_TRUE(cache.get(0, 5, data));
+  ASSERT_EQ(data.pubkey, out.pubkey);
+  ASSERT_EQ(data.height, 10);
+  ASSERT_FALSE(cache.get(1, 5, data));
+  ASSERT_FALSE(cache.get(0, 6, data));
+  ASSERT_EQ(cache.hits(), 1);
+  ASSERT_EQ(cache.misses(), 3);
+  ASSERT_EQ(cache.size(), 1);
+}
+
+TEST(output_cache, bounded)
+{
+  cryptonote::output_cache cache(1024);
+  for (uint64_t i = 0; i < 10000; ++i)
+    cache.put(0, i, make_output(i), 1);
+  ASSERT_LE(cache.size(), 1024);
+  ASSERT_GT(cache.size(), 512);
+
+  // recently used outputs are kept
+  cryptonote::output_data_t data;
+  ASSERT_TRUE(cache.get(0, 9999, data));
+  ASSERT_FALSE(cache.get(0, 0, data));
+}
+
+TEST(output_cache, lru)
+{
+  // one set of eight ways in each of the 16 shards
+  cryptonote::output_cache cache(128);
+  cryptonote::output_data_t data;
+  cache.put(0, 0, make_output(0), 1);
+  for (uint64_t i = 1; i < 1000; ++i)
+  {
+    ASSERT_TRUE(cache.get(0, 0, data));
+    cache.put(0, i, make_output(i), 1);
+  }
+  ASSERT_EQ(cache.size(), 128);
+}
+
+TEST(output_cache, remove)
+{
+  cryptonote::output_cache cache;
+  cryptonote::output_data_t data;
+  cache.put(0, 5, make_output(10), 3);
+  cache.put(0, 6, make_output(10), 3);
+  cache.remove(0, 5, 4);
+  ASSERT_FALSE(cache.get(0, 5, data));
+  ASSERT_TRUE(cache.get(0, 6, data));
+
+  // a reader which started before the removal can't add it back
+  cache.put(0, 5, make_output(10), 3);
+  ASSERT_FALSE(cache.get(0, 5, data));
+  cache.put(0, 5, make_output(11), 4);
+  ASSERT_TRUE(cache.get(0, 5, data));
+  ASSERT_EQ(data.height, 11);
+
+  // an older removal does not lower the generation
+  cache.remove(0, 7, 2);
+  cache.put(0, 8, make_output(10), 3);
+  ASSERT_FALSE(cache.get(0, 8, data));
+}
+
+TEST(output_cache, clear)
+{
+  cryptonote::output_cache cache;
+  cryptonote::output_data_t data;
+  cache.put(0, 5, make_output(10), 3);
+  cache.clear(5);
+  ASSERT_EQ(cache.size(), 0);
+  cache.put(0, 5, make_output(10), 4);
+  ASSERT_FALSE(cache.get(0, 5, data));
+  cache.clear();
+  cache.put(0, 5, make_output(10), 1);
+  ASSERT_TRUE(cache.get(0, 5, data));
+}
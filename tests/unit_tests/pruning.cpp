@@ -0,0 +1,129 @@
+// Copyright (c) 2019, The Graft Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include <gtest/gtest.h>
+
+#include "cryptonote_config.h"
+#include "common/pruning.h"
+
+#define ASSERT_EX(x) do { bool ex = false; try { x; } catch(...) { ex = true; } ASSERT_TRUE(ex); } while(0)
+
+static constexpr uint64_t STRIPE = CRYPTONOTE_PRUNING_STRIPE_SIZE;
+static constexpr uint64_t TIP = CRYPTONOTE_PRUNING_TIP_BLOCKS;
+
+TEST(pruning, seed)
+{
+  for (uint32_t log_stripes = 1; log_stripes <= 7; ++log_stripes)
+  {
+    for (uint32_t stripe = 1; stripe <= (1u << log_stripes); ++stripe)
+    {
+      const uint32_t seed = tools::make_pruning_seed(stripe, log_stripes);
+      ASSERT_NE(seed, 0);
+      ASSERT_EQ(tools::get_pruning_log_stripes(seed), log_stripes);
+      ASSERT_EQ(tools::get_pruning_stripe(seed), stripe);
+    }
+  }
+  ASSERT_EQ(tools::get_pruning_stripe(0), 0);
+  ASSERT_EX(tools::make_pruning_seed(0, 3));
+  ASSERT_EX(tools::make_pruning_seed(9, 3));
+  ASSERT_EX(tools::make_pruning_seed(1, 8));
+}
+
+TEST(pruning, block_stripe)
+{
+  const uint64_t height = 100 * STRIPE;
+  ASSERT_EQ(tools::get_pruning_stripe(0, height, 3), 1);
+  ASSERT_EQ(tools::get_pruning_stripe(STRIPE - 1, height, 3), 1);
+  ASSERT_EQ(tools::get_pruning_stripe(STRIPE, height, 3), 2);
+  ASSERT_EQ(tools::get_pruning_stripe(7 * STRIPE, height, 3), 8);
+  ASSERT_EQ(tools::get_pruning_stripe(8 * STRIPE, height, 3), 1);
+  ASSERT_NE(tools::get_pruning_stripe(height - TIP - 1, height, 3), 0);
+  ASSERT_EQ(tools::get_pruning_stripe(height - TIP, height, 3), 0);
+  ASSERT_EQ(tools::get_pruning_stripe(height - 1, height, 3), 0);
+}
+
+TEST(pruning, has_unpruned_block)
+{
+  const uint64_t height = 100 * STRIPE;
+  const uint32_t seed = tools::make_pruning_seed(2, 3);
+  ASSERT_FALSE(tools::has_unpruned_block(0, height, seed));
+  ASSERT_TRUE(tools::has_unpruned_block(STRIPE, height, seed));
+  ASSERT_TRUE(tools::has_unpruned_block(2 * STRIPE - 1, height, seed));
+  ASSERT_FALSE(tools::has_unpruned_block(2 * STRIPE, height, seed));
+  ASSERT_TRUE(tools::has_unpruned_block(9 * STRIPE, height, seed));
+  ASSERT_TRUE(tools::has_unpruned_block(height - 1, height, seed));
+  for (uint64_t h = 0; h < height; h += STRIPE / 2)
+    ASSERT_TRUE(tools::has_unpruned_block(h, height, 0));
+
+  // every old block is kept in full by exactly one stripe
+  for (uint64_t h = 0; h < height - TIP; h += 97)
+  {
+    size_t n = 0;
+    for (uint32_t stripe = 1; stripe <= 8; ++stripe)
+      n += tools::has_unpruned_block(h, height, tools::make_pruning_seed(stripe, 3));
+    ASSERT_EQ(n, 1);
+  }
+}
+
+TEST(pruning, next_heights)
+{
+  const uint64_t height = 100 * STRIPE;
+  const uint32_t seed = tools::make_pruning_seed(2, 3);
+
+  ASSERT_EQ(tools::get_next_unpruned_block_height(0, height, seed), STRIPE);
+  ASSERT_EQ(tools::get_next_unpruned_block_height(STRIPE + 5, height, seed), STRIPE + 5);
+  ASSERT_EQ(tools::get_next_unpruned_block_height(2 * STRIPE, height, seed), 9 * STRIPE);
+  ASSERT_EQ(tools::get_next_unpruned_block_height(height - TIP - 1, height, seed), height - TIP);
+  ASSERT_EQ(tools::get_next_unpruned_block_height(0, height, 0), 0);
+
+  ASSERT_EQ(tools::get_next_pruned_block_height(0, height, seed), 0);
+  ASSERT_EQ(tools::get_next_pruned_block_height(STRIPE, height, seed), 2 * STRIPE);
+  ASSERT_EQ(tools::get_next_pruned_block_height(2 * STRIPE - 1, height, seed), 2 * STRIPE);
+  ASSERT_EQ(tools::get_next_pruned_block_height(height - TIP, height, seed), height);
+  ASSERT_EQ(tools::get_next_pruned_block_height(0, height, 0), height);
+
+  for (uint64_t h = 0; h < height; h += 101)
+  {
+    const uint64_t next = tools::get_next_unpruned_block_height(h, height, seed);
+    ASSERT_GE(next, h);
+    ASSERT_TRUE(tools::has_unpruned_block(next, height, seed));
+    for (uint64_t i = h; i < next; i += 53)
+      ASSERT_FALSE(tools::has_unpruned_block(i, height, seed));
+  }
+}
+
+TEST(pruning, random_stripe)
+{
+  for (int i = 0; i < 100; ++i)
+  {
+    const uint32_t stripe = tools::get_random_stripe();
+    ASSERT_GE(stripe, 1);
+    ASSERT_LE(stripe, 1u << CRYPTONOTE_PRUNING_LOG_STRIPES);
+  }
+}
@@ -0,0 +1,148 @@
+// Copyright (c) 2019, The Graft Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include <gtest/gtest.h>
+
+#include "p2p/p2p_protocol_defs.h"
+#include "p2p/rta_relay_blob.h"
+#include "storages/portable_storage_template_helper.h"
+
+namespace
+{
+
+nodetool::COMMAND_MULTICAST::request make_multicast(uint64_t hop)
+{
+  nodetool::COMMAND_MULTICAST::request req;
+
+  req.receiver_addresses = {"receiver1", "receiver2"};
+  req.sender_address     = "sender";
+  req.callback_uri       = "/callback";
+  req.data               = std::string("payload \x03hop\x05 with a fake hop field", 38) + std::string(300, 'x');
+  req.wait_answer        = true;
+  req.hop                = hop;
+  req.message_id         = "message";
+
+  return req;
+}
+
+}
+
+TEST(rta_relay_blob, decrement_hop_in_place)
+{
+  nodetool::COMMAND_MULTICAST::request req = make_multicast(5);
+  std::string blob;
+  ASSERT_TRUE(epee::serialization::store_t_to_binary(req, blob));
+  const size_t size = blob.size();
+
+  uint64_t hop = 0;
+  ASSERT_TRUE(nodetool::get_binary_hop(blob, hop));
+  ASSERT_EQ(5, hop);
+
+  ASSERT_TRUE(nodetool::decrement_binary_hop(blob));
+  ASSERT_EQ(size, blob.size());
+
+  nodetool::COMMAND_MULTICAST::request relayed = make_multicast(4), loaded;
+  std::string expected;
+  ASSERT_TRUE(epee::serialization::store_t_to_binary(relayed, expected));
+  ASSERT_EQ(expected, blob);
+
+  ASSERT_TRUE(epee::serialization::load_t_from_binary(loaded, blob));
+  ASSERT_EQ(4, loaded.hop);
+  ASSERT_EQ(relayed.data, loaded.data);
+  ASSERT_EQ(relayed.receiver_addresses, loaded.receiver_addresses);
+}
+
+TEST(rta_relay_blob, hop_exhausted)
+{
+  nodetool::COMMAND_MULTICAST::request req = make_multicast(1);
+  std::string blob;
+  ASSERT_TRUE(epee::serialization::store_t_to_binary(req, blob));
+  ASSERT_TRUE(nodetool::decrement_binary_hop(blob));
+  const std::string exhausted = blob;
+  ASSERT_FALSE(nodetool::decrement_binary_hop(blob));
+  ASSERT_EQ(exhausted, blob);
+}
+
+TEST(rta_relay_blob, malformed_blob)
+{
+  nodetool::COMMAND_MULTICAST::request req = make_multicast(3);
+  std::string blob;
+  ASSERT_TRUE(epee::serialization::store_t_to_binary(req, blob));
+
+  uint8_t type;
+  size_t offset;
+  ASSERT_TRUE(nodetool::find_binary_field(blob, "hop", type, offset));
+  ASSERT_EQ(SERIALIZE_TYPE_UINT64, type);
+
+  uint64_t hop;
+  for (size_t size = 0; size < offset + sizeof(hop); ++size)
+  {
+    std::string truncated = blob.substr(0, size);
+    ASSERT_FALSE(nodetool::decrement_binary_hop(truncated));
+  }
+
+  nodetool::COMMAND_PING::request ping;
+  std::string no_hop;
+  ASSERT_TRUE(epee::serialization::store_t_to_binary(ping, no_hop));
+  ASSERT_FALSE(nodetool::get_binary_hop(no_hop, hop));
+  ASSERT_FALSE(nodetool::get_binary_hop("garbage", hop));
+}
+
+TEST(rta_relay_blob, check_fields)
+{
+  nodetool::COMMAND_MULTICAST::request req = make_multicast(3);
+  std::string blob;
+  ASSERT_TRUE(epee::serialization::store_t_to_binary(req, blob));
+  ASSERT_TRUE(nodetool::check_binary_fields(blob, nodetool::COMMAND_MULTICAST::request::relay_fields()));
+  ASSERT_FALSE(nodetool::check_binary_fields(blob, nodetool::COMMAND_UNICAST::request::relay_fields()));
+
+  // a field the request doesn't have would be forwarded as is
+  epee::serialization::portable_storage ps;
+  ASSERT_TRUE(ps.load_from_binary(blob));
+  ASSERT_TRUE(ps.set_value("extra", std::string(1000, 'e'), nullptr));
+  std::string extra;
+  ASSERT_TRUE(ps.store_to_binary(extra));
+  ASSERT_FALSE(nodetool::check_binary_fields(extra, nodetool::COMMAND_MULTICAST::request::relay_fields()));
+
+  // trailing bytes after the storage
+  ASSERT_FALSE(nodetool::check_binary_fields(blob + "x", nodetool::COMMAND_MULTICAST::request::relay_fields()));
+  ASSERT_FALSE(nodetool::check_binary_fields(blob.substr(0, blob.size() - 1), nodetool::COMMAND_MULTICAST::request::relay_fields()));
+
+  // a second hop field would keep its value while the first one is decremented
+  uint8_t type;
+  size_t offset;
+  ASSERT_TRUE(nodetool::find_binary_field(blob, "hop", type, offset));
+  const size_t field_start = offset - 1 - 1 - 3; // name length, name, type
+  std::string duplicate = blob;
+  duplicate.insert(offset + sizeof(uint64_t), blob.substr(field_start, offset + sizeof(uint64_t) - field_start));
+  // 7 fields are stored, the count is a single byte varint
+  ASSERT_EQ(7 << 2, uint8_t(duplicate[9]));
+  duplicate[9] = 8 << 2;
+  ASSERT_FALSE(nodetool::check_binary_fields(duplicate, nodetool::COMMAND_MULTICAST::request::relay_fields()));
+}
@@ -0,0 +1,159 @@
+// Copyright (c) 2019, The Graft Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include <sstream>
+
+#include <gtest/gtest.h>
+
+#include "cryptonote_basic/account.h"
+#include "cryptonote_basic/cryptonote_format_utils.h"
+#include "cryptonote_core/stake_transaction_processor.h"
+#include "graft_rta_config.h"
+#include "ringct/rctOps.h"
+#include "serialization/binary_archive.h"
+#include "string_tools.h"
+
+using namespace cryptonote;
+
+namespace
+{
+
+transaction make_stake_tx(const account_base& supernode, uint64_t amount, uint64_t unlock_time, std::string& supernode_public_id)
+{
+  const account_public_address& address = supernode.get_keys().m_account_address;
+
+  crypto::public_key W;
+  crypto::secret_key w;
+  crypto::generate_keys(W, w);
+  supernode_public_id = epee::string_tools::pod_to_hex(W);
+
+  std::string data = get_account_address_as_str(TESTNET, false, address) + ":" + supernode_public_id;
+  crypto::hash hash;
+  crypto::cn_fast_hash(data.data(), data.size(), hash);
+  crypto::signature sign;
+  crypto::generate_signature(hash, W, w, sign);
+
+  crypto::public_key tx_pub;
+  crypto::secret_key tx_sec;
+  crypto::generate_keys(tx_pub, tx_sec);
+
+  transaction tx;
+  tx.version     = 2;
+  tx.unlock_time = unlock_time;
+
+  txin_to_key in;
+  in.amount   = 0;
+  in.k_image  = crypto::rand<crypto::key_image>();
+  in.key_offsets.push_back(1);
+  tx.vin.push_back(in);
+
+  add_tx_pub_key_to_extra(tx, tx_pub);
+  add_graft_stake_tx_extra_to_extra(tx.extra, supernode_public_id, address, sign);
+  add_graft_tx_secret_key_to_extra(tx.extra, tx_sec);
+
+  crypto::key_derivation derivation;
+  crypto::generate_key_derivation(address.m_view_public_key, tx_sec, derivation);
+  txout_to_key out;
+  crypto::derive_public_key(derivation, 0, address.m_spend_public_key, out.key);
+  tx.vout.push_back(tx_out{0, out});
+
+  crypto::secret_key scalar;
+  crypto::derivation_to_scalar(derivation, 0, scalar);
+
+  rct::ecdhTuple ecdh;
+  ecdh.mask   = rct::skGen();
+  ecdh.amount = rct::d2h(amount);
+
+  rct::ctkey out_pk;
+  out_pk.dest = rct::pk2rct(out.key);
+  rct::addKeys2(out_pk.mask, ecdh.mask, ecdh.amount, rct::H);
+  rct::ecdhEncode(ecdh, rct::sk2rct(scalar));
+
+  tx.rct_signatures.type = rct::RCTTypeBulletproof;
+  tx.rct_signatures.txnFee = 0;
+  tx.rct_signatures.ecdhInfo.push_back(ecdh);
+  tx.rct_signatures.outPk.push_back(out_pk);
+
+  return tx;
+}
+
+//same layout as txs_pruned in the LMDB store: prefix and RCT base, no prunable part
+blobdata pruned_blob(transaction& tx)
+{
+  std::stringstream ss;
+  binary_archive<true> ba(ss);
+  EXPECT_TRUE(tx.serialize_base(ba));
+  return ss.str();
+}
+
+}
+
+TEST(StakeTransactionProcessor, pruned_stake_blobs)
+{
+  const uint64_t block_index = 1000;
+  const uint64_t amount      = config::graft::TIER1_STAKE_AMOUNT;
+  const uint64_t unlock_time = config::graft::STAKE_MIN_UNLOCK_TIME + 10;
+
+  account_base supernode;
+  supernode.generate();
+
+  std::string supernode_public_id;
+  transaction tx = make_stake_tx(supernode, amount, block_index + unlock_time, supernode_public_id);
+
+  StakeTransactionProcessor::prepared_block block;
+  block.block_index     = block_index;
+  block.process_stakes  = true;
+  block.max_unlock_time = config::graft::STAKE_MAX_UNLOCK_TIME;
+  block.tx_blobs.push_back(pruned_blob(tx));
+
+  StakeTransactionProcessor::extract_stake_transactions(TESTNET, block);
+
+  ASSERT_EQ(1u, block.stake_txs.size());
+  const stake_transaction& stake = block.stake_txs.front();
+  EXPECT_EQ(amount, stake.amount);
+  EXPECT_EQ(block_index, stake.block_height);
+  EXPECT_EQ(unlock_time, stake.unlock_time);
+  EXPECT_EQ(supernode_public_id, stake.supernode_public_id);
+  EXPECT_EQ(get_transaction_prefix_hash(tx), stake.hash);
+  EXPECT_TRUE(block.tx_blobs.empty());
+
+    //commitment not matching the encoded amount gives no stake
+
+  tx.rct_signatures.outPk[0].mask = rct::pkGen();
+
+  StakeTransactionProcessor::prepared_block bad_block;
+  bad_block.block_index     = block_index;
+  bad_block.process_stakes  = true;
+  bad_block.max_unlock_time = config::graft::STAKE_MAX_UNLOCK_TIME;
+  bad_block.tx_blobs.push_back(pruned_blob(tx));
+
+  StakeTransactionProcessor::extract_stake_transactions(TESTNET, bad_block);
+
+  EXPECT_TRUE(bad_block.stake_txs.empty());
+}
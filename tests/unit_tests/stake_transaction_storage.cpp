@@ -0,0 +1,166 @@
+// Copyright (c) 2019, The Graft Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include <random>
+
+#include <boost/filesystem.hpp>
+#include <gtest/gtest.h>
+
+#include "cryptonote_core/stake_transaction_storage.h"
+#include "graft_rta_config.h"
+
+using namespace cryptonote;
+
+namespace
+{
+
+void add_block(StakeTransactionStorage& storage, std::mt19937_64& rng, uint64_t block_height)
+{
+  size_t txs_count = rng() % 4;
+
+  for (size_t i=0; i<txs_count; i++)
+  {
+    stake_transaction tx;
+
+    tx.hash                     = crypto::rand<crypto::hash>();
+    tx.amount                   = 1 + rng() % config::graft::TIER4_STAKE_AMOUNT;
+    tx.block_height             = block_height;
+    tx.unlock_time              = config::graft::STAKE_MIN_UNLOCK_TIME + rng() % 300;
+    tx.supernode_public_id      = std::to_string(rng() % 20);
+    tx.supernode_public_address = account_public_address{crypto::rand<crypto::public_key>(), crypto::rand<crypto::public_key>()};
+
+    storage.add_tx(tx);
+  }
+
+  storage.add_last_processed_block(block_height, crypto::rand<crypto::hash>());
+}
+
+void check_stakes(StakeTransactionStorage& storage, uint64_t block_number)
+{
+  storage.update_supernode_stakes(block_number);
+
+  StakeTransactionStorage::supernode_stake_array incremental_stakes = storage.get_supernode_stakes(block_number);
+
+  storage.rebuild_supernode_stakes(block_number);
+
+  const StakeTransactionStorage::supernode_stake_array& full_stakes = storage.get_supernode_stakes(block_number);
+
+  ASSERT_EQ(full_stakes.size(), incremental_stakes.size()) << "block " << block_number;
+
+  for (size_t i=0; i<full_stakes.size(); i++)
+  {
+    const supernode_stake &s1 = full_stakes[i], &s2 = incremental_stakes[i];
+
+    ASSERT_EQ(s1.supernode_public_id, s2.supernode_public_id) << "block " << block_number;
+    ASSERT_EQ(s1.supernode_public_address, s2.supernode_public_address) << "block " << block_number;
+    ASSERT_EQ(s1.amount, s2.amount) << "block " << block_number;
+    ASSERT_EQ(s1.tier, s2.tier) << "block " << block_number;
+    ASSERT_EQ(s1.block_height, s2.block_height) << "block " << block_number;
+    ASSERT_EQ(s1.unlock_time, s2.unlock_time) << "block " << block_number;
+
+    const supernode_stake* found_stake = storage.find_supernode_stake(block_number, s1.supernode_public_id);
+
+    ASSERT_TRUE(found_stake != nullptr);
+    ASSERT_EQ(s1.amount, found_stake->amount);
+  }
+}
+
+}
+
+TEST(stake_transaction_storage, incremental_update_matches_full_rebuild)
+{
+  boost::filesystem::path path = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+  StakeTransactionStorage storage(path.string(), 0);
+  std::mt19937_64 rng;
+
+  const uint64_t blocks_count = 1000;
+
+    //sequential blocks processing
+
+  for (uint64_t block_height=1; block_height<=blocks_count; block_height++)
+  {
+    add_block(storage, rng, block_height);
+    check_stakes(storage, block_height);
+  }
+
+    //random access to history
+
+  for (size_t i=0; i<200; i++)
+    check_stakes(storage, 1 + rng() % blocks_count);
+
+    //rollback and reprocessing of blocks
+
+  for (size_t i=0; i<50; i++)
+    storage.remove_last_processed_block();
+
+  check_stakes(storage, storage.get_last_processed_block_index());
+
+  for (uint64_t block_height=storage.get_last_processed_block_index() + 1; block_height<=blocks_count; block_height++)
+  {
+    add_block(storage, rng, block_height);
+    check_stakes(storage, block_height);
+  }
+}
+
+TEST(stake_transaction_storage, journal_restores_storage)
+{
+  boost::filesystem::path path = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+  std::mt19937_64 rng;
+
+  const uint64_t blocks_count = 2500;
+
+  StakeTransactionStorage storage(path.string(), 0);
+
+  for (uint64_t block_height=1; block_height<=blocks_count; block_height++)
+  {
+    add_block(storage, rng, block_height);
+
+    if (block_height % 100 == 0)
+    {
+      storage.remove_last_processed_block();
+      add_block(storage, rng, block_height);
+    }
+
+    if (block_height % 7 == 0)
+      storage.store();
+  }
+
+  storage.store();
+
+  StakeTransactionStorage loaded_storage(path.string(), 0);
+
+  ASSERT_EQ(storage.get_last_processed_block_index(), loaded_storage.get_last_processed_block_index());
+  ASSERT_EQ(storage.get_last_processed_block_hash(), loaded_storage.get_last_processed_block_hash());
+  ASSERT_EQ(storage.get_tx_count(), loaded_storage.get_tx_count());
+
+  for (size_t i=0; i<storage.get_tx_count(); i++)
+    ASSERT_EQ(storage.get_txs()[i].hash, loaded_storage.get_txs()[i].hash);
+
+  boost::filesystem::remove(path);
+}
@@ -0,0 +1,132 @@
+// Copyright (c) 2019, The Graft Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include <boost/filesystem.hpp>
+#include <gtest/gtest.h>
+
+#include "cryptonote_core/storage_journal.h"
+
+using cryptonote::StorageJournal;
+
+namespace
+{
+
+struct storage_journal : public ::testing::Test
+{
+  storage_journal() : path((boost::filesystem::temp_directory_path() / boost::filesystem::unique_path()).string()) {}
+  ~storage_journal() { boost::filesystem::remove(path); }
+
+  std::string path;
+};
+
+}
+
+TEST_F(storage_journal, load_replays_records_after_last_snapshot)
+{
+  {
+    StorageJournal journal(path, 1, 100);
+    StorageJournal::record_array records;
+
+    ASSERT_FALSE(journal.load(records));
+    ASSERT_TRUE(journal.need_compaction());
+
+    journal.compact("snapshot1");
+    journal.append(StorageJournal::record_type_block, "block1");
+    journal.flush();
+    journal.compact("snapshot2");
+    journal.append(StorageJournal::record_type_block, "block2");
+    journal.append(StorageJournal::record_type_tombstone, "");
+    journal.flush();
+  }
+
+  StorageJournal journal(path, 1, 100);
+  StorageJournal::record_array records;
+
+  ASSERT_TRUE(journal.load(records));
+  ASSERT_EQ(3, records.size());
+  ASSERT_EQ(StorageJournal::record_type_snapshot, records[0].type);
+  ASSERT_EQ("snapshot2", records[0].data);
+  ASSERT_EQ(StorageJournal::record_type_block, records[1].type);
+  ASSERT_EQ("block2", records[1].data);
+  ASSERT_EQ(StorageJournal::record_type_tombstone, records[2].type);
+  ASSERT_FALSE(journal.need_compaction());
+}
+
+TEST_F(storage_journal, corrupted_tail_is_truncated)
+{
+  {
+    StorageJournal journal(path, 1, 100);
+
+    journal.compact("snapshot");
+    journal.append(StorageJournal::record_type_block, "block1");
+    journal.append(StorageJournal::record_type_block, "block2");
+    journal.flush();
+  }
+
+  uint64_t file_size = boost::filesystem::file_size(path);
+
+  boost::filesystem::resize_file(path, file_size - 1);
+
+  {
+    StorageJournal journal(path, 1, 100);
+    StorageJournal::record_array records;
+
+    ASSERT_TRUE(journal.load(records));
+    ASSERT_EQ(2, records.size());
+    ASSERT_EQ("block1", records[1].data);
+
+    journal.append(StorageJournal::record_type_block, "block3");
+    journal.flush();
+  }
+
+  StorageJournal journal(path, 1, 100);
+  StorageJournal::record_array records;
+
+  ASSERT_TRUE(journal.load(records));
+  ASSERT_EQ(3, records.size());
+  ASSERT_EQ("block3", records[2].data);
+}
+
+TEST_F(storage_journal, compaction_threshold_and_format_version)
+{
+  StorageJournal journal(path, 1, 3);
+
+  journal.compact("snapshot");
+  journal.append(StorageJournal::record_type_block, "block1");
+  journal.append(StorageJournal::record_type_block, "block2");
+  ASSERT_FALSE(journal.need_compaction());
+  journal.append(StorageJournal::record_type_block, "block3");
+  ASSERT_TRUE(journal.need_compaction());
+  journal.flush();
+
+  StorageJournal::record_array records;
+  StorageJournal other_version_journal(path, 2, 3);
+
+  ASSERT_FALSE(other_version_journal.load(records));
+}
@@ -0,0 +1,120 @@
+// Copyright (c) 2019, The Graft Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include <gtest/gtest.h>
+
+#include "p2p/supernode_announce_aggregator.h"
+
+using nodetool::supernode_announce_aggregator;
+
+namespace
+{
+
+supernode_announce_aggregator::announce make_announce(const std::string& id, uint64_t height)
+{
+  supernode_announce_aggregator::announce announce;
+
+  announce.supernode_public_id = id;
+  announce.height              = height;
+  announce.signature           = "signature";
+  announce.network_address     = "http://localhost:28690";
+  announce.hop                 = 1;
+
+  return announce;
+}
+
+}
+
+TEST(supernode_announce_aggregator, window)
+{
+  supernode_announce_aggregator aggregator(std::chrono::milliseconds(500), 100, std::chrono::seconds(120));
+  std::vector<supernode_announce_aggregator::entry> batch;
+
+  ASSERT_TRUE(aggregator.add(make_announce("sn1", 10), true, 1000));
+  ASSERT_TRUE(aggregator.add(make_announce("sn2", 10), false, 1200));
+  ASSERT_FALSE(aggregator.flush(1400, batch));
+  ASSERT_TRUE(aggregator.flush(1500, batch));
+  ASSERT_EQ(2, batch.size());
+  ASSERT_EQ("sn1", batch[0].value.supernode_public_id);
+  ASSERT_TRUE(batch[0].relay);
+  ASSERT_FALSE(batch[1].relay);
+  ASSERT_EQ(0, aggregator.size());
+  ASSERT_FALSE(aggregator.flush(5000, batch));
+}
+
+TEST(supernode_announce_aggregator, dedup)
+{
+  supernode_announce_aggregator aggregator(std::chrono::milliseconds(500), 100, std::chrono::seconds(120));
+  std::vector<supernode_announce_aggregator::entry> batch;
+
+  ASSERT_TRUE(aggregator.add(make_announce("sn1", 10), true, 1000));
+  ASSERT_FALSE(aggregator.add(make_announce("sn1", 10), true, 1001));
+  ASSERT_FALSE(aggregator.add(make_announce("sn1", 9), true, 1002));
+  ASSERT_TRUE(aggregator.add(make_announce("sn1", 11), true, 1003));
+  ASSERT_EQ(1, aggregator.size());
+
+  ASSERT_TRUE(aggregator.flush(2000, batch));
+  ASSERT_EQ(1, batch.size());
+  ASSERT_EQ(11, batch[0].value.height);
+
+    //flushed announce is remembered until memory expires
+
+  ASSERT_FALSE(aggregator.add(make_announce("sn1", 11), true, 3000));
+  ASSERT_TRUE(aggregator.add(make_announce("sn1", 12), true, 3000));
+  ASSERT_TRUE(aggregator.flush(4000, batch));
+  ASSERT_TRUE(aggregator.add(make_announce("sn1", 12), true, 4000 + 120 * 1000));
+}
+
+TEST(supernode_announce_aggregator, full_batch)
+{
+  supernode_announce_aggregator aggregator(std::chrono::milliseconds(500), 3, std::chrono::seconds(120));
+  std::vector<supernode_announce_aggregator::entry> batch;
+
+  for (size_t i=0; i<3; i++)
+    ASSERT_TRUE(aggregator.add(make_announce("sn" + std::to_string(i), 10), true, 1000));
+
+  ASSERT_TRUE(aggregator.flush(1000, batch));
+  ASSERT_EQ(3, batch.size());
+}
+
+TEST(token_bucket, rate)
+{
+  nodetool::token_bucket bucket(10, 5);
+
+  for (size_t i=0; i<5; i++)
+    ASSERT_TRUE(bucket.consume(1000));
+  ASSERT_FALSE(bucket.consume(1000));
+
+  ASSERT_FALSE(bucket.consume(1050));
+  ASSERT_TRUE(bucket.consume(1100));
+  ASSERT_FALSE(bucket.consume(1100));
+
+  ASSERT_TRUE(bucket.consume(100000, 5));
+  ASSERT_FALSE(bucket.consume(100000));
+}
@@ -0,0 +1,308 @@
+// Copyright (c) 2019, The Graft Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include <gtest/gtest.h>
+
+#include <boost/asio.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+
+#include "p2p/supernode_delivery_queue.h"
+
+namespace
+{
+  using nodetool::supernode_delivery_queue;
+
+  /// Keep-alive HTTP server which records request bodies and holds responses until released
+  class test_http_server
+  {
+  public:
+    test_http_server()
+      : m_acceptor(m_io, boost::asio::ip::tcp::endpoint(boost::asio::ip::address_v4::loopback(), 0))
+      , m_released(true), m_stopped(false), m_connections(0)
+    {
+      m_thread = boost::thread([this]() { run(); });
+    }
+
+    ~test_http_server()
+    {
+      {
+        boost::lock_guard<boost::mutex> lock(m_lock);
+        m_stopped = true;
+        m_released = true;
+      }
+      m_cond.notify_all();
+        //wake the blocking accept
+      boost::system::error_code ec;
+      boost::asio::ip::tcp::socket socket(m_io);
+      socket.connect(m_acceptor.local_endpoint(), ec);
+      m_thread.join();
+    }
+
+    uint16_t port() const { return m_acceptor.local_endpoint().port(); }
+
+    void hold()
+    {
+      boost::lock_guard<boost::mutex> lock(m_lock);
+      m_released = false;
+    }
+
+    void release()
+    {
+      {
+        boost::lock_guard<boost::mutex> lock(m_lock);
+        m_released = true;
+      }
+      m_cond.notify_all();
+    }
+
+    bool wait_requests(size_t count)
+    {
+      boost::unique_lock<boost::mutex> lock(m_lock);
+      return m_cond.wait_for(lock, boost::chrono::seconds(10), [&]() { return m_bodies.size() >= count; });
+    }
+
+    std::vector<std::string> bodies() const
+    {
+      boost::lock_guard<boost::mutex> lock(m_lock);
+      return m_bodies;
+    }
+
+    size_t connections() const
+    {
+      boost::lock_guard<boost::mutex> lock(m_lock);
+      return m_connections;
+    }
+
+  private:
+    void run()
+    {
+      for (;;)
+      {
+        boost::asio::ip::tcp::socket socket(m_io);
+        boost::system::error_code ec;
+        m_acceptor.accept(socket, ec);
+
+        {
+          boost::lock_guard<boost::mutex> lock(m_lock);
+          if (m_stopped)
+            return;
+          m_connections++;
+        }
+
+        serve(socket);
+      }
+    }
+
+    void serve(boost::asio::ip::tcp::socket& socket)
+    {
+      boost::asio::streambuf buffer;
+      boost::system::error_code ec;
+
+      for (;;)
+      {
+        size_t header_size = boost::asio::read_until(socket, buffer, "\r\n\r\n", ec);
+        if (ec)
+          return;
+
+        std::string header(boost::asio::buffers_begin(buffer.data()), boost::asio::buffers_begin(buffer.data()) + header_size);
+        buffer.consume(header_size);
+
+        size_t content_length = 0;
+        size_t pos = header.find("Content-Length:");
+        if (pos != std::string::npos)
+          content_length = std::stoul(header.substr(pos + 15));
+
+        if (buffer.size() < content_length)
+          boost::asio::read(socket, buffer, boost::asio::transfer_exactly(content_length - buffer.size()), ec);
+        if (ec)
+          return;
+
+        std::string body(boost::asio::buffers_begin(buffer.data()), boost::asio::buffers_begin(buffer.data()) + content_length);
+        buffer.consume(content_length);
+
+        {
+          boost::unique_lock<boost::mutex> lock(m_lock);
+          m_bodies.push_back(body);
+          m_cond.notify_all();
+          while (!m_released)
+            m_cond.wait(lock);
+        }
+
+        static const std::string response = "HTTP/1.1 200 OK\r\nContent-Length: 0\r\nConnection: keep-alive\r\n\r\n";
+        boost::asio::write(socket, boost::asio::buffer(response), ec);
+        if (ec)
+          return;
+      }
+    }
+
+    boost::asio::io_service m_io;
+    boost::asio::ip::tcp::acceptor m_acceptor;
+    mutable boost::mutex m_lock;
+    boost::condition_variable m_cond;
+    std::vector<std::string> m_bodies;
+    bool m_released;
+    bool m_stopped;
+    size_t m_connections;
+    boost::thread m_thread;
+  };
+
+  template <class Predicate>
+  bool wait_for_stats(const supernode_delivery_queue& queue, Predicate predicate)
+  {
+    for (size_t i=0; i<1000; i++)
+    {
+      if (predicate(queue.get_stats()))
+        return true;
+      boost::this_thread::sleep_for(boost::chrono::milliseconds(10));
+    }
+    return false;
+  }
+
+  const std::chrono::milliseconds TIMEOUT(5000);
+}
+
+TEST(supernode_delivery_queue, delivers_over_one_connection)
+{
+  test_http_server server;
+  {
+    supernode_delivery_queue queue("127.0.0.1", server.port(), 10, supernode_delivery_queue::drop_oldest, 1, TIMEOUT);
+
+    for (int i=0; i<5; i++)
+      ASSERT_TRUE(queue.push("/rpc", std::to_string(i)));
+
+    ASSERT_TRUE(wait_for_stats(queue, [](const supernode_delivery_queue::stats& s) { return s.delivered == 5; }));
+
+    supernode_delivery_queue::stats stats = queue.get_stats();
+    ASSERT_EQ(stats.depth, 0);
+    ASSERT_EQ(stats.queued, 5);
+    ASSERT_EQ(stats.posts, 5);
+    ASSERT_EQ(stats.failed, 0);
+    ASSERT_EQ(stats.dropped, 0);
+    ASSERT_GE(stats.max_latency_ms, stats.avg_latency_ms);
+  }
+
+  ASSERT_EQ(server.bodies(), std::vector<std::string>({"0", "1", "2", "3", "4"}));
+  ASSERT_EQ(server.connections(), 1);
+}
+
+TEST(supernode_delivery_queue, drop_oldest)
+{
+  test_http_server server;
+  server.hold();
+  {
+    supernode_delivery_queue queue("127.0.0.1", server.port(), 2, supernode_delivery_queue::drop_oldest, 1, TIMEOUT);
+
+      //the first message is in flight, the next ones wait in the queue
+
+    ASSERT_TRUE(queue.push("/rpc", "1"));
+    ASSERT_TRUE(server.wait_requests(1));
+    ASSERT_TRUE(queue.push("/rpc", "2"));
+    ASSERT_TRUE(queue.push("/rpc", "3"));
+    ASSERT_TRUE(queue.push("/rpc", "4"));
+
+    supernode_delivery_queue::stats stats = queue.get_stats();
+    ASSERT_EQ(stats.depth, 2);
+    ASSERT_EQ(stats.queued, 4);
+    ASSERT_EQ(stats.dropped, 1);
+
+    server.release();
+    ASSERT_TRUE(wait_for_stats(queue, [](const supernode_delivery_queue::stats& s) { return s.delivered == 3; }));
+  }
+
+  ASSERT_EQ(server.bodies(), std::vector<std::string>({"1", "3", "4"}));
+}
+
+TEST(supernode_delivery_queue, drop_newest)
+{
+  test_http_server server;
+  server.hold();
+  {
+    supernode_delivery_queue queue("127.0.0.1", server.port(), 2, supernode_delivery_queue::drop_newest, 1, TIMEOUT);
+
+    ASSERT_TRUE(queue.push("/rpc", "1"));
+    ASSERT_TRUE(server.wait_requests(1));
+    ASSERT_TRUE(queue.push("/rpc", "2"));
+    ASSERT_TRUE(queue.push("/rpc", "3"));
+    ASSERT_FALSE(queue.push("/rpc", "4"));
+
+    supernode_delivery_queue::stats stats = queue.get_stats();
+    ASSERT_EQ(stats.depth, 2);
+    ASSERT_EQ(stats.queued, 3);
+    ASSERT_EQ(stats.dropped, 1);
+
+    server.release();
+    ASSERT_TRUE(wait_for_stats(queue, [](const supernode_delivery_queue::stats& s) { return s.delivered == 3; }));
+  }
+
+  ASSERT_EQ(server.bodies(), std::vector<std::string>({"1", "2", "3"}));
+}
+
+TEST(supernode_delivery_queue, batches_json_for_same_uri)
+{
+  test_http_server server;
+  server.hold();
+  {
+    supernode_delivery_queue queue("127.0.0.1", server.port(), 10, supernode_delivery_queue::drop_oldest, 10, TIMEOUT);
+
+    ASSERT_TRUE(queue.push("/rpc", "{\"a\":1}"));
+    ASSERT_TRUE(server.wait_requests(1));
+    ASSERT_TRUE(queue.push("/rpc", "{\"b\":2}"));
+    ASSERT_TRUE(queue.push("/rpc", "{\"c\":3}"));
+    ASSERT_TRUE(queue.push("/rpc", "bin", supernode_delivery_queue::binary));
+
+    server.release();
+    ASSERT_TRUE(wait_for_stats(queue, [](const supernode_delivery_queue::stats& s) { return s.delivered == 4; }));
+    ASSERT_EQ(queue.get_stats().posts, 3);
+  }
+
+  ASSERT_EQ(server.bodies(), std::vector<std::string>({"{\"a\":1}", "[{\"b\":2},{\"c\":3}]", "bin"}));
+}
+
+TEST(supernode_delivery_queue, counts_failed_posts)
+{
+  uint16_t port;
+  {
+      //reserve a port nobody listens on
+    boost::asio::io_service io;
+    boost::asio::ip::tcp::acceptor acceptor(io, boost::asio::ip::tcp::endpoint(boost::asio::ip::address_v4::loopback(), 0));
+    port = acceptor.local_endpoint().port();
+  }
+
+  supernode_delivery_queue queue("127.0.0.1", port, 10, supernode_delivery_queue::drop_oldest, 1, TIMEOUT);
+
+  ASSERT_TRUE(queue.push("/rpc", "1"));
+  ASSERT_TRUE(wait_for_stats(queue, [](const supernode_delivery_queue::stats& s) { return s.failed == 1; }));
+
+  supernode_delivery_queue::stats stats = queue.get_stats();
+  ASSERT_EQ(stats.delivered, 0);
+  ASSERT_EQ(stats.posts, 1);
+  ASSERT_EQ(stats.depth, 0);
+}
@@ -0,0 +1,153 @@
+// Copyright (c) 2019, The Graft Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <gtest/gtest.h>
+
+#include "crypto/crypto.h"
+#include "p2p/supernode_list_encoder.h"
+
+using namespace cryptonote;
+
+namespace
+{
+
+supernode_stake make_stake(const std::string& id, uint64_t amount)
+{
+  supernode_stake stake;
+
+  stake.amount                   = amount;
+  stake.tier                     = 0;
+  stake.block_height             = 1;
+  stake.unlock_time              = 100;
+  stake.supernode_public_id      = id;
+  stake.supernode_public_address = account_public_address{crypto::rand<crypto::public_key>(), crypto::rand<crypto::public_key>()};
+
+  return stake;
+}
+
+BlockchainBasedList::supernode make_supernode(const supernode_stake& stake)
+{
+  BlockchainBasedList::supernode supernode;
+
+  supernode.supernode_public_id      = stake.supernode_public_id;
+  supernode.supernode_public_address = stake.supernode_public_address;
+  supernode.amount                   = stake.amount;
+  supernode.block_height             = stake.block_height;
+  supernode.unlock_time              = stake.unlock_time;
+
+  return supernode;
+}
+
+}
+
+TEST(supernode_list_encoder, stakes_delta)
+{
+  nodetool::supernode_list_encoder encoder;
+  nodetool::supernode_list_encoder::stakes_update delta, snapshot;
+
+  std::vector<supernode_stake> stakes = {make_stake("a", 1), make_stake("b", 2), make_stake("c", 3)};
+
+  encoder.update_stakes(10, stakes, delta);
+
+  ASSERT_EQ(delta.sequence, 1u);
+  ASSERT_FALSE(delta.snapshot);
+  ASSERT_EQ(delta.stakes.size(), 3u);
+  ASSERT_TRUE(delta.removed_supernodes.empty());
+  ASSERT_EQ(encoder.get_stakes().stakes[1].supernode_public_address, get_account_address_as_str(MAINNET, false, stakes[1].supernode_public_address));
+
+  stakes[1].amount = 5;
+  stakes.erase(stakes.begin());
+  stakes.push_back(make_stake("d", 4));
+
+  encoder.update_stakes(11, stakes, delta);
+
+  ASSERT_EQ(delta.sequence, 2u);
+  ASSERT_EQ(delta.block_height, 11u);
+  ASSERT_EQ(delta.stakes.size(), 2u);
+  ASSERT_EQ(delta.stakes[0].supernode_public_id, "b");
+  ASSERT_EQ(delta.stakes[0].amount, 5u);
+  ASSERT_EQ(delta.stakes[1].supernode_public_id, "d");
+  ASSERT_EQ(delta.removed_supernodes, std::vector<std::string>{"a"});
+
+  encoder.update_stakes(12, stakes, delta);
+
+  ASSERT_EQ(delta.sequence, 3u);
+  ASSERT_TRUE(delta.stakes.empty());
+  ASSERT_TRUE(delta.removed_supernodes.empty());
+
+  encoder.get_stakes_snapshot(snapshot);
+
+  ASSERT_TRUE(snapshot.snapshot);
+  ASSERT_EQ(snapshot.sequence, 3u);
+  ASSERT_EQ(snapshot.block_height, 12u);
+  ASSERT_EQ(snapshot.stakes.size(), 3u);
+  ASSERT_EQ(encoder.get_stakes().stakes.size(), 3u);
+}
+
+TEST(supernode_list_encoder, blockchain_based_list_delta)
+{
+  nodetool::supernode_list_encoder encoder;
+  nodetool::supernode_list_encoder::blockchain_based_list_update delta, snapshot;
+
+  supernode_stake stakes[] = {make_stake("a", 1), make_stake("b", 2), make_stake("c", 3), make_stake("d", 4)};
+
+  BlockchainBasedList::supernode_tier_array tiers(2);
+
+  tiers[0] = {make_supernode(stakes[0]), make_supernode(stakes[1]), make_supernode(stakes[2])};
+  tiers[1] = {make_supernode(stakes[3])};
+
+  encoder.update_blockchain_based_list(10, tiers, delta);
+
+  ASSERT_EQ(delta.sequence, 1u);
+  ASSERT_EQ(delta.tiers.size(), 2u);
+  ASSERT_EQ(delta.tiers[0].positions, (std::vector<uint32_t>{0, 1, 2}));
+  ASSERT_EQ(delta.tiers[0].supernodes.size(), 3u);
+
+    //reorder, drop "a", add "d" to the first tier
+
+  tiers[0] = {make_supernode(stakes[2]), make_supernode(stakes[3]), make_supernode(stakes[1])};
+  tiers[1].clear();
+
+  encoder.update_blockchain_based_list(11, tiers, delta);
+
+  ASSERT_EQ(delta.sequence, 2u);
+  ASSERT_EQ(delta.tiers[0].positions, (std::vector<uint32_t>{2, 3, 1}));
+  ASSERT_EQ(delta.tiers[0].supernodes.size(), 1u);
+  ASSERT_EQ(delta.tiers[0].supernodes[0].supernode_public_id, "d");
+  ASSERT_TRUE(delta.tiers[1].positions.empty());
+  ASSERT_TRUE(delta.tiers[1].supernodes.empty());
+
+  encoder.get_blockchain_based_list_snapshot(snapshot);
+
+  ASSERT_TRUE(snapshot.snapshot);
+  ASSERT_EQ(snapshot.sequence, 2u);
+  ASSERT_EQ(snapshot.tiers.size(), 2u);
+  ASSERT_TRUE(snapshot.tiers[0].positions.empty());
+  ASSERT_EQ(snapshot.tiers[0].supernodes.size(), 3u);
+  ASSERT_EQ(snapshot.tiers[0].supernodes[1].supernode_public_id, "d");
+}
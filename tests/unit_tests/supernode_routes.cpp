@@ -0,0 +1,162 @@
+// Copyright (c) 2019, The Graft Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include <gtest/gtest.h>
+
+#include "p2p/supernode_routes.h"
+
+using nodetool::supernode_routes;
+using nodetool::supernode_route_table;
+using nodetool::supernode_route_table_ptr;
+
+namespace
+{
+
+nodetool::peerlist_entry make_peer(uint64_t id)
+{
+  nodetool::peerlist_entry pe = AUTO_VAL_INIT(pe);
+  pe.id = id;
+  return pe;
+}
+
+boost::uuids::uuid make_connection(uint8_t n)
+{
+  boost::uuids::uuid id = boost::uuids::uuid();
+  id.data[0] = n;
+  return id;
+}
+
+const supernode_route_table::tunnel* find_tunnel(const supernode_route_table& table, const std::string& id, uint64_t peer_id)
+{
+  auto it = table.routes.find(id);
+  if (it == table.routes.end())
+    return nullptr;
+  for (size_t index : it->second.tunnels)
+    if (table.tunnels[index].peer.id == peer_id)
+      return &table.tunnels[index];
+  return nullptr;
+}
+
+}
+
+TEST(supernode_routes, readers_see_published_table)
+{
+  supernode_routes routes;
+  routes.on_connection(1, make_connection(1));
+  routes.on_connection(2, make_connection(2));
+  routes.publish();
+
+  supernode_route_table_ptr before = routes.get();
+  ASSERT_TRUE(before->routes.empty());
+
+  ASSERT_TRUE(routes.update("sn1", 10, 1, make_peer(1), 1000));
+  // repeat of the current announce through another peer only adds a tunnel
+  ASSERT_FALSE(routes.update("sn1", 10, 3, make_peer(2), 1010));
+  ASSERT_FALSE(routes.update("sn1", 10, 2, make_peer(2), 1020));
+  ASSERT_TRUE(routes.update("sn2", 10, 2, make_peer(2), 1000));
+
+  // nothing is visible until published
+  ASSERT_EQ(routes.get(), before);
+  routes.publish();
+  supernode_route_table_ptr table = routes.get();
+  ASSERT_NE(table, before);
+  ASSERT_GT(table->version, before->version);
+  ASSERT_TRUE(before->routes.empty());
+
+  ASSERT_EQ(table->routes.size(), 2);
+  ASSERT_EQ(table->tunnels.size(), 2); // peer 2 is stored once for both routes
+  ASSERT_EQ(table->routes.at("sn1").tunnels.size(), 2);
+  ASSERT_EQ(table->routes.at("sn1").max_hop, 3);
+  ASSERT_EQ(table->max_hop, 3);
+
+  const supernode_route_table::tunnel* tunnel = find_tunnel(*table, "sn2", 2);
+  ASSERT_TRUE(tunnel != nullptr);
+  ASSERT_TRUE(tunnel->connected);
+  ASSERT_EQ(tunnel->connection_id, make_connection(2));
+
+  // publishing without changes keeps the table
+  routes.publish();
+  ASSERT_EQ(routes.get(), table);
+}
+
+TEST(supernode_routes, new_announce_restarts_route)
+{
+  supernode_routes routes;
+  ASSERT_TRUE(routes.update("sn1", 10, 1, make_peer(1), 1000));
+  ASSERT_FALSE(routes.update("sn1", 10, 1, make_peer(2), 1000));
+  // same height after the announce expired, and a new height, both start over with the sending peer
+  ASSERT_TRUE(routes.update("sn1", 10, 4, make_peer(3), 1000 + DIFFICULTY_TARGET_V2));
+  ASSERT_TRUE(routes.update("sn1", 11, 2, make_peer(2), 1000 + DIFFICULTY_TARGET_V2));
+  routes.publish();
+
+  supernode_route_table_ptr table = routes.get();
+  ASSERT_EQ(table->routes.size(), 1);
+  ASSERT_EQ(table->routes.at("sn1").tunnels.size(), 1);
+  ASSERT_EQ(table->routes.at("sn1").last_announce_height, 11);
+  ASSERT_EQ(table->routes.at("sn1").max_hop, 2);
+  ASSERT_TRUE(find_tunnel(*table, "sn1", 2) != nullptr);
+  ASSERT_FALSE(find_tunnel(*table, "sn1", 2)->connected);
+}
+
+TEST(supernode_routes, connection_changes)
+{
+  supernode_routes routes;
+  routes.update("sn1", 10, 1, make_peer(1), 1000);
+  routes.update("sn1", 10, 1, make_peer(2), 1000);
+  routes.on_connection(1, make_connection(1));
+  routes.on_connection(2, make_connection(2));
+  routes.publish();
+  supernode_route_table_ptr connected = routes.get();
+  ASSERT_TRUE(find_tunnel(*connected, "sn1", 1)->connected);
+  ASSERT_TRUE(find_tunnel(*connected, "sn1", 2)->connected);
+
+  // closing an unknown connection of the peer changes nothing
+  routes.on_connection_close(1, make_connection(9));
+  routes.publish();
+  ASSERT_EQ(routes.get(), connected);
+
+  routes.on_connection_close(1, make_connection(1));
+  routes.publish();
+  supernode_route_table_ptr table = routes.get();
+  ASSERT_FALSE(find_tunnel(*table, "sn1", 1)->connected);
+  ASSERT_TRUE(find_tunnel(*table, "sn1", 2)->connected);
+  // a reader holding the old table still sees it unchanged
+  ASSERT_TRUE(find_tunnel(*connected, "sn1", 1)->connected);
+
+  // the peer reconnects on another connection, while the second one is closed
+  routes.on_connection(1, make_connection(3));
+  routes.on_connection(2, make_connection(4));
+  routes.on_connection_close(2, make_connection(2));
+  routes.publish();
+  table = routes.get();
+  ASSERT_TRUE(find_tunnel(*table, "sn1", 1)->connected);
+  ASSERT_EQ(find_tunnel(*table, "sn1", 1)->connection_id, make_connection(3));
+  ASSERT_TRUE(find_tunnel(*table, "sn1", 2)->connected);
+  ASSERT_EQ(find_tunnel(*table, "sn1", 2)->connection_id, make_connection(4));
+}
@@ -49,6 +49,25 @@ TEST(threadpool, wait_waits)
   ASSERT_TRUE(b);
 }
 
+TEST(threadpool, wait_runs_own_tasks)
+{
+  // no pool threads, queued tasks only run from wait
+  std::shared_ptr<tools::threadpool> tpool(tools::threadpool::getNewForUnitTests(1));
+  tools::threadpool::waiter mine, other;
+
+  std::atomic<unsigned int> ran_mine(0), ran_other(0);
+  for (size_t n = 0; n < 16; ++n)
+  {
+    tpool->submit(&other, [&ran_other](){++ran_other;});
+    tpool->submit(&mine, [&ran_mine](){++ran_mine;});
+  }
+  mine.wait(tpool.get());
+  ASSERT_EQ(ran_mine, 16);
+  ASSERT_EQ(ran_other, 0);
+  other.wait(tpool.get());
+  ASSERT_EQ(ran_other, 16);
+}
+
 TEST(threadpool, one_thread)
 {
   std::shared_ptr<tools::threadpool> tpool(tools::threadpool::getNewForUnitTests(1));
@@ -0,0 +1,84 @@
+// Copyright (c) 2019, The Graft Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include <gtest/gtest.h>
+
+#include "p2p/tunnel_metrics.h"
+
+TEST(tunnel_metrics, prefers_low_latency)
+{
+  nodetool::tunnel_metrics metrics(std::chrono::minutes(5), 500);
+
+  ASSERT_DOUBLE_EQ(metrics.get_score(1, 0), metrics.get_score(2, 0));
+
+  for (size_t i=0; i<10; i++)
+  {
+    metrics.on_latency(1, 20, 1000);
+    metrics.on_latency(2, 200, 1000);
+  }
+
+  ASSERT_LT(metrics.get_score(1, 1000), metrics.get_score(2, 1000));
+  ASSERT_LT(metrics.get_score(2, 1000), metrics.get_score(3, 1000));
+  ASSERT_NEAR(20, metrics.get_stats(1, 1000).latency_ms, 50);
+}
+
+TEST(tunnel_metrics, failures_penalized)
+{
+  nodetool::tunnel_metrics metrics(std::chrono::minutes(5), 500);
+
+  for (size_t i=0; i<10; i++)
+  {
+    metrics.on_latency(1, 20, 1000);
+    metrics.on_latency(2, 20, 1000);
+    metrics.on_delivery(1, true, 1000);
+    metrics.on_delivery(2, false, 1000);
+  }
+
+  ASSERT_LT(metrics.get_score(1, 1000), metrics.get_score(2, 1000));
+  ASSERT_DOUBLE_EQ(10, metrics.get_stats(1, 1000).delivered);
+  ASSERT_DOUBLE_EQ(10, metrics.get_stats(2, 1000).failed);
+}
+
+TEST(tunnel_metrics, stale_scores_decay)
+{
+  nodetool::tunnel_metrics metrics(std::chrono::seconds(10), 500);
+
+  for (size_t i=0; i<10; i++)
+    metrics.on_delivery(1, false, 0);
+  metrics.on_latency(1, 5000, 0);
+
+  const double fresh = metrics.get_score(1, 0);
+
+  ASSERT_NEAR(5, metrics.get_stats(1, 10 * 1000).failed, 1e-9);
+  ASSERT_LT(metrics.get_score(1, 10 * 1000), fresh);
+  ASSERT_NEAR(metrics.get_score(2, 0), metrics.get_score(1, 600 * 1000), 1e-3);
+
+  metrics.remove(1);
+  ASSERT_DOUBLE_EQ(metrics.get_score(2, 0), metrics.get_score(1, 0));
+}